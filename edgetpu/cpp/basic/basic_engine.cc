@@ -95,4 +95,13 @@ float BasicEngine::get_inference_time() const {
       << engine_->get_error_message();
   return time;
 }
+
+InferenceStats BasicEngine::get_inference_stats() const {
+  InferenceStats stats;
+  LOG_IF(FATAL, engine_->get_inference_stats(&stats) == kEdgeTpuApiError)
+      << engine_->get_error_message();
+  return stats;
+}
+
+void BasicEngine::ResetInferenceStats() { engine_->ResetInferenceStats(); }
 }  // namespace coral
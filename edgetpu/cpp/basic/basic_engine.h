@@ -42,6 +42,11 @@ class BasicEngine {
   std::vector<int> get_all_output_tensors_sizes() const;
   // Gets time consumed for last inference (milliseconds).
   float get_inference_time() const;
+  // Gets stats of all inferences since the engine was created or the stats
+  // were reset, broken down into input copy, Invoke() and output conversion.
+  // EdgeTpuResourceManager::GetInferenceStats() has those of a whole Edge TPU.
+  InferenceStats get_inference_stats() const;
+  void ResetInferenceStats();
 
  private:
   std::unique_ptr<BasicEngineNative> engine_;
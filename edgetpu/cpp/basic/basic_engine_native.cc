@@ -2,6 +2,7 @@
 
 #include <sys/stat.h>
 
+#include <array>
 #include <chrono>  // NOLINT(build/c++11)
 #include <numeric>
 #include <vector>
@@ -9,6 +10,7 @@
 #include "absl/memory/memory.h"
 #include "edgetpu.h"
 #include "edgetpu/cpp/basic/inference_utils.h"
+#include "edgetpu/cpp/tracing.h"
 #include "tensorflow/lite/kernels/register.h"
 
 namespace coral {
@@ -43,6 +45,7 @@ BasicEngineNative::~BasicEngineNative() {
 
 EdgeTpuApiStatus BasicEngineNative::BuildModelFromFile(
     const std::string& model_path) {
+  CORAL_TRACE_SPAN("BuildModelFromFile");
   model_path_ = model_path;
   model_ = tflite::FlatBufferModel::BuildFromFile(model_path_.c_str(),
                                                   error_reporter_.get());
@@ -71,7 +74,7 @@ EdgeTpuApiStatus BasicEngineNative::CreateInterpreterWithResolver(
   // Build interpreter.
   interpreter_ = BuildEdgeTpuInterpreter(
       *model_, resolver == nullptr ? &new_resolver : resolver,
-      edgetpu_resource_->context(), error_reporter_.get());
+      edgetpu_resource_->context(), error_reporter_.get(), model_path_);
 
   EDGETPU_API_ENSURE(interpreter_);
   return kEdgeTpuApiOk;
@@ -106,9 +109,9 @@ EdgeTpuApiStatus BasicEngineNative::InitializeInputAndOutput() {
 
 EdgeTpuApiStatus BasicEngineNative::Init(
     std::unique_ptr<tflite::FlatBufferModel> model,
-    BuiltinOpResolver* resolver) {
+    BuiltinOpResolver* resolver, const std::string& device_path) {
   model_ = std::move(model);
-  EDGETPU_API_ENSURE_STATUS(InitializeEdgeTpuResource(""));
+  EDGETPU_API_ENSURE_STATUS(InitializeEdgeTpuResource(device_path));
   EDGETPU_API_ENSURE_STATUS(CreateInterpreterWithResolver(resolver));
   EDGETPU_API_ENSURE_STATUS(InitializeInputAndOutput());
   is_initialized_ = true;
@@ -130,13 +133,19 @@ EdgeTpuApiStatus BasicEngineNative::RunInference(const uint8_t* const input,
                                                  float const** const output,
                                                  int* const out_size) {
   BASIC_ENGINE_INIT_CHECK();
-  const auto& start_time = std::chrono::steady_clock::now();
+  const auto start_time = std::chrono::steady_clock::now();
   // Assign input data and invoke.
   uint8_t* input_tensor_ptr = interpreter_->typed_input_tensor<uint8_t>(0);
   BASIC_ENGINE_NATIVE_ENSURE(input_tensor_ptr,
                              "typed_input_tensor returns nullptr!");
   std::memcpy(input_tensor_ptr, input, in_size);
-  EDGETPU_API_ENSURE(interpreter_->Invoke() == kTfLiteOk);
+  const auto invoke_start_time = std::chrono::steady_clock::now();
+  if (interpreter_->Invoke() != kTfLiteOk) {
+    stats_recorder_.RecordFailure();
+    edgetpu_resource_->stats_recorder()->RecordFailure();
+    return kEdgeTpuApiError;
+  }
+  const auto invoke_end_time = std::chrono::steady_clock::now();
   // Parse results.
   const auto& output_indices = interpreter_->outputs();
   const int num_outputs = output_indices.size();
@@ -182,12 +191,37 @@ EdgeTpuApiStatus BasicEngineNative::RunInference(const uint8_t* const input,
                              "Abnormal output size!");
   (*out_size) = inference_result_.size();
   (*output) = inference_result_.data();
-  std::chrono::duration<double, std::milli> time_span =
-      std::chrono::steady_clock::now() - start_time;
+  const auto end_time = std::chrono::steady_clock::now();
+  std::chrono::duration<double, std::milli> time_span = end_time - start_time;
   inference_time_ = time_span.count();
+  RecordInferenceStats(in_size, output_array_size_ * sizeof(float),
+                       {start_time, invoke_start_time, invoke_end_time,
+                        end_time});
+  if (IsTracingEnabled()) {
+    AddTraceSpan("RunInference", start_time, end_time);
+    AddTraceSpan("InputCopy", start_time, invoke_start_time);
+    AddTraceSpan("Invoke", invoke_start_time, invoke_end_time);
+    AddTraceSpan("OutputConversion", invoke_end_time, end_time);
+  }
   return kEdgeTpuApiOk;
 }
 
+void BasicEngineNative::RecordInferenceStats(
+    int input_bytes, int output_bytes,
+    const std::array<std::chrono::steady_clock::time_point, 4>& times) {
+  const auto ns = [](std::chrono::steady_clock::duration duration) {
+    return static_cast<int64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration)
+            .count());
+  };
+  for (InferenceStatsRecorder* recorder :
+       {&stats_recorder_, edgetpu_resource_->stats_recorder()}) {
+    recorder->RecordInference(ns(times[1] - times[0]), ns(times[2] - times[1]),
+                              ns(times[3] - times[2]), ns(times[3] - times[0]),
+                              input_bytes, output_bytes);
+  }
+}
+
 EdgeTpuApiStatus BasicEngineNative::get_input_tensor_shape(
     int const** const dims, int* const dims_num) const {
   BASIC_ENGINE_INIT_CHECK();
@@ -263,6 +297,15 @@ EdgeTpuApiStatus BasicEngineNative::get_inference_time(
   return kEdgeTpuApiOk;
 }
 
+EdgeTpuApiStatus BasicEngineNative::get_inference_stats(
+    InferenceStats* const stats) const {
+  BASIC_ENGINE_INIT_CHECK();
+  (*stats) = stats_recorder_.Get();
+  return kEdgeTpuApiOk;
+}
+
+void BasicEngineNative::ResetInferenceStats() { stats_recorder_.Reset(); }
+
 std::string BasicEngineNative::get_error_message() {
   return error_reporter_->message();
 }
@@ -288,6 +331,14 @@ BasicEngineNativeBuilder::BasicEngineNativeBuilder(
   error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
 }
 
+BasicEngineNativeBuilder::BasicEngineNativeBuilder(
+    std::unique_ptr<tflite::FlatBufferModel> model,
+    const std::string& device_path)
+    : device_path_(device_path), model_(std::move(model)), resolver_(nullptr) {
+  read_from_file_ = false;
+  error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
+}
+
 BasicEngineNativeBuilder::BasicEngineNativeBuilder(
     std::unique_ptr<tflite::FlatBufferModel> model,
     std::unique_ptr<BuiltinOpResolver> resolver)
@@ -311,7 +362,8 @@ EdgeTpuApiStatus BasicEngineNativeBuilder::operator()(
     EDGETPU_API_REPORT_ERROR(error_reporter_, !model_, "model_ is nullptr!");
     EDGETPU_API_REPORT_ERROR(
         error_reporter_,
-        (*engine)->Init(std::move(model_), resolver_.get()) != kEdgeTpuApiOk,
+        (*engine)->Init(std::move(model_), resolver_.get(), device_path_) !=
+            kEdgeTpuApiOk,
         (*engine)->get_error_message());
   }
   return kEdgeTpuApiOk;
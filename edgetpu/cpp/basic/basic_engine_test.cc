@@ -51,6 +51,40 @@ TEST(BasicEngineTest, TestDebugFunctionsOnSsdModel) {
   EXPECT_THAT(output_tensor_sizes, ElementsAre(80, 20, 20, 1));
 }
 
+TEST(BasicEngineTest, InferenceStats) {
+  BasicEngine engine(ModelPath("mobilenet_v1_1.0_224_quant_edgetpu.tflite"));
+  EdgeTpuResourceManager::GetSingleton()->ResetInferenceStats();
+  const auto input = GetRandomInput(engine.get_input_tensor_shape());
+  for (int i = 0; i < 10; ++i) engine.RunInference(input);
+
+  const InferenceStats stats = engine.get_inference_stats();
+  EXPECT_EQ(10, stats.num_inferences);
+  EXPECT_EQ(0, stats.num_failures);
+  EXPECT_EQ(10 * 224 * 224 * 3, stats.input_bytes);
+  EXPECT_EQ(10 * 1001 * sizeof(float), stats.output_bytes);
+  EXPECT_GT(stats.invoke.p50_us, 0);
+  EXPECT_LE(stats.invoke.p50_us, stats.invoke.max_us);
+  EXPECT_LE(stats.invoke.max_us, stats.total.max_us);
+  EXPECT_NEAR(stats.total.mean_us,
+              stats.input_copy.mean_us + stats.invoke.mean_us +
+                  stats.output_conversion.mean_us,
+              0.01 * stats.total.mean_us);
+
+  InferenceStats device_stats;
+  ASSERT_EQ(kEdgeTpuApiOk,
+            EdgeTpuResourceManager::GetSingleton()->GetInferenceStats(
+                engine.device_path(), &device_stats));
+  EXPECT_EQ(10, device_stats.num_inferences);
+
+  engine.ResetInferenceStats();
+  EXPECT_EQ(0, engine.get_inference_stats().num_inferences);
+  // Device stats are kept.
+  ASSERT_EQ(kEdgeTpuApiOk,
+            EdgeTpuResourceManager::GetSingleton()->GetInferenceStats(
+                engine.device_path(), &device_stats));
+  EXPECT_EQ(10, device_stats.num_inferences);
+}
+
 // Run inference on all models to ensure they're runnable.
 TEST(BasicEngineTest, TestAllModelsWithRamdomInput) {
   std::vector<std::string> models = GetAllModels();
@@ -0,0 +1,80 @@
+#include "edgetpu/cpp/basic/edgetpu_device_manager.h"
+
+#include <mutex>  // NOLINT
+
+#include "edgetpu/cpp/posenet/posenet_decoder_op.h"
+#include "glog/logging.h"
+
+namespace coral {
+namespace {
+
+using tflite::ops::builtin::BuiltinOpResolver;
+
+// Edge TPUs of the Edge TPU runtime.
+class RuntimeDeviceManager : public EdgeTpuDeviceManager {
+ public:
+  std::vector<DeviceRecord> EnumerateEdgeTpu() override {
+    return edgetpu::EdgeTpuManager::GetSingleton()->EnumerateEdgeTpu();
+  }
+
+  std::shared_ptr<edgetpu::EdgeTpuContext> OpenDevice(
+      edgetpu::DeviceType type, const std::string& path,
+      const edgetpu::EdgeTpuManager::DeviceOptions& options) override {
+    return edgetpu::EdgeTpuManager::GetSingleton()->OpenDevice(type, path,
+                                                               options);
+  }
+
+  std::unique_ptr<tflite::Interpreter> BuildInterpreter(
+      const tflite::FlatBufferModel& model, const std::string& model_path,
+      BuiltinOpResolver* resolver, edgetpu::EdgeTpuContext* context,
+      EdgeTpuErrorReporter* error_reporter) override {
+    if (resolver == nullptr) {
+      error_reporter->Report("nullptr resolver.");
+      return nullptr;
+    }
+    resolver->AddCustom(edgetpu::kCustomOp, edgetpu::RegisterCustomOp());
+    resolver->AddCustom(kPosenetDecoderOp, RegisterPosenetDecoderOp());
+    std::unique_ptr<tflite::Interpreter> interpreter;
+    // When BasicEngine is initializing with FlatBufferModel, it's possible
+    // that there is no ErrorReporter binded with it.
+    tflite::InterpreterBuilder interpreter_builder(model.GetModel(), *resolver,
+                                                   error_reporter);
+    if (interpreter_builder(&interpreter) != kTfLiteOk) {
+      error_reporter->Report("Error in interpreter initialization.");
+      return nullptr;
+    }
+    // Bind given context with interpreter.
+    interpreter->SetExternalContext(kTfLiteEdgeTpuContext, context);
+    interpreter->SetNumThreads(1);
+    if (interpreter->AllocateTensors() != kTfLiteOk) {
+      error_reporter->Report("Failed to allocate tensors.");
+      return nullptr;
+    }
+    return interpreter;
+  }
+};
+
+std::mutex manager_mutex;
+std::unique_ptr<EdgeTpuDeviceManager>& ManagerLocked() {
+  static auto* const manager = new std::unique_ptr<EdgeTpuDeviceManager>(
+      new RuntimeDeviceManager());
+  return *manager;
+}
+
+}  // namespace
+
+EdgeTpuDeviceManager* GetEdgeTpuDeviceManager() {
+  std::lock_guard<std::mutex> lock(manager_mutex);
+  return ManagerLocked().get();
+}
+
+void SetEdgeTpuDeviceManager(std::unique_ptr<EdgeTpuDeviceManager> manager) {
+  std::lock_guard<std::mutex> lock(manager_mutex);
+  if (manager) {
+    ManagerLocked() = std::move(manager);
+  } else {
+    ManagerLocked().reset(new RuntimeDeviceManager());
+  }
+}
+
+}  // namespace coral
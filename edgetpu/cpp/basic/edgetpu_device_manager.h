@@ -0,0 +1,55 @@
+#ifndef EDGETPU_CPP_BASIC_EDGETPU_DEVICE_MANAGER_H_
+#define EDGETPU_CPP_BASIC_EDGETPU_DEVICE_MANAGER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "edgetpu.h"
+#include "edgetpu/cpp/error_reporter.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/kernels/register.h"
+#include "tensorflow/lite/model.h"
+
+namespace coral {
+
+// What lists and opens Edge TPUs, and builds interpreters running models on
+// them. By default, the Edge TPU runtime, i.e. edgetpu::EdgeTpuManager. Tests
+// and benchmarks can replace it, e.g. with a SimulatedEdgeTpuManager, to run
+// engines, pools and schedulers without Edge TPUs.
+class EdgeTpuDeviceManager {
+ public:
+  using DeviceRecord = edgetpu::EdgeTpuManager::DeviceEnumerationRecord;
+
+  virtual ~EdgeTpuDeviceManager() = default;
+
+  // Lists connected Edge TPUs.
+  virtual std::vector<DeviceRecord> EnumerateEdgeTpu() = 0;
+
+  // Opens Edge TPU `path`. Returns nullptr on error.
+  virtual std::shared_ptr<edgetpu::EdgeTpuContext> OpenDevice(
+      edgetpu::DeviceType type, const std::string& path,
+      const edgetpu::EdgeTpuManager::DeviceOptions& options) = 0;
+
+  // Builds an interpreter running `model` on `context`, which OpenDevice()
+  // returned, and allocates its tensors. `model_path` is the file `model` was
+  // read from, or empty if unknown. Adds the custom ops of Edge TPU models to
+  // `resolver`. Returns nullptr on error, reported to `error_reporter`.
+  virtual std::unique_ptr<tflite::Interpreter> BuildInterpreter(
+      const tflite::FlatBufferModel& model, const std::string& model_path,
+      tflite::ops::builtin::BuiltinOpResolver* resolver,
+      edgetpu::EdgeTpuContext* context,
+      EdgeTpuErrorReporter* error_reporter) = 0;
+};
+
+// Returns the device manager in use.
+EdgeTpuDeviceManager* GetEdgeTpuDeviceManager();
+
+// Replaces the device manager in use, or restores the Edge TPU runtime if
+// `manager` is nullptr. No Edge TPU of the previous manager may be open, i.e.
+// all engines must have been destroyed.
+void SetEdgeTpuDeviceManager(std::unique_ptr<EdgeTpuDeviceManager> manager);
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_BASIC_EDGETPU_DEVICE_MANAGER_H_
@@ -2,6 +2,8 @@
 
 #include "absl/memory/memory.h"
 #include "absl/strings/substitute.h"
+#include "edgetpu/cpp/basic/edgetpu_device_manager.h"
+#include "edgetpu/cpp/tracing.h"
 #include "glog/logging.h"
 
 namespace coral {
@@ -28,8 +30,7 @@ EdgeTpuApiStatus EdgeTpuResourceManager::CreateEdgeTpuResource(
   std::unordered_map<std::string, std::string> options = {
       {"Usb.MaxBulkInQueueLength", "8"},
   };
-  auto tpu_context =
-      edgetpu::EdgeTpuManager::GetSingleton()->OpenDevice(type, path, options);
+  auto tpu_context = GetEdgeTpuDeviceManager()->OpenDevice(type, path, options);
   if (!tpu_context) {
     error_reporter_->Report(
         absl::Substitute("Error in device opening ($0)!", path));
@@ -38,15 +39,15 @@ EdgeTpuApiStatus EdgeTpuResourceManager::CreateEdgeTpuResource(
   resource_map_[path].usage_count = 1;
   resource_map_[path].context = tpu_context;
   // Using `new` to access a non-public constructor.
-  (*resource) =
-      absl::WrapUnique(new EdgeTpuResource(path, resource_map_[path].context));
+  (*resource) = absl::WrapUnique(new EdgeTpuResource(
+      path, resource_map_[path].context, GetStatsRecorder(path)));
   return kEdgeTpuApiOk;
 }
 
 EdgeTpuApiStatus EdgeTpuResourceManager::GetEdgeTpuResource(
     std::unique_ptr<EdgeTpuResource>* resource) {
-  const auto& tpu_devices =
-      edgetpu::EdgeTpuManager::GetSingleton()->EnumerateEdgeTpu();
+  CORAL_TRACE_SPAN("AcquireEdgeTpu");
+  const auto& tpu_devices = GetEdgeTpuDeviceManager()->EnumerateEdgeTpu();
 
   if (tpu_devices.empty()) {
     error_reporter_->Report("No Edge TPU device detected!");
@@ -60,6 +61,7 @@ EdgeTpuApiStatus EdgeTpuResourceManager::GetEdgeTpuResource(
 
 EdgeTpuApiStatus EdgeTpuResourceManager::GetEdgeTpuResource(
     const std::string& path, std::unique_ptr<EdgeTpuResource>* resource) {
+  CORAL_TRACE_SPAN("AcquireEdgeTpuAtPath");
   absl::MutexLock lock(&mu_);
   // Call to EnumerateEdgeTpu() is relatively expensive (10+ ms), Search
   // `resource_map_` first to see if there's cache-hit.
@@ -67,14 +69,13 @@ EdgeTpuApiStatus EdgeTpuResourceManager::GetEdgeTpuResource(
   if (it != resource_map_.end()) {
     it->second.usage_count++;
     // Using `new` to access a non-public constructor.
-    (*resource) =
-        absl::WrapUnique(new EdgeTpuResource(path, it->second.context));
+    (*resource) = absl::WrapUnique(
+        new EdgeTpuResource(path, it->second.context, GetStatsRecorder(path)));
     return kEdgeTpuApiOk;
   }
 
   // No cache-hit, create EdgeTpuResource from scratch.
-  const auto& tpu_devices =
-      edgetpu::EdgeTpuManager::GetSingleton()->EnumerateEdgeTpu();
+  const auto& tpu_devices = GetEdgeTpuDeviceManager()->EnumerateEdgeTpu();
   for (const auto& device : tpu_devices) {
     if (device.path == path) {
       CHECK(resource_map_.find(path) == resource_map_.end());
@@ -89,8 +90,7 @@ EdgeTpuApiStatus EdgeTpuResourceManager::GetEdgeTpuResource(
 EdgeTpuApiStatus EdgeTpuResourceManager::GetEdgeTpuResourceMultipleDetected(
     std::unique_ptr<EdgeTpuResource>* resource) {
   absl::MutexLock lock(&mu_);
-  const auto& tpu_devices =
-      edgetpu::EdgeTpuManager::GetSingleton()->EnumerateEdgeTpu();
+  const auto& tpu_devices = GetEdgeTpuDeviceManager()->EnumerateEdgeTpu();
 
   // Always prefer to use PCIe version of EdgeTpu.
   for (const auto& device : tpu_devices) {
@@ -116,6 +116,7 @@ EdgeTpuApiStatus EdgeTpuResourceManager::GetEdgeTpuResourceMultipleDetected(
 
 EdgeTpuApiStatus EdgeTpuResourceManager::ReclaimEdgeTpuResource(
     const std::string& path) {
+  CORAL_TRACE_SPAN("ReleaseEdgeTpu");
   absl::MutexLock lock(&mu_);
   auto it = resource_map_.find(path);
   if (it != resource_map_.end()) {
@@ -132,11 +133,45 @@ EdgeTpuApiStatus EdgeTpuResourceManager::ReclaimEdgeTpuResource(
   return kEdgeTpuApiOk;
 }
 
+InferenceStatsRecorder* EdgeTpuResourceManager::GetStatsRecorder(
+    const std::string& path) {
+  auto& recorder = stats_map_[path];
+  if (!recorder) recorder = absl::make_unique<InferenceStatsRecorder>();
+  return recorder.get();
+}
+
+EdgeTpuApiStatus EdgeTpuResourceManager::GetInferenceStats(
+    const std::string& path, InferenceStats* stats) {
+  CHECK(stats);
+  {
+    absl::ReaderMutexLock lock(&mu_);
+    auto it = stats_map_.find(path);
+    if (it != stats_map_.end()) {
+      *stats = it->second->Get();
+      return kEdgeTpuApiOk;
+    }
+  }
+  // Devices that never got assigned have empty stats.
+  for (const auto& device : GetEdgeTpuDeviceManager()->EnumerateEdgeTpu()) {
+    if (device.path == path) {
+      *stats = InferenceStats();
+      return kEdgeTpuApiOk;
+    }
+  }
+  error_reporter_->Report(
+      absl::Substitute("Path $0 does not map to an Edge TPU device.", path));
+  return kEdgeTpuApiError;
+}
+
+void EdgeTpuResourceManager::ResetInferenceStats() {
+  absl::ReaderMutexLock lock(&mu_);
+  for (auto& entry : stats_map_) entry.second->Reset();
+}
+
 std::vector<std::string> EdgeTpuResourceManager::ListEdgeTpuPaths(
     const EdgeTpuState& state) {
   std::vector<std::string> result;
-  const auto& edgetpu_devices =
-      edgetpu::EdgeTpuManager::GetSingleton()->EnumerateEdgeTpu();
+  const auto& edgetpu_devices = GetEdgeTpuDeviceManager()->EnumerateEdgeTpu();
   switch (state) {
     case EdgeTpuState::kNone: {
       for (const auto& device : edgetpu_devices) {
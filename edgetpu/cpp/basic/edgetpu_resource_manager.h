@@ -6,6 +6,7 @@
 
 #include "absl/synchronization/mutex.h"
 #include "edgetpu.h"
+#include "edgetpu/cpp/basic/inference_stats.h"
 #include "edgetpu/cpp/error_reporter.h"
 
 namespace coral {
@@ -27,14 +28,19 @@ class EdgeTpuResource {
   // Gets associated device path for `EdgeTpuContext`.
   std::string path() const { return path_; }
 
+  // Gets the recorder of inference stats of the device, which outlives the
+  // resource.
+  InferenceStatsRecorder* stats_recorder() { return stats_recorder_; }
+
  private:
   friend class EdgeTpuResourceManager;
   // Only allows `EdgeTpuResourceManager` to create `EdgeTpuResource`, such that
   // no one can mess up the ownership management of `EdgeTpuResourceManager`
   // through `EdgeTpuResource`.
   EdgeTpuResource(const std::string& path,
-                  std::shared_ptr<edgetpu::EdgeTpuContext> context)
-      : path_(path), context_(context) {}
+                  std::shared_ptr<edgetpu::EdgeTpuContext> context,
+                  InferenceStatsRecorder* stats_recorder)
+      : path_(path), context_(context), stats_recorder_(stats_recorder) {}
   // Disallows copy constructor and assignment.
   EdgeTpuResource(const EdgeTpuResource&) = delete;
   EdgeTpuResource& operator=(const EdgeTpuResource&) = delete;
@@ -42,6 +48,7 @@ class EdgeTpuResource {
   // Path associated with `EdgeTpuContext`.
   std::string path_;
   std::shared_ptr<edgetpu::EdgeTpuContext> context_;
+  InferenceStatsRecorder* stats_recorder_;
 };
 
 // This class manages `EdgeTpuResource`.
@@ -105,6 +112,14 @@ class EdgeTpuResourceManager {
   // Lists path of Edge TPU devices.
   std::vector<std::string> ListEdgeTpuPaths(const EdgeTpuState& state);
 
+  // Gets stats of inferences that engines ran on device `path`, since the
+  // stats were last reset, whichever models they ran.
+  EdgeTpuApiStatus GetInferenceStats(const std::string& path,
+                                     InferenceStats* stats) LOCKS_EXCLUDED(mu_);
+
+  // Resets inference stats of all devices.
+  void ResetInferenceStats() LOCKS_EXCLUDED(mu_);
+
   // Caller can use this function to retrieve error message when get
   // kEdgeTpuApiError.
   std::string get_error_message() { return error_reporter_->message(); }
@@ -117,6 +132,10 @@ class EdgeTpuResourceManager {
       const edgetpu::DeviceType type, const std::string& path,
       std::unique_ptr<EdgeTpuResource>* resource) EXCLUSIVE_LOCKS_REQUIRED(mu_);
 
+  // Gets the stats recorder of device `path`, creating it on first use.
+  InferenceStatsRecorder* GetStatsRecorder(const std::string& path)
+      EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
   // Gets next available EdgeTpuResource when there are multiple detected.
   EdgeTpuApiStatus GetEdgeTpuResourceMultipleDetected(
       std::unique_ptr<EdgeTpuResource>* resource) LOCKS_EXCLUDED(mu_);
@@ -129,6 +148,10 @@ class EdgeTpuResourceManager {
   // Keeps track of assigned Edge TPU, e.g., how many references on it.
   // Keyed by device path.
   std::unordered_map<std::string, ResourceState> resource_map_ GUARDED_BY(mu_);
+  // Inference stats by device path. Unlike `resource_map_`, entries are never
+  // removed, so that stats of a device accumulate across its assignments.
+  std::unordered_map<std::string, std::unique_ptr<InferenceStatsRecorder>>
+      stats_map_ GUARDED_BY(mu_);
   // Data structure to stores error messages.
   std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
 };
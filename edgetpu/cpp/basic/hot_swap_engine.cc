@@ -0,0 +1,136 @@
+#include "edgetpu/cpp/basic/hot_swap_engine.h"
+
+#include "absl/memory/memory.h"
+#include "glog/logging.h"
+
+namespace coral {
+
+HotSwapEngine::HotSwapEngine(const std::string& model_path,
+                             const std::string& device_path) {
+  error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
+  LOG_IF(FATAL,
+         BuildModel(model_path, device_path, &current_) == kEdgeTpuApiError)
+      << error_reporter_->message();
+  LOG_IF(FATAL, current_->engine->device_path(&device_path_) ==
+                    kEdgeTpuApiError)
+      << current_->engine->get_error_message();
+  int const* dims;
+  int dims_num;
+  LOG_IF(FATAL, current_->engine->get_input_tensor_shape(&dims, &dims_num) ==
+                    kEdgeTpuApiError)
+      << current_->engine->get_error_message();
+  input_tensor_shape_.assign(dims, dims + dims_num);
+}
+
+EdgeTpuApiStatus HotSwapEngine::BuildModel(const std::string& model_path,
+                                           const std::string& device_path,
+                                           std::unique_ptr<Model>* model) {
+  auto new_model = absl::make_unique<Model>();
+  new_model->path = model_path;
+  // With the device path of the engine, the Edge TPU context is shared.
+  BasicEngineNativeBuilder builder(model_path, device_path);
+  EDGETPU_API_REPORT_ERROR(error_reporter_,
+                           builder(&new_model->engine) == kEdgeTpuApiError,
+                           builder.get_error_message());
+  BasicEngineNative* engine = new_model->engine.get();
+  if (!input_tensor_shape_.empty()) {
+    int const* dims;
+    int dims_num;
+    EDGETPU_API_REPORT_ERROR(
+        error_reporter_,
+        engine->get_input_tensor_shape(&dims, &dims_num) == kEdgeTpuApiError,
+        engine->get_error_message());
+    EDGETPU_API_REPORT_ERROR(
+        error_reporter_,
+        std::vector<int>(dims, dims + dims_num) != input_tensor_shape_,
+        "Input tensor shape of " + model_path +
+            " differs from that of the current model!");
+  }
+  int const* sizes;
+  int num_sizes;
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_,
+      engine->get_all_output_tensors_sizes(&sizes, &num_sizes) ==
+          kEdgeTpuApiError,
+      engine->get_error_message());
+  new_model->output_tensor_sizes.assign(sizes, sizes + num_sizes);
+  (*model) = std::move(new_model);
+  return kEdgeTpuApiOk;
+}
+
+HotSwapEngine::Model* HotSwapEngine::AcquireModel() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++current_->num_inferences;
+  return current_.get();
+}
+
+void HotSwapEngine::ReleaseModel(Model* model) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (--model->num_inferences == 0) inferences_done_.notify_all();
+}
+
+std::vector<std::vector<float>> HotSwapEngine::RunInference(
+    const std::vector<uint8_t>& input, int64_t* model_version) {
+  Model* model = AcquireModel();
+  std::vector<std::vector<float>> results;
+  {
+    std::lock_guard<std::mutex> lock(model->mutex);
+    float const* result;
+    int result_size;
+    LOG_IF(FATAL, model->engine->RunInference(input.data(), input.size(),
+                                              &result, &result_size) ==
+                      kEdgeTpuApiError)
+        << model->engine->get_error_message();
+    int offset = 0;
+    for (int size : model->output_tensor_sizes) {
+      results.emplace_back(result + offset, result + offset + size);
+      offset += size;
+    }
+    CHECK_EQ(result_size, offset);
+    if (model_version) (*model_version) = model->version;
+  }
+  ReleaseModel(model);
+  return results;
+}
+
+EdgeTpuApiStatus HotSwapEngine::SwapModel(const std::string& model_path) {
+  std::lock_guard<std::mutex> swap_lock(swap_mutex_);
+  std::unique_ptr<Model> model;
+  EDGETPU_API_ENSURE_STATUS(BuildModel(model_path, device_path_, &model));
+  std::unique_lock<std::mutex> lock(mutex_);
+  model->version = current_->version + 1;
+  current_.swap(model);
+  // `model` is now the old one, which inferences that got it before the swap
+  // may still run on.
+  inferences_done_.wait(lock, [&model] { return model->num_inferences == 0; });
+  lock.unlock();
+  model.reset();
+  return kEdgeTpuApiOk;
+}
+
+int64_t HotSwapEngine::model_version() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return current_->version;
+}
+
+std::string HotSwapEngine::device_path() const { return device_path_; }
+
+std::string HotSwapEngine::model_path() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return current_->path;
+}
+
+std::vector<int> HotSwapEngine::get_input_tensor_shape() const {
+  return input_tensor_shape_;
+}
+
+std::vector<int> HotSwapEngine::get_all_output_tensors_sizes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return current_->output_tensor_sizes;
+}
+
+std::string HotSwapEngine::get_error_message() {
+  return error_reporter_->message();
+}
+
+}  // namespace coral
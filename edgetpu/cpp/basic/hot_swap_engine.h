@@ -0,0 +1,101 @@
+#ifndef EDGETPU_CPP_BASIC_HOT_SWAP_ENGINE_H_
+#define EDGETPU_CPP_BASIC_HOT_SWAP_ENGINE_H_
+
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "edgetpu/cpp/basic/basic_engine_native.h"
+#include "edgetpu/cpp/error_reporter.h"
+
+namespace coral {
+
+// Engine whose model can be replaced while it serves inferences, e.g. to roll
+// out a new version of the model without failing requests.
+//
+// SwapModel() loads the new model and builds its interpreter on the Edge TPU
+// of the engine, sharing its context, while inferences go on with the current
+// model. It then switches the engine to the new model between inferences, and
+// releases the old one once inferences already running on it are done.
+//
+// Unlike BasicEngine, this class is thread-safe: inferences of different
+// threads take turns on the model. Like BasicEngine, it crashes on errors,
+// except of SwapModel().
+class HotSwapEngine {
+ public:
+  // Loads the model of `model_path`, on Edge TPU `device_path`, or the next
+  // available one if empty.
+  explicit HotSwapEngine(const std::string& model_path,
+                         const std::string& device_path = "");
+
+  HotSwapEngine(const HotSwapEngine&) = delete;
+  HotSwapEngine& operator=(const HotSwapEngine&) = delete;
+
+  // Runs the current model, like BasicEngine::RunInference(). Sets
+  // `model_version` to that of the model, if not null.
+  std::vector<std::vector<float>> RunInference(
+      const std::vector<uint8_t>& input, int64_t* model_version = nullptr);
+
+  // Replaces the model with that of `model_path`, which must take inputs of
+  // the same shape. Waits for inferences still running on the old model, so
+  // that it's released when this returns. On error, the current model stays.
+  EdgeTpuApiStatus SwapModel(const std::string& model_path);
+
+  // Version of the current model: 0 for the first one, incremented by each
+  // swap.
+  int64_t model_version() const;
+
+  std::string device_path() const;
+  // Gets the path of the current model.
+  std::string model_path() const;
+  std::vector<int> get_input_tensor_shape() const;
+  // Gets sizes of output tensors of the current model.
+  std::vector<int> get_all_output_tensors_sizes() const;
+
+  // Caller can use this function to retrieve error message when SwapModel()
+  // returns kEdgeTpuApiError.
+  std::string get_error_message();
+
+ private:
+  // Model with its engine, which inferences take turns on.
+  struct Model {
+    int64_t version = 0;
+    std::string path;
+    std::vector<int> output_tensor_sizes;
+    // Inferences which got the model and aren't done, guarded by `mutex_` of
+    // the engine.
+    int num_inferences = 0;
+    std::mutex mutex;
+    std::unique_ptr<BasicEngineNative> engine;
+  };
+
+  // Builds `model_path` on the Edge TPU of the engine, or `device_path` for
+  // the first model.
+  EdgeTpuApiStatus BuildModel(const std::string& model_path,
+                              const std::string& device_path,
+                              std::unique_ptr<Model>* model);
+
+  // Gets the current model for an inference, which must release it with
+  // ReleaseModel(). It stays alive until then, even if swapped meanwhile.
+  Model* AcquireModel();
+  void ReleaseModel(Model* model);
+
+  std::string device_path_;
+  std::vector<int> input_tensor_shape_;
+  // Guards `current_` and `num_inferences` of models.
+  mutable std::mutex mutex_;
+  std::unique_ptr<Model> current_;
+  // Notified when the last inference on a model is done.
+  std::condition_variable inferences_done_;
+  // Serializes swaps.
+  std::mutex swap_mutex_;
+  // Data structure to store error messages of SwapModel().
+  std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
+};
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_BASIC_HOT_SWAP_ENGINE_H_
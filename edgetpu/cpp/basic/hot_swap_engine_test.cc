@@ -0,0 +1,114 @@
+#include "edgetpu/cpp/basic/hot_swap_engine.h"
+
+#include <atomic>
+#include <thread>  // NOLINT
+
+#include "edgetpu/cpp/basic/basic_engine.h"
+#include "edgetpu/cpp/basic/edgetpu_resource_manager.h"
+#include "edgetpu/cpp/test_utils.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace coral {
+namespace {
+
+// Two versions of a model, with inputs of the same shape.
+constexpr char kModelV1[] = "mobilenet_v1_1.0_224_quant_edgetpu.tflite";
+constexpr char kModelV2[] = "mobilenet_v2_1.0_224_quant_edgetpu.tflite";
+
+class HotSwapEngineTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (const auto& model : {kModelV1, kModelV2}) {
+      BasicEngine engine(ModelPath(model));
+      if (input_.empty()) {
+        input_ = GetRandomInput(engine.get_input_tensor_shape());
+      }
+      expected_.push_back(engine.RunInference(input_));
+    }
+    ASSERT_NE(expected_[0], expected_[1]);
+  }
+
+  void TearDown() override {
+    EXPECT_TRUE(EdgeTpuResourceManager::GetSingleton()
+                    ->ListEdgeTpuPaths(
+                        EdgeTpuResourceManager::EdgeTpuState::kAssigned)
+                    .empty());
+  }
+
+  std::vector<uint8_t> input_;
+  // Results of each version.
+  std::vector<std::vector<std::vector<float>>> expected_;
+};
+
+TEST_F(HotSwapEngineTest, SwapsModel) {
+  HotSwapEngine engine(ModelPath(kModelV1));
+  const std::string device_path = engine.device_path();
+  int64_t version;
+  EXPECT_EQ(expected_[0], engine.RunInference(input_, &version));
+  EXPECT_EQ(0, version);
+  EXPECT_EQ(ModelPath(kModelV1), engine.model_path());
+
+  ASSERT_EQ(kEdgeTpuApiOk, engine.SwapModel(ModelPath(kModelV2)))
+      << engine.get_error_message();
+  EXPECT_EQ(expected_[1], engine.RunInference(input_, &version));
+  EXPECT_EQ(1, version);
+  EXPECT_EQ(1, engine.model_version());
+  EXPECT_EQ(ModelPath(kModelV2), engine.model_path());
+  EXPECT_EQ(device_path, engine.device_path());
+  // The old model is released, the Edge TPU stays assigned to the engine.
+  EXPECT_EQ(std::vector<std::string>({device_path}),
+            EdgeTpuResourceManager::GetSingleton()->ListEdgeTpuPaths(
+                EdgeTpuResourceManager::EdgeTpuState::kAssigned));
+}
+
+TEST_F(HotSwapEngineTest, SwapsWhileServing) {
+  HotSwapEngine engine(ModelPath(kModelV1));
+  std::atomic<bool> done(false);
+  std::vector<std::thread> clients;
+  for (int i = 0; i < 3; ++i) {
+    clients.emplace_back([this, &engine, &done] {
+      int num_inferences = 0;
+      int64_t version;
+      while (!done || num_inferences < 10) {
+        const auto results = engine.RunInference(input_, &version);
+        // Versions alternate between the two models.
+        EXPECT_EQ(expected_[version % 2], results);
+        ++num_inferences;
+      }
+    });
+  }
+  for (int i = 1; i <= 6; ++i) {
+    ASSERT_EQ(kEdgeTpuApiOk,
+              engine.SwapModel(ModelPath(i % 2 ? kModelV2 : kModelV1)))
+        << engine.get_error_message();
+    EXPECT_EQ(i, engine.model_version());
+  }
+  done = true;
+  for (auto& client : clients) client.join();
+}
+
+TEST_F(HotSwapEngineTest, KeepsModelOnErrors) {
+  HotSwapEngine engine(ModelPath(kModelV1));
+  EXPECT_EQ(kEdgeTpuApiError,
+            engine.SwapModel(ModelPath("invalid_model.tflite")));
+  EXPECT_FALSE(engine.get_error_message().empty());
+  const std::string other_shape_model =
+      ModelPath("mobilenet_v1_0.25_128_quant_edgetpu.tflite");
+  EXPECT_EQ(kEdgeTpuApiError, engine.SwapModel(other_shape_model));
+  EXPECT_EQ("Input tensor shape of " + other_shape_model +
+                " differs from that of the current model!",
+            engine.get_error_message());
+  EXPECT_EQ(0, engine.model_version());
+  EXPECT_EQ(expected_[0], engine.RunInference(input_));
+}
+
+}  // namespace
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,151 @@
+#include "edgetpu/cpp/basic/inference_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "edgetpu/cpp/histogram_buckets.h"
+
+namespace coral {
+
+namespace {
+// Values below 2^kPrecisionBits have buckets of their own, then every power of
+// 2 spans 2^(kPrecisionBits - 1) buckets.
+constexpr int kPrecisionBits = 5;
+constexpr int64_t kMaxValue = (int64_t{1} << 40) - 1;
+
+void AtomicMax(std::atomic<int64_t>* target, int64_t value) {
+  int64_t current = target->load(std::memory_order_relaxed);
+  while (current < value &&
+         !target->compare_exchange_weak(current, value,
+                                        std::memory_order_relaxed)) {
+  }
+}
+
+std::string FormatStage(const char* name, const StageLatency& stage) {
+  char line[192];
+  std::snprintf(line, sizeof(line),
+                "  %-18s mean %.3f p50 %.3f p90 %.3f p99 %.3f max %.3f\n",
+                name, stage.mean_us / 1000, stage.p50_us / 1000,
+                stage.p90_us / 1000, stage.p99_us / 1000, stage.max_us / 1000);
+  return line;
+}
+}  // namespace
+
+std::string InferenceStats::ToString() const {
+  char header[192];
+  std::snprintf(header, sizeof(header),
+                "inferences %lld failures %lld input bytes %lld output bytes "
+                "%lld, latencies in ms:\n",
+                static_cast<long long>(num_inferences),  // NOLINT
+                static_cast<long long>(num_failures),    // NOLINT
+                static_cast<long long>(input_bytes),     // NOLINT
+                static_cast<long long>(output_bytes));   // NOLINT
+  return header + FormatStage("input copy", input_copy) +
+         FormatStage("invoke", invoke) +
+         FormatStage("output conversion", output_conversion) +
+         FormatStage("total", total);
+}
+
+ConcurrentLatencyHistogram::ConcurrentLatencyHistogram()
+    : num_buckets_(HistogramBucketIndex(kMaxValue, kPrecisionBits) + 1),
+      buckets_(new std::atomic<int64_t>[num_buckets_]) {
+  Reset();
+}
+
+void ConcurrentLatencyHistogram::Record(int64_t latency_ns) {
+  latency_ns = std::min(std::max(latency_ns, int64_t{0}), kMaxValue);
+  buckets_[HistogramBucketIndex(latency_ns, kPrecisionBits)].fetch_add(
+      1, std::memory_order_relaxed);
+  sum_.fetch_add(latency_ns, std::memory_order_relaxed);
+  AtomicMax(&max_, latency_ns);
+}
+
+void ConcurrentLatencyHistogram::Reset() {
+  for (int i = 0; i < num_buckets_; ++i) {
+    buckets_[i].store(0, std::memory_order_relaxed);
+  }
+  sum_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+StageLatency ConcurrentLatencyHistogram::Summarize() const {
+  // Counts from the buckets, so that percentiles are consistent with them
+  // even while others record.
+  std::vector<int64_t> buckets(num_buckets_);
+  int64_t count = 0;
+  for (int i = 0; i < num_buckets_; ++i) {
+    buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    count += buckets[i];
+  }
+  StageLatency summary;
+  if (!count) return summary;
+  const double max_ns = max_.load(std::memory_order_relaxed);
+  const auto percentile_us = [&](double percentile) {
+    const int64_t rank = std::max<int64_t>(
+        1, static_cast<int64_t>(std::ceil(percentile / 100 * count)));
+    int64_t seen = 0;
+    for (int i = 0; i < num_buckets_; ++i) {
+      seen += buckets[i];
+      if (seen >= rank) {
+        return std::min<double>(HistogramBucketMaxValue(i, kPrecisionBits),
+                                max_ns) /
+               1e3;
+      }
+    }
+    return max_ns / 1e3;
+  };
+  summary.count = count;
+  summary.mean_us = sum_.load(std::memory_order_relaxed) / 1e3 / count;
+  summary.p50_us = percentile_us(50);
+  summary.p90_us = percentile_us(90);
+  summary.p99_us = percentile_us(99);
+  summary.max_us = max_ns / 1e3;
+  return summary;
+}
+
+InferenceStatsRecorder::InferenceStatsRecorder() { Reset(); }
+
+void InferenceStatsRecorder::RecordInference(int64_t input_copy_ns,
+                                             int64_t invoke_ns,
+                                             int64_t output_conversion_ns,
+                                             int64_t total_ns,
+                                             int64_t input_bytes,
+                                             int64_t output_bytes) {
+  input_copy_.Record(input_copy_ns);
+  invoke_.Record(invoke_ns);
+  output_conversion_.Record(output_conversion_ns);
+  total_.Record(total_ns);
+  input_bytes_.fetch_add(input_bytes, std::memory_order_relaxed);
+  output_bytes_.fetch_add(output_bytes, std::memory_order_relaxed);
+}
+
+void InferenceStatsRecorder::RecordFailure() {
+  num_failures_.fetch_add(1, std::memory_order_relaxed);
+}
+
+InferenceStats InferenceStatsRecorder::Get() const {
+  InferenceStats stats;
+  stats.input_copy = input_copy_.Summarize();
+  stats.invoke = invoke_.Summarize();
+  stats.output_conversion = output_conversion_.Summarize();
+  stats.total = total_.Summarize();
+  stats.num_inferences = stats.total.count;
+  stats.num_failures = num_failures_.load(std::memory_order_relaxed);
+  stats.input_bytes = input_bytes_.load(std::memory_order_relaxed);
+  stats.output_bytes = output_bytes_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void InferenceStatsRecorder::Reset() {
+  num_failures_.store(0, std::memory_order_relaxed);
+  input_bytes_.store(0, std::memory_order_relaxed);
+  output_bytes_.store(0, std::memory_order_relaxed);
+  input_copy_.Reset();
+  invoke_.Reset();
+  output_conversion_.Reset();
+  total_.Reset();
+}
+
+}  // namespace coral
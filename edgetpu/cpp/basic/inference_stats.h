@@ -0,0 +1,105 @@
+#ifndef EDGETPU_CPP_BASIC_INFERENCE_STATS_H_
+#define EDGETPU_CPP_BASIC_INFERENCE_STATS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace coral {
+
+// Latencies of one stage of inferences, in microseconds. Percentiles are
+// accurate to within about 6%.
+struct StageLatency {
+  int64_t count = 0;
+  double mean_us = 0;
+  double p50_us = 0;
+  double p90_us = 0;
+  double p99_us = 0;
+  double max_us = 0;
+};
+
+// Stats of inferences since they were last reset.
+struct InferenceStats {
+  // Successful inferences, which the latencies cover.
+  int64_t num_inferences = 0;
+  // Inferences whose Invoke() failed.
+  int64_t num_failures = 0;
+  // Bytes copied into input tensors and out of output tensors.
+  int64_t input_bytes = 0;
+  int64_t output_bytes = 0;
+
+  // Copy of the input into the input tensor.
+  StageLatency input_copy;
+  // Interpreter::Invoke(), i.e. the Edge TPU and any CPU ops.
+  StageLatency invoke;
+  // Dequantization of output tensors into the float result.
+  StageLatency output_conversion;
+  // The whole of RunInference().
+  StageLatency total;
+
+  // Formats the stats in a few lines, latencies in milliseconds.
+  std::string ToString() const;
+};
+
+// Histogram of latencies in nanoseconds, which threads record into
+// concurrently without locks, e.g. from every inference of an engine.
+//
+// Buckets are log-linear as in LatencyHistogram, with 16 per power of 2, up to
+// 2^40 ns (about 18 minutes). Recording is a few relaxed atomic increments.
+// Reading while others record returns a view that may miss the latest values.
+class ConcurrentLatencyHistogram {
+ public:
+  ConcurrentLatencyHistogram();
+
+  ConcurrentLatencyHistogram(const ConcurrentLatencyHistogram&) = delete;
+  ConcurrentLatencyHistogram& operator=(const ConcurrentLatencyHistogram&) =
+      delete;
+
+  void Record(int64_t latency_ns);
+
+  void Reset();
+
+  StageLatency Summarize() const;
+
+ private:
+  const int num_buckets_;
+  std::unique_ptr<std::atomic<int64_t>[]> buckets_;
+  std::atomic<int64_t> sum_;
+  std::atomic<int64_t> max_;
+};
+
+// Records InferenceStats of inferences, concurrently and without locks. Each
+// BasicEngineNative has one, and EdgeTpuResourceManager one per Edge TPU.
+class InferenceStatsRecorder {
+ public:
+  InferenceStatsRecorder();
+
+  InferenceStatsRecorder(const InferenceStatsRecorder&) = delete;
+  InferenceStatsRecorder& operator=(const InferenceStatsRecorder&) = delete;
+
+  // Records a successful inference, with the times of its stages in
+  // nanoseconds.
+  void RecordInference(int64_t input_copy_ns, int64_t invoke_ns,
+                       int64_t output_conversion_ns, int64_t total_ns,
+                       int64_t input_bytes, int64_t output_bytes);
+
+  void RecordFailure();
+
+  InferenceStats Get() const;
+
+  void Reset();
+
+ private:
+  std::atomic<int64_t> num_failures_;
+  std::atomic<int64_t> input_bytes_;
+  std::atomic<int64_t> output_bytes_;
+  ConcurrentLatencyHistogram input_copy_;
+  ConcurrentLatencyHistogram invoke_;
+  ConcurrentLatencyHistogram output_conversion_;
+  ConcurrentLatencyHistogram total_;
+};
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_BASIC_INFERENCE_STATS_H_
@@ -0,0 +1,105 @@
+#include "edgetpu/cpp/basic/inference_stats.h"
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+
+namespace coral {
+namespace {
+
+TEST(ConcurrentLatencyHistogramTest, Empty) {
+  ConcurrentLatencyHistogram histogram;
+  const StageLatency summary = histogram.Summarize();
+  EXPECT_EQ(0, summary.count);
+  EXPECT_EQ(0, summary.p50_us);
+  EXPECT_EQ(0, summary.max_us);
+}
+
+TEST(ConcurrentLatencyHistogramTest, Percentiles) {
+  ConcurrentLatencyHistogram histogram;
+  // 1 us to 1000 us.
+  for (int i = 1; i <= 1000; ++i) histogram.Record(i * 1000);
+  const StageLatency summary = histogram.Summarize();
+  EXPECT_EQ(1000, summary.count);
+  EXPECT_NEAR(500.5, summary.mean_us, 1e-9);
+  EXPECT_NEAR(500, summary.p50_us, 500 * 0.0625);
+  EXPECT_NEAR(900, summary.p90_us, 900 * 0.0625);
+  EXPECT_NEAR(990, summary.p99_us, 990 * 0.0625);
+  EXPECT_EQ(1000, summary.max_us);
+}
+
+TEST(ConcurrentLatencyHistogramTest, ClampsValues) {
+  ConcurrentLatencyHistogram histogram;
+  histogram.Record(-5);
+  histogram.Record(int64_t{1} << 50);
+  const StageLatency summary = histogram.Summarize();
+  EXPECT_EQ(2, summary.count);
+  EXPECT_EQ(0, summary.p50_us);
+  EXPECT_EQ(((int64_t{1} << 40) - 1) / 1e3, summary.max_us);
+}
+
+TEST(ConcurrentLatencyHistogramTest, Reset) {
+  ConcurrentLatencyHistogram histogram;
+  histogram.Record(1000);
+  histogram.Reset();
+  EXPECT_EQ(0, histogram.Summarize().count);
+  histogram.Record(2000);
+  EXPECT_EQ(2, histogram.Summarize().max_us);
+}
+
+TEST(InferenceStatsRecorderTest, RecordsStagesAndBytes) {
+  InferenceStatsRecorder recorder;
+  recorder.RecordInference(1000, 5000, 2000, 9000, 300, 40);
+  recorder.RecordInference(1000, 7000, 2000, 11000, 300, 40);
+  recorder.RecordFailure();
+  const InferenceStats stats = recorder.Get();
+  EXPECT_EQ(2, stats.num_inferences);
+  EXPECT_EQ(1, stats.num_failures);
+  EXPECT_EQ(600, stats.input_bytes);
+  EXPECT_EQ(80, stats.output_bytes);
+  EXPECT_EQ(1, stats.input_copy.mean_us);
+  EXPECT_EQ(6, stats.invoke.mean_us);
+  EXPECT_EQ(7, stats.invoke.max_us);
+  EXPECT_EQ(2, stats.output_conversion.mean_us);
+  EXPECT_EQ(10, stats.total.mean_us);
+  EXPECT_FALSE(stats.ToString().empty());
+
+  recorder.Reset();
+  const InferenceStats reset_stats = recorder.Get();
+  EXPECT_EQ(0, reset_stats.num_inferences);
+  EXPECT_EQ(0, reset_stats.num_failures);
+  EXPECT_EQ(0, reset_stats.input_bytes);
+}
+
+TEST(InferenceStatsRecorderTest, RecordsConcurrently) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumInferences = 10000;
+  InferenceStatsRecorder recorder;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([&recorder, i] {
+      for (int j = 0; j < kNumInferences; ++j) {
+        recorder.RecordInference(j, j, j, 3 * j + i, 1, 2);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  const InferenceStats stats = recorder.Get();
+  EXPECT_EQ(kNumThreads * kNumInferences, stats.num_inferences);
+  EXPECT_EQ(kNumThreads * kNumInferences, stats.input_copy.count);
+  EXPECT_EQ(kNumThreads * kNumInferences, stats.input_bytes);
+  EXPECT_EQ(2 * kNumThreads * kNumInferences, stats.output_bytes);
+  EXPECT_EQ((3 * (kNumInferences - 1) + kNumThreads - 1) / 1e3,
+            stats.total.max_us);
+}
+
+}  // namespace
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
@@ -1,5 +1,6 @@
 #include "edgetpu/cpp/basic/inference_utils.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
@@ -7,7 +8,8 @@
 #include <iostream>
 #include <vector>
 
-#include "edgetpu/cpp/posenet/posenet_decoder_op.h"
+#include "edgetpu/cpp/basic/edgetpu_device_manager.h"
+#include "edgetpu/cpp/tracing.h"
 #include "edgetpu/cpp/utils.h"
 #include "glog/logging.h"
 #include "tensorflow/lite/builtin_op_data.h"
@@ -190,6 +192,29 @@ std::vector<uint8_t> ReadBmp(const std::string& input_bmp_name,
                     top_down);
 }
 
+std::vector<uint8_t> CropImage(const ImageDims& in_dims, const uint8_t* in,
+                               const Box& box, ImageDims* out_dims) {
+  const int height = in_dims[0];
+  const int width = in_dims[1];
+  const int depth = in_dims[2];
+  const auto clamp = [](float value, int max) {
+    return std::min(std::max(static_cast<int>(std::lround(value)), 0), max);
+  };
+  const int x1 = clamp(box[0] * width, width - 1);
+  const int y1 = clamp(box[1] * height, height - 1);
+  const int x2 = std::max(clamp(box[2] * width, width), x1 + 1);
+  const int y2 = std::max(clamp(box[3] * height, height), y1 + 1);
+  (*out_dims) = {{y2 - y1, x2 - x1, depth}};
+  std::vector<uint8_t> result(ImageDimsToSize(*out_dims));
+  const int row_size = (x2 - x1) * depth;
+  for (int y = y1; y < y2; ++y) {
+    std::copy(in + (y * width + x1) * depth,
+              in + (y * width + x1) * depth + row_size,
+              result.begin() + (y - y1) * row_size);
+  }
+  return result;
+}
+
 std::vector<uint8_t> RgbToGrayscale(const std::vector<uint8_t>& in,
                                     const ImageDims& in_dims) {
   CHECK_GE(in_dims[2], 3);
@@ -206,22 +231,33 @@ std::vector<uint8_t> RgbToGrayscale(const std::vector<uint8_t>& in,
   return result;
 }
 
+std::vector<uint8_t> ResizeImageToDims(const ImageDims& in_dims,
+                                       const uint8_t* in,
+                                       const ImageDims& out_dims) {
+  ImageDims dims = in_dims;
+  std::vector<uint8_t> grayscale;
+  if (out_dims[2] == 1 && (in_dims[2] == 3 || in_dims[2] == 4)) {
+    grayscale = RgbToGrayscale(
+        std::vector<uint8_t>(in, in + ImageDimsToSize(in_dims)), in_dims);
+    in = grayscale.data();
+    // The image to resize has one channel now.
+    dims[2] = 1;
+  }
+  std::vector<uint8_t> result(ImageDimsToSize(out_dims));
+  ResizeImage(dims, in, out_dims, result.data());
+  return result;
+}
+
 std::vector<uint8_t> GetInputFromImage(const std::string& image_path,
                                        const ImageDims& target_dims) {
-  std::vector<uint8_t> result;
   if (!EndsWith(image_path, ".bmp")) {
     LOG(FATAL) << "Unsupported image type: " << image_path;
-    return result;
+    return {};
   }
-  result.resize(ImageDimsToSize(target_dims));
   ImageDims image_dims;
-  std::vector<uint8_t> in = ReadBmp(image_path, &image_dims);
+  const std::vector<uint8_t> in = ReadBmp(image_path, &image_dims);
   if (in.empty()) return {};
-  if (target_dims[2] == 1 && (image_dims[2] == 3 || image_dims[2] == 4)) {
-    in = RgbToGrayscale(in, image_dims);
-  }
-  ResizeImage(image_dims, in.data(), target_dims, result.data());
-  return result;
+  return ResizeImageToDims(image_dims, in.data(), target_dims);
 }
 
 std::vector<int> GetOutputTensorSizes(const tflite::Interpreter& interpreter) {
@@ -244,6 +280,13 @@ std::vector<int> GetOutputTensorSizes(const tflite::Interpreter& interpreter) {
   return output_tensor_sizes;
 }
 
+void DequantizeOutput(const uint8_t* data, int size, int zero_point,
+                      float scale, float* output) {
+  for (int i = 0; i < size; ++i) {
+    output[i] = (data[i] - zero_point) * scale;
+  }
+}
+
 bool RunInferenceHelper(const uint8_t* const input_data, int input_size,
                         int output_size, tflite::Interpreter* interpreter,
                         float* output_data) {
@@ -266,10 +309,9 @@ bool RunInferenceHelper(const uint8_t* const input_data, int input_size,
       const int num_values = out_tensor->bytes;
       const uint8_t* output = interpreter->typed_output_tensor<uint8_t>(i);
       CHECK(output);
-      for (int j = 0; j < num_values; ++j) {
-        output_data[out_idx++] = (output[j] - out_tensor->params.zero_point) *
-                                 out_tensor->params.scale;
-      }
+      DequantizeOutput(output, num_values, out_tensor->params.zero_point,
+                       out_tensor->params.scale, output_data + out_idx);
+      out_idx += num_values;
     } else if (out_tensor->type == kTfLiteFloat32) {
       const int num_values = out_tensor->bytes / sizeof(float);
       const float* output = interpreter->typed_output_tensor<float>(i);
@@ -297,30 +339,10 @@ bool RunInferenceHelper(const uint8_t* const input_data, int input_size,
 std::unique_ptr<tflite::Interpreter> BuildEdgeTpuInterpreter(
     const tflite::FlatBufferModel& model, BuiltinOpResolver* resolver,
     edgetpu::EdgeTpuContext* edgetpu_context,
-    EdgeTpuErrorReporter* error_reporter) {
-  if (resolver == nullptr) {
-    error_reporter->Report("nullptr resolver.");
-    return nullptr;
-  }
-  resolver->AddCustom(edgetpu::kCustomOp, edgetpu::RegisterCustomOp());
-  resolver->AddCustom(kPosenetDecoderOp, RegisterPosenetDecoderOp());
-  std::unique_ptr<tflite::Interpreter> interpreter;
-  // When BasicEngine is initializing with FlatBufferModel, it's possible that
-  // there is no ErrorReporter binded with it.
-  tflite::InterpreterBuilder interpreter_builder(model.GetModel(), *resolver,
-                                                 error_reporter);
-  if (interpreter_builder(&interpreter) != kTfLiteOk) {
-    error_reporter->Report("Error in interpreter initialization.");
-    return nullptr;
-  }
-  // Bind given context with interpreter.
-  interpreter->SetExternalContext(kTfLiteEdgeTpuContext, edgetpu_context);
-  interpreter->SetNumThreads(1);
-  if (interpreter->AllocateTensors() != kTfLiteOk) {
-    error_reporter->Report("Failed to allocate tensors.");
-    return nullptr;
-  }
-  return interpreter;
+    EdgeTpuErrorReporter* error_reporter, const std::string& model_path) {
+  CORAL_TRACE_SPAN("BuildEdgeTpuInterpreter");
+  return GetEdgeTpuDeviceManager()->BuildInterpreter(
+      model, model_path, resolver, edgetpu_context, error_reporter);
 }
 
 }  // namespace coral
@@ -5,6 +5,7 @@
 
 #include <array>
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include "absl/base/macros.h"
@@ -43,10 +44,21 @@ std::vector<uint8_t> ReadBmp(const std::string& input_bmp_name,
 void ResizeImage(const ImageDims& in_dims, const uint8_t* in,
                  const ImageDims& out_dims, uint8_t* out);
 
+// Crops `box` of an image, in coordinates normalized to [0, 1] like those of
+// DetectionCandidate, into an image of at least one pixel, whose dims it sets.
+std::vector<uint8_t> CropImage(const ImageDims& in_dims, const uint8_t* in,
+                               const Box& box, ImageDims* out_dims);
+
 // Converts RGB image to grayscale. Take the average.
 std::vector<uint8_t> RgbToGrayscale(const std::vector<uint8_t>& in,
                                     const ImageDims& in_dims);
 
+// Resizes an image into one of `out_dims`, converting it to grayscale first
+// when `out_dims` has one channel and the image is RGB(A).
+std::vector<uint8_t> ResizeImageToDims(const ImageDims& in_dims,
+                                       const uint8_t* in,
+                                       const ImageDims& out_dims);
+
 // Gets input from images and resizes to `target_dims`. Returns empty vector
 // upon failure.
 std::vector<uint8_t> GetInputFromImage(const std::string& image_path,
@@ -56,6 +68,11 @@ std::vector<uint8_t> GetInputFromImage(const std::string& image_path,
 // been allocated.
 std::vector<int> GetOutputTensorSizes(const tflite::Interpreter& interpreter);
 
+// Dequantizes `size` uint8 values of an output tensor quantized with
+// `zero_point` and `scale` into `output`.
+void DequantizeOutput(const uint8_t* data, int size, int zero_point,
+                      float scale, float* output);
+
 // Runs inference with CPU or EdgeTpu tflite model, and returns raw inference
 // results. It assumes memory of input and output tensors have been allocated
 // properly. Note that output is concatenated list of all output tensor values.
@@ -64,11 +81,14 @@ bool RunInferenceHelper(const uint8_t* const input_data, int input_size,
                         float* output);
 
 // Builds interpreter from model that can run on EdgeTpu, and allocates tensors.
+// `model_path` is the file `model` was read from, if known, which the
+// simulated Edge TPUs of SimulatedEdgeTpuManager need. See
+// EdgeTpuDeviceManager::BuildInterpreter().
 std::unique_ptr<tflite::Interpreter> BuildEdgeTpuInterpreter(
     const tflite::FlatBufferModel& model,
     tflite::ops::builtin::BuiltinOpResolver* resolver,
     edgetpu::EdgeTpuContext* edgetpu_context,
-    EdgeTpuErrorReporter* error_reporter);
+    EdgeTpuErrorReporter* error_reporter, const std::string& model_path = "");
 
 }  // namespace coral
 
@@ -0,0 +1,257 @@
+#include "edgetpu/cpp/basic/simulated_edgetpu_manager.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <random>
+#include <thread>  // NOLINT
+
+#include "edgetpu/cpp/posenet/posenet_decoder_op.h"
+#include "glog/logging.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace coral {
+namespace {
+
+constexpr char kPathPrefix[] = "/sim/edgetpu/";
+constexpr char kEdgeTpuSuffix[] = "_edgetpu.tflite";
+constexpr char kCoCompiledInfix[] = "_cocompiled_with_";
+
+// Returns the CPU model of Edge TPU model `model_path`, or an empty string if
+// it isn't an Edge TPU model.
+std::string CpuModelPath(const std::string& model_path) {
+  const size_t suffix_size = sizeof(kEdgeTpuSuffix) - 1;
+  if (model_path.size() < suffix_size ||
+      model_path.compare(model_path.size() - suffix_size, suffix_size,
+                         kEdgeTpuSuffix) != 0) {
+    return "";
+  }
+  const size_t name_start = model_path.rfind('/') + 1;
+  size_t name_end = model_path.find(kCoCompiledInfix, name_start);
+  if (name_end == std::string::npos) {
+    name_end = model_path.size() - suffix_size;
+  }
+  return model_path.substr(0, name_end) + ".tflite";
+}
+
+}  // namespace
+
+// A simulated device, which is its own context.
+class SimulatedEdgeTpu : public edgetpu::EdgeTpuContext {
+ public:
+  using DeviceRecord = EdgeTpuDeviceManager::DeviceRecord;
+
+  SimulatedEdgeTpu(const DeviceRecord& record,
+                   const SimulatedEdgeTpuOptions& options, int seed)
+      : record_(record), options_(options), generator_(seed) {
+    type = kTfLiteEdgeTpuContext;
+    Refresh = nullptr;
+  }
+
+  const DeviceRecord& GetDeviceEnumRecord() const override { return record_; }
+
+  edgetpu::EdgeTpuManager::DeviceOptions GetDeviceOptions() const override {
+    return {};
+  }
+
+  bool IsReady() const override { return true; }
+
+  // Runs an inference of model `model_key`, reloading its `parameter_bytes`
+  // if another model ran last. Returns false if the inference fails.
+  bool Run(const std::string& model_key, size_t parameter_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++stats_.num_inferences;
+    double time_ms = options_.latency_ms;
+    if (options_.jitter_ms > 0) {
+      std::normal_distribution<double> jitter(0, options_.jitter_ms);
+      time_ms = std::max(0.0, time_ms + jitter(generator_));
+    }
+    if (model_key != cached_model_) {
+      ++stats_.num_reloads;
+      cached_model_ = model_key;
+      if (options_.reload_bytes_per_second > 0) {
+        time_ms += 1000.0 * parameter_bytes / options_.reload_bytes_per_second;
+      }
+    }
+    // The device is busy meanwhile, hence sleeping with the lock held.
+    std::this_thread::sleep_for(
+        std::chrono::duration<double, std::milli>(time_ms));
+    if (options_.failure_rate > 0 &&
+        std::uniform_real_distribution<double>(0, 1)(generator_) <
+            options_.failure_rate) {
+      ++stats_.num_failures;
+      // Whatever was loaded can't be trusted anymore.
+      cached_model_.clear();
+      return false;
+    }
+    return true;
+  }
+
+  SimulatedEdgeTpuStats stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+ private:
+  const DeviceRecord record_;
+  const SimulatedEdgeTpuOptions options_;
+
+  std::mutex mutex_;
+  std::mt19937 generator_;
+  // Model whose parameters are cached on the device.
+  std::string cached_model_;
+  SimulatedEdgeTpuStats stats_;
+};
+
+namespace {
+
+// Op appended to interpreters of Edge TPU models, which takes the time of the
+// simulated device.
+struct SimulatedEdgeTpuOpData {
+  SimulatedEdgeTpu* device;
+  std::string model_key;
+  size_t parameter_bytes;
+};
+
+void* SimulatedEdgeTpuOpInit(TfLiteContext* context, const char* buffer,
+                             size_t length) {
+  return new SimulatedEdgeTpuOpData(
+      *reinterpret_cast<const SimulatedEdgeTpuOpData*>(buffer));
+}
+
+void SimulatedEdgeTpuOpFree(TfLiteContext* context, void* buffer) {
+  delete static_cast<SimulatedEdgeTpuOpData*>(buffer);
+}
+
+TfLiteStatus SimulatedEdgeTpuOpInvoke(TfLiteContext* context,
+                                      TfLiteNode* node) {
+  const auto* data = static_cast<SimulatedEdgeTpuOpData*>(node->user_data);
+  if (!data->device->Run(data->model_key, data->parameter_bytes)) {
+    context->ReportError(context, "Simulated failure of Edge TPU %s.",
+                         data->device->GetDeviceEnumRecord().path.c_str());
+    return kTfLiteError;
+  }
+  return kTfLiteOk;
+}
+
+TfLiteRegistration* RegisterSimulatedEdgeTpuOp() {
+  static TfLiteRegistration registration = {
+      SimulatedEdgeTpuOpInit, SimulatedEdgeTpuOpFree, nullptr,
+      SimulatedEdgeTpuOpInvoke};
+  registration.builtin_code = tflite::BuiltinOperator_CUSTOM;
+  registration.custom_name = "SimulatedEdgeTpuOp";
+  return &registration;
+}
+
+}  // namespace
+
+SimulatedEdgeTpuManager::SimulatedEdgeTpuManager(
+    const std::vector<SimulatedEdgeTpuOptions>& devices, int seed) {
+  for (int i = 0; i < devices.size(); ++i) {
+    DeviceRecord record;
+    record.type = devices[i].type;
+    record.path = kPathPrefix + std::to_string(i);
+    devices_.push_back(
+        std::make_shared<SimulatedEdgeTpu>(record, devices[i], seed + i));
+  }
+}
+
+SimulatedEdgeTpuManager::~SimulatedEdgeTpuManager() = default;
+
+std::vector<EdgeTpuDeviceManager::DeviceRecord>
+SimulatedEdgeTpuManager::EnumerateEdgeTpu() {
+  std::vector<DeviceRecord> records;
+  for (const auto& device : devices_) {
+    records.push_back(device->GetDeviceEnumRecord());
+  }
+  return records;
+}
+
+std::shared_ptr<edgetpu::EdgeTpuContext> SimulatedEdgeTpuManager::OpenDevice(
+    edgetpu::DeviceType type, const std::string& path,
+    const edgetpu::EdgeTpuManager::DeviceOptions& options) {
+  for (const auto& device : devices_) {
+    const DeviceRecord& record = device->GetDeviceEnumRecord();
+    if (record.type == type && (path.empty() || record.path == path)) {
+      return device;
+    }
+  }
+  return nullptr;
+}
+
+std::unique_ptr<tflite::Interpreter> SimulatedEdgeTpuManager::BuildInterpreter(
+    const tflite::FlatBufferModel& model, const std::string& model_path,
+    tflite::ops::builtin::BuiltinOpResolver* resolver,
+    edgetpu::EdgeTpuContext* context, EdgeTpuErrorReporter* error_reporter) {
+  if (resolver == nullptr) {
+    error_reporter->Report("nullptr resolver.");
+    return nullptr;
+  }
+  if (model_path.empty()) {
+    error_reporter->Report("Simulated Edge TPUs need the model path.");
+    return nullptr;
+  }
+  const auto device =
+      std::find_if(devices_.begin(), devices_.end(),
+                   [context](const std::shared_ptr<SimulatedEdgeTpu>& device) {
+                     return device.get() == context;
+                   });
+  if (device == devices_.end()) {
+    error_reporter->Report("Not a simulated Edge TPU.");
+    return nullptr;
+  }
+  resolver->AddCustom(kPosenetDecoderOp, RegisterPosenetDecoderOp());
+
+  const std::string cpu_model_path = CpuModelPath(model_path);
+  const tflite::FlatBufferModel* cpu_model = &model;
+  if (!cpu_model_path.empty()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& loaded = cpu_models_[cpu_model_path];
+    if (!loaded) {
+      loaded = tflite::FlatBufferModel::BuildFromFile(cpu_model_path.c_str(),
+                                                      error_reporter);
+    }
+    if (!loaded) {
+      error_reporter->Report("Failed to load CPU model " + cpu_model_path +
+                             " of simulated Edge TPU model " + model_path);
+      cpu_models_.erase(cpu_model_path);
+      return nullptr;
+    }
+    cpu_model = loaded.get();
+  }
+
+  std::unique_ptr<tflite::Interpreter> interpreter;
+  tflite::InterpreterBuilder interpreter_builder(cpu_model->GetModel(),
+                                                 *resolver, error_reporter);
+  if (interpreter_builder(&interpreter) != kTfLiteOk) {
+    error_reporter->Report("Error in interpreter initialization.");
+    return nullptr;
+  }
+  if (!cpu_model_path.empty()) {
+    const SimulatedEdgeTpuOpData data = {
+        device->get(), model_path,
+        model.allocation() ? model.allocation()->bytes() : 0};
+    if (interpreter->AddNodeWithParameters(
+            {}, {}, reinterpret_cast<const char*>(&data), sizeof(data),
+            nullptr, RegisterSimulatedEdgeTpuOp()) != kTfLiteOk) {
+      error_reporter->Report("Failed to add simulated Edge TPU op.");
+      return nullptr;
+    }
+  }
+  interpreter->SetNumThreads(1);
+  if (interpreter->AllocateTensors() != kTfLiteOk) {
+    error_reporter->Report("Failed to allocate tensors.");
+    return nullptr;
+  }
+  return interpreter;
+}
+
+SimulatedEdgeTpuStats SimulatedEdgeTpuManager::GetStats(
+    const std::string& path) {
+  for (const auto& device : devices_) {
+    if (device->GetDeviceEnumRecord().path == path) return device->stats();
+  }
+  LOG(FATAL) << "No simulated Edge TPU " << path;
+  return {};
+}
+
+}  // namespace coral
@@ -0,0 +1,100 @@
+#ifndef EDGETPU_CPP_BASIC_SIMULATED_EDGETPU_MANAGER_H_
+#define EDGETPU_CPP_BASIC_SIMULATED_EDGETPU_MANAGER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "edgetpu.h"
+#include "edgetpu/cpp/basic/edgetpu_device_manager.h"
+
+namespace coral {
+
+// Behavior of a simulated Edge TPU.
+struct SimulatedEdgeTpuOptions {
+  // Type the device reports. EdgeTpuResourceManager assigns PCIe devices
+  // first.
+  edgetpu::DeviceType type = edgetpu::DeviceType::kApexUsb;
+  // Time the device takes per inference, on top of running the CPU model, in
+  // milliseconds.
+  double latency_ms = 0;
+  // Standard deviation of that time, which is normally distributed and
+  // truncated at 0, in milliseconds.
+  double jitter_ms = 0;
+  // Speed at which the device reloads parameters when it runs another model
+  // than the last one, in bytes per second, or 0 for free reloads. The
+  // parameters of a model are as large as its Edge TPU model file.
+  double reload_bytes_per_second = 0;
+  // Probability that an inference fails.
+  double failure_rate = 0;
+};
+
+class SimulatedEdgeTpu;
+
+struct SimulatedEdgeTpuStats {
+  // Inferences that ran on the device, failures included.
+  int64_t num_inferences = 0;
+  int64_t num_reloads = 0;
+  int64_t num_failures = 0;
+};
+
+// Simulated Edge TPUs, such that engines, pools and schedulers run, and can be
+// tested and benchmarked, on machines without Edge TPUs.
+//
+// Instead of an Edge TPU model, e.g. `x_edgetpu.tflite` or
+// `x_cocompiled_with_y_edgetpu.tflite`, a simulated device runs the CPU model
+// next to it, `x.tflite`, and then waits as configured by
+// SimulatedEdgeTpuOptions, one inference at a time. Models without `_edgetpu`
+// run as they are, without using the device. Model paths must be known, i.e.
+// engines built from FlatBufferModels are not supported.
+//
+// Example:
+//   SimulatedEdgeTpuOptions options;
+//   options.latency_ms = 5;
+//   SetEdgeTpuDeviceManager(absl::make_unique<SimulatedEdgeTpuManager>(
+//       std::vector<SimulatedEdgeTpuOptions>(4, options)));
+//   BasicEngine engine(ModelPath("mobilenet_v1_1.0_224_quant_edgetpu.tflite"));
+//
+// This class is thread-safe.
+class SimulatedEdgeTpuManager : public EdgeTpuDeviceManager {
+ public:
+  // Simulates one Edge TPU per element of `devices`, with paths
+  // `/sim/edgetpu/0`, `/sim/edgetpu/1`, ... `seed` seeds jitter and failures.
+  explicit SimulatedEdgeTpuManager(
+      const std::vector<SimulatedEdgeTpuOptions>& devices, int seed = 1);
+  ~SimulatedEdgeTpuManager() override;
+
+  SimulatedEdgeTpuManager(const SimulatedEdgeTpuManager&) = delete;
+  SimulatedEdgeTpuManager& operator=(const SimulatedEdgeTpuManager&) = delete;
+
+  std::vector<DeviceRecord> EnumerateEdgeTpu() override;
+
+  std::shared_ptr<edgetpu::EdgeTpuContext> OpenDevice(
+      edgetpu::DeviceType type, const std::string& path,
+      const edgetpu::EdgeTpuManager::DeviceOptions& options) override;
+
+  std::unique_ptr<tflite::Interpreter> BuildInterpreter(
+      const tflite::FlatBufferModel& model, const std::string& model_path,
+      tflite::ops::builtin::BuiltinOpResolver* resolver,
+      edgetpu::EdgeTpuContext* context,
+      EdgeTpuErrorReporter* error_reporter) override;
+
+  // Returns the stats of device `path` since this manager was created.
+  SimulatedEdgeTpuStats GetStats(const std::string& path);
+
+ private:
+  std::vector<std::shared_ptr<SimulatedEdgeTpu>> devices_;
+
+  // Guards `cpu_models_`.
+  std::mutex mutex_;
+  // CPU models by path, which interpreters refer to, loaded once.
+  std::map<std::string, std::shared_ptr<tflite::FlatBufferModel>> cpu_models_;
+};
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_BASIC_SIMULATED_EDGETPU_MANAGER_H_
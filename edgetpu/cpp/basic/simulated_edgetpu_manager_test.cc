@@ -0,0 +1,128 @@
+#include "edgetpu/cpp/basic/simulated_edgetpu_manager.h"
+
+#include "absl/memory/memory.h"
+#include "edgetpu/cpp/basic/basic_engine.h"
+#include "edgetpu/cpp/basic/basic_engine_native.h"
+#include "edgetpu/cpp/basic/edgetpu_resource_manager.h"
+#include "edgetpu/cpp/test_utils.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace coral {
+namespace {
+
+using EdgeTpuState = EdgeTpuResourceManager::EdgeTpuState;
+
+constexpr char kEdgeTpuModel[] = "mobilenet_v1_0.25_128_quant_edgetpu.tflite";
+constexpr char kOtherEdgeTpuModel[] =
+    "mobilenet_v1_0.5_160_quant_edgetpu.tflite";
+
+class SimulatedEdgeTpuManagerTest : public ::testing::Test {
+ protected:
+  // Installs simulated devices, owned by the device manager.
+  SimulatedEdgeTpuManager* Simulate(
+      const std::vector<SimulatedEdgeTpuOptions>& devices) {
+    auto manager = absl::make_unique<SimulatedEdgeTpuManager>(devices);
+    SimulatedEdgeTpuManager* simulated = manager.get();
+    SetEdgeTpuDeviceManager(std::move(manager));
+    return simulated;
+  }
+
+  void TearDown() override {
+    EXPECT_TRUE(EdgeTpuResourceManager::GetSingleton()
+                    ->ListEdgeTpuPaths(EdgeTpuState::kAssigned)
+                    .empty());
+    SetEdgeTpuDeviceManager(nullptr);
+  }
+};
+
+TEST_F(SimulatedEdgeTpuManagerTest, ListsDevices) {
+  Simulate(std::vector<SimulatedEdgeTpuOptions>(3));
+  EXPECT_EQ(std::vector<std::string>(
+                {"/sim/edgetpu/0", "/sim/edgetpu/1", "/sim/edgetpu/2"}),
+            EdgeTpuResourceManager::GetSingleton()->ListEdgeTpuPaths(
+                EdgeTpuState::kUnassigned));
+}
+
+TEST_F(SimulatedEdgeTpuManagerTest, RunsCpuModel) {
+  SimulatedEdgeTpuManager* manager =
+      Simulate(std::vector<SimulatedEdgeTpuOptions>(2));
+  BasicEngine engine(ModelPath(kEdgeTpuModel));
+  BasicEngine cpu_engine(ModelPath("mobilenet_v1_0.25_128_quant.tflite"));
+  EXPECT_NE(engine.device_path(), cpu_engine.device_path());
+  const auto input = GetRandomInput(engine.get_input_tensor_shape());
+  EXPECT_EQ(cpu_engine.RunInference(input), engine.RunInference(input));
+  // Only the Edge TPU model uses its device.
+  EXPECT_EQ(1, manager->GetStats(engine.device_path()).num_inferences);
+  EXPECT_EQ(0, manager->GetStats(cpu_engine.device_path()).num_inferences);
+}
+
+TEST_F(SimulatedEdgeTpuManagerTest, AddsLatency) {
+  SimulatedEdgeTpuOptions options;
+  options.latency_ms = 50;
+  Simulate({options});
+  BasicEngine engine(ModelPath(kEdgeTpuModel));
+  engine.RunInference(GetRandomInput(engine.get_input_tensor_shape()));
+  EXPECT_GE(engine.get_inference_time(), 50);
+}
+
+TEST_F(SimulatedEdgeTpuManagerTest, ReloadsParametersOfOtherModels) {
+  SimulatedEdgeTpuOptions options;
+  // 10 ms per MB.
+  options.reload_bytes_per_second = 100e6;
+  SimulatedEdgeTpuManager* manager = Simulate({options});
+  BasicEngine engine(ModelPath(kEdgeTpuModel));
+  BasicEngine other_engine(ModelPath(kOtherEdgeTpuModel),
+                           engine.device_path());
+  const auto input = GetRandomInput(engine.get_input_tensor_shape());
+  const auto other_input =
+      GetRandomInput(other_engine.get_input_tensor_shape());
+  engine.RunInference(input);
+  engine.RunInference(input);
+  EXPECT_EQ(1, manager->GetStats(engine.device_path()).num_reloads);
+  for (int i = 0; i < 3; ++i) {
+    other_engine.RunInference(other_input);
+    engine.RunInference(input);
+  }
+  const SimulatedEdgeTpuStats stats = manager->GetStats(engine.device_path());
+  EXPECT_EQ(8, stats.num_inferences);
+  EXPECT_EQ(7, stats.num_reloads);
+  EXPECT_EQ(0, stats.num_failures);
+}
+
+TEST_F(SimulatedEdgeTpuManagerTest, InjectsFailures) {
+  SimulatedEdgeTpuOptions options;
+  options.failure_rate = 1;
+  SimulatedEdgeTpuManager* manager = Simulate({options});
+  BasicEngineNativeBuilder builder(ModelPath(kEdgeTpuModel));
+  std::unique_ptr<BasicEngineNative> engine;
+  ASSERT_EQ(kEdgeTpuApiOk, builder(&engine)) << builder.get_error_message();
+  int input_size;
+  ASSERT_EQ(kEdgeTpuApiOk, engine->get_input_array_size(&input_size));
+  const auto input = GetRandomInput(input_size);
+  float const* output;
+  int output_size;
+  EXPECT_EQ(kEdgeTpuApiError, engine->RunInference(input.data(), input.size(),
+                                                   &output, &output_size));
+  EXPECT_EQ(1, manager->GetStats("/sim/edgetpu/0").num_failures);
+}
+
+TEST_F(SimulatedEdgeTpuManagerTest, NeedsModelPath) {
+  Simulate({SimulatedEdgeTpuOptions()});
+  BasicEngineNativeBuilder builder(
+      tflite::FlatBufferModel::BuildFromFile(ModelPath(kEdgeTpuModel).c_str()));
+  std::unique_ptr<BasicEngineNative> engine;
+  EXPECT_EQ(kEdgeTpuApiError, builder(&engine));
+  EXPECT_EQ("Simulated Edge TPUs need the model path.",
+            builder.get_error_message());
+}
+
+}  // namespace
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,236 @@
+// Benchmarks the pre- and post-processing that runs on the host around Edge TPU
+// inferences: image decoding, resizing and grayscale conversion, output
+// dequantization, top-k of classification and detection results, and IoU.
+// None of them needs an Edge TPU, so this runs on any dev box.
+//
+// Results are printed as JSON by default, such that runs can be diffed, e.g.
+//   host_kernels --benchmark_out=before.json
+// Pass --benchmark_format=console for a table.
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "edgetpu/cpp/basic/inference_utils.h"
+#include "edgetpu/cpp/classification/engine.h"
+#include "edgetpu/cpp/detection/engine.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DEFINE_string(tmp_dir, "/tmp",
+              "Directory to write the BMP images read by the benchmarks.");
+
+namespace coral {
+namespace {
+
+// Input sizes of the models we ship, and of the larger PoseNet one, which
+// camera frames are about the size of.
+void ImageSizes(benchmark::internal::Benchmark* b) {
+  b->Args({224, 224})->Args({299, 299})->Args({300, 300})->Args({481, 641});
+}
+
+// Images of the sizes above, resized to each model input size.
+void ResizeSizes(benchmark::internal::Benchmark* b) {
+  const int sizes[][2] = {{224, 224}, {299, 299}, {300, 300}, {481, 641}};
+  for (const auto& size : sizes) {
+    for (const int model_size : {224, 299, 300}) {
+      if (size[0] != model_size) b->Args({size[0], size[1], model_size});
+    }
+  }
+}
+
+std::vector<uint8_t> RandomBytes(int size, int seed) {
+  std::mt19937 generator(seed);
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::vector<uint8_t> bytes(size);
+  for (auto& b : bytes) b = byte(generator);
+  return bytes;
+}
+
+// Returns random scores of `num_classes` classes, most of them low like the
+// softmax output of a classifier.
+std::vector<float> RandomScores(int num_classes, int seed) {
+  std::mt19937 generator(seed);
+  std::exponential_distribution<float> score(1000);
+  std::vector<float> scores(num_classes);
+  for (auto& s : scores) s = std::min(1.0f, score(generator));
+  return scores;
+}
+
+// Writes a random 24-bit bottom-up BMP image and returns its path.
+std::string WriteRandomBmp(int height, int width) {
+  const std::string path = FLAGS_tmp_dir + "/host_kernels_" +
+                           std::to_string(height) + "x" +
+                           std::to_string(width) + ".bmp";
+  const int row_size = (3 * width + 3) / 4 * 4;
+  const int pixels_size = row_size * height;
+  const int header_size = 54;
+  std::vector<uint8_t> file(header_size);
+  const auto put_int = [&file](int offset, int size, int value) {
+    for (int i = 0; i < size; ++i) file[offset + i] = (value >> (8 * i)) & 0xff;
+  };
+  file[0] = 'B';
+  file[1] = 'M';
+  put_int(2, 4, header_size + pixels_size);
+  put_int(10, 4, header_size);
+  put_int(14, 4, 40);
+  put_int(18, 4, width);
+  put_int(22, 4, height);
+  put_int(26, 2, 1);
+  put_int(28, 2, 24);
+  put_int(34, 4, pixels_size);
+  const auto pixels = RandomBytes(pixels_size, height * width);
+  file.insert(file.end(), pixels.begin(), pixels.end());
+
+  FILE* f = std::fopen(path.c_str(), "wb");
+  CHECK(f) << "Cannot open " << path;
+  CHECK_EQ(file.size(), std::fwrite(file.data(), 1, file.size(), f));
+  CHECK_EQ(0, std::fclose(f));
+  return path;
+}
+
+void BM_ReadBmp(benchmark::State& state) {
+  const std::string path = WriteRandomBmp(state.range(0), state.range(1));
+  ImageDims dims;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ReadBmp(path, &dims));
+  }
+  state.SetBytesProcessed(state.iterations() * ImageDimsToSize(dims));
+}
+BENCHMARK(BM_ReadBmp)->Apply(ImageSizes);
+
+// Resizes images to the input size of a model, `state.range(2)` squared.
+void BM_ResizeImage(benchmark::State& state) {
+  const ImageDims in_dims = {static_cast<int>(state.range(0)),
+                             static_cast<int>(state.range(1)), 3};
+  const ImageDims out_dims = {static_cast<int>(state.range(2)),
+                              static_cast<int>(state.range(2)), 3};
+  const auto in = RandomBytes(ImageDimsToSize(in_dims), 1);
+  std::vector<uint8_t> out(ImageDimsToSize(out_dims));
+  for (auto _ : state) {
+    ResizeImage(in_dims, in.data(), out_dims, out.data());
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.SetBytesProcessed(state.iterations() * in.size());
+}
+BENCHMARK(BM_ResizeImage)->Apply(ResizeSizes);
+
+void BM_RgbToGrayscale(benchmark::State& state) {
+  const ImageDims dims = {static_cast<int>(state.range(0)),
+                          static_cast<int>(state.range(1)), 3};
+  const auto in = RandomBytes(ImageDimsToSize(dims), 1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(RgbToGrayscale(in, dims));
+  }
+  state.SetBytesProcessed(state.iterations() * in.size());
+}
+BENCHMARK(BM_RgbToGrayscale)->Apply(ImageSizes);
+
+// Reads, converts and resizes images to a 224x224 RGB input, as the examples
+// do.
+void BM_GetInputFromImage(benchmark::State& state) {
+  const std::string path = WriteRandomBmp(state.range(0), state.range(1));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(GetInputFromImage(path, {224, 224, 3}));
+  }
+}
+BENCHMARK(BM_GetInputFromImage)->Apply(ImageSizes);
+
+void BM_DequantizeOutput(benchmark::State& state) {
+  const auto data = RandomBytes(state.range(0), 1);
+  std::vector<float> output(data.size());
+  for (auto _ : state) {
+    DequantizeOutput(data.data(), data.size(), /*zero_point=*/0,
+                     /*scale=*/1.0f / 256, output.data());
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetItemsProcessed(state.iterations() * data.size());
+}
+// Classification heads, and the raw boxes and class scores of SSD models.
+BENCHMARK(BM_DequantizeOutput)
+    ->Arg(1001)
+    ->Arg(10000)
+    ->Arg(1917 * 4)
+    ->Arg(1917 * 91);
+
+// Top `state.range(1)` classes of `state.range(0)`.
+void BM_GetTopClassificationCandidates(benchmark::State& state) {
+  const auto scores = RandomScores(state.range(0), 1);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(GetTopClassificationCandidates(
+        scores, /*threshold=*/0, state.range(1)));
+  }
+  state.SetItemsProcessed(state.iterations() * scores.size());
+}
+BENCHMARK(BM_GetTopClassificationCandidates)
+    ->Args({1001, 1})
+    ->Args({1001, 5})
+    ->Args({1001, 100})
+    ->Args({10000, 1})
+    ->Args({10000, 5})
+    ->Args({10000, 100});
+
+// Top `state.range(1)` of `state.range(0)` detections, the outputs of the
+// postprocessing operator of SSD models.
+void BM_GetTopDetectionCandidates(benchmark::State& state) {
+  const int num_detections = state.range(0);
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<float> coordinate(-0.1, 1.1);
+  std::vector<std::vector<float>> output(4);
+  for (int i = 0; i < num_detections; ++i) {
+    const float y = coordinate(generator), x = coordinate(generator);
+    output[0].insert(output[0].end(), {y, x, y + 0.2f, x + 0.2f});
+    output[1].push_back(i % 90);
+  }
+  output[2] = RandomScores(num_detections, 2);
+  std::sort(output[2].rbegin(), output[2].rend());
+  output[3] = {static_cast<float>(num_detections)};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        GetTopDetectionCandidates(output, /*threshold=*/0, state.range(1)));
+  }
+  state.SetItemsProcessed(state.iterations() * num_detections);
+}
+BENCHMARK(BM_GetTopDetectionCandidates)
+    ->Args({20, 3})
+    ->Args({20, 10})
+    ->Args({100, 3})
+    ->Args({100, 10});
+
+// IoU of every pair of `state.range(0)` boxes, as in non-maximum suppression.
+void BM_IntersectionOverUnion(benchmark::State& state) {
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<float> coordinate(0, 0.8);
+  std::vector<Box> boxes(state.range(0));
+  for (auto& box : boxes) {
+    const float x = coordinate(generator), y = coordinate(generator);
+    box = {x, y, x + 0.2f, y + 0.2f};
+  }
+  for (auto _ : state) {
+    float sum = 0;
+    for (const auto& a : boxes) {
+      for (const auto& b : boxes) sum += IntersectionOverUnion(a, b);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * boxes.size() * boxes.size());
+}
+BENCHMARK(BM_IntersectionOverUnion)->Arg(10)->Arg(100);
+
+}  // namespace
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  // JSON unless told otherwise; later flags win.
+  std::vector<char*> args(argv, argv + argc + 1);
+  char json_format[] = "--benchmark_format=json";
+  args.insert(args.begin() + 1, json_format);
+  int num_args = argc + 1;
+  char** args_data = args.data();
+  benchmark::Initialize(&num_args, args_data);
+  gflags::ParseCommandLineFlags(&num_args, &args_data, true);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
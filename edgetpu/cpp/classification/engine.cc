@@ -5,6 +5,7 @@
 #include <queue>
 #include <tuple>
 
+#include "edgetpu/cpp/tracing.h"
 #include "glog/logging.h"
 
 namespace coral {
@@ -25,10 +26,9 @@ void ClassificationEngine::Validate() {
          "only!";
 }
 
-std::vector<ClassificationCandidate>
-ClassificationEngine::ClassifyWithInputTensor(const std::vector<uint8_t>& input,
-                                              float threshold, int top_k) {
-  std::vector<float> scores = RunInference(input)[0];
+std::vector<ClassificationCandidate> GetTopClassificationCandidates(
+    const std::vector<float>& scores, float threshold, int top_k) {
+  CORAL_TRACE_SPAN("GetTopClassificationCandidates");
   std::priority_queue<ClassificationCandidate,
                       std::vector<ClassificationCandidate>,
                       ClassificationCandidateComparator>
@@ -48,4 +48,11 @@ ClassificationEngine::ClassifyWithInputTensor(const std::vector<uint8_t>& input,
   return ret;
 }
 
+std::vector<ClassificationCandidate>
+ClassificationEngine::ClassifyWithInputTensor(const std::vector<uint8_t>& input,
+                                              float threshold, int top_k) {
+  return GetTopClassificationCandidates(RunInference(input)[0], threshold,
+                                        top_k);
+}
+
 }  // namespace coral
@@ -24,6 +24,12 @@ inline bool operator!=(const ClassificationCandidate& x,
   return !(x == y);
 }
 
+// Returns the candidates among `scores` of classes 0, 1, ... with a score of at
+// least `threshold`, at most `top_k` of them, sorted by <score, label_id> in
+// descending order.
+std::vector<ClassificationCandidate> GetTopClassificationCandidates(
+    const std::vector<float>& scores, float threshold, int top_k);
+
 class ClassificationEngine : public BasicEngine {
  public:
   // Loads classification model.
@@ -29,6 +29,18 @@ TEST(ClassificationEngineTest, ClassificationCandidate) {
   EXPECT_TRUE(a != tmp);
 }
 
+TEST(ClassificationEngineTest, GetTopClassificationCandidates) {
+  const std::vector<float> scores = {0.1, 0.4, 0.05, 0.4, 0.3};
+  EXPECT_THAT(GetTopClassificationCandidates(scores, 0.0, 3),
+              ElementsAre(ClassificationCandidate(3, 0.4),
+                          ClassificationCandidate(1, 0.4),
+                          ClassificationCandidate(4, 0.3)));
+  EXPECT_THAT(GetTopClassificationCandidates(scores, 0.35, 3),
+              ElementsAre(ClassificationCandidate(3, 0.4),
+                          ClassificationCandidate(1, 0.4)));
+  EXPECT_TRUE(GetTopClassificationCandidates(scores, 0.5, 3).empty());
+}
+
 TEST(ClassificationEngineTest, TestDebugFunctions) {
   // Load the model.
   ClassificationEngine mobilenet_engine(
@@ -6,6 +6,7 @@
 #include <queue>
 #include <tuple>
 
+#include "edgetpu/cpp/tracing.h"
 #include "glog/logging.h"
 
 namespace coral {
@@ -29,9 +30,10 @@ void DetectionEngine::Validate() {
   CHECK_EQ(output_tensor_sizes[3], 1);
 }
 
-std::vector<DetectionCandidate> DetectionEngine::DetectWithInputTensor(
-    const std::vector<uint8_t>& input, float threshold, int top_k) {
-  std::vector<std::vector<float>> output = RunInference(input);
+std::vector<DetectionCandidate> GetTopDetectionCandidates(
+    const std::vector<std::vector<float>>& output, float threshold,
+    int top_k) {
+  CORAL_TRACE_SPAN("GetTopDetectionCandidates");
   int n = lround(output[3][0]);
 
   std::priority_queue<DetectionCandidate, std::vector<DetectionCandidate>,
@@ -59,4 +61,9 @@ std::vector<DetectionCandidate> DetectionEngine::DetectWithInputTensor(
   return ret;
 }
 
+std::vector<DetectionCandidate> DetectionEngine::DetectWithInputTensor(
+    const std::vector<uint8_t>& input, float threshold, int top_k) {
+  return GetTopDetectionCandidates(RunInference(input), threshold, top_k);
+}
+
 }  // namespace coral
@@ -24,6 +24,13 @@ inline bool operator!=(const DetectionCandidate& x,
   return !(x == y);
 }
 
+// Returns the candidates among the outputs of an SSD model with postprocessing
+// operator, i.e. <bounding boxes, label ids, scores, number of predictions>,
+// with a score of at least `threshold`, at most `top_k` of them, sorted by
+// <score, label_id> in descending order.
+std::vector<DetectionCandidate> GetTopDetectionCandidates(
+    const std::vector<std::vector<float>>& output, float threshold, int top_k);
+
 class DetectionEngine : public BasicEngine {
  public:
   // Loads detection model. Now we only support SSD model with postprocessing
@@ -31,6 +31,22 @@ TEST(DetectionEngineTest, TestDetectionCandidate) {
   EXPECT_TRUE(a != tmp);
 }
 
+TEST(DetectionEngineTest, GetTopDetectionCandidates) {
+  // Boxes are in y1, x1, y2, x2 order, and get clamped to [0, 1]. The last
+  // prediction is beyond the number of predictions.
+  const std::vector<std::vector<float>> output = {
+      {0.1, 0.2, 0.5, 0.6, -0.1, 0.0, 0.3, 1.2, 0.0, 0.0, 1.0, 1.0},
+      {4, 7, 2},
+      {0.3, 0.8, 0.9},
+      {2}};
+  EXPECT_THAT(GetTopDetectionCandidates(output, 0.0, 3),
+              ElementsAre(DetectionCandidate({7, 0.8, {0.0, 0.0, 1.0, 0.3}}),
+                          DetectionCandidate({4, 0.3, {0.2, 0.1, 0.6, 0.5}})));
+  EXPECT_THAT(GetTopDetectionCandidates(output, 0.0, 1),
+              ElementsAre(DetectionCandidate({7, 0.8, {0.0, 0.0, 1.0, 0.3}})));
+  EXPECT_TRUE(GetTopDetectionCandidates(output, 0.85, 3).empty());
+}
+
 TEST(DetectionEngineTest, TestDebugFunctions) {
   // Load the model.
   DetectionEngine engine(
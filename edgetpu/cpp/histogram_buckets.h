@@ -0,0 +1,44 @@
+#ifndef EDGETPU_CPP_HISTOGRAM_BUCKETS_H_
+#define EDGETPU_CPP_HISTOGRAM_BUCKETS_H_
+
+#include <cstdint>
+
+namespace coral {
+
+// Log-linear buckets of the latency histograms, LatencyHistogram and
+// ConcurrentLatencyHistogram.
+//
+// Values below 2^precision_bits have buckets of their own. Above, a value with
+// its most significant bit at b >= precision_bits goes to bucket
+// shift * half + (value >> shift), where shift = b - precision_bits + 1 and
+// half = 2^(precision_bits - 1), such that every power of 2 spans `half`
+// buckets.
+
+// Returns the index of the most significant bit set in `value` > 0.
+inline int MostSignificantBit(uint64_t value) {
+  int bit = 0;
+  while (value >>= 1) ++bit;
+  return bit;
+}
+
+// Returns the bucket of `value` >= 0.
+inline int HistogramBucketIndex(int64_t value, int precision_bits) {
+  const int64_t sub_buckets = int64_t{1} << precision_bits;
+  if (value < sub_buckets) return value;
+  const int shift = MostSignificantBit(value) - precision_bits + 1;
+  return shift * (sub_buckets / 2) + (value >> shift);
+}
+
+// Returns the largest value of bucket `index`.
+inline int64_t HistogramBucketMaxValue(int index, int precision_bits) {
+  const int64_t sub_buckets = int64_t{1} << precision_bits;
+  if (index < sub_buckets) return index;
+  const int half = sub_buckets / 2;
+  const int shift = index / half - 1;
+  const int64_t mantissa = index - shift * half;
+  return ((mantissa + 1) << shift) - 1;
+}
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_HISTOGRAM_BUCKETS_H_
@@ -0,0 +1,339 @@
+#include "edgetpu/cpp/learn/backprop/softmax_regression_trainer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>  // NOLINT
+#include <limits>
+#include <mutex>  // NOLINT
+#include <numeric>
+#include <random>
+#include <thread>  // NOLINT
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "edgetpu/cpp/learn/utils.h"
+#include "glog/logging.h"
+
+namespace coral {
+namespace learn {
+namespace backprop {
+
+namespace {
+
+// Returns the dot product of two float vectors of length `size`.
+float Dot(const float* a, const float* b, int size) {
+  int i = 0;
+  float result = 0.0f;
+#if defined(__AVX2__)
+  __m256 acc = _mm256_setzero_ps();
+  for (; i + 8 <= size; i += 8) {
+    acc = _mm256_add_ps(
+        acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+  }
+  float lanes[8];
+  _mm256_storeu_ps(lanes, acc);
+  for (float lane : lanes) result += lane;
+#elif defined(__SSE4_1__)
+  __m128 acc = _mm_setzero_ps();
+  for (; i + 4 <= size; i += 4) {
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, acc);
+  for (float lane : lanes) result += lane;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  float32x4_t acc = vdupq_n_f32(0.0f);
+  for (; i + 4 <= size; i += 4) {
+    acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+  }
+  float lanes[4];
+  vst1q_f32(lanes, acc);
+  for (float lane : lanes) result += lane;
+#endif
+  for (; i < size; ++i) {
+    result += a[i] * b[i];
+  }
+  return result;
+}
+
+// Computes y = decay * y + a * x, for vectors of length `size`.
+void ScaleAndAdd(float decay, float a, const float* x, float* y, int size) {
+  int i = 0;
+#if defined(__AVX2__)
+  const __m256 vdecay = _mm256_set1_ps(decay);
+  const __m256 va = _mm256_set1_ps(a);
+  for (; i + 8 <= size; i += 8) {
+    _mm256_storeu_ps(
+        y + i, _mm256_add_ps(_mm256_mul_ps(vdecay, _mm256_loadu_ps(y + i)),
+                             _mm256_mul_ps(va, _mm256_loadu_ps(x + i))));
+  }
+#elif defined(__SSE4_1__)
+  const __m128 vdecay = _mm_set1_ps(decay);
+  const __m128 va = _mm_set1_ps(a);
+  for (; i + 4 <= size; i += 4) {
+    _mm_storeu_ps(y + i, _mm_add_ps(_mm_mul_ps(vdecay, _mm_loadu_ps(y + i)),
+                                    _mm_mul_ps(va, _mm_loadu_ps(x + i))));
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  const float32x4_t vdecay = vdupq_n_f32(decay);
+  for (; i + 4 <= size; i += 4) {
+    vst1q_f32(y + i, vmlaq_n_f32(vmulq_f32(vdecay, vld1q_f32(y + i)),
+                                 vld1q_f32(x + i), a));
+  }
+#endif
+  for (; i < size; ++i) {
+    y[i] = decay * y[i] + a * x[i];
+  }
+}
+
+// Replaces `logits` of `num_classes` classes with their softmax.
+void Softmax(int num_classes, float* logits) {
+  const float max_logit = *std::max_element(logits, logits + num_classes);
+  float sum = 0.0f;
+  for (int i = 0; i < num_classes; ++i) {
+    logits[i] = std::exp(logits[i] - max_logit);
+    sum += logits[i];
+  }
+  for (int i = 0; i < num_classes; ++i) {
+    logits[i] /= sum;
+  }
+}
+
+// Blocks threads until `count` of them are waiting.
+class Barrier {
+ public:
+  explicit Barrier(int count)
+      : count_(count), num_waiting_(0), generation_(0) {}
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    const int generation = generation_;
+    if (++num_waiting_ == count_) {
+      num_waiting_ = 0;
+      ++generation_;
+      condition_.notify_all();
+    } else {
+      condition_.wait(lock,
+                      [this, generation] { return generation != generation_; });
+    }
+  }
+
+ private:
+  const int count_;
+  int num_waiting_;
+  int generation_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+};
+
+// Returns the beginning of part `index` out of `num_parts` of [0, size).
+int PartBegin(int size, int index, int num_parts) {
+  return static_cast<int64_t>(size) * index / num_parts;
+}
+
+}  // namespace
+
+SoftmaxRegressionTrainer::SoftmaxRegressionTrainer(int feature_dim,
+                                                   int num_classes)
+    : feature_dim_(feature_dim),
+      num_classes_(num_classes),
+      weights_(feature_dim * num_classes, 0.0f),
+      biases_(num_classes, 0.0f) {
+  CHECK_GT(feature_dim, 0);
+  CHECK_GT(num_classes, 1);
+  error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
+}
+
+EdgeTpuApiStatus SoftmaxRegressionTrainer::AddImages(
+    BasicEngineNative* extractor, const uint8_t* images, int num_images,
+    int image_size, int label) {
+  EDGETPU_API_REPORT_ERROR(error_reporter_, !extractor,
+                           "Embedding extractor is null!");
+  EDGETPU_API_REPORT_ERROR(error_reporter_, label < 0 || label >= num_classes_,
+                           absl::StrCat("Label ", label, " is out of range!"));
+  for (int i = 0; i < num_images; ++i) {
+    float const* embedding;
+    int embedding_size;
+    EDGETPU_API_REPORT_ERROR(
+        error_reporter_,
+        extractor->RunInference(images + i * image_size, image_size,
+                                &embedding,
+                                &embedding_size) == kEdgeTpuApiError,
+        extractor->get_error_message());
+    EDGETPU_API_REPORT_ERROR(
+        error_reporter_, embedding_size != feature_dim_,
+        absl::StrCat("Embedding size is ", embedding_size, " instead of ",
+                     feature_dim_, "!"));
+    embeddings_.insert(embeddings_.end(), embedding,
+                       embedding + embedding_size);
+    labels_.push_back(label);
+  }
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus SoftmaxRegressionTrainer::AddEmbeddings(
+    const float* embeddings, int num_embeddings, int label) {
+  EDGETPU_API_REPORT_ERROR(error_reporter_, label < 0 || label >= num_classes_,
+                           absl::StrCat("Label ", label, " is out of range!"));
+  embeddings_.insert(embeddings_.end(), embeddings,
+                     embeddings + num_embeddings * feature_dim_);
+  labels_.insert(labels_.end(), num_embeddings, label);
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus SoftmaxRegressionTrainer::Train(const TrainConfig& config) {
+  EDGETPU_API_REPORT_ERROR(error_reporter_, labels_.empty(),
+                           "No embeddings to train on!");
+  EDGETPU_API_REPORT_ERROR(error_reporter_, config.batch_size <= 0,
+                           "Batch size must be positive!");
+  EDGETPU_API_REPORT_ERROR(error_reporter_, config.learning_rate <= 0,
+                           "Learning rate must be positive!");
+  EDGETPU_API_REPORT_ERROR(error_reporter_, config.l2_reg < 0,
+                           "L2 regularization must not be negative!");
+
+  const int num_embeddings = labels_.size();
+  const int batch_size = std::min(config.batch_size, num_embeddings);
+  int num_threads = config.num_threads > 0
+                        ? config.num_threads
+                        : std::max<int>(1, std::thread::hardware_concurrency());
+  num_threads = std::min(num_threads, std::max(batch_size, num_classes_));
+
+  // Batches are consecutive rows of `order`, shuffled at each pass. Thread 0
+  // samples the next batch while all threads update the weights with the
+  // current one, hence two buffers.
+  std::mt19937 generator(config.seed);
+  std::vector<int> order(num_embeddings);
+  std::iota(order.begin(), order.end(), 0);
+  int next_row = num_embeddings;
+  std::vector<int> batches[2];
+  auto sample_batch = [&](std::vector<int>* batch) {
+    batch->clear();
+    while (batch->size() < batch_size) {
+      if (next_row == num_embeddings) {
+        std::shuffle(order.begin(), order.end(), generator);
+        next_row = 0;
+      }
+      batch->push_back(order[next_row++]);
+    }
+  };
+  sample_batch(&batches[0]);
+
+  // Gradients of the loss with respect to the logits of the batch.
+  std::vector<float> logit_gradients(batch_size * num_classes_);
+  const float decay = 1.0f - config.learning_rate * config.l2_reg;
+  Barrier barrier(num_threads);
+  auto worker = [&](int thread_index) {
+    const int batch_begin = PartBegin(batch_size, thread_index, num_threads);
+    const int batch_end = PartBegin(batch_size, thread_index + 1, num_threads);
+    const int class_begin = PartBegin(num_classes_, thread_index, num_threads);
+    const int class_end =
+        PartBegin(num_classes_, thread_index + 1, num_threads);
+    for (int iteration = 0; iteration < config.num_iterations; ++iteration) {
+      const std::vector<int>& batch = batches[iteration % 2];
+      // Gradients of the mean cross-entropy are (softmax - one hot) / size.
+      for (int i = batch_begin; i < batch_end; ++i) {
+        float* gradients = &logit_gradients[i * num_classes_];
+        ComputeLogits(&embeddings_[batch[i] * feature_dim_], gradients);
+        Softmax(num_classes_, gradients);
+        gradients[labels_[batch[i]]] -= 1.0f;
+        for (int c = 0; c < num_classes_; ++c) gradients[c] /= batch_size;
+      }
+      barrier.Wait();
+
+      if (thread_index == 0 && iteration + 1 < config.num_iterations) {
+        sample_batch(&batches[(iteration + 1) % 2]);
+      }
+      for (int c = class_begin; c < class_end; ++c) {
+        float* weights = &weights_[c * feature_dim_];
+        for (int i = 0; i < batch_size; ++i) {
+          const float step =
+              -config.learning_rate * logit_gradients[i * num_classes_ + c];
+          // Regularization decays the weights once per batch.
+          ScaleAndAdd(i == 0 ? decay : 1.0f, step,
+                      &embeddings_[batch[i] * feature_dim_], weights,
+                      feature_dim_);
+          biases_[c] += step;
+        }
+      }
+      barrier.Wait();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads; ++i) {
+    threads.emplace_back(worker, i);
+  }
+  worker(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return kEdgeTpuApiOk;
+}
+
+void SoftmaxRegressionTrainer::ComputeLogits(const float* embedding,
+                                             float* logits) const {
+  for (int c = 0; c < num_classes_; ++c) {
+    logits[c] = Dot(&weights_[c * feature_dim_], embedding, feature_dim_) +
+                biases_[c];
+  }
+}
+
+int SoftmaxRegressionTrainer::Classify(const float* embedding) const {
+  std::vector<float> logits(num_classes_);
+  ComputeLogits(embedding, logits.data());
+  return std::distance(logits.begin(),
+                       std::max_element(logits.begin(), logits.end()));
+}
+
+float SoftmaxRegressionTrainer::GetAccuracy() const {
+  if (labels_.empty()) return 0.0f;
+  int num_correct = 0;
+  for (int i = 0; i < labels_.size(); ++i) {
+    num_correct += Classify(&embeddings_[i * feature_dim_]) == labels_[i];
+  }
+  return static_cast<float>(num_correct) / labels_.size();
+}
+
+float SoftmaxRegressionTrainer::GetLoss() const {
+  if (labels_.empty()) return 0.0f;
+  std::vector<float> logits(num_classes_);
+  double loss = 0.0;
+  for (int i = 0; i < labels_.size(); ++i) {
+    ComputeLogits(&embeddings_[i * feature_dim_], logits.data());
+    const float max_logit = *std::max_element(logits.begin(), logits.end());
+    float sum = 0.0f;
+    for (float logit : logits) sum += std::exp(logit - max_logit);
+    loss += max_logit + std::log(sum) - logits[labels_[i]];
+  }
+  return loss / labels_.size();
+}
+
+EdgeTpuApiStatus SoftmaxRegressionTrainer::AppendLayerToModel(
+    const std::string& in_model_path, const std::string& out_model_path) {
+  EDGETPU_API_REPORT_ERROR(error_reporter_, labels_.empty(),
+                           "No embeddings to compute the range of logits!");
+  float min_logit = std::numeric_limits<float>::max();
+  float max_logit = std::numeric_limits<float>::lowest();
+  std::vector<float> logits(num_classes_);
+  for (int i = 0; i < labels_.size(); ++i) {
+    ComputeLogits(&embeddings_[i * feature_dim_], logits.data());
+    for (float logit : logits) {
+      min_logit = std::min(min_logit, logit);
+      max_logit = std::max(max_logit, logit);
+    }
+  }
+  return AppendFullyConnectedAndSoftmaxLayerToModel(
+      in_model_path, out_model_path, weights_.data(), weights_.size(),
+      biases_.data(), biases_.size(), min_logit, max_logit,
+      error_reporter_.get());
+}
+
+}  // namespace backprop
+}  // namespace learn
+}  // namespace coral
@@ -0,0 +1,130 @@
+#ifndef EDGETPU_CPP_LEARN_BACKPROP_SOFTMAX_REGRESSION_TRAINER_H_
+#define EDGETPU_CPP_LEARN_BACKPROP_SOFTMAX_REGRESSION_TRAINER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "edgetpu/cpp/basic/basic_engine_native.h"
+#include "edgetpu/cpp/error_reporter.h"
+
+namespace coral {
+namespace learn {
+namespace backprop {
+
+// Hyperparameters of SoftmaxRegressionTrainer::Train().
+struct TrainConfig {
+  // Number of mini-batch updates.
+  int num_iterations = 500;
+  // Number of embeddings per mini-batch, sampled without replacement within
+  // each pass over the training data.
+  int batch_size = 100;
+  float learning_rate = 0.01f;
+  // Weight of the L2 regularization of the weights (not the biases).
+  float l2_reg = 0.0f;
+  // Number of threads, 0 for the number of cores. Results don't depend on it.
+  int num_threads = 0;
+  // Seed of the mini-batch sampling. Results only depend on the training data,
+  // the hyperparameters and the seed.
+  int seed = 0;
+};
+
+// Trains the last layer of a classification model on host: a fully-connected
+// layer followed by softmax, on top of the embeddings of an embedding
+// extractor, i.e. a classification model without these layers.
+//
+// Embeddings of all training images are extracted once and cached, so that
+// training runs mini-batch SGD on the cached embeddings only. Gradients of a
+// batch are computed by several threads, each scoring part of the batch and
+// then updating part of the classes, with SIMD dot products.
+//
+// The trained layer is appended to the embedding extractor with
+// AppendFullyConnectedAndSoftmaxLayerToModel(), which gives a model that can
+// be compiled for (or run on) the Edge TPU.
+//
+// Example:
+//   SoftmaxRegressionTrainer trainer(/*feature_dim=*/1024, /*num_classes=*/3);
+//   std::unique_ptr<BasicEngineNative> extractor;
+//   BasicEngineNativeBuilder builder(embedding_extractor_path);
+//   builder(&extractor);
+//   for (...) {
+//     trainer.AddImages(extractor.get(), images.data(), num_images,
+//                       image_size, label);
+//   }
+//   trainer.Train(TrainConfig());
+//   trainer.AppendLayerToModel(embedding_extractor_path, output_path);
+//
+// This class is not thread-safe.
+class SoftmaxRegressionTrainer {
+ public:
+  SoftmaxRegressionTrainer(int feature_dim, int num_classes);
+
+  // Copying or assignment is disallowed
+  SoftmaxRegressionTrainer(const SoftmaxRegressionTrainer&) = delete;
+  SoftmaxRegressionTrainer& operator=(const SoftmaxRegressionTrainer&) =
+      delete;
+
+  // Runs `extractor` on `num_images` images of `image_size` bytes, stored one
+  // after the other in `images`, and caches their embeddings with `label`.
+  EdgeTpuApiStatus AddImages(BasicEngineNative* extractor,
+                             const uint8_t* images, int num_images,
+                             int image_size, int label);
+
+  // Caches `num_embeddings` embeddings of `label`, stored one after the other.
+  EdgeTpuApiStatus AddEmbeddings(const float* embeddings, int num_embeddings,
+                                 int label);
+
+  // Trains the layer on all cached embeddings, starting from its current
+  // weights (zeros before the first call).
+  EdgeTpuApiStatus Train(const TrainConfig& config);
+
+  // Returns the label with the highest score for `embedding`.
+  int Classify(const float* embedding) const;
+
+  // Returns the ratio of cached embeddings classified with their label.
+  float GetAccuracy() const;
+
+  // Returns the mean cross-entropy loss on cached embeddings, without
+  // regularization.
+  float GetLoss() const;
+
+  // Appends the trained layer to the embedding extractor at `in_model_path`,
+  // and saves the classification model to `out_model_path`. The output of the
+  // fully-connected layer is quantized to the range of logits of the cached
+  // embeddings.
+  EdgeTpuApiStatus AppendLayerToModel(const std::string& in_model_path,
+                                      const std::string& out_model_path);
+
+  int feature_dim() const { return feature_dim_; }
+  int num_classes() const { return num_classes_; }
+  int num_embeddings() const { return labels_.size(); }
+
+  // Weights are stored class by class, as expected by
+  // AppendFullyConnectedAndSoftmaxLayerToModel().
+  const std::vector<float>& weights() const { return weights_; }
+  const std::vector<float>& biases() const { return biases_; }
+
+  // Caller can use this function to retrieve error message when get
+  // kEdgeTpuApiError.
+  std::string get_error_message() { return error_reporter_->message(); }
+
+ private:
+  // Computes the logits of `embedding` into `logits`.
+  void ComputeLogits(const float* embedding, float* logits) const;
+
+  const int feature_dim_;
+  const int num_classes_;
+  std::vector<float> weights_;
+  std::vector<float> biases_;
+  // Cached embeddings and their labels.
+  std::vector<float> embeddings_;
+  std::vector<int> labels_;
+  std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
+};
+
+}  // namespace backprop
+}  // namespace learn
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_LEARN_BACKPROP_SOFTMAX_REGRESSION_TRAINER_H_
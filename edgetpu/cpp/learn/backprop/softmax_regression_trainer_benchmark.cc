@@ -0,0 +1,67 @@
+// Benchmarks SoftmaxRegressionTrainer::Train() on synthetic embeddings with the
+// size of MobileNet embeddings, with different numbers of classes and threads.
+#include <random>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+#include "edgetpu/cpp/learn/backprop/softmax_regression_trainer.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+namespace coral {
+namespace learn {
+namespace backprop {
+namespace {
+
+constexpr int kDim = 1024;
+constexpr int kNumEmbeddingsPerClass = 50;
+constexpr int kNumIterations = 100;
+
+void AddRandomEmbeddings(SoftmaxRegressionTrainer* trainer) {
+  std::mt19937 generator(0);
+  std::normal_distribution<float> normal(0.0f, 1.0f);
+  std::vector<float> embeddings(kNumEmbeddingsPerClass * kDim);
+  for (int c = 0; c < trainer->num_classes(); ++c) {
+    for (float& value : embeddings) value = normal(generator);
+    CHECK_EQ(trainer->AddEmbeddings(embeddings.data(), kNumEmbeddingsPerClass,
+                                    c),
+             kEdgeTpuApiOk);
+  }
+}
+
+// Arguments are the number of classes, the batch size and the number of
+// threads.
+static void BM_Train(benchmark::State& state) {
+  SoftmaxRegressionTrainer trainer(kDim, state.range(0));
+  AddRandomEmbeddings(&trainer);
+  TrainConfig config;
+  config.num_iterations = kNumIterations;
+  config.batch_size = state.range(1);
+  config.num_threads = state.range(2);
+  while (state.KeepRunning()) {
+    CHECK_EQ(trainer.Train(config), kEdgeTpuApiOk)
+        << trainer.get_error_message();
+  }
+  state.SetItemsProcessed(state.iterations() * kNumIterations *
+                          config.batch_size);
+}
+BENCHMARK(BM_Train)
+    ->Args({10, 100, 1})
+    ->Args({10, 100, 4})
+    ->Args({100, 100, 1})
+    ->Args({100, 100, 4})
+    ->Args({100, 500, 1})
+    ->Args({100, 500, 4})
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace backprop
+}  // namespace learn
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,180 @@
+#include "edgetpu/cpp/learn/backprop/softmax_regression_trainer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "edgetpu/cpp/basic/basic_engine_native.h"
+#include "edgetpu/cpp/basic/inference_utils.h"
+#include "edgetpu/cpp/test_utils.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace coral {
+namespace learn {
+namespace backprop {
+namespace {
+
+constexpr int kDim = 64;
+constexpr int kNumClasses = 5;
+
+// Adds `num_per_class` embeddings around a random center for each class, with
+// noise of standard deviation `spread`.
+void AddClusters(int num_per_class, float spread, int seed,
+                 SoftmaxRegressionTrainer* trainer) {
+  std::mt19937 generator(seed);
+  std::normal_distribution<float> normal(0.0f, 1.0f);
+  for (int c = 0; c < trainer->num_classes(); ++c) {
+    std::vector<float> center(trainer->feature_dim());
+    for (float& value : center) value = normal(generator);
+    std::vector<float> embeddings;
+    for (int i = 0; i < num_per_class; ++i) {
+      for (float value : center) {
+        embeddings.push_back(value + spread * normal(generator));
+      }
+    }
+    ASSERT_EQ(kEdgeTpuApiOk,
+              trainer->AddEmbeddings(embeddings.data(), num_per_class, c));
+  }
+}
+
+TEST(SoftmaxRegressionTrainerTest, LearnsSeparableClasses) {
+  SoftmaxRegressionTrainer trainer(kDim, kNumClasses);
+  AddClusters(/*num_per_class=*/100, /*spread=*/0.5f, /*seed=*/0, &trainer);
+  EXPECT_EQ(500, trainer.num_embeddings());
+  const float initial_loss = trainer.GetLoss();
+  EXPECT_NEAR(std::log(kNumClasses), initial_loss, 1e-5f);
+
+  TrainConfig config;
+  config.num_iterations = 200;
+  config.batch_size = 50;
+  ASSERT_EQ(kEdgeTpuApiOk, trainer.Train(config));
+  EXPECT_LT(trainer.GetLoss(), 0.1f * initial_loss);
+  EXPECT_EQ(1.0f, trainer.GetAccuracy());
+
+  // Training again continues from the trained weights.
+  const float loss = trainer.GetLoss();
+  ASSERT_EQ(kEdgeTpuApiOk, trainer.Train(config));
+  EXPECT_LT(trainer.GetLoss(), loss);
+}
+
+TEST(SoftmaxRegressionTrainerTest, ResultsDontDependOnThreads) {
+  TrainConfig config;
+  config.num_iterations = 50;
+  config.batch_size = 33;
+  config.l2_reg = 0.01f;
+  config.seed = 7;
+  std::vector<float> expected_weights, expected_biases;
+  for (int num_threads : {1, 2, 3, 8}) {
+    SoftmaxRegressionTrainer trainer(kDim, kNumClasses);
+    AddClusters(/*num_per_class=*/20, /*spread=*/1.0f, /*seed=*/1, &trainer);
+    config.num_threads = num_threads;
+    ASSERT_EQ(kEdgeTpuApiOk, trainer.Train(config));
+    if (expected_weights.empty()) {
+      expected_weights = trainer.weights();
+      expected_biases = trainer.biases();
+    } else {
+      EXPECT_EQ(expected_weights, trainer.weights()) << num_threads;
+      EXPECT_EQ(expected_biases, trainer.biases()) << num_threads;
+    }
+  }
+}
+
+TEST(SoftmaxRegressionTrainerTest, RegularizationShrinksWeights) {
+  auto train = [](float l2_reg) {
+    SoftmaxRegressionTrainer trainer(kDim, kNumClasses);
+    AddClusters(/*num_per_class=*/20, /*spread=*/0.5f, /*seed=*/2, &trainer);
+    TrainConfig config;
+    config.l2_reg = l2_reg;
+    CHECK_EQ(trainer.Train(config), kEdgeTpuApiOk);
+    float squared_sum = 0.0f;
+    for (float weight : trainer.weights()) squared_sum += weight * weight;
+    return squared_sum;
+  };
+  EXPECT_LT(train(/*l2_reg=*/1.0f), train(/*l2_reg=*/0.0f));
+}
+
+TEST(SoftmaxRegressionTrainerTest, InvalidArguments) {
+  SoftmaxRegressionTrainer trainer(kDim, kNumClasses);
+  EXPECT_EQ(kEdgeTpuApiError, trainer.Train(TrainConfig()));
+  EXPECT_EQ("No embeddings to train on!", trainer.get_error_message());
+
+  const std::vector<float> embedding(kDim);
+  EXPECT_EQ(kEdgeTpuApiError, trainer.AddEmbeddings(embedding.data(), 1, 5));
+  EXPECT_EQ("Label 5 is out of range!", trainer.get_error_message());
+  EXPECT_EQ(kEdgeTpuApiError, trainer.AddImages(nullptr, nullptr, 1, 1, 0));
+  EXPECT_EQ("Embedding extractor is null!", trainer.get_error_message());
+
+  ASSERT_EQ(kEdgeTpuApiOk, trainer.AddEmbeddings(embedding.data(), 1, 0));
+  TrainConfig config;
+  config.batch_size = 0;
+  EXPECT_EQ(kEdgeTpuApiError, trainer.Train(config));
+  EXPECT_EQ("Batch size must be positive!", trainer.get_error_message());
+}
+
+// Trains on the embeddings of a few images, and checks that the model with
+// the trained layer classifies them.
+TEST(SoftmaxRegressionTrainerTest, TrainAndAppendLayerToModel) {
+  const std::string extractor_path = ModelPath(
+      "mobilenet_v1_1.0_224_quant_embedding_extractor_edgetpu.tflite");
+  const std::vector<std::string> images = {"cat.bmp", "grace_hopper.bmp",
+                                           "sunflower.bmp"};
+  std::unique_ptr<BasicEngineNative> extractor;
+  BasicEngineNativeBuilder builder(extractor_path);
+  ASSERT_EQ(kEdgeTpuApiOk, builder(&extractor)) << builder.get_error_message();
+  int const* input_shape;
+  int input_shape_size;
+  ASSERT_EQ(kEdgeTpuApiOk,
+            extractor->get_input_tensor_shape(&input_shape, &input_shape_size));
+  const ImageDims image_dims = {input_shape[1], input_shape[2], input_shape[3]};
+  int const* output_sizes;
+  int num_outputs;
+  ASSERT_EQ(kEdgeTpuApiOk,
+            extractor->get_all_output_tensors_sizes(&output_sizes,
+                                                    &num_outputs));
+
+  SoftmaxRegressionTrainer trainer(output_sizes[0], images.size());
+  std::vector<std::vector<uint8_t>> inputs;
+  for (int i = 0; i < images.size(); ++i) {
+    inputs.push_back(GetInputFromImage(TestDataPath(images[i]), image_dims));
+    ASSERT_EQ(kEdgeTpuApiOk,
+              trainer.AddImages(extractor.get(), inputs[i].data(),
+                                /*num_images=*/1, inputs[i].size(), i))
+        << trainer.get_error_message();
+  }
+  ASSERT_EQ(kEdgeTpuApiOk, trainer.Train(TrainConfig()));
+  EXPECT_EQ(1.0f, trainer.GetAccuracy());
+
+  const std::string output_path = "/tmp/softmax_regression_edgetpu.tflite";
+  ASSERT_EQ(kEdgeTpuApiOk,
+            trainer.AppendLayerToModel(extractor_path, output_path))
+      << trainer.get_error_message();
+  std::unique_ptr<BasicEngineNative> classifier;
+  BasicEngineNativeBuilder classifier_builder(output_path);
+  ASSERT_EQ(kEdgeTpuApiOk, classifier_builder(&classifier));
+  for (int i = 0; i < inputs.size(); ++i) {
+    float const* scores;
+    int num_scores;
+    ASSERT_EQ(kEdgeTpuApiOk,
+              classifier->RunInference(inputs[i].data(), inputs[i].size(),
+                                       &scores, &num_scores));
+    ASSERT_EQ(images.size(), num_scores);
+    EXPECT_EQ(i, std::max_element(scores, scores + num_scores) - scores)
+        << images[i];
+  }
+}
+
+}  // namespace
+}  // namespace backprop
+}  // namespace learn
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,60 @@
+#include "edgetpu/cpp/learn/flatbuffer_patcher.h"
+
+namespace coral {
+namespace learn {
+
+constexpr int FlatBufferPatcher::kAlignment;
+
+FlatBufferPatcher::FlatBufferPatcher(const void* buffer, size_t size)
+    : original_(static_cast<const char*>(buffer)),
+      buffer_(original_, original_ + size) {}
+
+void FlatBufferPatcher::ReplaceVectorWithValue(const uint8_t* field_address,
+                                               uint8_t value, int size) {
+  const int position = AppendVector(size, sizeof(uint8_t));
+  std::memset(&buffer_[position], value, size);
+  SetOffset(field_address, position - sizeof(flatbuffers::uoffset_t));
+}
+
+void FlatBufferPatcher::ReplaceString(const uint8_t* field_address,
+                                      const std::string& value) {
+  // Strings are vectors of chars followed by a null terminator.
+  const int position = AppendVector(value.size() + 1, sizeof(char));
+  std::memcpy(&buffer_[position], value.c_str(), value.size() + 1);
+  // The length doesn't count the terminator.
+  flatbuffers::WriteScalar<flatbuffers::uoffset_t>(
+      &buffer_[position - sizeof(flatbuffers::uoffset_t)], value.size());
+  SetOffset(field_address, position - sizeof(flatbuffers::uoffset_t));
+}
+
+int FlatBufferPatcher::Position(const void* address) const {
+  const int position = static_cast<const char*>(address) - original_;
+  CHECK_GE(position, 0);
+  CHECK_LT(position, buffer_.size());
+  return position;
+}
+
+int FlatBufferPatcher::AppendVector(int size, int element_size,
+                                    int alignment) {
+  CHECK_GE(alignment, kAlignment);
+  CHECK_EQ(alignment & (alignment - 1), 0);
+  constexpr int kLengthSize = sizeof(flatbuffers::uoffset_t);
+  // Pads so that elements start on `alignment`, after the length.
+  const int padding =
+      (alignment - (buffer_.size() + kLengthSize) % alignment) % alignment;
+  const int position = buffer_.size() + padding + kLengthSize;
+  buffer_.resize(position + size * element_size, 0);
+  flatbuffers::WriteScalar<flatbuffers::uoffset_t>(
+      &buffer_[position - kLengthSize], size);
+  return position;
+}
+
+void FlatBufferPatcher::SetOffset(const uint8_t* field_address, int target) {
+  const int position = Position(field_address);
+  CHECK_GT(target, position);
+  flatbuffers::WriteScalar<flatbuffers::uoffset_t>(&buffer_[position],
+                                                   target - position);
+}
+
+}  // namespace learn
+}  // namespace coral
@@ -0,0 +1,110 @@
+// Edits a copy of a packed flatbuffer without unpacking it.
+//
+// Unpacking a model to tflite::ModelT and packing it back copies every buffer
+// element by element, which is slow for models with megabytes of weights when
+// only a few tensors change. FlatBufferPatcher copies the packed bytes once
+// and rewrites fields of that copy:
+//
+// - Scalars, including vector elements, are overwritten in place.
+// - Vectors and strings of another size are appended to the end of the copy,
+//   and the offset field referencing them is pointed at the new data. Offsets
+//   in flatbuffers only point forward, so this always works; the old data is
+//   left unreferenced.
+//
+// Fields which are not set in a table can't be added this way, callers have
+// to unpack the model in this case.
+
+#ifndef EDGETPU_CPP_LEARN_FLATBUFFER_PATCHER_H_
+#define EDGETPU_CPP_LEARN_FLATBUFFER_PATCHER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "flatbuffers/flatbuffers.h"
+#include "glog/logging.h"
+
+namespace coral {
+namespace learn {
+
+class FlatBufferPatcher {
+ public:
+  // Copies the `size` bytes of `buffer`. Addresses given to other methods
+  // point into `buffer`, which must outlive the patcher.
+  FlatBufferPatcher(const void* buffer, size_t size);
+
+  // Returns the address of `field` in `table`, or nullptr if it isn't set.
+  // `table` is any generated table type, e.g. tflite::Tensor, and `field` one
+  // of its VT_ constants.
+  template <typename Table>
+  static const uint8_t* FieldAddress(const Table* table,
+                                     flatbuffers::voffset_t field) {
+    return reinterpret_cast<const flatbuffers::Table*>(table)->GetAddressOf(
+        field);
+  }
+
+  // Overwrites the scalar at `address` in the copy.
+  template <typename T>
+  void SetScalar(const uint8_t* address, T value) {
+    CHECK_LE(Position(address) + sizeof(T), buffer_.size());
+    flatbuffers::WriteScalar(&buffer_[Position(address)], value);
+  }
+
+  // Overwrites element `index` of `vector` in the copy.
+  template <typename T>
+  void SetElement(const flatbuffers::Vector<T>* vector, int index, T value) {
+    CHECK_LT(index, vector->size());
+    SetScalar(vector->Data() + index * sizeof(T), value);
+  }
+
+  // Appends a vector with the `size` elements of `data` to the copy, and
+  // points the offset field at `field_address` to it. Elements start at a
+  // multiple of `alignment` from the beginning of the copy, a power of 2 at
+  // least kAlignment, e.g. the page size for weights read with mmap().
+  template <typename T>
+  void ReplaceVector(const uint8_t* field_address, const T* data, int size,
+                     int alignment = kAlignment) {
+    const int position = AppendVector(size, sizeof(T), alignment);
+    // Flatbuffers are little-endian, like all supported platforms.
+    std::memcpy(&buffer_[position], data, size * sizeof(T));
+    SetOffset(field_address, position - sizeof(flatbuffers::uoffset_t));
+  }
+
+  // Same as above for a vector of `size` bytes all set to `value`.
+  void ReplaceVectorWithValue(const uint8_t* field_address, uint8_t value,
+                              int size);
+
+  // Appends `value` to the copy, and points the string field at
+  // `field_address` to it.
+  void ReplaceString(const uint8_t* field_address, const std::string& value);
+
+  // Default alignment of appended elements, enough for any scalar and SIMD
+  // loads of tensor data.
+  static constexpr int kAlignment = 16;
+
+  // Returns the patched flatbuffer.
+  const std::vector<char>& buffer() const { return buffer_; }
+  std::vector<char>* mutable_buffer() { return &buffer_; }
+
+ private:
+  // Returns the position in the copy of `address` in the original buffer.
+  int Position(const void* address) const;
+
+  // Appends the length of a vector of `size` elements of `element_size` bytes
+  // and room for its elements, aligned on `alignment`. Returns the position of
+  // the first element.
+  int AppendVector(int size, int element_size, int alignment = kAlignment);
+
+  // Points the offset field at `field_address` to `target` position.
+  void SetOffset(const uint8_t* field_address, int target);
+
+  const char* original_;
+  std::vector<char> buffer_;
+};
+
+}  // namespace learn
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_LEARN_FLATBUFFER_PATCHER_H_
@@ -0,0 +1,134 @@
+#include "edgetpu/cpp/learn/flatbuffer_patcher.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "edgetpu/cpp/learn/utils.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace coral {
+namespace learn {
+namespace {
+
+class FlatBufferPatcherTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    tflite::ModelT model_t;
+    model_t.version = 3;
+    model_t.description = "Test model";
+    model_t.buffers.push_back(absl::make_unique<tflite::BufferT>());
+    model_t.buffers.push_back(absl::make_unique<tflite::BufferT>());
+    model_t.buffers[1]->data = {1, 2, 3, 4};
+    model_t.buffers.push_back(absl::make_unique<tflite::BufferT>());
+    model_t.buffers[2]->data = {5, 6};
+    auto subgraph = absl::make_unique<tflite::SubGraphT>();
+    auto tensor = absl::make_unique<tflite::TensorT>();
+    tensor->shape = {1, 2};
+    tensor->buffer = 1;
+    tensor->name = "tensor";
+    subgraph->tensors.push_back(std::move(tensor));
+    model_t.subgraphs.push_back(std::move(subgraph));
+
+    auto fbb = GetFlatBufferBuilder(&model_t);
+    original_.assign(fbb->GetBufferPointer(),
+                     fbb->GetBufferPointer() + fbb->GetSize());
+    model_ = tflite::GetModel(original_.data());
+  }
+
+  // Verifies the patched buffer, and returns its model.
+  const tflite::Model* GetPatchedModel(const FlatBufferPatcher& patcher) {
+    const auto& buffer = patcher.buffer();
+    flatbuffers::Verifier verifier(
+        reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+    CHECK(tflite::VerifyModelBuffer(verifier));
+    return tflite::GetModel(buffer.data());
+  }
+
+  std::vector<uint8_t> original_;
+  const tflite::Model* model_;
+};
+
+TEST_F(FlatBufferPatcherTest, NoChanges) {
+  FlatBufferPatcher patcher(original_.data(), original_.size());
+  EXPECT_EQ(std::vector<char>(original_.begin(), original_.end()),
+            patcher.buffer());
+}
+
+TEST_F(FlatBufferPatcherTest, SetElement) {
+  FlatBufferPatcher patcher(original_.data(), original_.size());
+  const auto* tensor = model_->subgraphs()->Get(0)->tensors()->Get(0);
+  patcher.SetElement<int32_t>(tensor->shape(), 1, 10);
+  EXPECT_EQ(original_.size(), patcher.buffer().size());
+
+  const auto* patched_model = GetPatchedModel(patcher);
+  const auto* shape =
+      patched_model->subgraphs()->Get(0)->tensors()->Get(0)->shape();
+  EXPECT_EQ(std::vector<int32_t>({1, 10}),
+            std::vector<int32_t>(shape->begin(), shape->end()));
+  // The original buffer is untouched.
+  EXPECT_EQ(2, tensor->shape()->Get(1));
+}
+
+TEST_F(FlatBufferPatcherTest, ReplaceVector) {
+  FlatBufferPatcher patcher(original_.data(), original_.size());
+  std::vector<uint8_t> data(100);
+  for (int i = 0; i < data.size(); ++i) data[i] = i;
+  patcher.ReplaceVector(
+      FlatBufferPatcher::FieldAddress(model_->buffers()->Get(1),
+                                      tflite::Buffer::VT_DATA),
+      data.data(), data.size());
+  patcher.ReplaceVectorWithValue(
+      FlatBufferPatcher::FieldAddress(model_->buffers()->Get(2),
+                                      tflite::Buffer::VT_DATA),
+      7, 3);
+
+  const auto* patched_model = GetPatchedModel(patcher);
+  const auto* patched_data = patched_model->buffers()->Get(1)->data();
+  EXPECT_EQ(data, std::vector<uint8_t>(patched_data->begin(),
+                                       patched_data->end()));
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(patched_data->data()) % 16);
+  patched_data = patched_model->buffers()->Get(2)->data();
+  EXPECT_EQ(std::vector<uint8_t>({7, 7, 7}),
+            std::vector<uint8_t>(patched_data->begin(), patched_data->end()));
+  // Other fields are unchanged.
+  EXPECT_EQ(3, patched_model->version());
+  EXPECT_EQ("Test model", patched_model->description()->str());
+  const auto* tensor = patched_model->subgraphs()->Get(0)->tensors()->Get(0);
+  EXPECT_EQ("tensor", tensor->name()->str());
+}
+
+TEST_F(FlatBufferPatcherTest, ReplaceString) {
+  FlatBufferPatcher patcher(original_.data(), original_.size());
+  const uint8_t* description =
+      FlatBufferPatcher::FieldAddress(model_, tflite::Model::VT_DESCRIPTION);
+  patcher.ReplaceString(description, "Patched test model");
+  EXPECT_EQ("Patched test model",
+            GetPatchedModel(patcher)->description()->str());
+  // The same field can be replaced again.
+  patcher.ReplaceString(description, "");
+  EXPECT_EQ("", GetPatchedModel(patcher)->description()->str());
+}
+
+TEST_F(FlatBufferPatcherTest, UnsetField) {
+  EXPECT_EQ(nullptr, FlatBufferPatcher::FieldAddress(
+                         model_, tflite::Model::VT_METADATA_BUFFER));
+  EXPECT_EQ(nullptr,
+            FlatBufferPatcher::FieldAddress(model_->buffers()->Get(0),
+                                            tflite::Buffer::VT_DATA));
+}
+
+}  // namespace
+}  // namespace learn
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
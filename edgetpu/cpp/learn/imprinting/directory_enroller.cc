@@ -0,0 +1,269 @@
+#include "edgetpu/cpp/learn/imprinting/directory_enroller.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <condition_variable>  // NOLINT
+#include <cstring>
+#include <mutex>  // NOLINT
+#include <thread>  // NOLINT
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "edgetpu/cpp/basic/inference_utils.h"
+#include "glog/logging.h"
+
+namespace coral {
+namespace learn {
+namespace imprinting {
+
+namespace {
+
+bool IsDirectory(const std::string& path) {
+  struct stat info;
+  return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+// Lists the entries of directory `path`, in name order. Returns false if it
+// can't be opened.
+bool ListDirectory(const std::string& path, std::vector<std::string>* names) {
+  DIR* dirp = opendir(path.c_str());
+  if (!dirp) return false;
+  names->clear();
+  struct dirent* dp;
+  while ((dp = readdir(dirp)) != nullptr) {
+    const std::string name = dp->d_name;
+    if (name != "." && name != "..") names->push_back(name);
+  }
+  closedir(dirp);
+  std::sort(names->begin(), names->end());
+  return true;
+}
+
+// Appends the paths of all BMP images under directory `path`, at any depth, in
+// path order.
+void FindImages(const std::string& path, std::vector<std::string>* images) {
+  std::vector<std::string> names;
+  if (!ListDirectory(path, &names)) return;
+  for (const auto& name : names) {
+    const std::string child = path + "/" + name;
+    if (IsDirectory(child)) {
+      FindImages(child, images);
+    } else if (EndsWith(name, ".bmp")) {
+      images->push_back(child);
+    }
+  }
+}
+
+// Pool of threads decoding and resizing chunks of images in the background.
+class ImageDecoder {
+ public:
+  ImageDecoder(int num_threads, const ImageDims& image_dims)
+      : image_dims_(image_dims),
+        image_size_(ImageDimsToSize(image_dims)),
+        paths_(nullptr),
+        begin_(0),
+        next_(0),
+        end_(0),
+        images_(nullptr),
+        num_running_(0),
+        stop_(false) {
+    for (int i = 0; i < num_threads; ++i) {
+      threads_.emplace_back(&ImageDecoder::Work, this);
+    }
+  }
+
+  ~ImageDecoder() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    work_available_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  // Starts decoding images [begin, end) of `paths` into `images`, one after
+  // the other. The previous chunk must be done.
+  void Start(const std::vector<std::string>* paths, int begin, int end,
+             uint8_t* images) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      paths_ = paths;
+      begin_ = begin;
+      next_ = begin;
+      end_ = end;
+      images_ = images;
+    }
+    work_available_.notify_all();
+  }
+
+  // Waits for the chunk of last call to Start(). Returns the first image that
+  // couldn't be read, or an empty string.
+  std::string Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    work_done_.wait(lock, [this] { return next_ >= end_ && !num_running_; });
+    std::string failed_path;
+    std::swap(failed_path, failed_path_);
+    return failed_path;
+  }
+
+ private:
+  void Work() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      work_available_.wait(lock, [this] { return stop_ || next_ < end_; });
+      if (stop_) return;
+      const std::string& path = (*paths_)[next_];
+      uint8_t* image = images_ + (next_ - begin_) * image_size_;
+      ++next_;
+      ++num_running_;
+      lock.unlock();
+      const std::vector<uint8_t> resized = GetInputFromImage(path, image_dims_);
+      const bool ok = resized.size() == image_size_;
+      if (ok) std::memcpy(image, resized.data(), image_size_);
+      lock.lock();
+      if (!ok && failed_path_.empty()) failed_path_ = path;
+      if (--num_running_ == 0 && next_ >= end_) work_done_.notify_all();
+    }
+  }
+
+  const ImageDims image_dims_;
+  const int image_size_;
+  std::vector<std::thread> threads_;
+
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable work_done_;
+  // Chunk being decoded, guarded by `mutex_`.
+  const std::vector<std::string>* paths_;
+  int begin_;
+  int next_;
+  int end_;
+  uint8_t* images_;
+  int num_running_;
+  std::string failed_path_;
+  bool stop_;
+};
+
+}  // namespace
+
+DirectoryEnroller::DirectoryEnroller(ImprintingEngineNative* engine,
+                                     const EnrollmentOptions& options)
+    : engine_(engine), options_(options) {
+  CHECK(engine_);
+  CHECK_GE(options_.num_decode_threads, 0);
+  CHECK_GT(options_.chunk_size, 0);
+  error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
+}
+
+EdgeTpuApiStatus DirectoryEnroller::ListImages(
+    const std::string& root_dir, std::vector<std::string>* image_paths,
+    std::vector<int>* class_begins) {
+  std::vector<std::string> names;
+  EDGETPU_API_REPORT_ERROR(error_reporter_, !ListDirectory(root_dir, &names),
+                           "Failed to open directory: " + root_dir);
+  image_paths->clear();
+  class_begins->clear();
+  for (const auto& name : names) {
+    const std::string class_dir = root_dir + "/" + name;
+    if (!IsDirectory(class_dir)) continue;
+    class_begins->push_back(image_paths->size());
+    FindImages(class_dir, image_paths);
+    EDGETPU_API_REPORT_ERROR(error_reporter_,
+                             image_paths->size() == class_begins->back(),
+                             "No images in class directory: " + class_dir);
+    class_names_.push_back(name);
+  }
+  EDGETPU_API_REPORT_ERROR(error_reporter_, class_names_.empty(),
+                           "No class directories in: " + root_dir);
+  class_begins->push_back(image_paths->size());
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus DirectoryEnroller::Enroll(const std::string& root_dir,
+                                           int first_class_id) {
+  class_names_.clear();
+  num_images_ = 0;
+  std::vector<std::string> image_paths;
+  std::vector<int> class_begins;
+  EDGETPU_API_ENSURE_STATUS(ListImages(root_dir, &image_paths, &class_begins));
+
+  int const* input_shape;
+  int input_shape_size;
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_,
+      engine_->get_input_tensor_shape(&input_shape, &input_shape_size) ==
+          kEdgeTpuApiError,
+      engine_->get_error_message());
+  EDGETPU_API_REPORT_ERROR(error_reporter_, input_shape_size != 4,
+                           "Input tensor of embedding extractor should be "
+                           "[1, height, width, channels]");
+  const ImageDims image_dims = {input_shape[1], input_shape[2],
+                                input_shape[3]};
+  const int image_size = ImageDimsToSize(image_dims);
+
+  // Chunks never span two classes. The images of chunk i are decoded into
+  // buffer i % 2, while the embedding extractor runs on chunk i - 1.
+  std::vector<std::pair<int, int>> chunks;
+  for (int c = 0; c + 1 < class_begins.size(); ++c) {
+    for (int begin = class_begins[c]; begin < class_begins[c + 1];
+         begin += options_.chunk_size) {
+      chunks.emplace_back(
+          begin, std::min(begin + options_.chunk_size, class_begins[c + 1]));
+    }
+  }
+  std::vector<uint8_t> buffers[2];
+  for (auto& buffer : buffers) {
+    buffer.resize(static_cast<size_t>(options_.chunk_size) * image_size);
+  }
+  int num_threads = options_.num_decode_threads;
+  if (num_threads == 0) {
+    num_threads = std::max<int>(1, std::thread::hardware_concurrency());
+  }
+  ImageDecoder decoder(num_threads, image_dims);
+  decoder.Start(&image_paths, chunks[0].first, chunks[0].second,
+                buffers[0].data());
+
+  std::vector<float> embedding_sum(engine_->get_embedding_vector_dim(), 0.0f);
+  int class_index = 0;
+  for (int i = 0; i < chunks.size(); ++i) {
+    const std::string failed_path = decoder.Wait();
+    EDGETPU_API_REPORT_ERROR(error_reporter_, !failed_path.empty(),
+                             "Failed to read image: " + failed_path);
+    if (i + 1 < chunks.size()) {
+      decoder.Start(&image_paths, chunks[i + 1].first, chunks[i + 1].second,
+                    buffers[(i + 1) % 2].data());
+    }
+
+    const int num_images = chunks[i].second - chunks[i].first;
+    EDGETPU_API_REPORT_ERROR(
+        error_reporter_,
+        engine_->AddToEmbeddingSum(buffers[i % 2].data(), num_images,
+                                   image_size,
+                                   &embedding_sum) == kEdgeTpuApiError,
+        engine_->get_error_message());
+    num_images_ += num_images;
+
+    if (chunks[i].second == class_begins[class_index + 1]) {
+      VLOG(1) << "Enrolling " << class_names_[class_index] << " with "
+              << class_begins[class_index + 1] - class_begins[class_index]
+              << " images.";
+      EDGETPU_API_REPORT_ERROR(
+          error_reporter_,
+          engine_->TrainWithEmbeddingSum(embedding_sum,
+                                         first_class_id + class_index) ==
+              kEdgeTpuApiError,
+          engine_->get_error_message());
+      std::fill(embedding_sum.begin(), embedding_sum.end(), 0.0f);
+      ++class_index;
+    }
+  }
+  return kEdgeTpuApiOk;
+}
+
+}  // namespace imprinting
+}  // namespace learn
+}  // namespace coral
@@ -0,0 +1,94 @@
+#ifndef EDGETPU_CPP_LEARN_IMPRINTING_DIRECTORY_ENROLLER_H_
+#define EDGETPU_CPP_LEARN_IMPRINTING_DIRECTORY_ENROLLER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "edgetpu/cpp/error_reporter.h"
+#include "edgetpu/cpp/learn/imprinting/engine_native.h"
+
+namespace coral {
+namespace learn {
+namespace imprinting {
+
+// Options of DirectoryEnroller.
+struct EnrollmentOptions {
+  // Number of threads decoding and resizing images, 0 for the number of cores.
+  int num_decode_threads = 0;
+  // Maximum number of images sent to the embedding extractor at once. Memory
+  // use is about twice this number of resized images.
+  int chunk_size = 32;
+};
+
+// Enrolls the images of a directory tree into an ImprintingEngineNative,
+// without holding more than two chunks of images in memory.
+//
+// Each subdirectory of the root directory is a class, and all BMP images
+// found under it, at any depth, are its training images. Classes are enrolled
+// in the order of their names, and images in the order of their paths, so
+// that results are the same with any number of threads.
+//
+// A pool of threads decodes and resizes the next chunk of images while the
+// embedding extractor runs on the current one. Embeddings are added to a
+// running sum per class, with ImprintingEngineNative::AddToEmbeddingSum(), so
+// there is no limit on the number of images of a class.
+//
+// Example:
+//   std::unique_ptr<ImprintingEngineNative> engine;
+//   ImprintingEngineNativeBuilder builder(model_path);
+//   builder(&engine);
+//   DirectoryEnroller enroller(engine.get());
+//   if (enroller.Enroll("/data/train", /*first_class_id=*/0) ==
+//       kEdgeTpuApiOk) {
+//     // Class i is enroller.class_names()[i].
+//     engine->SaveModel(output_path);
+//   }
+class DirectoryEnroller {
+ public:
+  // `engine` must be initialized, and outlive the enroller.
+  explicit DirectoryEnroller(ImprintingEngineNative* engine,
+                             const EnrollmentOptions& options =
+                                 EnrollmentOptions());
+
+  // Copying or assignment is disallowed
+  DirectoryEnroller(const DirectoryEnroller&) = delete;
+  DirectoryEnroller& operator=(const DirectoryEnroller&) = delete;
+
+  // Trains each subdirectory of `root_dir` as class `first_class_id` + its
+  // index in name order. Class ids follow the rules of
+  // ImprintingEngineNative::Train(). Classes enrolled before an error stay
+  // trained.
+  EdgeTpuApiStatus Enroll(const std::string& root_dir, int first_class_id);
+
+  // Names of the subdirectories enrolled by last call to Enroll(), in class
+  // id order.
+  const std::vector<std::string>& class_names() const { return class_names_; }
+
+  // Number of images enrolled by last call to Enroll().
+  int num_images() const { return num_images_; }
+
+  // Caller can use this function to retrieve error message when get
+  // kEdgeTpuApiError.
+  std::string get_error_message() { return error_reporter_->message(); }
+
+ private:
+  // Lists the images of each class under `root_dir` into `image_paths`, with
+  // the images of class i in [class_begins[i], class_begins[i + 1]).
+  EdgeTpuApiStatus ListImages(const std::string& root_dir,
+                              std::vector<std::string>* image_paths,
+                              std::vector<int>* class_begins);
+
+  ImprintingEngineNative* const engine_;
+  const EnrollmentOptions options_;
+  std::vector<std::string> class_names_;
+  int num_images_ = 0;
+  // Data structure to stores error messages.
+  std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
+};
+
+}  // namespace imprinting
+}  // namespace learn
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_LEARN_IMPRINTING_DIRECTORY_ENROLLER_H_
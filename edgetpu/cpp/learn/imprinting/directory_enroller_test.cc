@@ -0,0 +1,183 @@
+#include "edgetpu/cpp/learn/imprinting/directory_enroller.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+
+#include "edgetpu/cpp/learn/imprinting/engine_native.h"
+#include "edgetpu/cpp/learn/imprinting/imprinting_test_base.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace coral {
+namespace learn {
+namespace imprinting {
+
+class DirectoryEnrollerTest : public ImprintingTestBase {
+ protected:
+  static std::string ReadFileToString(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+  }
+
+  static void WriteStringToFile(const std::string& content,
+                                const std::string& path) {
+    std::ofstream(path, std::ios::binary) << content;
+  }
+
+  // Creates directory `path` under the root directory of the test, and its
+  // parent if needed.
+  void MakeDirectory(const std::string& path) {
+    const size_t slash = path.rfind('/');
+    if (slash != std::string::npos) MakeDirectory(path.substr(0, slash));
+    ::mkdir((root_dir_ + "/" + path).c_str(), 0755);
+  }
+
+  void SetUp() override {
+    ImprintingTestBase::SetUp();
+    // Parameterized test names are like "Errors/0".
+    std::string test_name =
+        ::testing::UnitTest::GetInstance()->current_test_info()->name();
+    std::replace(test_name.begin(), test_name.end(), '/', '_');
+    root_dir_ = "/tmp/directory_enroller_test_" + test_name;
+    std::system(("rm -rf " + root_dir_).c_str());
+    ::mkdir(root_dir_.c_str(), 0755);
+  }
+
+  // Copies test image `image_name` to `path` under the root directory.
+  void CopyImage(const std::string& image_name, const std::string& path) {
+    WriteStringToFile(ReadFileToString(ImagePath(image_name)),
+                      root_dir_ + "/" + path);
+  }
+
+  std::unique_ptr<ImprintingEngineNative> CreateEngine() {
+    std::unique_ptr<ImprintingEngineNative> engine;
+    ImprintingEngineNativeBuilder builder(
+        GenerateInputModelPath("mobilenet_v1_1.0_224_l2norm_quant"),
+        /*keep_classes=*/false);
+    CHECK_EQ(builder(&engine), kEdgeTpuApiOk) << builder.get_error_message();
+    return engine;
+  }
+
+  std::string root_dir_;
+};
+
+TEST_P(DirectoryEnrollerTest, MatchesTrainingAllImagesAtOnce) {
+  MakeDirectory("cat");
+  CopyImage("cat_train_0.bmp", "cat/0.bmp");
+  CopyImage("cat_test_0.bmp", "cat/1.bmp");
+  MakeDirectory("dog/more");
+  CopyImage("dog_train_0.bmp", "dog/0.bmp");
+  CopyImage("dog_test_0.bmp", "dog/more/0.bmp");
+  CopyImage("cat_train_0.bmp", "dog/not_an_image.txt");
+  MakeDirectory("hotdog");
+  CopyImage("hotdog_train_0.bmp", "hotdog/0.bmp");
+  CopyImage("hotdog_train_1.bmp", "hotdog/1.bmp");
+  CopyImage("hotdog_test_0.bmp", "hotdog/2.bmp");
+  WriteStringToFile("not a class", root_dir_ + "/README");
+
+  auto engine = CreateEngine();
+  const std::string expected_path =
+      GenerateOutputModelPath("directory_enroller_expected");
+  const std::vector<std::vector<Image>> classes = {
+      {cat_train_0_, cat_test_0_},
+      {dog_train_0_, dog_test_0_},
+      {hotdog_train_0_, hotdog_train_1_, hotdog_test_0_}};
+  for (int i = 0; i < classes.size(); ++i) {
+    std::vector<uint8_t> images;
+    for (const auto& image : classes[i]) {
+      images.insert(images.end(), image.begin(), image.end());
+    }
+    ASSERT_EQ(kEdgeTpuApiOk,
+              engine->Train(images.data(), classes[i].size(),
+                            classes[i][0].size(), i));
+  }
+  ASSERT_EQ(kEdgeTpuApiOk, engine->SaveModel(expected_path));
+
+  // Results don't depend on the chunk size nor on the number of threads.
+  for (int chunk_size : {1, 2, 32}) {
+    EnrollmentOptions options;
+    options.chunk_size = chunk_size;
+    options.num_decode_threads = chunk_size == 2 ? 1 : 0;
+    engine = CreateEngine();
+    DirectoryEnroller enroller(engine.get(), options);
+    ASSERT_EQ(kEdgeTpuApiOk, enroller.Enroll(root_dir_, /*first_class_id=*/0))
+        << enroller.get_error_message();
+    EXPECT_EQ(std::vector<std::string>({"cat", "dog", "hotdog"}),
+              enroller.class_names());
+    EXPECT_EQ(7, enroller.num_images());
+    const std::string output_path =
+        GenerateOutputModelPath("directory_enroller_enrolled");
+    ASSERT_EQ(kEdgeTpuApiOk, engine->SaveModel(output_path));
+    EXPECT_EQ(ReadFileToString(expected_path), ReadFileToString(output_path))
+        << "chunk_size=" << chunk_size;
+  }
+  TestTrainedModel({TestDatapoint(cat_test_0_, 0, 0.99f),
+                    TestDatapoint(dog_test_0_, 1, 0.99f),
+                    TestDatapoint(hotdog_test_0_, 2, 0.99f)},
+                   GenerateOutputModelPath("directory_enroller_enrolled"));
+}
+
+TEST_P(DirectoryEnrollerTest, MoreImagesThanTrainAccepts) {
+  MakeDirectory("cat");
+  constexpr int kNumImages = 250;
+  for (int i = 0; i < kNumImages; ++i) {
+    CopyImage("cat_train_0.bmp", "cat/" + std::to_string(1000 + i) + ".bmp");
+  }
+  auto engine = CreateEngine();
+  DirectoryEnroller enroller(engine.get());
+  ASSERT_EQ(kEdgeTpuApiOk, enroller.Enroll(root_dir_, /*first_class_id=*/0))
+      << enroller.get_error_message();
+  EXPECT_EQ(kNumImages, enroller.num_images());
+  // All embeddings are the same, so their sum has the norm of their count.
+  std::map<int, float> metadata;
+  ASSERT_EQ(kEdgeTpuApiOk, engine->get_metadata(&metadata));
+  ASSERT_EQ(1, metadata.size());
+  EXPECT_NEAR(kNumImages, metadata[0], kNumImages * 1e-4f);
+}
+
+TEST_P(DirectoryEnrollerTest, Errors) {
+  auto engine = CreateEngine();
+  DirectoryEnroller enroller(engine.get());
+  EXPECT_EQ(kEdgeTpuApiError, enroller.Enroll(root_dir_ + "/missing", 0));
+  EXPECT_EQ("Failed to open directory: " + root_dir_ + "/missing",
+            enroller.get_error_message());
+
+  EXPECT_EQ(kEdgeTpuApiError, enroller.Enroll(root_dir_, 0));
+  EXPECT_EQ("No class directories in: " + root_dir_,
+            enroller.get_error_message());
+
+  MakeDirectory("cat");
+  EXPECT_EQ(kEdgeTpuApiError, enroller.Enroll(root_dir_, 0));
+  EXPECT_EQ("No images in class directory: " + root_dir_ + "/cat",
+            enroller.get_error_message());
+
+  WriteStringToFile("", root_dir_ + "/cat/0.bmp");
+  EXPECT_EQ(kEdgeTpuApiError, enroller.Enroll(root_dir_, 0));
+  EXPECT_EQ("Failed to read image: " + root_dir_ + "/cat/0.bmp",
+            enroller.get_error_message());
+
+  CopyImage("cat_train_0.bmp", "cat/0.bmp");
+  EXPECT_EQ(kEdgeTpuApiError, enroller.Enroll(root_dir_, 1));
+  EXPECT_EQ("The class index of a new category is too large!",
+            enroller.get_error_message());
+}
+
+INSTANTIATE_TEST_CASE_P(DirectoryEnrollerTest, DirectoryEnrollerTest,
+                        ::testing::Values(false, true));
+
+}  // namespace imprinting
+}  // namespace learn
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
@@ -7,8 +7,9 @@ namespace learn {
 namespace imprinting {
 
 ImprintingEngine::ImprintingEngine(const std::string& model_path,
-                                   bool keep_classes) {
-  ImprintingEngineNativeBuilder builder(model_path, keep_classes);
+                                   bool keep_classes, bool classify_on_host) {
+  ImprintingEngineNativeBuilder builder(model_path, keep_classes,
+                                        classify_on_host);
   CHECK_EQ(builder(&engine_), kEdgeTpuApiOk) << builder.get_error_message();
 }
 
@@ -30,6 +31,12 @@ void ImprintingEngine::Train(const std::vector<std::vector<uint8_t>>& images,
       << engine_->get_error_message();
 }
 
+int ImprintingEngine::SetNumTrainingDevices(int num_devices) {
+  CHECK_EQ(engine_->SetNumTrainingDevices(num_devices), kEdgeTpuApiOk)
+      << engine_->get_error_message();
+  return engine_->get_num_training_devices();
+}
+
 std::vector<float> ImprintingEngine::RunInference(
     const std::vector<uint8_t>& input) {
   std::vector<float> results;
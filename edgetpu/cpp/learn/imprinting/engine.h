@@ -21,8 +21,12 @@ class ImprintingEngine {
   //
   // Users can choose whether to keep previous classes by setting keep_classes
   // to true or false.
+  //
+  // With classify_on_host, classes are scored on host from the embedding
+  // vectors, so that training does not rebuild the classification model.
   explicit ImprintingEngine(const std::string& model_path,
-                            bool keep_classes = false);
+                            bool keep_classes = false,
+                            bool classify_on_host = false);
 
   // For input, we assume there is only one tensor with type uint8_t.
   // There is only one output tensor, the classification results after softmax.
@@ -52,6 +56,10 @@ class ImprintingEngine {
   void Train(const std::vector<std::vector<uint8_t>>& images,
              const int class_id);
 
+  // Spreads training images across up to `num_devices` Edge TPUs and returns
+  // the number actually used. Training results are the same for any number.
+  int SetNumTrainingDevices(int num_devices);
+
   // Copying or assignment is disallowed
   ImprintingEngine(const ImprintingEngine&) = delete;
   ImprintingEngine& operator=(const ImprintingEngine&) = delete;
@@ -1,14 +1,21 @@
 #include "edgetpu/cpp/learn/imprinting/engine_native.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <limits>
 #include <memory>
+#include <numeric>
+#include <thread>  // NOLINT
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"
-#include "absl/strings/numbers.h"
-#include "absl/strings/str_cat.h"
-#include "absl/strings/str_format.h"
-#include "absl/strings/str_split.h"
+#include "absl/types/span.h"
+#include "edgetpu/cpp/basic/edgetpu_resource_manager.h"
+#include "edgetpu/cpp/learn/flatbuffer_patcher.h"
+#include "edgetpu/cpp/learn/imprinting/training_metadata.h"
 #include "edgetpu/cpp/learn/utils.h"
 #include "glog/logging.h"
 #include "tensorflow/lite/model.h"
@@ -25,35 +32,23 @@ namespace {
       "instance is created by ImprintingEngineNativeBuilder!")
 }  // namespace
 
-void ImprintingEngineNative::ExtractModelTrainingMetadata() {
-  metadata_ = {};
-  if (model_t_->description.empty()) return;
-
+void ImprintingEngineNative::ExtractModelTrainingMetadata(
+    const tflite::Model& model) {
+  TrainingMetadataView view;
+  if (FindTrainingMetadata(model, &view)) {
+    metadata_ = view.ToMap();
+    return;
+  }
+  // Models trained by older versions keep metadata in description.
   VLOG(1) << "Model description: " << model_t_->description;
-  const std::vector<std::string> v =
-      absl::StrSplit(model_t_->description, absl::ByAnyChar(" \n"));
-
-  for (int i = 0; i < v.size() - 1; i += 2) {
-    int label;
-    float sqrt_sum;
-    if (absl::SimpleAtoi(v[i], &label) &&
-        absl::SimpleAtof(v[i + 1], &sqrt_sum)) {
-      metadata_.insert({label, sqrt_sum});
-    } else {
-      metadata_ = {};
-      return;
-    }
+  if (!ParseTextTrainingMetadata(model_t_->description, &metadata_)) {
+    metadata_ = {};
   }
 }
 
 EdgeTpuApiStatus ImprintingEngineNative::UpdateModelTrainingMetaData() {
   EDGETPU_API_REPORT_ERROR(error_reporter_, !model_t_, "model_t == nullptr!");
-  std::string description;
-  for (const auto& entry : metadata_) {
-    absl::StrAppend(&description,
-                    absl::StrFormat("%d %f\n", entry.first, entry.second));
-  }
-  model_t_->description = description;
+  SetTrainingMetadata(metadata_, model_t_.get());
   return kEdgeTpuApiOk;
 }
 
@@ -97,8 +92,6 @@ EdgeTpuApiStatus ImprintingEngineNative::PreprocessImprintingModel() {
     weights_.resize(kernel_buffer->data.size());
     std::memcpy(weights_.data(), kernel_buffer->data.data(),
                 kernel_buffer->data.size());
-    // Read metadata from model description.
-    ExtractModelTrainingMetadata();
   } else {
     weights_.clear();
     metadata_.clear();
@@ -170,13 +163,7 @@ EdgeTpuApiStatus ImprintingEngineNative::PostprocessImprintingModel() {
   const int mul_tensor_index = mul_op->outputs[0];
   auto& mul_tensor = tensors[mul_tensor_index];
   mul_tensor->shape[3] = new_num_classes;
-  const int scale_factor_tensor_index = mul_op->inputs[1];
-  auto& scale_factor_tensor = tensors[scale_factor_tensor_index];
-  auto& scale_factor_buffer = buffers[scale_factor_tensor->buffer];
-  float scale_factor = Dequantize(
-      scale_factor_buffer->data,
-      /*scale=*/scale_factor_tensor->quantization->scale[0],
-      /*zero_point=*/scale_factor_tensor->quantization->zero_point[0])[0];
+  const float scale_factor = scale_factor_;
   mul_tensor->quantization =
       CreateQuantParam(/*min=*/{-scale_factor}, /*max=*/{scale_factor},
                        /*scale=*/{1.0f / 128 * scale_factor},
@@ -228,17 +215,207 @@ EdgeTpuApiStatus ImprintingEngineNative::PostprocessImprintingModel() {
   return kEdgeTpuApiOk;
 }
 
+namespace {
+// Tables and vectors of `subgraph` which are referenced by more than one
+// tensor, and so can't be changed in place for a single tensor.
+std::unordered_set<const void*> FindSharedTensorFields(
+    const tflite::SubGraph& subgraph) {
+  std::unordered_set<const void*> seen, shared;
+  auto add = [&seen, &shared](const void* field) {
+    if (field && !seen.insert(field).second) shared.insert(field);
+  };
+  for (const auto* tensor : *subgraph.tensors()) {
+    add(tensor->shape());
+    const auto* quantization = tensor->quantization();
+    add(quantization);
+    if (quantization) {
+      add(quantization->min());
+      add(quantization->max());
+      add(quantization->scale());
+      add(quantization->zero_point());
+    }
+  }
+  return shared;
+}
+}  // namespace
+
+bool ImprintingEngineNative::PatchClassificationModel(
+    std::vector<char>* buffer) {
+  const tflite::Model* model = tflite::GetModel(model_buffer_.data());
+  if (!model->subgraphs() || model->subgraphs()->size() != 1 ||
+      !model->buffers()) {
+    return false;
+  }
+  const auto& subgraph = *model->subgraphs()->Get(0);
+  const auto& ops = *subgraph.operators();
+  const auto& tensors = *subgraph.tensors();
+  const auto& buffers = *model->buffers();
+  const std::unordered_set<const void*> shared =
+      FindSharedTensorFields(subgraph);
+  FlatBufferPatcher patcher(model_buffer_.data(), model_buffer_.size());
+
+  // Sets dimension `dim` of the shape of `tensor`, negative from the end.
+  auto set_dim = [&shared, &patcher](const tflite::Tensor* tensor, int dim,
+                                     int value) {
+    const auto* shape = tensor->shape();
+    if (!shape || shared.count(shape)) return false;
+    if (dim < 0) dim += shape->size();
+    if (dim < 0 || dim >= shape->size()) return false;
+    patcher.SetElement<int32_t>(shape, dim, value);
+    return true;
+  };
+  // Sets per-tensor quantization parameters like CreateQuantParam().
+  auto set_quant_param = [&shared, &patcher](const tflite::Tensor* tensor,
+                                             float min, float max,
+                                             float scale,
+                                             int64_t zero_point) {
+    const auto* q = tensor->quantization();
+    if (!q || shared.count(q) || !q->min() || q->min()->size() != 1 ||
+        shared.count(q->min()) || !q->max() || q->max()->size() != 1 ||
+        shared.count(q->max()) || !q->scale() || q->scale()->size() != 1 ||
+        shared.count(q->scale()) || !q->zero_point() ||
+        q->zero_point()->size() != 1 || shared.count(q->zero_point())) {
+      return false;
+    }
+    patcher.SetElement(q->min(), 0, min);
+    patcher.SetElement(q->max(), 0, max);
+    patcher.SetElement(q->scale(), 0, scale);
+    patcher.SetElement(q->zero_point(), 0, zero_point);
+    return true;
+  };
+  auto data_field = [&buffers](const tflite::Tensor* tensor) {
+    return FlatBufferPatcher::FieldAddress(buffers.Get(tensor->buffer()),
+                                           tflite::Buffer::VT_DATA);
+  };
+
+  const int new_num_classes = weights_.size() / embedding_vector_dim_;
+  const int num_ops = ops.size();
+  if (num_ops < 5) return false;
+
+  // Conv2d kernel, bias and output.
+  const auto* fc_op = ops.Get(num_ops - 4);
+  const auto* kernel_tensor = tensors.Get(fc_op->inputs()->Get(1));
+  const auto* bias_tensor = tensors.Get(fc_op->inputs()->Get(2));
+  const auto* fc_output_tensor = tensors.Get(fc_op->outputs()->Get(0));
+  const uint8_t* kernel_data = data_field(kernel_tensor);
+  const uint8_t* bias_data = data_field(bias_tensor);
+  if (!kernel_data || !bias_data || !bias_tensor->quantization() ||
+      !bias_tensor->quantization()->zero_point() ||
+      bias_tensor->quantization()->zero_point()->size() != 1) {
+    return false;
+  }
+  const int64_t bias_zero_point =
+      bias_tensor->quantization()->zero_point()->Get(0);
+  if (bias_zero_point < 0 || bias_zero_point > 255) return false;
+  patcher.ReplaceVector(
+      kernel_data, weights_.data(), weights_.size(),
+      buffer_alignment_ && weights_.size() >= buffer_alignment_
+          ? std::max<int>(buffer_alignment_, FlatBufferPatcher::kAlignment)
+          : FlatBufferPatcher::kAlignment);
+  patcher.ReplaceVectorWithValue(bias_data,
+                                 static_cast<uint8_t>(bias_zero_point),
+                                 new_num_classes * sizeof(int32_t));
+  if (!set_dim(kernel_tensor, 0, new_num_classes) ||
+      !set_dim(bias_tensor, 0, new_num_classes) ||
+      !set_dim(fc_output_tensor, 3, new_num_classes) ||
+      !set_quant_param(fc_output_tensor, -1.0f, 1.0f, 1.0f / 128, 128)) {
+    return false;
+  }
+
+  // Mul output.
+  const float scale_factor = scale_factor_;
+  const auto* mul_tensor = tensors.Get(ops.Get(num_ops - 3)->outputs()->Get(0));
+  if (!set_dim(mul_tensor, 3, new_num_classes) ||
+      !set_quant_param(mul_tensor, -scale_factor, scale_factor,
+                       1.0f / 128 * scale_factor, 128)) {
+    return false;
+  }
+
+  // Reshape output, shape input and options.
+  const auto* reshape_op = ops.Get(num_ops - 2);
+  const auto* reshape_tensor = tensors.Get(reshape_op->outputs()->Get(0));
+  if (!set_dim(reshape_tensor, -1, new_num_classes) ||
+      !set_quant_param(reshape_tensor, -scale_factor, scale_factor,
+                       1.0f / 128 * scale_factor, 128)) {
+    return false;
+  }
+  if (reshape_op->inputs()->size() == 2) {
+    const auto* shape_tensor = tensors.Get(reshape_op->inputs()->Get(1));
+    const auto* shape_data = buffers.Get(shape_tensor->buffer())->data();
+    if (!shape_data || shape_data->size() < 2 * sizeof(int32_t)) return false;
+    // Bytes of the int32 shape, the second value is the number of classes.
+    patcher.SetScalar<int32_t>(shape_data->Data() + sizeof(int32_t),
+                               new_num_classes);
+  }
+  const auto* reshape_options = reshape_op->builtin_options_as_ReshapeOptions();
+  if (!reshape_options || !reshape_options->new_shape() ||
+      reshape_options->new_shape()->size() == 0) {
+    return false;
+  }
+  patcher.SetElement<int32_t>(reshape_options->new_shape(),
+                              reshape_options->new_shape()->size() - 1,
+                              new_num_classes);
+
+  // Softmax output.
+  const auto* softmax_tensor =
+      tensors.Get(ops.Get(num_ops - 1)->outputs()->Get(0));
+  if (!set_dim(softmax_tensor, 1, new_num_classes)) return false;
+
+  // Training metadata, only found in models saved by this engine.
+  const int metadata_index = FindTrainingMetadataBuffer(*model);
+  if (metadata_index == -1) return false;
+  const std::vector<uint8_t> metadata = EncodeTrainingMetadata(metadata_);
+  patcher.ReplaceVector(
+      FlatBufferPatcher::FieldAddress(buffers.Get(metadata_index),
+                                      tflite::Buffer::VT_DATA),
+      metadata.data(), metadata.size());
+  std::map<int, float> text_metadata;
+  if (model->description() &&
+      ParseTextTrainingMetadata(model->description()->str(), &text_metadata)) {
+    patcher.ReplaceString(FlatBufferPatcher::FieldAddress(
+                              model, tflite::Model::VT_DESCRIPTION),
+                          "");
+  }
+
+  *buffer = std::move(*patcher.mutable_buffer());
+  num_classes_ = new_num_classes;
+  return true;
+}
+
+EdgeTpuApiStatus ImprintingEngineNative::BuildClassificationModel(
+    std::vector<char>* buffer) {
+  // Patching only aligns the new weights, other buffers keep their offsets.
+  const bool keeps_alignment =
+      buffer_alignment_ == 0 || buffer_alignment_ == model_buffer_alignment_;
+  if (keeps_alignment && PatchClassificationModel(buffer)) {
+    return kEdgeTpuApiOk;
+  }
+
+  VLOG(1) << "Model can't be patched in place, packing it again.";
+  EDGETPU_API_ENSURE_STATUS(PostprocessImprintingModel());
+  EDGETPU_API_ENSURE_STATUS(UpdateModelTrainingMetaData());
+  auto fbb = GetFlatBufferBuilder(model_t_.get(), buffer_alignment_);
+  const char* data = reinterpret_cast<const char*>(fbb->GetBufferPointer());
+  buffer->assign(data, data + fbb->GetSize());
+  // This one has all the fields to patch next time.
+  model_buffer_.assign(data, fbb->GetSize());
+  model_buffer_alignment_ = buffer_alignment_;
+  return kEdgeTpuApiOk;
+}
+
 EdgeTpuApiStatus ImprintingEngineNative::Init(const std::string& model_path,
-                                              bool keep_classes) {
+                                              bool keep_classes,
+                                              bool classify_on_host) {
   keep_classes_ = keep_classes;
-  std::string input_model_content;
+  classify_on_host_ = classify_on_host;
   EDGETPU_API_ENSURE_STATUS(
-      ReadFile(model_path, &input_model_content, error_reporter_.get()));
-  VLOG(1) << "Input model size in bytes: " << input_model_content.size();
-  const tflite::Model* model = tflite::GetModel(input_model_content.data());
+      ReadFile(model_path, &model_buffer_, error_reporter_.get()));
+  VLOG(1) << "Input model size in bytes: " << model_buffer_.size();
+  const tflite::Model* model = tflite::GetModel(model_buffer_.data());
   EDGETPU_API_REPORT_ERROR(error_reporter_, !model,
                            "Failed to parse input model.");
   model_t_ = absl::WrapUnique<tflite::ModelT>(model->UnPack());
+  if (keep_classes_) ExtractModelTrainingMetadata(*model);
 
   std::vector<tflite::TensorT*> graph_output_tensors =
       GetGraphOutputTensors(model_t_.get());
@@ -277,6 +454,17 @@ EdgeTpuApiStatus ImprintingEngineNative::Init(const std::string& model_path,
   std::get<0>(fc_kernel_quant_param_) = kernel_tensor->quantization->scale[0];
   std::get<1>(fc_kernel_quant_param_) =
       kernel_tensor->quantization->zero_point[0];
+  std::get<0>(embedding_quant_param_) =
+      embedding_output_tensor->quantization->scale[0];
+  std::get<1>(embedding_quant_param_) =
+      embedding_output_tensor->quantization->zero_point[0];
+  // Get the scale factor of Mul layer, which is a constant.
+  auto& mul_op = ops[ops.size() - 3];
+  auto& scale_factor_tensor = tensors[mul_op->inputs[1]];
+  scale_factor_ = Dequantize(
+      model_t_->buffers[scale_factor_tensor->buffer]->data,
+      /*scale=*/scale_factor_tensor->quantization->scale[0],
+      /*zero_point=*/scale_factor_tensor->quantization->zero_point[0])[0];
   // Construct inference engine that can calculate embedding vectors.
   auto fbb = GetFlatBufferBuilder(model_t_.get());
   embedding_extractor_buffer_ = std::vector<char>(
@@ -309,19 +497,18 @@ EdgeTpuApiStatus ImprintingEngineNative::Init(const std::string& model_path,
   return kEdgeTpuApiOk;
 }
 
-EdgeTpuApiStatus ImprintingEngineNative::Train(const uint8_t* input, int dim1,
-                                               int dim2, const int class_id) {
-  IMPRINTING_ENGINE_NATIVE_INIT_CHECK();
+EdgeTpuApiStatus ImprintingEngineNative::CheckTrainingClass(
+    int class_id, float* sqrt_sum_old) {
   EDGETPU_API_REPORT_ERROR(
       error_reporter_, weights_.size() % embedding_vector_dim_ != 0,
       "Size of weights_ must be multiple of embedding_vector_dim_!");
   int num_classes_trained = weights_.size() / embedding_vector_dim_;
   // Get previous trained image number of class |class_id|.
   // Or add a new category if |class_id| is not trained.
-  float sqrt_sum_old = 0.;
+  *sqrt_sum_old = 0.;
   auto iter = metadata_.find(class_id);
   if (iter != metadata_.end()) {
-    sqrt_sum_old = iter->second;
+    *sqrt_sum_old = iter->second;
     EDGETPU_API_REPORT_ERROR(
         error_reporter_, class_id >= num_classes_trained,
         "This class_id must be smaller than the number of trained classes if "
@@ -335,6 +522,14 @@ EdgeTpuApiStatus ImprintingEngineNative::Train(const uint8_t* input, int dim1,
         "Cannot change the base model classes not trained with imprinting "
         "method!");
   }
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus ImprintingEngineNative::Train(const uint8_t* input, int dim1,
+                                               int dim2, const int class_id) {
+  IMPRINTING_ENGINE_NATIVE_INIT_CHECK();
+  float sqrt_sum_old;
+  EDGETPU_API_ENSURE_STATUS(CheckTrainingClass(class_id, &sqrt_sum_old));
   const int num_images = dim1;
   EDGETPU_API_REPORT_ERROR(
       error_reporter_, num_images > 200,
@@ -343,34 +538,64 @@ EdgeTpuApiStatus ImprintingEngineNative::Train(const uint8_t* input, int dim1,
                            "No images sent for training!");
   EDGETPU_API_REPORT_ERROR(error_reporter_, dim2 == 0, "Image size is zero!");
 
-  std::vector<float> weights_sum(embedding_vector_dim_, 0.0f);
+  std::vector<float> embedding_sum(embedding_vector_dim_, 0.0f);
+  EDGETPU_API_ENSURE_STATUS(
+      AddToEmbeddingSum(input, num_images, dim2, &embedding_sum));
+  return TrainWithEmbeddingSum(embedding_sum, class_id);
+}
 
-  if (sqrt_sum_old > 0.f) {
-    weights_sum = Dequantize<uint8_t>(
-        {weights_.begin() + class_id * embedding_vector_dim_,
-         weights_.begin() + (class_id + 1) * embedding_vector_dim_},
-        /*scale=*/std::get<0>(fc_kernel_quant_param_),
-        /*zero_point=*/std::get<1>(fc_kernel_quant_param_));
+EdgeTpuApiStatus ImprintingEngineNative::AddToEmbeddingSum(
+    const uint8_t* input, int num_images, int image_size,
+    std::vector<float>* embedding_sum) {
+  IMPRINTING_ENGINE_NATIVE_INIT_CHECK();
+  EDGETPU_API_REPORT_ERROR(error_reporter_,
+                           embedding_sum->size() != embedding_vector_dim_,
+                           "Size of embedding sum must be the dimension of "
+                           "embedding vector!");
+  EDGETPU_API_REPORT_ERROR(error_reporter_, image_size == 0,
+                           "Image size is zero!");
+  if (num_images == 0) return kEdgeTpuApiOk;
+
+  std::vector<float> embeddings;
+  EDGETPU_API_ENSURE_STATUS(
+      ExtractEmbeddings(input, num_images, image_size, &embeddings));
+  // Sum in image order, so that results are the same with any number of
+  // devices.
+  float* sum = embedding_sum->data();
+  for (int i = 0; i < num_images; ++i) {
+    const float* embedding = embeddings.data() + i * embedding_vector_dim_;
     for (int j = 0; j < embedding_vector_dim_; ++j) {
-      weights_sum[j] = sqrt_sum_old * weights_sum[j];
+      sum[j] += embedding[j];
     }
   }
+  return kEdgeTpuApiOk;
+}
 
-  for (int i = 0; i < num_images; ++i) {
-    float const* result;
-    int result_size;
-    EDGETPU_API_REPORT_ERROR(
-        error_reporter_,
-        embedding_extractor_->RunInference(input + i * dim2, dim2, &result,
-                                           &result_size) == kEdgeTpuApiError,
-        embedding_extractor_->get_error_message());
-    EDGETPU_API_REPORT_ERROR(
-        error_reporter_, result_size != embedding_vector_dim_,
-        "Unexpected inference result size of embedding extractor!");
+EdgeTpuApiStatus ImprintingEngineNative::TrainWithEmbeddingSum(
+    const std::vector<float>& embedding_sum, int class_id) {
+  IMPRINTING_ENGINE_NATIVE_INIT_CHECK();
+  EDGETPU_API_REPORT_ERROR(error_reporter_,
+                           embedding_sum.size() != embedding_vector_dim_,
+                           "Size of embedding sum must be the dimension of "
+                           "embedding vector!");
+  float sqrt_sum_old;
+  EDGETPU_API_ENSURE_STATUS(CheckTrainingClass(class_id, &sqrt_sum_old));
+
+  std::vector<float> weights_sum(embedding_vector_dim_, 0.0f);
+  if (sqrt_sum_old > 0.f) {
+    Dequantize(absl::MakeConstSpan(
+                   weights_.data() + class_id * embedding_vector_dim_,
+                   embedding_vector_dim_),
+               /*scale=*/std::get<0>(fc_kernel_quant_param_),
+               /*zero_point=*/std::get<1>(fc_kernel_quant_param_),
+               absl::MakeSpan(weights_sum));
     for (int j = 0; j < embedding_vector_dim_; ++j) {
-      weights_sum[j] += result[j];
+      weights_sum[j] = sqrt_sum_old * weights_sum[j];
     }
   }
+  for (int j = 0; j < embedding_vector_dim_; ++j) {
+    weights_sum[j] += embedding_sum[j];
+  }
 
   // Average weights and then re-normalize, same as normalizing the sum.
   float sum = 0.0f;
@@ -378,30 +603,122 @@ EdgeTpuApiStatus ImprintingEngineNative::Train(const uint8_t* input, int dim1,
     sum += weights_sum[i] * weights_sum[i];
   }
   float sqrt_sum = std::sqrt(sum);
+  EDGETPU_API_REPORT_ERROR(error_reporter_, !(sqrt_sum > 0.0f),
+                           "Sum of embeddings is zero!");
   std::vector<float> normalized_weights(embedding_vector_dim_);
 
   for (int i = 0; i < weights_sum.size(); ++i) {
     normalized_weights[i] = weights_sum[i] / sqrt_sum;
   }
-  auto quant_normalized_weights = Quantize<uint8_t>(
-      normalized_weights, /*scale=*/std::get<0>(fc_kernel_quant_param_),
-      /*zero_point=*/std::get<1>(fc_kernel_quant_param_));
-
-  if (sqrt_sum_old > 0) {
-    for (int j = 0; j < embedding_vector_dim_; ++j) {
-      weights_[class_id * embedding_vector_dim_ + j] =
-          quant_normalized_weights[j];
-    }
-  } else {
-    weights_.insert(weights_.end(), quant_normalized_weights.begin(),
-                    quant_normalized_weights.end());
+  // Quantizes the weights of the class in place, or after the previous
+  // classes for a new one.
+  int offset = class_id * embedding_vector_dim_;
+  if (!(sqrt_sum_old > 0)) {
+    offset = weights_.size();
+    weights_.resize(offset + embedding_vector_dim_);
   }
+  Quantize(normalized_weights, /*scale=*/std::get<0>(fc_kernel_quant_param_),
+           /*zero_point=*/std::get<1>(fc_kernel_quant_param_),
+           absl::MakeSpan(weights_.data() + offset, embedding_vector_dim_));
   // Insert or replace metadata_.
   metadata_[class_id] = sqrt_sum;
   needs_postprocess_ = true;
   return kEdgeTpuApiOk;
 }
 
+EdgeTpuApiStatus ImprintingEngineNative::get_input_tensor_shape(
+    int const** dims, int* dims_num) const {
+  IMPRINTING_ENGINE_NATIVE_INIT_CHECK();
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_,
+      embedding_extractor_->get_input_tensor_shape(dims, dims_num) ==
+          kEdgeTpuApiError,
+      embedding_extractor_->get_error_message());
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus ImprintingEngineNative::SetNumTrainingDevices(
+    int num_devices) {
+  IMPRINTING_ENGINE_NATIVE_INIT_CHECK();
+  EDGETPU_API_REPORT_ERROR(error_reporter_, num_devices < 1,
+                           "Number of training devices must be positive!");
+  training_extractors_.clear();
+  const std::vector<std::string> device_paths =
+      EdgeTpuResourceManager::GetSingleton()->ListEdgeTpuPaths(
+          EdgeTpuResourceManager::EdgeTpuState::kUnassigned);
+  for (int i = 0; i < device_paths.size() && i < num_devices - 1; ++i) {
+    BasicEngineNativeBuilder builder(
+        tflite::FlatBufferModel::BuildFromBuffer(
+            embedding_extractor_buffer_.data(),
+            embedding_extractor_buffer_.size()),
+        device_paths[i]);
+    std::unique_ptr<BasicEngineNative> extractor;
+    EDGETPU_API_REPORT_ERROR(error_reporter_,
+                             builder(&extractor) == kEdgeTpuApiError,
+                             builder.get_error_message());
+    training_extractors_.push_back(std::move(extractor));
+  }
+  VLOG(1) << "Training on " << get_num_training_devices() << " Edge TPU(s).";
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus ImprintingEngineNative::SetBufferAlignment(int alignment) {
+  EDGETPU_API_REPORT_ERROR(error_reporter_,
+                           alignment < 0 || (alignment & (alignment - 1)),
+                           "Buffer alignment must be 0 or a power of 2!");
+  buffer_alignment_ = alignment;
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus ImprintingEngineNative::ExtractEmbeddings(
+    const uint8_t* input, int num_images, int image_size,
+    std::vector<float>* embeddings) {
+  embeddings->resize(num_images * embedding_vector_dim_);
+  std::vector<BasicEngineNative*> extractors = {embedding_extractor_.get()};
+  for (const auto& extractor : training_extractors_) {
+    extractors.push_back(extractor.get());
+  }
+  const int num_workers = std::min<int>(extractors.size(), num_images);
+
+  // Every worker drives one device and keeps pulling the next image to run,
+  // so that faster devices take more images.
+  std::atomic<int> next_image(0);
+  std::atomic<bool> failed(false);
+  std::vector<std::string> errors(num_workers);
+  auto worker = [&](int worker_index) {
+    BasicEngineNative* extractor = extractors[worker_index];
+    for (int i = next_image++; i < num_images && !failed; i = next_image++) {
+      float const* result;
+      int result_size;
+      if (extractor->RunInference(input + i * image_size, image_size, &result,
+                                  &result_size) == kEdgeTpuApiError) {
+        errors[worker_index] = extractor->get_error_message();
+      } else if (result_size != embedding_vector_dim_) {
+        errors[worker_index] =
+            "Unexpected inference result size of embedding extractor!";
+      }
+      if (!errors[worker_index].empty()) {
+        failed = true;
+        return;
+      }
+      std::copy(result, result + result_size,
+                embeddings->data() + i * embedding_vector_dim_);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_workers; ++i) {
+    threads.emplace_back(worker, i);
+  }
+  worker(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& error : errors) {
+    EDGETPU_API_REPORT_ERROR(error_reporter_, !error.empty(), error);
+  }
+  return kEdgeTpuApiOk;
+}
+
 EdgeTpuApiStatus ImprintingEngineNative::SaveModel(
     const std::string& output_path) {
   IMPRINTING_ENGINE_NATIVE_INIT_CHECK();
@@ -412,24 +729,17 @@ EdgeTpuApiStatus ImprintingEngineNative::SaveModel(
       "Weights size mismatch! It must be multiple of embedding vector's "
       "dimension!");
 
-  EDGETPU_API_ENSURE_STATUS(PostprocessImprintingModel());
-  EDGETPU_API_ENSURE_STATUS(UpdateModelTrainingMetaData());
-
-  // Convert from tflite::ModelT format to FlatBufferBuilder.
-  auto fbb = GetFlatBufferBuilder(model_t_.get());
-  VLOG(1) << "Output model size in bytes: " << fbb->GetSize();
-  EDGETPU_API_ENSURE_STATUS(WriteFile(
-      std::string(reinterpret_cast<const char*>(fbb->GetBufferPointer()),
-                  fbb->GetSize()),
-      output_path, error_reporter_.get()));
+  std::vector<char> buffer;
+  EDGETPU_API_ENSURE_STATUS(BuildClassificationModel(&buffer));
+  VLOG(1) << "Output model size in bytes: " << buffer.size();
+  EDGETPU_API_ENSURE_STATUS(
+      WriteFile(std::string(buffer.data(), buffer.size()), output_path,
+                error_reporter_.get()));
   return kEdgeTpuApiOk;
 }
 
-EdgeTpuApiStatus ImprintingEngineNative::RunInference(
-    const uint8_t* const input, const int in_size, float const** const output,
-    int* const out_size) {
-  const auto& start_time = std::chrono::steady_clock::now();
-
+EdgeTpuApiStatus ImprintingEngineNative::RunClassificationModel(
+    const uint8_t* const input, const int in_size) {
   if (needs_postprocess_) {
     EDGETPU_API_REPORT_ERROR(error_reporter_, weights_.empty(),
                              "Model without training couldn't run inference!");
@@ -438,15 +748,25 @@ EdgeTpuApiStatus ImprintingEngineNative::RunInference(
         "Weights size mismatch! It must be multiple of embedding vector's "
         "dimension!");
 
-    EDGETPU_API_ENSURE_STATUS(PostprocessImprintingModel());
-
-    auto fbb = GetFlatBufferBuilder(model_t_.get());
-    classification_model_buffer_ = std::vector<char>(
-        fbb->GetBufferPointer(), fbb->GetBufferPointer() + fbb->GetSize());
-
-    BasicEngineNativeBuilder builder(tflite::FlatBufferModel::BuildFromBuffer(
-        classification_model_buffer_.data(),
-        classification_model_buffer_.size()));
+    // The previous model uses the buffer about to be replaced.
+    classification_model_.reset();
+    EDGETPU_API_ENSURE_STATUS(
+        BuildClassificationModel(&classification_model_buffer_));
+
+    // Other Edge TPUs may all be taken by training, in which case the
+    // classification model shares the device of the embedding extractor.
+    std::string device_path;
+    if (!training_extractors_.empty()) {
+      EDGETPU_API_REPORT_ERROR(
+          error_reporter_,
+          embedding_extractor_->device_path(&device_path) == kEdgeTpuApiError,
+          embedding_extractor_->get_error_message());
+    }
+    BasicEngineNativeBuilder builder(
+        tflite::FlatBufferModel::BuildFromBuffer(
+            classification_model_buffer_.data(),
+            classification_model_buffer_.size()),
+        device_path);
 
     EDGETPU_API_REPORT_ERROR(
         error_reporter_, builder(&classification_model_) == kEdgeTpuApiError,
@@ -464,9 +784,99 @@ EdgeTpuApiStatus ImprintingEngineNative::RunInference(
   EDGETPU_API_REPORT_ERROR(
       error_reporter_, result_size != num_classes_,
       "Unexpected inference result size of classification model!");
-  (*out_size) = num_classes_;
   inference_result_.resize(num_classes_);
   std::memcpy(&inference_result_[0], result, sizeof(float) * num_classes_);
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus ImprintingEngineNative::ClassifyOnHost(
+    const uint8_t* const input, const int in_size) {
+  const int dim = embedding_vector_dim_;
+  if (needs_postprocess_ || weights_row_sums_.empty()) {
+    EDGETPU_API_REPORT_ERROR(error_reporter_, weights_.empty(),
+                             "Model without training couldn't run inference!");
+    EDGETPU_API_REPORT_ERROR(
+        error_reporter_, weights_.size() % dim != 0,
+        "Weights size mismatch! It must be multiple of embedding vector's "
+        "dimension!");
+    num_classes_ = weights_.size() / dim;
+    weights_row_sums_.resize(num_classes_);
+    for (int i = 0; i < num_classes_; ++i) {
+      weights_row_sums_[i] = std::accumulate(weights_.begin() + i * dim,
+                                             weights_.begin() + (i + 1) * dim,
+                                             static_cast<int32_t>(0));
+    }
+    needs_postprocess_ = false;
+  }
+
+  float const* embedding;
+  int embedding_size;
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_,
+      embedding_extractor_->RunInference(input, in_size, &embedding,
+                                         &embedding_size) == kEdgeTpuApiError,
+      embedding_extractor_->get_error_message());
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_, embedding_size != dim,
+      "Unexpected inference result size of embedding extractor!");
+
+  // The extractor dequantizes its uint8 output, recover the exact values.
+  const float embedding_scale = std::get<0>(embedding_quant_param_);
+  const int32_t embedding_zero_point = std::get<1>(embedding_quant_param_);
+  quant_embedding_.resize(dim);
+  int32_t embedding_sum = 0;
+  for (int j = 0; j < dim; ++j) {
+    quant_embedding_[j] = static_cast<uint8_t>(std::max(
+        0.0f, std::min(255.0f, std::round(embedding[j] / embedding_scale +
+                                          embedding_zero_point))));
+    embedding_sum += quant_embedding_[j];
+  }
+
+  // Conv2d accumulates (embedding - zero point) * (weights - zero point). Its
+  // output is quantized to [-1, 1] with scale 1/128, which the Mul layer
+  // scales by `scale_factor_`.
+  const float kernel_scale = std::get<0>(fc_kernel_quant_param_);
+  const int32_t kernel_zero_point = std::get<1>(fc_kernel_quant_param_);
+  const int32_t zero_points_term =
+      dim * embedding_zero_point * kernel_zero_point;
+  const float acc_scale = embedding_scale * kernel_scale * 128;
+  inference_result_.resize(num_classes_);
+  float max_logit = -std::numeric_limits<float>::max();
+  for (int i = 0; i < num_classes_; ++i) {
+    const int32_t acc =
+        DotProduct(quant_embedding_.data(), &weights_[i * dim], dim) -
+        kernel_zero_point * embedding_sum -
+        embedding_zero_point * weights_row_sums_[i] + zero_points_term;
+    const float quant_logit =
+        std::max(-128.0f, std::min(127.0f, std::round(acc * acc_scale)));
+    inference_result_[i] = quant_logit / 128 * scale_factor_;
+    max_logit = std::max(max_logit, inference_result_[i]);
+  }
+
+  // Softmax.
+  float sum = 0.0f;
+  for (float& value : inference_result_) {
+    value = std::exp(value - max_logit);
+    sum += value;
+  }
+  for (float& value : inference_result_) {
+    value /= sum;
+  }
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus ImprintingEngineNative::RunInference(
+    const uint8_t* const input, const int in_size, float const** const output,
+    int* const out_size) {
+  IMPRINTING_ENGINE_NATIVE_INIT_CHECK();
+  const auto& start_time = std::chrono::steady_clock::now();
+
+  if (classify_on_host_) {
+    EDGETPU_API_ENSURE_STATUS(ClassifyOnHost(input, in_size));
+  } else {
+    EDGETPU_API_ENSURE_STATUS(RunClassificationModel(input, in_size));
+  }
+  (*out_size) = num_classes_;
   (*output) = inference_result_.data();
 
   std::chrono::duration<double, std::milli> time_span =
@@ -498,8 +908,10 @@ EdgeTpuApiStatus ImprintingEngineNative::set_metadata(
 
 // Creates BasicEngineNative with FlatBuffer file.
 ImprintingEngineNativeBuilder::ImprintingEngineNativeBuilder(
-    const std::string& model_path, bool keep_classes)
-    : model_path_(model_path), keep_classes_(keep_classes) {
+    const std::string& model_path, bool keep_classes, bool classify_on_host)
+    : model_path_(model_path),
+      keep_classes_(keep_classes),
+      classify_on_host_(classify_on_host) {
   error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
 }
 
@@ -511,7 +923,8 @@ EdgeTpuApiStatus ImprintingEngineNativeBuilder::operator()(
   (*engine) = absl::make_unique<ImprintingEngineNative>();
   EDGETPU_API_REPORT_ERROR(
       error_reporter_,
-      (*engine)->Init(model_path_, keep_classes_) == kEdgeTpuApiError,
+      (*engine)->Init(model_path_, keep_classes_, classify_on_host_) ==
+          kEdgeTpuApiError,
       (*engine)->get_error_message());
   return kEdgeTpuApiOk;
 }
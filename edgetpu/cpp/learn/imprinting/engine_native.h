@@ -2,6 +2,7 @@
 #define EDGETPU_CPP_LEARN_IMPRINTING_ENGINE_NATIVE_H_
 
 #include <map>
+#include <string>
 #include <vector>
 
 #include "absl/memory/memory.h"
@@ -24,7 +25,8 @@ class ImprintingEngineNative {
 
   ~ImprintingEngineNative() {
     // Free memory here explicitly to make sure `embedding_extractor_buffer_`
-    // lives longer than `embedding_extractor_`.
+    // lives longer than `embedding_extractor_` and `training_extractors_`.
+    training_extractors_.clear();
     embedding_extractor_.reset();
     embedding_extractor_buffer_.clear();
   }
@@ -40,7 +42,13 @@ class ImprintingEngineNative {
   //
   // Users can choose whether to keep previous classes by setting keep_classes
   // to true or false.
-  EdgeTpuApiStatus Init(const std::string& model_path, bool keep_classes);
+  //
+  // With classify_on_host, RunInference() only runs the embedding extractor on
+  // Edge TPU and scores the classes on host against the imprinted weights, so
+  // training never triggers a rebuild of the classification model. The model
+  // is then only assembled by SaveModel().
+  EdgeTpuApiStatus Init(const std::string& model_path, bool keep_classes,
+                        bool classify_on_host = false);
 
   // Saves the re-trained model to specific path.
   //
@@ -69,9 +77,53 @@ class ImprintingEngineNative {
   // be under keep_classes mode.
   //
   // Call this function multiple times to train multiple different categories.
+  //
+  // At most 200 images can be trained at once. Use AddToEmbeddingSum() and
+  // TrainWithEmbeddingSum() for more.
   EdgeTpuApiStatus Train(const uint8_t* input, int dim1, int dim2,
                          const int class_id);
 
+  // Streaming counterpart of Train(), for any number of images of a class.
+  // AddToEmbeddingSum() runs the embedding extractor on `num_images` images of
+  // `image_size` bytes, stored one after the other in `input`, and adds their
+  // embeddings to `embedding_sum`, which has one value per dimension of the
+  // embedding vector. Once all images of the class have been added, in chunks
+  // of any size, TrainWithEmbeddingSum() imprints them like Train() would
+  // with all of them at once. Class ids follow the rules of Train().
+  //
+  // See DirectoryEnroller to enroll the images of a directory tree.
+  EdgeTpuApiStatus AddToEmbeddingSum(const uint8_t* input, int num_images,
+                                     int image_size,
+                                     std::vector<float>* embedding_sum);
+  EdgeTpuApiStatus TrainWithEmbeddingSum(
+      const std::vector<float>& embedding_sum, int class_id);
+
+  // Gets shape of the input tensor of the embedding extractor, i.e. of
+  // training images.
+  EdgeTpuApiStatus get_input_tensor_shape(int const** dims,
+                                          int* dims_num) const;
+
+  // Dimension of the embedding vector.
+  int get_embedding_vector_dim() const { return embedding_vector_dim_; }
+
+  // Sets the number of Edge TPUs that Train() spreads images across. Besides
+  // the device of the embedding extractor, it opens one embedding extractor on
+  // each of up to `num_devices - 1` unassigned Edge TPUs, so fewer devices may
+  // end up being used. Training results do not depend on the number of
+  // devices.
+  EdgeTpuApiStatus SetNumTrainingDevices(int num_devices);
+
+  // Number of Edge TPUs used by Train().
+  int get_num_training_devices() const {
+    return 1 + training_extractors_.size();
+  }
+
+  // Sets the alignment of buffers of at least `alignment` bytes in models
+  // saved by SaveModel(), like GetFlatBufferBuilder() does, e.g. the page size
+  // to share the weights of models loaded with mmap(). `alignment` is a power
+  // of 2, 0 (default) doesn't align them more than usual.
+  EdgeTpuApiStatus SetBufferAlignment(int alignment);
+
   // Getter/setter for metadata, used in tests only.
   EdgeTpuApiStatus get_metadata(std::map<int, float>* metadata);
   EdgeTpuApiStatus set_metadata(const std::map<int, float>& metadata);
@@ -81,15 +133,16 @@ class ImprintingEngineNative {
   std::string get_error_message() { return error_reporter_->message(); }
 
  private:
-  // Extracts training metadata from model description string. It assumes that
-  // model description looks like:
-  // 0 5.4
-  // 1 6.5
-  // 2 4.1
-  // ...
-  void ExtractModelTrainingMetadata();
-
-  // Saves training metadata to model description.
+  // Extracts training metadata from the metadata buffer of `model`, or from
+  // the description of models trained by older versions. See
+  // training_metadata.h for both formats.
+  void ExtractModelTrainingMetadata(const tflite::Model& model);
+
+  // Checks that `class_id` can be trained, and gets the weight of its seen
+  // average embedding into `sqrt_sum_old`, 0 for a new class.
+  EdgeTpuApiStatus CheckTrainingClass(int class_id, float* sqrt_sum_old);
+
+  // Saves training metadata to the metadata buffer of model_t_.
   EdgeTpuApiStatus UpdateModelTrainingMetaData();
 
   // Preprocesses the model before training.
@@ -106,6 +159,36 @@ class ImprintingEngineNative {
   // model outputs.
   EdgeTpuApiStatus PostprocessImprintingModel();
 
+  // Builds the classification model with the trained weights into `buffer`,
+  // by patching model_buffer_ when possible, or with
+  // PostprocessImprintingModel() otherwise.
+  EdgeTpuApiStatus BuildClassificationModel(std::vector<char>* buffer);
+
+  // Applies the changes of PostprocessImprintingModel() and the training
+  // metadata to a copy of model_buffer_, so that the cost only depends on the
+  // size of the classification layers. Returns false if some of the fields to
+  // change aren't set in the packed model, e.g. when it has no training
+  // metadata yet.
+  bool PatchClassificationModel(std::vector<char>* buffer);
+
+  // Runs all embedding extractors on `num_images` images of `image_size` bytes
+  // each. The embedding of image i goes to the i-th row of `embeddings`,
+  // whichever device computed it.
+  EdgeTpuApiStatus ExtractEmbeddings(const uint8_t* input, int num_images,
+                                     int image_size,
+                                     std::vector<float>* embeddings);
+
+  // Runs the classification model, rebuilding it first if new classes were
+  // trained since last call. Results go to `inference_result_`.
+  EdgeTpuApiStatus RunClassificationModel(const uint8_t* const input,
+                                          const int in_size);
+
+  // Runs the embedding extractor and computes the classification layers on
+  // host, replicating the quantization of the classification model. Results
+  // go to `inference_result_`.
+  EdgeTpuApiStatus ClassifyOnHost(const uint8_t* const input,
+                                  const int in_size);
+
   // Weights of Fully Connected layer.
   std::vector<uint8_t> weights_;
 
@@ -120,11 +203,8 @@ class ImprintingEngineNative {
   // (`f_0`+`f_1`), which is needed to calculate (`f_0`+`f_1`+`f_2)
   // when we want to train a new sample with embedding `f_2`.
   //
-  // This map is used for online learning and is stored in model description
-  // field with the following format:
-  // 0 5.4
-  // 1 6.5
-  // 2 4.1
+  // This map is used for online learning and is stored in a metadata buffer of
+  // the model, see training_metadata.h.
   std::map<int, float> metadata_;
 
   // Dimension of embedding vector.
@@ -139,16 +219,36 @@ class ImprintingEngineNative {
   // Quantization parameters, i.e., scale and zero point for fc kernel.
   std::tuple<float, int64_t> fc_kernel_quant_param_;
 
+  // Quantization parameters of the L2Norm output, i.e., the embedding vector.
+  std::tuple<float, int64_t> embedding_quant_param_;
+
+  // Factor applied by the Mul layer to the output of the fc layer.
+  float scale_factor_;
+
+  // Whether classes are scored on host instead of by a classification model.
+  bool classify_on_host_ = false;
+
+  // Sum of each row of `weights_`, needed to apply zero points on host.
+  std::vector<int32_t> weights_row_sums_;
+
+  // Quantized embedding vector of last inference on host.
+  std::vector<uint8_t> quant_embedding_;
+
   // `embedding_extractor_buffer_` is needed since
   // FlatBufferModel::BuildFromBuffer() (called by BasicEngine) requires caller
   // to maintain the ownership.
   std::vector<char> embedding_extractor_buffer_;
   // Run this engine to get embedding vectors.
   std::unique_ptr<BasicEngineNative> embedding_extractor_;
+  // Extra embedding extractors on other Edge TPUs, only used by Train().
+  std::vector<std::unique_ptr<BasicEngineNative>> training_extractors_;
 
   std::vector<char> classification_model_buffer_;
   // Runs this engine to get classification results.
   std::unique_ptr<BasicEngineNative> classification_model_;
+  // Packed classification model, the input model until a model is built with
+  // PostprocessImprintingModel().
+  std::string model_buffer_;
   // tflite::ModelT representation of the classification model.
   // Notice the model_t is initialized as an embedding extractor after
   // Preprocess step. With one Postprocess step, it will turn out to be a
@@ -166,6 +266,11 @@ class ImprintingEngineNative {
   // Whether to keep previous clasess.
   bool keep_classes_;
 
+  // Alignment of large buffers in saved models, 0 if not aligned.
+  int buffer_alignment_ = 0;
+  // Alignment that `model_buffer_` was packed with, which patching keeps.
+  int model_buffer_alignment_ = 0;
+
   // Data structure to stores error messages.
   std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
   // Indicates whether the instance is initialized.
@@ -177,6 +282,8 @@ class ImprintingEngineNative {
 // model_path: The file path of FlatBuffer model file.
 // keep_classes: Whether to keep classes existed in the model. By default it is
 //   False.
+// classify_on_host: Whether to score classes on host instead of running a
+//   rebuilt classification model on Edge TPU. By default it is False.
 //
 // Returns kEdgeTpuApiOk when ImprintingEngineNative is successfully created.
 // Otherwise you can call get_error_message() to retrieve error message.
@@ -193,7 +300,8 @@ class ImprintingEngineNativeBuilder {
  public:
   // Creates ImprintingEngineNativeBuilder with FlatBuffer file.
   explicit ImprintingEngineNativeBuilder(const std::string& model_path,
-                                         bool keep_classes = false);
+                                         bool keep_classes = false,
+                                         bool classify_on_host = false);
 
   ImprintingEngineNativeBuilder(const ImprintingEngineNativeBuilder&) = delete;
   ImprintingEngineNativeBuilder& operator=(
@@ -210,6 +318,7 @@ class ImprintingEngineNativeBuilder {
   std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
   std::string model_path_;
   bool keep_classes_;
+  bool classify_on_host_;
 };
 
 }  // namespace imprinting
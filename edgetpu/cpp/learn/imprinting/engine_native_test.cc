@@ -1,8 +1,12 @@
 #include "edgetpu/cpp/learn/imprinting/engine_native.h"
 
 #include <cmath>
+#include <fstream>
+#include <iterator>
 
 #include "edgetpu/cpp/learn/imprinting/imprinting_test_base.h"
+#include "edgetpu/cpp/learn/imprinting/training_metadata.h"
+#include "edgetpu/cpp/learn/utils.h"
 #include "gflags/gflags.h"
 #include "glog/logging.h"
 #include "gmock/gmock.h"
@@ -14,6 +18,12 @@ namespace imprinting {
 
 class ImprintingEngineNativeTest : public ImprintingTestBase {
  protected:
+  static std::string ReadFileToString(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file),
+                       std::istreambuf_iterator<char>());
+  }
+
   struct TrainingDatapoint {
     TrainingDatapoint(const std::vector<Image>& images_,
                       const int groundtruth_class_id_)
@@ -148,6 +158,112 @@ TEST_P(ImprintingEngineNativeTest, TestMetadataForOnlineTrainingWithTraining) {
   CheckMetadata(metadata_expected, metadata);
 }
 
+TEST_P(ImprintingEngineNativeTest, TestMetadataIsExact) {
+  EXPECT_EQ(kEdgeTpuApiOk,
+            CreateImprintingEngineNative(
+                GenerateInputModelPath("mobilenet_v1_1.0_224_l2norm_quant"),
+                /*keep_classes=*/true));
+  // Values that "%f" would round.
+  const std::map<int, float> metadata_expected = {{0, 1.23456789f},
+                                                  {5, 1e-7f}};
+  const std::string output_file_path =
+      GenerateOutputModelPath("metadata_exact");
+  EXPECT_EQ(kEdgeTpuApiOk,
+            imprinting_engine_native_->set_metadata(metadata_expected));
+  EXPECT_EQ(kEdgeTpuApiOk,
+            imprinting_engine_native_->SaveModel(output_file_path));
+
+  EXPECT_EQ(kEdgeTpuApiOk, CreateImprintingEngineNative(output_file_path,
+                                                        /*keep_classes=*/true));
+  std::map<int, float> metadata;
+  EXPECT_EQ(kEdgeTpuApiOk, imprinting_engine_native_->get_metadata(&metadata));
+  EXPECT_EQ(metadata_expected, metadata);
+}
+
+TEST_P(ImprintingEngineNativeTest, TestMetadataFromOlderVersions) {
+  EXPECT_EQ(kEdgeTpuApiOk,
+            CreateImprintingEngineNative(
+                GenerateInputModelPath("mobilenet_v1_1.0_224_l2norm_quant"),
+                /*keep_classes=*/false));
+  const std::string trained_path = GenerateOutputModelPath("metadata_binary");
+  EXPECT_EQ(kEdgeTpuApiOk,
+            OnlineTrain({TrainingDatapoint({cat_train_0_}, 0),
+                         TrainingDatapoint({hotdog_train_0_}, 1)},
+                        trained_path));
+
+  // Rewrites the trained model the way older versions saved it, with
+  // metadata in description.
+  std::string model_content = ReadFileToString(trained_path);
+  std::unique_ptr<tflite::ModelT> model_t(
+      tflite::GetModel(model_content.data())->UnPack());
+  ASSERT_NE(-1, FindTrainingMetadataBuffer(*model_t));
+  model_t->metadata_buffer.clear();
+  model_t->description = "0 1.000000\n1 2.500000\n";
+  const std::string text_path = GenerateOutputModelPath("metadata_text");
+  auto fbb = GetFlatBufferBuilder(model_t.get());
+  std::ofstream(text_path, std::ios::binary)
+      .write(reinterpret_cast<const char*>(fbb->GetBufferPointer()),
+             fbb->GetSize());
+
+  const std::map<int, float> metadata_expected = {{0, 1.0f}, {1, 2.5f}};
+  EXPECT_EQ(kEdgeTpuApiOk,
+            CreateImprintingEngineNative(text_path, /*keep_classes=*/true));
+  std::map<int, float> metadata;
+  EXPECT_EQ(kEdgeTpuApiOk, imprinting_engine_native_->get_metadata(&metadata));
+  EXPECT_EQ(metadata_expected, metadata);
+
+  // Saving the model again migrates metadata to the binary buffer.
+  const std::string migrated_path =
+      GenerateOutputModelPath("metadata_migrated");
+  EXPECT_EQ(kEdgeTpuApiOk, imprinting_engine_native_->SaveModel(migrated_path));
+  model_content = ReadFileToString(migrated_path);
+  const tflite::Model* model = tflite::GetModel(model_content.data());
+  TrainingMetadataView view;
+  ASSERT_TRUE(FindTrainingMetadata(*model, &view));
+  EXPECT_EQ(metadata_expected, view.ToMap());
+  EXPECT_TRUE(!model->description() || model->description()->size() == 0);
+}
+
+TEST_P(ImprintingEngineNativeTest, TestSaveModelTwice) {
+  EXPECT_EQ(kEdgeTpuApiOk,
+            CreateImprintingEngineNative(
+                GenerateInputModelPath("mobilenet_v1_1.0_224_l2norm_quant"),
+                /*keep_classes=*/false));
+  // The first model is packed from tflite::ModelT, as the input model has no
+  // training metadata. The second one is patched from the first one.
+  EXPECT_EQ(kEdgeTpuApiOk,
+            OnlineTrain({TrainingDatapoint({cat_train_0_}, 0)},
+                        GenerateOutputModelPath("saved_once")));
+  const std::string output_file_path = GenerateOutputModelPath("saved_twice");
+  EXPECT_EQ(kEdgeTpuApiOk,
+            OnlineTrain({TrainingDatapoint({hotdog_train_0_}, 1),
+                         TrainingDatapoint({dog_train_0_}, 2)},
+                        output_file_path));
+
+  const std::string model_content = ReadFileToString(output_file_path);
+  flatbuffers::Verifier verifier(
+      reinterpret_cast<const uint8_t*>(model_content.data()),
+      model_content.size());
+  ASSERT_TRUE(tflite::VerifyModelBuffer(verifier));
+  TrainingMetadataView view;
+  ASSERT_TRUE(
+      FindTrainingMetadata(*tflite::GetModel(model_content.data()), &view));
+  EXPECT_EQ(3, view.size());
+  TestTrainedModel({TestDatapoint(cat_test_0_, 0, 0.99f),
+                    TestDatapoint(hotdog_test_0_, 1, 0.99f),
+                    TestDatapoint(dog_test_0_, 2, 0.99f)},
+                   output_file_path);
+
+  // Rebuilt models for inference are patched the same way.
+  float const* results;
+  int results_size;
+  EXPECT_EQ(kEdgeTpuApiOk, imprinting_engine_native_->RunInference(
+                               hotdog_test_0_.data(), hotdog_test_0_.size(),
+                               &results, &results_size));
+  ASSERT_EQ(3, results_size);
+  EXPECT_GT(results[1], 0.99f);
+}
+
 TEST_P(ImprintingEngineNativeTest, TestModelWithoutL2NormLayer) {
   ImprintingEngineNativeBuilder builder(
       GenerateInputModelPath("mobilenet_v1_1.0_224_quant"),
@@ -229,6 +345,94 @@ TEST_P(ImprintingEngineNativeTest, TestOnlineTrainingChangeBaseModelClasses) {
       imprinting_engine_native_->get_error_message());
 }
 
+TEST_P(ImprintingEngineNativeTest, TestInvalidNumTrainingDevices) {
+  EXPECT_EQ(kEdgeTpuApiOk,
+            CreateImprintingEngineNative(
+                GenerateInputModelPath("mobilenet_v1_1.0_224_l2norm_quant"),
+                /*keep_classes=*/false));
+  EXPECT_EQ(kEdgeTpuApiError,
+            imprinting_engine_native_->SetNumTrainingDevices(0));
+  EXPECT_EQ("Number of training devices must be positive!",
+            imprinting_engine_native_->get_error_message());
+  EXPECT_EQ(1, imprinting_engine_native_->get_num_training_devices());
+}
+
+TEST_P(ImprintingEngineNativeTest, TestBufferAlignment) {
+  EXPECT_EQ(kEdgeTpuApiOk,
+            CreateImprintingEngineNative(
+                GenerateInputModelPath("mobilenet_v1_1.0_224_l2norm_quant"),
+                /*keep_classes=*/false));
+  EXPECT_EQ(kEdgeTpuApiError, imprinting_engine_native_->SetBufferAlignment(3));
+  EXPECT_EQ("Buffer alignment must be 0 or a power of 2!",
+            imprinting_engine_native_->get_error_message());
+  constexpr int kAlignment = 4096;
+  EXPECT_EQ(kEdgeTpuApiOk,
+            imprinting_engine_native_->SetBufferAlignment(kAlignment));
+
+  // The first model is packed, the second one is patched.
+  EXPECT_EQ(kEdgeTpuApiOk,
+            OnlineTrain({TrainingDatapoint({cat_train_0_}, 0)},
+                        GenerateOutputModelPath("aligned_once")));
+  const std::string output_file_path = GenerateOutputModelPath("aligned_twice");
+  EXPECT_EQ(kEdgeTpuApiOk,
+            OnlineTrain({TrainingDatapoint({hotdog_train_0_}, 1),
+                         TrainingDatapoint({dog_train_0_}, 2)},
+                        output_file_path));
+
+  const std::string model_content = ReadFileToString(output_file_path);
+  flatbuffers::Verifier verifier(
+      reinterpret_cast<const uint8_t*>(model_content.data()),
+      model_content.size());
+  ASSERT_TRUE(tflite::VerifyModelBuffer(verifier));
+  const tflite::Model* model = tflite::GetModel(model_content.data());
+  int num_aligned = 0;
+  for (const auto* buffer : *model->buffers()) {
+    if (!buffer->data() || buffer->data()->size() < kAlignment) continue;
+    const char* data = reinterpret_cast<const char*>(buffer->data()->Data());
+    EXPECT_EQ(0, (data - model_content.data()) % kAlignment);
+    ++num_aligned;
+  }
+  EXPECT_GT(num_aligned, 0);
+  TestTrainedModel({TestDatapoint(cat_test_0_, 0, 0.99f),
+                    TestDatapoint(hotdog_test_0_, 1, 0.99f),
+                    TestDatapoint(dog_test_0_, 2, 0.99f)},
+                   output_file_path);
+}
+
+TEST_P(ImprintingEngineNativeTest, TestTrainingOnMultipleDevices) {
+  const std::vector<TrainingDatapoint> training_datapoints = {
+      TrainingDatapoint({cat_train_0_, dog_train_0_, cat_test_0_}, 0),
+      TrainingDatapoint({hotdog_train_0_, hotdog_train_1_, hotdog_test_0_,
+                         dog_test_0_, cat_train_0_},
+                        1)};
+  EXPECT_EQ(kEdgeTpuApiOk,
+            CreateImprintingEngineNative(
+                GenerateInputModelPath("mobilenet_v1_1.0_224_l2norm_quant"),
+                /*keep_classes=*/false));
+  const std::string single_device_path =
+      GenerateOutputModelPath("trained_on_single_device");
+  EXPECT_EQ(kEdgeTpuApiOk,
+            OnlineTrain(training_datapoints, single_device_path));
+  imprinting_engine_native_.reset();
+
+  // Saved models must be the same byte for byte, however many devices are
+  // actually available.
+  EXPECT_EQ(kEdgeTpuApiOk,
+            CreateImprintingEngineNative(
+                GenerateInputModelPath("mobilenet_v1_1.0_224_l2norm_quant"),
+                /*keep_classes=*/false));
+  EXPECT_EQ(kEdgeTpuApiOk, imprinting_engine_native_->SetNumTrainingDevices(4));
+  LOG(INFO) << "Training on "
+            << imprinting_engine_native_->get_num_training_devices()
+            << " Edge TPU(s).";
+  const std::string multiple_devices_path =
+      GenerateOutputModelPath("trained_on_multiple_devices");
+  EXPECT_EQ(kEdgeTpuApiOk,
+            OnlineTrain(training_datapoints, multiple_devices_path));
+  EXPECT_EQ(ReadFileToString(single_device_path),
+            ReadFileToString(multiple_devices_path));
+}
+
 INSTANTIATE_TEST_CASE_P(ImprintingEngineNativeTest, ImprintingEngineNativeTest,
                         ::testing::Values(false, true));
 
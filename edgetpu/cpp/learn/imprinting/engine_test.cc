@@ -22,9 +22,10 @@ class ImprintingEngineTest : public ImprintingTestBase {
   };
 
   void CreateImprintingEngine(const std::string& model_path,
-                              bool keep_classes) {
-    imprinting_engine_ =
-        absl::make_unique<ImprintingEngine>(model_path, keep_classes);
+                              bool keep_classes,
+                              bool classify_on_host = false) {
+    imprinting_engine_ = absl::make_unique<ImprintingEngine>(
+        model_path, keep_classes, classify_on_host);
   }
 
   void OnlineTrain(const std::vector<TrainingDatapoint>& training_datapoints) {
@@ -193,6 +194,63 @@ TEST_P(ImprintingEngineTest,
   TestTrainedModel(test_datapoints, output_file_path);
 }
 
+TEST_P(ImprintingEngineTest,
+       RunInferenceOnHostWithMobileNetV1L2NormAndRealImagesNotKeepClasses) {
+  CreateImprintingEngine(
+      GenerateInputModelPath("mobilenet_v1_1.0_224_l2norm_quant"),
+      /*keep_classes=*/false, /*classify_on_host=*/true);
+  const std::vector<TrainingDatapoint> training_datapoints = {
+      TrainingDatapoint({cat_train_0_}, 0),
+      TrainingDatapoint({hotdog_train_0_, hotdog_train_1_}, 1),
+      TrainingDatapoint({dog_train_0_}, 2)};
+  const std::vector<TestDatapoint> test_datapoints = {
+      TestDatapoint(cat_train_0_, 0, 0.99f),
+      TestDatapoint(hotdog_train_0_, 1, 0.99f),
+      TestDatapoint(dog_train_0_, 2, 0.99f),
+      TestDatapoint(cat_test_0_, 0, 0.99f),
+      TestDatapoint(hotdog_test_0_, 1, 0.99f),
+      TestDatapoint(dog_test_0_, 2, 0.99f)};
+  OnlineTrain(training_datapoints);
+  OnlineTest(test_datapoints);
+  const std::string output_file_path =
+      GenerateOutputModelPath("retrained_model_notkeep_on_host");
+  std::remove(output_file_path.c_str());
+  imprinting_engine_->SaveModel(output_file_path);
+  TestTrainedModel(test_datapoints, output_file_path);
+}
+
+TEST_P(ImprintingEngineTest,
+       RunInferenceOnHostWithMobileNetV1L2NormAndRealImagesKeepClasses) {
+  const std::vector<TrainingDatapoint> training_datapoints = {
+      TrainingDatapoint({cat_train_0_}, 1001),
+      TrainingDatapoint({hotdog_train_0_, hotdog_train_1_}, 1002),
+      TrainingDatapoint({dog_train_0_}, 1003)};
+  const std::vector<Image> test_images = {cat_test_0_, hotdog_test_0_,
+                                          dog_test_0_};
+  // Scores on host must match the ones of the classification model, up to
+  // the quantization of its softmax output.
+  std::vector<std::vector<float>> expected_results;
+  CreateImprintingEngine(
+      GenerateInputModelPath("mobilenet_v1_1.0_224_l2norm_quant"),
+      /*keep_classes=*/true);
+  OnlineTrain(training_datapoints);
+  for (const auto& image : test_images) {
+    expected_results.push_back(imprinting_engine_->RunInference(image));
+  }
+
+  CreateImprintingEngine(
+      GenerateInputModelPath("mobilenet_v1_1.0_224_l2norm_quant"),
+      /*keep_classes=*/true, /*classify_on_host=*/true);
+  OnlineTrain(training_datapoints);
+  for (int i = 0; i < test_images.size(); ++i) {
+    const auto& results = imprinting_engine_->RunInference(test_images[i]);
+    ASSERT_EQ(expected_results[i].size(), results.size());
+    for (int j = 0; j < results.size(); ++j) {
+      EXPECT_NEAR(expected_results[i][j], results[j], 0.01f);
+    }
+  }
+}
+
 INSTANTIATE_TEST_CASE_P(ImprintingEngineTest, ImprintingEngineTest,
                         ::testing::Values(false, true));
 }  // namespace
@@ -0,0 +1,153 @@
+#include "edgetpu/cpp/learn/imprinting/training_metadata.h"
+
+#include <cstring>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+
+namespace coral {
+namespace learn {
+namespace imprinting {
+
+namespace {
+constexpr char kMagic[8] = {'I', 'M', 'P', 'R', 'I', 'N', 'T', '\0'};
+constexpr int kHeaderSize = sizeof(kMagic) + 2 * sizeof(uint32_t);
+constexpr int kEntrySize = sizeof(int32_t) + sizeof(float);
+
+bool HasMagic(const uint8_t* data, int size) {
+  return size >= sizeof(kMagic) &&
+         std::memcmp(data, kMagic, sizeof(kMagic)) == 0;
+}
+
+// Buffers are only aligned on 4 bytes in model files, and not at all in
+// memory, so fields are read with memcpy, which compiles to a plain load.
+template <typename T>
+T Load(const uint8_t* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+template <typename T>
+void Store(T value, uint8_t* data) {
+  std::memcpy(data, &value, sizeof(T));
+}
+}  // namespace
+
+int32_t TrainingMetadataView::label(int i) const {
+  return Load<int32_t>(entries_ + i * kEntrySize);
+}
+
+float TrainingMetadataView::sqrt_sum(int i) const {
+  return Load<float>(entries_ + i * kEntrySize + sizeof(int32_t));
+}
+
+std::map<int, float> TrainingMetadataView::ToMap() const {
+  std::map<int, float> metadata;
+  // Entries are sorted, so each one goes to the end in constant time.
+  for (int i = 0; i < size_; ++i) {
+    metadata.emplace_hint(metadata.end(), label(i), sqrt_sum(i));
+  }
+  return metadata;
+}
+
+bool DecodeTrainingMetadata(const uint8_t* data, int size,
+                            TrainingMetadataView* view) {
+  if (size < kHeaderSize || !HasMagic(data, size)) return false;
+  const uint32_t version = Load<uint32_t>(data + sizeof(kMagic));
+  const uint32_t num_entries =
+      Load<uint32_t>(data + sizeof(kMagic) + sizeof(uint32_t));
+  if (version != kTrainingMetadataVersion ||
+      num_entries != (size - kHeaderSize) / kEntrySize ||
+      (size - kHeaderSize) % kEntrySize != 0) {
+    return false;
+  }
+  view->entries_ = data + kHeaderSize;
+  view->size_ = num_entries;
+  return true;
+}
+
+bool FindTrainingMetadata(const tflite::Model& model,
+                          TrainingMetadataView* view) {
+  const int index = FindTrainingMetadataBuffer(model);
+  if (index == -1) return false;
+  const auto* data = model.buffers()->Get(index)->data();
+  return DecodeTrainingMetadata(data->data(), data->size(), view);
+}
+
+int FindTrainingMetadataBuffer(const tflite::Model& model) {
+  if (!model.metadata_buffer() || !model.buffers()) return -1;
+  for (const int32_t index : *model.metadata_buffer()) {
+    if (index < 0 || index >= model.buffers()->size()) continue;
+    const auto* data = model.buffers()->Get(index)->data();
+    if (data && HasMagic(data->data(), data->size())) return index;
+  }
+  return -1;
+}
+
+int FindTrainingMetadataBuffer(const tflite::ModelT& model_t) {
+  for (const int32_t index : model_t.metadata_buffer) {
+    if (index < 0 || index >= model_t.buffers.size()) continue;
+    const auto& data = model_t.buffers[index]->data;
+    if (HasMagic(data.data(), data.size())) return index;
+  }
+  return -1;
+}
+
+std::vector<uint8_t> EncodeTrainingMetadata(
+    const std::map<int, float>& metadata) {
+  std::vector<uint8_t> data(kHeaderSize + metadata.size() * kEntrySize);
+  std::memcpy(data.data(), kMagic, sizeof(kMagic));
+  Store<uint32_t>(kTrainingMetadataVersion, data.data() + sizeof(kMagic));
+  Store<uint32_t>(metadata.size(),
+                  data.data() + sizeof(kMagic) + sizeof(uint32_t));
+  uint8_t* entry = data.data() + kHeaderSize;
+  for (const auto& item : metadata) {
+    Store<int32_t>(item.first, entry);
+    Store<float>(item.second, entry + sizeof(int32_t));
+    entry += kEntrySize;
+  }
+  return data;
+}
+
+void SetTrainingMetadata(const std::map<int, float>& metadata,
+                         tflite::ModelT* model_t) {
+  int index = FindTrainingMetadataBuffer(*model_t);
+  if (index == -1) {
+    index = model_t->buffers.size();
+    model_t->buffers.push_back(absl::make_unique<tflite::BufferT>());
+    model_t->metadata_buffer.push_back(index);
+  }
+  model_t->buffers[index]->data = EncodeTrainingMetadata(metadata);
+
+  std::map<int, float> text_metadata;
+  if (ParseTextTrainingMetadata(model_t->description, &text_metadata)) {
+    model_t->description.clear();
+  }
+}
+
+bool ParseTextTrainingMetadata(const std::string& description,
+                               std::map<int, float>* metadata) {
+  const std::vector<std::string> v = absl::StrSplit(
+      description, absl::ByAnyChar(" \n"), absl::SkipEmpty());
+  if (v.empty() || v.size() % 2 != 0) return false;
+
+  std::map<int, float> result;
+  for (int i = 0; i < v.size(); i += 2) {
+    int label;
+    float sqrt_sum;
+    if (!absl::SimpleAtoi(v[i], &label) ||
+        !absl::SimpleAtof(v[i + 1], &sqrt_sum)) {
+      return false;
+    }
+    result.insert({label, sqrt_sum});
+  }
+  *metadata = std::move(result);
+  return true;
+}
+
+}  // namespace imprinting
+}  // namespace learn
+}  // namespace coral
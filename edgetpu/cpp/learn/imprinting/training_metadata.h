@@ -0,0 +1,93 @@
+// Training metadata of imprinting models.
+//
+// Imprinting engine keeps, for each trained class, the norm of the sum of its
+// embeddings (see ImprintingEngineNative::metadata_), in order to train the
+// class again later. It is stored in a model buffer listed in
+// Model.metadata_buffer, with the following little-endian layout:
+//
+//   char magic[8];       // "IMPRINT\0"
+//   uint32_t version;    // kTrainingMetadataVersion
+//   uint32_t num_entries;
+//   struct { int32_t label; float sqrt_sum; } entries[num_entries];
+//
+// Entries are sorted by label. Floats are stored exactly, and the buffer can
+// be read in place from the model file.
+//
+// Models trained by older versions store the same map as "%d %f\n" text in
+// Model.description instead. Such models are still read, and are migrated to
+// the binary buffer when saved.
+
+#ifndef EDGETPU_CPP_LEARN_IMPRINTING_TRAINING_METADATA_H_
+#define EDGETPU_CPP_LEARN_IMPRINTING_TRAINING_METADATA_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace coral {
+namespace learn {
+namespace imprinting {
+
+constexpr uint32_t kTrainingMetadataVersion = 1;
+
+// Read-only view of binary training metadata. It doesn't own the data, which
+// must outlive it.
+class TrainingMetadataView {
+ public:
+  TrainingMetadataView() = default;
+
+  int size() const { return size_; }
+  int32_t label(int i) const;
+  float sqrt_sum(int i) const;
+
+  // Returns the entries as the map used by ImprintingEngineNative.
+  std::map<int, float> ToMap() const;
+
+ private:
+  friend bool DecodeTrainingMetadata(const uint8_t* data, int size,
+                                     TrainingMetadataView* view);
+
+  const uint8_t* entries_ = nullptr;
+  int size_ = 0;
+};
+
+// Decodes the `size` bytes of a training metadata buffer into `view`. Returns
+// false if they are not valid training metadata.
+bool DecodeTrainingMetadata(const uint8_t* data, int size,
+                            TrainingMetadataView* view);
+
+// Finds the training metadata buffer of `model`, pointing `view` into it.
+// Returns false if the model has no binary training metadata.
+bool FindTrainingMetadata(const tflite::Model& model,
+                          TrainingMetadataView* view);
+
+// Returns the index in the buffers of `model` of the training metadata buffer,
+// or -1 if there is none.
+int FindTrainingMetadataBuffer(const tflite::Model& model);
+int FindTrainingMetadataBuffer(const tflite::ModelT& model_t);
+
+// Encodes `metadata` with the layout described above.
+std::vector<uint8_t> EncodeTrainingMetadata(
+    const std::map<int, float>& metadata);
+
+// Stores `metadata` in the training metadata buffer of `model_t`, which is
+// added if needed. Text metadata left in the description by older versions is
+// removed.
+void SetTrainingMetadata(const std::map<int, float>& metadata,
+                         tflite::ModelT* model_t);
+
+// Parses training metadata stored as text by older versions, e.g.:
+// 0 5.4
+// 1 6.5
+// Returns false if `description` is empty or isn't in this format.
+bool ParseTextTrainingMetadata(const std::string& description,
+                               std::map<int, float>* metadata);
+
+}  // namespace imprinting
+}  // namespace learn
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_LEARN_IMPRINTING_TRAINING_METADATA_H_
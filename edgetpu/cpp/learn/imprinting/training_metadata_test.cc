@@ -0,0 +1,121 @@
+#include "edgetpu/cpp/learn/imprinting/training_metadata.h"
+
+#include <memory>
+
+#include "edgetpu/cpp/learn/utils.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace coral {
+namespace learn {
+namespace imprinting {
+namespace {
+
+std::map<int, float> Decode(const std::vector<uint8_t>& data) {
+  TrainingMetadataView view;
+  CHECK(DecodeTrainingMetadata(data.data(), data.size(), &view));
+  return view.ToMap();
+}
+
+TEST(TrainingMetadataTest, EncodeAndDecode) {
+  const std::map<int, float> metadata = {
+      {0, 1.23456789f}, {3, 1e-7f}, {1000, 12345.678f}};
+  const std::vector<uint8_t> data = EncodeTrainingMetadata(metadata);
+  EXPECT_EQ(16 + 3 * 8, data.size());
+
+  TrainingMetadataView view;
+  ASSERT_TRUE(DecodeTrainingMetadata(data.data(), data.size(), &view));
+  ASSERT_EQ(3, view.size());
+  EXPECT_EQ(1000, view.label(2));
+  EXPECT_EQ(12345.678f, view.sqrt_sum(2));
+  EXPECT_EQ(metadata, view.ToMap());
+
+  EXPECT_TRUE(Decode(EncodeTrainingMetadata({})).empty());
+}
+
+TEST(TrainingMetadataTest, DecodeInvalidData) {
+  const std::vector<uint8_t> data = EncodeTrainingMetadata({{0, 1.0f}});
+  TrainingMetadataView view;
+  EXPECT_FALSE(DecodeTrainingMetadata(data.data(), 8, &view));
+  EXPECT_FALSE(DecodeTrainingMetadata(data.data(), data.size() - 1, &view));
+
+  std::vector<uint8_t> invalid = data;
+  invalid[0] = 'X';
+  EXPECT_FALSE(DecodeTrainingMetadata(invalid.data(), invalid.size(), &view));
+  invalid = data;
+  invalid[8] = kTrainingMetadataVersion + 1;
+  EXPECT_FALSE(DecodeTrainingMetadata(invalid.data(), invalid.size(), &view));
+  invalid = data;
+  invalid[12] = 2;
+  EXPECT_FALSE(DecodeTrainingMetadata(invalid.data(), invalid.size(), &view));
+}
+
+TEST(TrainingMetadataTest, SetTrainingMetadata) {
+  tflite::ModelT model_t;
+  model_t.buffers.push_back(absl::make_unique<tflite::BufferT>());
+  model_t.description = "Imprinted model";
+  EXPECT_EQ(-1, FindTrainingMetadataBuffer(model_t));
+
+  SetTrainingMetadata({{0, 1.0f}}, &model_t);
+  ASSERT_EQ(1, FindTrainingMetadataBuffer(model_t));
+  EXPECT_EQ(std::vector<int32_t>({1}), model_t.metadata_buffer);
+  // Descriptions that aren't metadata are kept.
+  EXPECT_EQ("Imprinted model", model_t.description);
+
+  // Metadata is replaced in the same buffer.
+  const std::map<int, float> metadata = {{0, 2.0f}, {1, 3.0f}};
+  SetTrainingMetadata(metadata, &model_t);
+  EXPECT_EQ(2, model_t.buffers.size());
+  EXPECT_EQ(std::vector<int32_t>({1}), model_t.metadata_buffer);
+  EXPECT_EQ(metadata, Decode(model_t.buffers[1]->data));
+}
+
+TEST(TrainingMetadataTest, SetTrainingMetadataRemovesTextMetadata) {
+  tflite::ModelT model_t;
+  model_t.description = "0 1.000000\n1 2.000000\n";
+  SetTrainingMetadata({{0, 1.0f}, {1, 2.0f}}, &model_t);
+  EXPECT_TRUE(model_t.description.empty());
+}
+
+TEST(TrainingMetadataTest, FindTrainingMetadata) {
+  tflite::ModelT model_t;
+  model_t.buffers.push_back(absl::make_unique<tflite::BufferT>());
+  const std::map<int, float> metadata = {{0, 0.5f}, {7, 1.5f}};
+  SetTrainingMetadata(metadata, &model_t);
+
+  auto fbb = GetFlatBufferBuilder(&model_t);
+  const tflite::Model* model = tflite::GetModel(fbb->GetBufferPointer());
+  TrainingMetadataView view;
+  ASSERT_TRUE(FindTrainingMetadata(*model, &view));
+  EXPECT_EQ(metadata, view.ToMap());
+
+  model_t.metadata_buffer.clear();
+  fbb = GetFlatBufferBuilder(&model_t);
+  model = tflite::GetModel(fbb->GetBufferPointer());
+  EXPECT_FALSE(FindTrainingMetadata(*model, &view));
+}
+
+TEST(TrainingMetadataTest, ParseTextTrainingMetadata) {
+  std::map<int, float> metadata;
+  ASSERT_TRUE(
+      ParseTextTrainingMetadata("0 5.400000\n1 6.500000\n2 4.1\n", &metadata));
+  const std::map<int, float> expected = {{0, 5.4f}, {1, 6.5f}, {2, 4.1f}};
+  EXPECT_EQ(expected, metadata);
+
+  EXPECT_FALSE(ParseTextTrainingMetadata("", &metadata));
+  EXPECT_FALSE(ParseTextTrainingMetadata("0 5.4\n1\n", &metadata));
+  EXPECT_FALSE(ParseTextTrainingMetadata("Imprinted model", &metadata));
+  EXPECT_EQ(expected, metadata);
+}
+
+}  // namespace
+}  // namespace imprinting
+}  // namespace learn
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,473 @@
+#include "edgetpu/cpp/learn/knn/embedding_index.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "edgetpu/cpp/learn/utils.h"
+#include "glog/logging.h"
+
+namespace coral {
+namespace learn {
+namespace knn {
+
+namespace {
+
+// Quantized value of 1.0, the largest component of a normalized embedding.
+constexpr int kQuantizedOne = 127;
+
+// Number of bytes of embeddings scanned for all queries before moving on to
+// the next ones. Sized to stay in L2 cache.
+constexpr int kScanBlockBytes = 256 * 1024;
+
+// On-disk format. The header is followed by the sections at the given offsets,
+// each aligned to kSectionAlignment bytes. All values are in host byte order.
+//   labels:       int32[size]
+//   norms:        float[size], inverse L2 norms of the codes
+//   list_offsets: int32[num_lists + 1], only when num_lists > 0
+//   centroids:    int8[num_lists * dim], only when num_lists > 0
+//   codes:        int8[size * dim]
+constexpr char kFileMagic[8] = {'E', 'D', 'G', 'E', 'K', 'N', 'N', '\0'};
+constexpr uint32_t kFileVersion = 1;
+constexpr int kSectionAlignment = 64;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  int32_t dim;
+  int32_t size;
+  int32_t num_lists;
+  uint64_t labels_offset;
+  uint64_t norms_offset;
+  uint64_t list_offsets_offset;
+  uint64_t centroids_offset;
+  uint64_t codes_offset;
+};
+
+uint64_t AlignOffset(uint64_t offset) {
+  return (offset + kSectionAlignment - 1) / kSectionAlignment *
+         kSectionAlignment;
+}
+
+// A candidate neighbor: score and row in the index.
+struct Candidate {
+  float score;
+  int row;
+};
+
+// Higher scores are better, ties go to the earlier row, so that results do
+// not depend on the order rows are scanned in.
+bool IsBetter(const Candidate& a, const Candidate& b) {
+  return a.score > b.score || (a.score == b.score && a.row < b.row);
+}
+
+// Keeps the best `k` candidates in `heap`, whose front is the worst one.
+void PushCandidate(const Candidate& candidate, int k,
+                   std::vector<Candidate>* heap) {
+  if (heap->size() < k) {
+    heap->push_back(candidate);
+    std::push_heap(heap->begin(), heap->end(), IsBetter);
+  } else if (IsBetter(candidate, heap->front())) {
+    std::pop_heap(heap->begin(), heap->end(), IsBetter);
+    heap->back() = candidate;
+    std::push_heap(heap->begin(), heap->end(), IsBetter);
+  }
+}
+
+// Returns the inverse L2 norm of `code`, or 0 for a null vector.
+float InverseNorm(const int8_t* code, int dim) {
+  const int32_t squared_norm = DotProduct(code, code, dim);
+  return squared_norm > 0 ? 1.0f / std::sqrt(squared_norm) : 0.0f;
+}
+
+// Returns the index of the row of `codes` with the highest cosine similarity
+// with `code`. Ties go to the first row.
+int FindClosest(const int8_t* code, const int8_t* codes,
+                const float* inverse_norms, int num_rows, int dim) {
+  int best = 0;
+  float best_score = DotProduct(code, codes, dim) * inverse_norms[0];
+  for (int i = 1; i < num_rows; ++i) {
+    const float score =
+        DotProduct(code, codes + i * dim, dim) * inverse_norms[i];
+    if (score > best_score) {
+      best_score = score;
+      best = i;
+    }
+  }
+  return best;
+}
+
+}  // namespace
+
+struct EmbeddingIndex::MappedFile {
+  MappedFile(void* data, size_t size) : data(data), size(size) {}
+  ~MappedFile() { munmap(data, size); }
+
+  void* data;
+  size_t size;
+};
+
+EmbeddingIndex::EmbeddingIndex(int dim) : dim_(dim) {
+  CHECK_GT(dim, 0);
+  error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
+}
+
+EmbeddingIndex::~EmbeddingIndex() = default;
+
+void EmbeddingIndex::QuantizeEmbedding(const float* embedding,
+                                       int8_t* code) const {
+  float squared_sum = 0.0f;
+  for (int i = 0; i < dim_; ++i) {
+    squared_sum += embedding[i] * embedding[i];
+  }
+  const float norm = std::sqrt(squared_sum);
+  const float scale = norm > 1e-5f ? kQuantizedOne / norm : 0.0f;
+  for (int i = 0; i < dim_; ++i) {
+    const float value = std::round(embedding[i] * scale);
+    code[i] = static_cast<int8_t>(std::max<float>(
+        -kQuantizedOne, std::min<float>(kQuantizedOne, value)));
+  }
+}
+
+void EmbeddingIndex::CopyMappedEmbeddings() {
+  if (!mapped_file_) return;
+  owned_codes_.assign(codes_, codes_ + size_ * dim_);
+  owned_labels_.assign(labels_, labels_ + size_);
+  owned_inverse_norms_.assign(inverse_norms_, inverse_norms_ + size_);
+  codes_ = owned_codes_.data();
+  labels_ = owned_labels_.data();
+  inverse_norms_ = owned_inverse_norms_.data();
+  mapped_file_.reset();
+}
+
+EdgeTpuApiStatus EmbeddingIndex::Add(const float* embedding, int label) {
+  EDGETPU_API_REPORT_ERROR(error_reporter_, !embedding,
+                           "Embedding is nullptr!");
+  CopyMappedEmbeddings();
+  owned_codes_.resize((size_ + 1) * dim_);
+  int8_t* code = owned_codes_.data() + size_ * dim_;
+  QuantizeEmbedding(embedding, code);
+  owned_labels_.push_back(label);
+  owned_inverse_norms_.push_back(InverseNorm(code, dim_));
+  ++size_;
+  codes_ = owned_codes_.data();
+  labels_ = owned_labels_.data();
+  inverse_norms_ = owned_inverse_norms_.data();
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus EmbeddingIndex::Add(const uint8_t* embedding, float scale,
+                                     int32_t zero_point, int label) {
+  EDGETPU_API_REPORT_ERROR(error_reporter_, !embedding,
+                           "Embedding is nullptr!");
+  std::vector<float> dequantized(dim_);
+  for (int i = 0; i < dim_; ++i) {
+    dequantized[i] = scale * (embedding[i] - zero_point);
+  }
+  return Add(dequantized.data(), label);
+}
+
+EdgeTpuApiStatus EmbeddingIndex::BuildInvertedLists(int num_lists,
+                                                    int num_iterations) {
+  EDGETPU_API_REPORT_ERROR(error_reporter_, num_lists < 1,
+                           "Number of lists must be positive!");
+  EDGETPU_API_REPORT_ERROR(error_reporter_, num_lists > size_,
+                           "Number of lists is larger than the index size!");
+  EDGETPU_API_REPORT_ERROR(error_reporter_, num_iterations < 0,
+                           "Number of iterations must not be negative!");
+  CopyMappedEmbeddings();
+
+  // Initial centroids are distinct embeddings picked with a fixed seed.
+  std::vector<int> rows(size_);
+  std::iota(rows.begin(), rows.end(), 0);
+  std::shuffle(rows.begin(), rows.end(), std::mt19937(0));
+  std::vector<int8_t> centroids(num_lists * dim_);
+  std::vector<float> centroid_inverse_norms(num_lists);
+  for (int i = 0; i < num_lists; ++i) {
+    std::copy(codes_ + rows[i] * dim_, codes_ + (rows[i] + 1) * dim_,
+              centroids.begin() + i * dim_);
+    centroid_inverse_norms[i] = inverse_norms_[rows[i]];
+  }
+
+  // Spherical k-means: centroids are the normalized means of their embeddings,
+  // and embeddings go to the centroid with the highest cosine similarity.
+  std::vector<int> assignments(size_);
+  std::vector<float> sums(num_lists * dim_);
+  std::vector<int> counts(num_lists);
+  for (int iteration = 0; iteration <= num_iterations; ++iteration) {
+    for (int row = 0; row < size_; ++row) {
+      assignments[row] =
+          FindClosest(codes_ + row * dim_, centroids.data(),
+                      centroid_inverse_norms.data(), num_lists, dim_);
+    }
+    if (iteration == num_iterations) break;
+    std::fill(sums.begin(), sums.end(), 0.0f);
+    std::fill(counts.begin(), counts.end(), 0);
+    for (int row = 0; row < size_; ++row) {
+      float* sum = sums.data() + assignments[row] * dim_;
+      const int8_t* code = codes_ + row * dim_;
+      for (int i = 0; i < dim_; ++i) {
+        sum[i] += code[i];
+      }
+      ++counts[assignments[row]];
+    }
+    for (int list = 0; list < num_lists; ++list) {
+      // Empty lists keep their centroid.
+      if (counts[list] == 0) continue;
+      int8_t* centroid = centroids.data() + list * dim_;
+      QuantizeEmbedding(sums.data() + list * dim_, centroid);
+      centroid_inverse_norms[list] = InverseNorm(centroid, dim_);
+    }
+  }
+
+  // Sorts rows by list, keeping their order within each list.
+  std::vector<int32_t> list_offsets(num_lists + 1, 0);
+  for (int row = 0; row < size_; ++row) {
+    ++list_offsets[assignments[row] + 1];
+  }
+  std::partial_sum(list_offsets.begin(), list_offsets.end(),
+                   list_offsets.begin());
+  std::vector<int32_t> positions(list_offsets.begin(), list_offsets.end() - 1);
+  std::vector<int8_t> codes(size_ * dim_);
+  std::vector<int32_t> labels(size_);
+  std::vector<float> inverse_norms(size_);
+  for (int row = 0; row < size_; ++row) {
+    const int position = positions[assignments[row]]++;
+    std::copy(codes_ + row * dim_, codes_ + (row + 1) * dim_,
+              codes.begin() + position * dim_);
+    labels[position] = labels_[row];
+    inverse_norms[position] = inverse_norms_[row];
+  }
+
+  owned_codes_ = std::move(codes);
+  owned_labels_ = std::move(labels);
+  owned_inverse_norms_ = std::move(inverse_norms);
+  codes_ = owned_codes_.data();
+  labels_ = owned_labels_.data();
+  inverse_norms_ = owned_inverse_norms_.data();
+  num_lists_ = num_lists;
+  centroids_ = std::move(centroids);
+  centroid_inverse_norms_ = std::move(centroid_inverse_norms);
+  list_offsets_ = std::move(list_offsets);
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus EmbeddingIndex::Search(
+    const float* queries, int num_queries, int k, int num_probes,
+    std::vector<std::vector<Neighbor>>* results) {
+  EDGETPU_API_REPORT_ERROR(error_reporter_, !results,
+                           "Null output pointer passed to Search!");
+  EDGETPU_API_REPORT_ERROR(error_reporter_, !queries && num_queries > 0,
+                           "Queries are nullptr!");
+  EDGETPU_API_REPORT_ERROR(error_reporter_, k < 1, "k must be positive!");
+  EDGETPU_API_REPORT_ERROR(error_reporter_, num_probes < 0,
+                           "Number of probes must not be negative!");
+
+  std::vector<int8_t> query_codes(num_queries * dim_);
+  std::vector<float> query_inverse_norms(num_queries);
+  for (int q = 0; q < num_queries; ++q) {
+    int8_t* query_code = query_codes.data() + q * dim_;
+    QuantizeEmbedding(queries + q * dim_, query_code);
+    query_inverse_norms[q] = InverseNorm(query_code, dim_);
+  }
+
+  // Row ranges [first, second) to scan for each query, in increasing order.
+  std::vector<std::vector<std::pair<int, int>>> ranges(num_queries);
+  const bool use_lists = num_lists() > 0 && num_probes > 0 &&
+                         num_probes < num_lists_;
+  for (int q = 0; q < num_queries; ++q) {
+    if (!use_lists) {
+      ranges[q].emplace_back(0, size_);
+      continue;
+    }
+    std::vector<Candidate> closest_lists;
+    for (int list = 0; list < num_lists_; ++list) {
+      PushCandidate({DotProduct(query_codes.data() + q * dim_,
+                                centroids_.data() + list * dim_, dim_) *
+                         centroid_inverse_norms_[list],
+                     list},
+                    num_probes, &closest_lists);
+    }
+    for (const auto& list : closest_lists) {
+      ranges[q].emplace_back(list_offsets_[list.row],
+                             list_offsets_[list.row + 1]);
+    }
+    // Rows added after the lists were built.
+    ranges[q].emplace_back(list_offsets_.back(), size_);
+    std::sort(ranges[q].begin(), ranges[q].end());
+  }
+
+  // Scans the index block by block, so that each block is read from memory
+  // once for the whole batch of queries.
+  std::vector<std::vector<Candidate>> heaps(num_queries);
+  const int block_rows = std::max(1, kScanBlockBytes / dim_);
+  for (int block_begin = 0; block_begin < size_; block_begin += block_rows) {
+    const int block_end = std::min(size_, block_begin + block_rows);
+    for (int q = 0; q < num_queries; ++q) {
+      const int8_t* query_code = query_codes.data() + q * dim_;
+      const float query_inverse_norm = query_inverse_norms[q];
+      for (const auto& range : ranges[q]) {
+        const int begin = std::max(range.first, block_begin);
+        const int end = std::min(range.second, block_end);
+        for (int row = begin; row < end; ++row) {
+          const float score =
+              DotProduct(query_code, codes_ + row * dim_, dim_) *
+              query_inverse_norm * inverse_norms_[row];
+          PushCandidate({score, row}, k, &heaps[q]);
+        }
+      }
+    }
+  }
+
+  results->assign(num_queries, {});
+  for (int q = 0; q < num_queries; ++q) {
+    // Puts the best candidate first.
+    std::sort_heap(heaps[q].begin(), heaps[q].end(), IsBetter);
+    for (const auto& candidate : heaps[q]) {
+      (*results)[q].push_back({labels_[candidate.row], candidate.score});
+    }
+  }
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus EmbeddingIndex::Save(const std::string& path) {
+  FileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kFileMagic, sizeof(kFileMagic));
+  header.version = kFileVersion;
+  header.dim = dim_;
+  header.size = size_;
+  header.num_lists = num_lists();
+  header.labels_offset = AlignOffset(sizeof(header));
+  header.norms_offset =
+      AlignOffset(header.labels_offset + size_ * sizeof(int32_t));
+  header.list_offsets_offset =
+      AlignOffset(header.norms_offset + size_ * sizeof(float));
+  header.centroids_offset = AlignOffset(header.list_offsets_offset +
+                                        list_offsets_.size() * sizeof(int32_t));
+  header.codes_offset = AlignOffset(header.centroids_offset +
+                                    header.num_lists * dim_ * sizeof(int8_t));
+
+  // Writes to a temporary file first, as `path` may be the file this index is
+  // mapped from.
+  const std::string tmp_path = absl::StrCat(path, ".tmp");
+  std::unique_ptr<FILE, decltype(&std::fclose)> file(
+      std::fopen(tmp_path.c_str(), "wb"), std::fclose);
+  EDGETPU_API_REPORT_ERROR(error_reporter_, !file,
+                           absl::StrCat("Failed to open file: ", tmp_path));
+  uint64_t offset = 0;
+  auto write_section = [&](uint64_t section_offset, const void* data,
+                           size_t size) {
+    static const char kPadding[kSectionAlignment] = {};
+    if (std::fwrite(kPadding, 1, section_offset - offset, file.get()) !=
+        section_offset - offset) {
+      return false;
+    }
+    offset = section_offset + size;
+    return size == 0 || std::fwrite(data, 1, size, file.get()) == size;
+  };
+  const bool written =
+      write_section(0, &header, sizeof(header)) &&
+      write_section(header.labels_offset, labels_, size_ * sizeof(int32_t)) &&
+      write_section(header.norms_offset, inverse_norms_,
+                    size_ * sizeof(float)) &&
+      write_section(header.list_offsets_offset, list_offsets_.data(),
+                    list_offsets_.size() * sizeof(int32_t)) &&
+      write_section(header.centroids_offset, centroids_.data(),
+                    header.num_lists * dim_ * sizeof(int8_t)) &&
+      write_section(header.codes_offset, codes_, size_ * dim_);
+  const bool closed = std::fclose(file.release()) == 0;
+  EDGETPU_API_REPORT_ERROR(error_reporter_, !written || !closed,
+                           absl::StrCat("Failed to write file: ", tmp_path));
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_, std::rename(tmp_path.c_str(), path.c_str()) != 0,
+      absl::StrCat("Failed to rename ", tmp_path, " to ", path));
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus EmbeddingIndex::Load(const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  EDGETPU_API_REPORT_ERROR(error_reporter_, fd < 0,
+                           absl::StrCat("Failed to open file: ", path));
+  struct stat file_stat;
+  const bool has_size = fstat(fd, &file_stat) == 0;
+  const size_t file_size = has_size ? file_stat.st_size : 0;
+  void* data = MAP_FAILED;
+  if (file_size >= sizeof(FileHeader)) {
+    data = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  EDGETPU_API_REPORT_ERROR(error_reporter_, data == MAP_FAILED,
+                           absl::StrCat("Failed to map file: ", path));
+  auto mapped_file = absl::make_unique<MappedFile>(data, file_size);
+
+  const auto* bytes = static_cast<const uint8_t*>(data);
+  FileHeader header;
+  std::memcpy(&header, bytes, sizeof(header));
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_,
+      std::memcmp(header.magic, kFileMagic, sizeof(kFileMagic)) != 0 ||
+          header.version != kFileVersion,
+      absl::StrCat("Not an embedding index file: ", path));
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_, header.dim != dim_,
+      absl::StrCat("Embedding dimension of ", path, " is ", header.dim,
+                   " instead of ", dim_));
+  const uint64_t num_offsets = header.num_lists > 0 ? header.num_lists + 1 : 0;
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_,
+      header.size < 0 || header.num_lists < 0 ||
+          header.labels_offset + header.size * sizeof(int32_t) > file_size ||
+          header.norms_offset + header.size * sizeof(float) > file_size ||
+          header.list_offsets_offset + num_offsets * sizeof(int32_t) >
+              file_size ||
+          header.centroids_offset + header.num_lists * dim_ > file_size ||
+          header.codes_offset + static_cast<uint64_t>(header.size) * dim_ >
+              file_size,
+      absl::StrCat("Truncated embedding index file: ", path));
+  const auto* list_offsets =
+      reinterpret_cast<const int32_t*>(bytes + header.list_offsets_offset);
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_,
+      num_offsets > 0 &&
+          (list_offsets[0] != 0 ||
+           !std::is_sorted(list_offsets, list_offsets + num_offsets) ||
+           list_offsets[num_offsets - 1] > header.size),
+      absl::StrCat("Invalid inverted lists in file: ", path));
+
+  const auto* centroids =
+      reinterpret_cast<const int8_t*>(bytes + header.centroids_offset);
+  list_offsets_.assign(list_offsets, list_offsets + num_offsets);
+  centroids_.assign(centroids, centroids + header.num_lists * dim_);
+  centroid_inverse_norms_.resize(header.num_lists);
+  for (int i = 0; i < header.num_lists; ++i) {
+    centroid_inverse_norms_[i] =
+        InverseNorm(centroids_.data() + i * dim_, dim_);
+  }
+  num_lists_ = header.num_lists;
+  owned_codes_.clear();
+  owned_labels_.clear();
+  owned_inverse_norms_.clear();
+  size_ = header.size;
+  labels_ = reinterpret_cast<const int32_t*>(bytes + header.labels_offset);
+  inverse_norms_ =
+      reinterpret_cast<const float*>(bytes + header.norms_offset);
+  codes_ = reinterpret_cast<const int8_t*>(bytes + header.codes_offset);
+  mapped_file_ = std::move(mapped_file);
+  return kEdgeTpuApiOk;
+}
+
+}  // namespace knn
+}  // namespace learn
+}  // namespace coral
@@ -0,0 +1,143 @@
+#ifndef EDGETPU_CPP_LEARN_KNN_EMBEDDING_INDEX_H_
+#define EDGETPU_CPP_LEARN_KNN_EMBEDDING_INDEX_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "edgetpu/cpp/error_reporter.h"
+
+namespace coral {
+namespace learn {
+namespace knn {
+
+// A nearest neighbor of a query. Score is the cosine similarity between the
+// query and the enrolled embedding, in [-1, 1].
+struct Neighbor {
+  int label;
+  float score;
+};
+
+// Index of L2-normalized embedding vectors for k-nearest-neighbor search, e.g.
+// the outputs of the embedding extractor of an imprinting model (the L2Norm
+// layer). Unlike imprinting, every enrolled embedding is kept, so there is no
+// limit on the number of images per label.
+//
+// Embeddings are stored as int8, with a fixed scale of 1/127: as they are
+// L2-normalized, every component is in [-1, 1]. Search scores queries against
+// them with SIMD integer dot products, scaled by the norms of the codes so that
+// scores are the cosine similarities of the quantized vectors.
+//
+// Search is exhaustive by default: the stored embeddings are scanned in blocks
+// that stay in cache while all queries of a batch are scored against them.
+// With BuildInvertedLists(), embeddings are grouped by their closest k-means
+// centroid (IVF), and search only scans the lists of the centroids closest to
+// the query. Embeddings added after BuildInvertedLists() are kept apart and
+// always scanned, until the lists are built again.
+//
+// The index can be saved to a file, and loaded back with mmap(): embeddings
+// are then read in place, without copying or parsing them.
+//
+// Example:
+//   EmbeddingIndex index(1024);
+//   for (...) {
+//     // `embedding` comes from an embedding extractor, e.g. a BasicEngine
+//     // running an imprinting model without its classification layers.
+//     index.Add(embedding.data(), label);
+//   }
+//   std::vector<std::vector<Neighbor>> neighbors;
+//   index.Search(query.data(), /*num_queries=*/1, /*k=*/5,
+//                /*num_probes=*/0, &neighbors);
+//
+// This class is not thread-safe.
+class EmbeddingIndex {
+ public:
+  // Creates an empty index for embeddings with `dim` components.
+  explicit EmbeddingIndex(int dim);
+  ~EmbeddingIndex();
+
+  // Copying or assignment is disallowed
+  EmbeddingIndex(const EmbeddingIndex&) = delete;
+  EmbeddingIndex& operator=(const EmbeddingIndex&) = delete;
+
+  // Adds a float embedding. It is L2-normalized before being quantized, so it
+  // does not need to be normalized already.
+  EdgeTpuApiStatus Add(const float* embedding, int label);
+
+  // Adds a quantized embedding, as found in the output tensor of an embedding
+  // extractor.
+  EdgeTpuApiStatus Add(const uint8_t* embedding, float scale,
+                       int32_t zero_point, int label);
+
+  // Groups embeddings into `num_lists` inverted lists with spherical k-means,
+  // running `num_iterations` iterations. Results only depend on the stored
+  // embeddings.
+  EdgeTpuApiStatus BuildInvertedLists(int num_lists, int num_iterations);
+
+  // Finds the `k` nearest neighbors of each of `num_queries` queries, stored
+  // one after the other in `queries`. Neighbors of each query go to one row of
+  // `results`, in decreasing score order.
+  //
+  // With inverted lists, only the `num_probes` lists with the closest
+  // centroids are scanned. 0, or at least the number of lists, scans the whole
+  // index.
+  EdgeTpuApiStatus Search(const float* queries, int num_queries, int k,
+                          int num_probes,
+                          std::vector<std::vector<Neighbor>>* results);
+
+  // Saves the index to `path`.
+  EdgeTpuApiStatus Save(const std::string& path);
+
+  // Replaces the content of the index with the one saved at `path`. The file
+  // is mapped in memory, and must have been saved with the same `dim`.
+  EdgeTpuApiStatus Load(const std::string& path);
+
+  int dim() const { return dim_; }
+  // Number of embeddings in the index.
+  int size() const { return size_; }
+  // Number of inverted lists, 0 if they are not built.
+  int num_lists() const { return list_offsets_.empty() ? 0 : num_lists_; }
+
+  // Caller can use this function to retrieve error message when get
+  // kEdgeTpuApiError.
+  std::string get_error_message() { return error_reporter_->message(); }
+
+ private:
+  struct MappedFile;
+
+  // L2-normalizes `embedding` and quantizes it to `code`.
+  void QuantizeEmbedding(const float* embedding, int8_t* code) const;
+
+  // Copies embeddings of a mapped file to owned storage, so they can change.
+  void CopyMappedEmbeddings();
+
+  const int dim_;
+  int size_ = 0;
+
+  // Embedding codes (size_ x dim_), labels and inverse L2 norms of the codes.
+  // They point either to the owned storage below, or into a mapped file.
+  const int8_t* codes_ = nullptr;
+  const int32_t* labels_ = nullptr;
+  const float* inverse_norms_ = nullptr;
+  std::vector<int8_t> owned_codes_;
+  std::vector<int32_t> owned_labels_;
+  std::vector<float> owned_inverse_norms_;
+  std::unique_ptr<MappedFile> mapped_file_;
+
+  // Inverted lists. Rows of list i are [list_offsets_[i], list_offsets_[i+1]).
+  // Rows from list_offsets_.back() on were added after the lists were built.
+  int num_lists_ = 0;
+  std::vector<int8_t> centroids_;
+  std::vector<float> centroid_inverse_norms_;
+  std::vector<int32_t> list_offsets_;
+
+  // Data structure to store error messages.
+  std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
+};
+
+}  // namespace knn
+}  // namespace learn
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_LEARN_KNN_EMBEDDING_INDEX_H_
@@ -0,0 +1,141 @@
+// Benchmarks EmbeddingIndex search latency and recall on synthetic embeddings
+// with the size of MobileNet embeddings. Recall@k is the fraction of the exact
+// (float) k nearest neighbors that are returned.
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "edgetpu/cpp/learn/knn/embedding_index.h"
+#include "edgetpu/cpp/learn/knn/test_utils.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+namespace coral {
+namespace learn {
+namespace knn {
+namespace {
+
+constexpr int kDim = 1024;
+constexpr int kNumQueries = 64;
+constexpr int kNumNeighbors = 10;
+// Number of identities, each with about the same number of embeddings.
+constexpr int kNumClusters = 1000;
+constexpr float kSpread = 0.03f;
+constexpr int kNumLists = 256;
+constexpr int kNumIterations = 4;
+
+struct Dataset {
+  Embeddings database;
+  Embeddings queries;
+  std::vector<std::vector<int>> exact_neighbors;
+};
+
+const Dataset& GetDataset(int size) {
+  static auto* const cache = new std::map<int, Dataset>();
+  auto it = cache->find(size);
+  if (it == cache->end()) {
+    const Embeddings embeddings = GenerateClusteredEmbeddings(
+        size + kNumQueries, kDim, kNumClusters, kSpread, /*seed=*/size);
+    Dataset dataset;
+    dataset.database = Slice(embeddings, 0, size);
+    dataset.queries = Slice(embeddings, size, size + kNumQueries);
+    dataset.exact_neighbors =
+        ExactNeighbors(dataset.database, dataset.queries, kNumNeighbors);
+    it = cache->emplace(size, std::move(dataset)).first;
+  }
+  return it->second;
+}
+
+// Returns an index of `size` embeddings, with inverted lists if asked.
+EmbeddingIndex* GetIndex(int size, bool inverted_lists) {
+  static auto* const cache =
+      new std::map<std::pair<int, bool>, std::unique_ptr<EmbeddingIndex>>();
+  const auto key = std::make_pair(size, inverted_lists);
+  auto it = cache->find(key);
+  if (it == cache->end()) {
+    auto index = absl::make_unique<EmbeddingIndex>(kDim);
+    AddToIndex(GetDataset(size).database, index.get());
+    if (inverted_lists) {
+      CHECK_EQ(index->BuildInvertedLists(kNumLists, kNumIterations),
+               kEdgeTpuApiOk)
+          << index->get_error_message();
+    }
+    it = cache->emplace(key, std::move(index)).first;
+  }
+  return it->second.get();
+}
+
+// Runs batches of `batch_size` queries, and reports the recall over all
+// queries of the dataset.
+void RunSearch(EmbeddingIndex* index, const Dataset& dataset, int batch_size,
+               int num_probes, benchmark::State& state) {
+  std::vector<std::vector<Neighbor>> results;
+  int batch_begin = 0;
+  while (state.KeepRunning()) {
+    CHECK_EQ(index->Search(dataset.queries.data(batch_begin), batch_size,
+                           kNumNeighbors, num_probes, &results),
+             kEdgeTpuApiOk)
+        << index->get_error_message();
+    batch_begin = (batch_begin + batch_size) % kNumQueries;
+  }
+  state.SetItemsProcessed(state.iterations() * batch_size);
+
+  CHECK_EQ(index->Search(dataset.queries.values.data(), kNumQueries,
+                         kNumNeighbors, num_probes, &results),
+           kEdgeTpuApiOk)
+      << index->get_error_message();
+  state.counters["recall"] =
+      Recall(dataset.exact_neighbors, results, kNumNeighbors);
+}
+
+// Arguments are the index size and the number of queries per batch.
+static void BM_Search(benchmark::State& state) {
+  const int size = state.range(0);
+  RunSearch(GetIndex(size, /*inverted_lists=*/false), GetDataset(size),
+            state.range(1), /*num_probes=*/0, state);
+}
+BENCHMARK(BM_Search)
+    ->Args({10000, 1})
+    ->Args({10000, 16})
+    ->Args({50000, 1})
+    ->Args({50000, 16});
+
+// Arguments are the index size and the number of probed lists.
+static void BM_SearchInvertedLists(benchmark::State& state) {
+  const int size = state.range(0);
+  RunSearch(GetIndex(size, /*inverted_lists=*/true), GetDataset(size),
+            /*batch_size=*/1, state.range(1), state);
+}
+BENCHMARK(BM_SearchInvertedLists)
+    ->Args({50000, 4})
+    ->Args({50000, 16})
+    ->Args({50000, 64});
+
+// Measures how long it takes to get a saved index ready to search.
+static void BM_Load(benchmark::State& state) {
+  const int size = state.range(0);
+  const std::string path = absl::StrCat("/tmp/embedding_index_", size, ".knn");
+  CHECK_EQ(GetIndex(size, /*inverted_lists=*/true)->Save(path), kEdgeTpuApiOk);
+  EmbeddingIndex index(kDim);
+  while (state.KeepRunning()) {
+    CHECK_EQ(index.Load(path), kEdgeTpuApiOk) << index.get_error_message();
+  }
+}
+BENCHMARK(BM_Load)->Arg(50000);
+
+}  // namespace
+}  // namespace knn
+}  // namespace learn
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
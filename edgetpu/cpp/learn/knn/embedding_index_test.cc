@@ -0,0 +1,237 @@
+#include "edgetpu/cpp/learn/knn/embedding_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "edgetpu/cpp/learn/knn/test_utils.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace coral {
+namespace learn {
+namespace knn {
+namespace {
+
+constexpr int kDim = 128;
+
+std::vector<std::vector<Neighbor>> Search(EmbeddingIndex* index,
+                                          const Embeddings& queries, int k,
+                                          int num_probes) {
+  std::vector<std::vector<Neighbor>> results;
+  CHECK_EQ(index->Search(queries.values.data(), queries.size(), k, num_probes,
+                         &results),
+           kEdgeTpuApiOk)
+      << index->get_error_message();
+  return results;
+}
+
+void ExpectSameResults(const std::vector<std::vector<Neighbor>>& expected,
+                       const std::vector<std::vector<Neighbor>>& actual) {
+  ASSERT_EQ(expected.size(), actual.size());
+  for (int q = 0; q < expected.size(); ++q) {
+    ASSERT_EQ(expected[q].size(), actual[q].size());
+    for (int i = 0; i < expected[q].size(); ++i) {
+      EXPECT_EQ(expected[q][i].label, actual[q][i].label);
+      EXPECT_EQ(expected[q][i].score, actual[q][i].score);
+    }
+  }
+}
+
+TEST(EmbeddingIndexTest, EmptyIndex) {
+  EmbeddingIndex index(kDim);
+  EXPECT_EQ(0, index.size());
+  EXPECT_EQ(0, index.num_lists());
+  const Embeddings queries = GenerateClusteredEmbeddings(
+      /*size=*/2, kDim, /*num_clusters=*/1, /*spread=*/0.1f, /*seed=*/0);
+  const auto results = Search(&index, queries, /*k=*/3, /*num_probes=*/0);
+  ASSERT_EQ(2, results.size());
+  EXPECT_TRUE(results[0].empty());
+  EXPECT_TRUE(results[1].empty());
+}
+
+TEST(EmbeddingIndexTest, FindsEnrolledEmbeddings) {
+  const Embeddings embeddings = GenerateClusteredEmbeddings(
+      /*size=*/500, kDim, /*num_clusters=*/50, /*spread=*/0.05f, /*seed=*/1);
+  EmbeddingIndex index(kDim);
+  AddToIndex(embeddings, &index);
+  EXPECT_EQ(500, index.size());
+
+  const auto results = Search(&index, embeddings, /*k=*/1, /*num_probes=*/0);
+  for (int i = 0; i < embeddings.size(); ++i) {
+    ASSERT_EQ(1, results[i].size());
+    EXPECT_EQ(i, results[i][0].label);
+    EXPECT_NEAR(1.0f, results[i][0].score, 1e-5f);
+  }
+}
+
+TEST(EmbeddingIndexTest, MatchesFloatSearch) {
+  const Embeddings embeddings = GenerateClusteredEmbeddings(
+      /*size=*/2100, kDim, /*num_clusters=*/20, /*spread=*/0.1f, /*seed=*/2);
+  const Embeddings database = Slice(embeddings, 0, 2000);
+  const Embeddings queries = Slice(embeddings, 2000, 2100);
+  EmbeddingIndex index(kDim);
+  AddToIndex(database, &index);
+
+  constexpr int kNumNeighbors = 10;
+  const auto results = Search(&index, queries, kNumNeighbors, 0);
+  for (int q = 0; q < queries.size(); ++q) {
+    ASSERT_EQ(kNumNeighbors, results[q].size());
+    for (int i = 0; i < kNumNeighbors; ++i) {
+      // Sorted by score, and scores match float cosine similarities up to the
+      // int8 quantization.
+      if (i > 0) {
+        EXPECT_GE(results[q][i - 1].score, results[q][i].score);
+      }
+      const float* embedding = database.data(results[q][i].label);
+      float expected_score = 0.0f;
+      for (int j = 0; j < kDim; ++j) {
+        expected_score += embedding[j] * queries.data(q)[j];
+      }
+      EXPECT_NEAR(expected_score, results[q][i].score, 0.01f);
+    }
+  }
+  EXPECT_GT(Recall(ExactNeighbors(database, queries, kNumNeighbors), results,
+                   kNumNeighbors),
+            0.9f);
+}
+
+TEST(EmbeddingIndexTest, AddQuantizedEmbedding) {
+  const Embeddings embeddings = GenerateClusteredEmbeddings(
+      /*size=*/1, kDim, /*num_clusters=*/1, /*spread=*/0.1f, /*seed=*/3);
+  // Quantizes like an L2Norm output tensor: scale 1/128, zero point 128.
+  std::vector<uint8_t> quantized(kDim);
+  for (int i = 0; i < kDim; ++i) {
+    quantized[i] = static_cast<uint8_t>(std::max(
+        0.0f, std::min(255.0f, std::round(embeddings.values[i] * 128 + 128))));
+  }
+  EmbeddingIndex index(kDim);
+  ASSERT_EQ(kEdgeTpuApiOk, index.Add(quantized.data(), 1.0f / 128, 128, 7));
+  const auto results = Search(&index, embeddings, /*k=*/1, /*num_probes=*/0);
+  ASSERT_EQ(1, results[0].size());
+  EXPECT_EQ(7, results[0][0].label);
+  EXPECT_NEAR(1.0f, results[0][0].score, 0.02f);
+}
+
+TEST(EmbeddingIndexTest, InvertedListsWithAllProbesMatchExhaustiveSearch) {
+  const Embeddings embeddings = GenerateClusteredEmbeddings(
+      /*size=*/1050, kDim, /*num_clusters=*/30, /*spread=*/0.1f, /*seed=*/4);
+  const Embeddings database = Slice(embeddings, 0, 1000);
+  const Embeddings queries = Slice(embeddings, 1000, 1050);
+  EmbeddingIndex index(kDim);
+  AddToIndex(database, &index);
+  const auto expected = Search(&index, queries, /*k=*/5, /*num_probes=*/0);
+
+  ASSERT_EQ(kEdgeTpuApiOk,
+            index.BuildInvertedLists(/*num_lists=*/16, /*num_iterations=*/5));
+  EXPECT_EQ(16, index.num_lists());
+  ExpectSameResults(expected, Search(&index, queries, 5, /*num_probes=*/16));
+  ExpectSameResults(expected, Search(&index, queries, 5, /*num_probes=*/0));
+}
+
+TEST(EmbeddingIndexTest, InvertedListsRecall) {
+  const Embeddings embeddings = GenerateClusteredEmbeddings(
+      /*size=*/4100, kDim, /*num_clusters=*/32, /*spread=*/0.1f, /*seed=*/5);
+  const Embeddings database = Slice(embeddings, 0, 4000);
+  const Embeddings queries = Slice(embeddings, 4000, 4100);
+  EmbeddingIndex index(kDim);
+  AddToIndex(database, &index);
+  ASSERT_EQ(kEdgeTpuApiOk,
+            index.BuildInvertedLists(/*num_lists=*/32, /*num_iterations=*/10));
+  const auto exact = ExactNeighbors(database, queries, /*k=*/1);
+  EXPECT_GT(Recall(exact, Search(&index, queries, 1, /*num_probes=*/4), 1),
+            0.9f);
+}
+
+TEST(EmbeddingIndexTest, AddAfterInvertedLists) {
+  const Embeddings embeddings = GenerateClusteredEmbeddings(
+      /*size=*/301, kDim, /*num_clusters=*/10, /*spread=*/0.1f, /*seed=*/6);
+  EmbeddingIndex index(kDim);
+  AddToIndex(Slice(embeddings, 0, 300), &index);
+  ASSERT_EQ(kEdgeTpuApiOk,
+            index.BuildInvertedLists(/*num_lists=*/10, /*num_iterations=*/5));
+
+  // Embeddings added later are always scanned, even with a single probe.
+  const Embeddings added = Slice(embeddings, 300, 301);
+  ASSERT_EQ(kEdgeTpuApiOk, index.Add(added.data(0), 1000));
+  EXPECT_EQ(301, index.size());
+  const auto results = Search(&index, added, /*k=*/1, /*num_probes=*/1);
+  EXPECT_EQ(1000, results[0][0].label);
+}
+
+TEST(EmbeddingIndexTest, SaveAndLoad) {
+  const Embeddings embeddings = GenerateClusteredEmbeddings(
+      /*size=*/1050, kDim, /*num_clusters=*/30, /*spread=*/0.1f, /*seed=*/7);
+  const Embeddings database = Slice(embeddings, 0, 1000);
+  const Embeddings queries = Slice(embeddings, 1000, 1050);
+  const std::string path = "/tmp/embedding_index_test.knn";
+  std::remove(path.c_str());
+
+  EmbeddingIndex index(kDim);
+  AddToIndex(database, &index);
+  ASSERT_EQ(kEdgeTpuApiOk, index.BuildInvertedLists(16, 5));
+  ASSERT_EQ(kEdgeTpuApiOk, index.Add(queries.data(0), 2000));
+  ASSERT_EQ(kEdgeTpuApiOk, index.Save(path));
+
+  EmbeddingIndex loaded(kDim);
+  ASSERT_EQ(kEdgeTpuApiOk, loaded.Load(path));
+  EXPECT_EQ(index.size(), loaded.size());
+  EXPECT_EQ(index.num_lists(), loaded.num_lists());
+  for (int num_probes : {0, 1, 4}) {
+    ExpectSameResults(Search(&index, queries, 5, num_probes),
+                      Search(&loaded, queries, 5, num_probes));
+  }
+
+  // A loaded index can change, and be saved back to the file it is mapped
+  // from.
+  ASSERT_EQ(kEdgeTpuApiOk, loaded.Add(queries.data(1), 2001));
+  ASSERT_EQ(kEdgeTpuApiOk, loaded.Save(path));
+  ASSERT_EQ(kEdgeTpuApiOk, index.Load(path));
+  EXPECT_EQ(1002, index.size());
+  EXPECT_EQ(2001, Search(&index, Slice(queries, 1, 2), 1, 1)[0][0].label);
+}
+
+TEST(EmbeddingIndexTest, LoadErrors) {
+  EmbeddingIndex index(kDim);
+  EXPECT_EQ(kEdgeTpuApiError, index.Load("/tmp/missing_embedding_index.knn"));
+  EXPECT_EQ("Failed to open file: /tmp/missing_embedding_index.knn",
+            index.get_error_message());
+
+  const std::string path = "/tmp/embedding_index_test_dim.knn";
+  EmbeddingIndex other_index(kDim * 2);
+  ASSERT_EQ(kEdgeTpuApiOk, other_index.Save(path));
+  EXPECT_EQ(kEdgeTpuApiError, index.Load(path));
+  EXPECT_EQ(
+      "Embedding dimension of /tmp/embedding_index_test_dim.knn is 256 "
+      "instead of 128",
+      index.get_error_message());
+}
+
+TEST(EmbeddingIndexTest, InvalidArguments) {
+  const Embeddings embeddings = GenerateClusteredEmbeddings(
+      /*size=*/10, kDim, /*num_clusters=*/2, /*spread=*/0.1f, /*seed=*/8);
+  EmbeddingIndex index(kDim);
+  AddToIndex(embeddings, &index);
+  std::vector<std::vector<Neighbor>> results;
+  EXPECT_EQ(kEdgeTpuApiError,
+            index.Search(embeddings.values.data(), 1, 0, 0, &results));
+  EXPECT_EQ("k must be positive!", index.get_error_message());
+  EXPECT_EQ(kEdgeTpuApiError, index.BuildInvertedLists(11, 1));
+  EXPECT_EQ("Number of lists is larger than the index size!",
+            index.get_error_message());
+  EXPECT_EQ(kEdgeTpuApiError, index.BuildInvertedLists(0, 1));
+  EXPECT_EQ("Number of lists must be positive!", index.get_error_message());
+}
+
+}  // namespace
+}  // namespace knn
+}  // namespace learn
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,117 @@
+#include "edgetpu/cpp/learn/knn/test_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <unordered_set>
+
+#include "glog/logging.h"
+
+namespace coral {
+namespace learn {
+namespace knn {
+namespace {
+
+void Normalize(float* values, int dim) {
+  float squared_sum = 0.0f;
+  for (int i = 0; i < dim; ++i) squared_sum += values[i] * values[i];
+  const float norm = std::sqrt(squared_sum);
+  for (int i = 0; i < dim; ++i) values[i] /= norm;
+}
+
+}  // namespace
+
+Embeddings GenerateClusteredEmbeddings(int size, int dim, int num_clusters,
+                                       float spread, int seed) {
+  CHECK_GT(num_clusters, 0);
+  std::mt19937 generator(seed);
+  std::normal_distribution<float> normal(0.0f, 1.0f);
+  std::vector<float> centers(num_clusters * dim);
+  for (int i = 0; i < num_clusters; ++i) {
+    for (int j = 0; j < dim; ++j) centers[i * dim + j] = normal(generator);
+    Normalize(centers.data() + i * dim, dim);
+  }
+
+  Embeddings result;
+  result.dim = dim;
+  result.values.resize(size * dim);
+  result.clusters.resize(size);
+  std::uniform_int_distribution<int> cluster(0, num_clusters - 1);
+  for (int i = 0; i < size; ++i) {
+    result.clusters[i] = cluster(generator);
+    const float* center = centers.data() + result.clusters[i] * dim;
+    float* values = result.values.data() + i * dim;
+    for (int j = 0; j < dim; ++j) {
+      values[j] = center[j] + spread * normal(generator);
+    }
+    Normalize(values, dim);
+  }
+  return result;
+}
+
+Embeddings Slice(const Embeddings& embeddings, int begin, int end) {
+  CHECK_LE(0, begin);
+  CHECK_LE(begin, end);
+  CHECK_LE(end, embeddings.size());
+  Embeddings result;
+  result.dim = embeddings.dim;
+  result.values.assign(embeddings.data(begin), embeddings.data(end));
+  result.clusters.assign(embeddings.clusters.begin() + begin,
+                         embeddings.clusters.begin() + end);
+  return result;
+}
+
+std::vector<std::vector<int>> ExactNeighbors(const Embeddings& database,
+                                             const Embeddings& queries,
+                                             int k) {
+  CHECK_EQ(database.dim, queries.dim);
+  const int dim = database.dim;
+  std::vector<std::vector<int>> result(queries.size());
+  std::vector<float> scores(database.size());
+  for (int q = 0; q < queries.size(); ++q) {
+    for (int i = 0; i < database.size(); ++i) {
+      scores[i] = std::inner_product(queries.data(q), queries.data(q) + dim,
+                                     database.data(i), 0.0f);
+    }
+    std::vector<int> rows(database.size());
+    std::iota(rows.begin(), rows.end(), 0);
+    const int num_neighbors = std::min<int>(k, rows.size());
+    std::partial_sort(rows.begin(), rows.begin() + num_neighbors, rows.end(),
+                      [&scores](int a, int b) {
+                        return scores[a] > scores[b];
+                      });
+    result[q].assign(rows.begin(), rows.begin() + num_neighbors);
+  }
+  return result;
+}
+
+void AddToIndex(const Embeddings& embeddings, EmbeddingIndex* index) {
+  for (int i = 0; i < embeddings.size(); ++i) {
+    CHECK_EQ(index->Add(embeddings.data(i), i), kEdgeTpuApiOk)
+        << index->get_error_message();
+  }
+}
+
+float Recall(const std::vector<std::vector<int>>& expected_rows,
+             const std::vector<std::vector<Neighbor>>& results, int k) {
+  CHECK_EQ(expected_rows.size(), results.size());
+  int num_expected = 0;
+  int num_found = 0;
+  for (int q = 0; q < results.size(); ++q) {
+    std::unordered_set<int> found;
+    for (int i = 0; i < k && i < results[q].size(); ++i) {
+      found.insert(results[q][i].label);
+    }
+    for (int i = 0; i < k && i < expected_rows[q].size(); ++i) {
+      ++num_expected;
+      num_found += found.count(expected_rows[q][i]);
+    }
+  }
+  return num_expected == 0 ? 1.0f
+                           : static_cast<float>(num_found) / num_expected;
+}
+
+}  // namespace knn
+}  // namespace learn
+}  // namespace coral
@@ -0,0 +1,53 @@
+// Utilities to test and benchmark EmbeddingIndex with synthetic embeddings.
+
+#ifndef EDGETPU_CPP_LEARN_KNN_TEST_UTILS_H_
+#define EDGETPU_CPP_LEARN_KNN_TEST_UTILS_H_
+
+#include <vector>
+
+#include "edgetpu/cpp/learn/knn/embedding_index.h"
+
+namespace coral {
+namespace learn {
+namespace knn {
+
+// Synthetic embeddings, stored one after the other.
+struct Embeddings {
+  int dim;
+  std::vector<float> values;
+  // Cluster of each embedding.
+  std::vector<int> clusters;
+
+  int size() const { return clusters.size(); }
+  const float* data(int i) const { return values.data() + i * dim; }
+};
+
+// Generates `size` L2-normalized embeddings around `num_clusters` random
+// centers, like embeddings of several images of each identity. `spread` is the
+// standard deviation of the noise added to each component of a center, whose
+// norm is 1. Embeddings and clusters are fully determined by `seed`.
+Embeddings GenerateClusteredEmbeddings(int size, int dim, int num_clusters,
+                                       float spread, int seed);
+
+// Returns embeddings [begin, end) of `embeddings`, e.g. to split generated
+// embeddings into enrolled ones and queries from the same clusters.
+Embeddings Slice(const Embeddings& embeddings, int begin, int end);
+
+// Returns the rows of the `k` embeddings of `database` with the highest
+// cosine similarity to each embedding of `queries`, computed in float.
+std::vector<std::vector<int>> ExactNeighbors(const Embeddings& database,
+                                             const Embeddings& queries, int k);
+
+// Adds all `embeddings` to `index`, labeled with their row.
+void AddToIndex(const Embeddings& embeddings, EmbeddingIndex* index);
+
+// Returns the ratio of the first `k` rows of `expected_rows` found among the
+// first `k` labels of `results`, for an index filled by AddToIndex().
+float Recall(const std::vector<std::vector<int>>& expected_rows,
+             const std::vector<std::vector<Neighbor>>& results, int k);
+
+}  // namespace knn
+}  // namespace learn
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_LEARN_KNN_TEST_UTILS_H_
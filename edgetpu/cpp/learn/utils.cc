@@ -2,6 +2,14 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
 
 #include "absl/memory/memory.h"
 #include "absl/strings/substitute.h"
@@ -212,8 +220,327 @@ CalculateQuantParamsForConv2d(
   return quant_params;
 }
 
+#if defined(__AVX2__)
+// Returns zero_point + data / scale rounded half away from zero, like
+// std::round(), and clamped to [min, max]. x - trunc(x) is exact, so one is
+// added away from zero when it is at least 0.5.
+inline __m256 QuantizeRound(__m256 data, __m256 scale, __m256 zero_point,
+                            __m256 min, __m256 max) {
+  const __m256 x = _mm256_add_ps(zero_point, _mm256_div_ps(data, scale));
+  const __m256 truncated =
+      _mm256_round_ps(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+  const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+  const __m256 fraction =
+      _mm256_andnot_ps(sign_mask, _mm256_sub_ps(x, truncated));
+  const __m256 one =
+      _mm256_or_ps(_mm256_and_ps(x, sign_mask), _mm256_set1_ps(1.0f));
+  const __m256 rounded = _mm256_add_ps(
+      truncated,
+      _mm256_and_ps(
+          _mm256_cmp_ps(fraction, _mm256_set1_ps(0.5f), _CMP_GE_OS), one));
+  return _mm256_max_ps(_mm256_min_ps(rounded, max), min);
+}
+#elif defined(__SSE4_1__)
+// Same as above with 4 lanes.
+inline __m128 QuantizeRound(__m128 data, __m128 scale, __m128 zero_point,
+                            __m128 min, __m128 max) {
+  const __m128 x = _mm_add_ps(zero_point, _mm_div_ps(data, scale));
+  const __m128 truncated =
+      _mm_round_ps(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+  const __m128 sign_mask = _mm_set1_ps(-0.0f);
+  const __m128 fraction = _mm_andnot_ps(sign_mask, _mm_sub_ps(x, truncated));
+  const __m128 one = _mm_or_ps(_mm_and_ps(x, sign_mask), _mm_set1_ps(1.0f));
+  const __m128 rounded = _mm_add_ps(
+      truncated, _mm_and_ps(_mm_cmpge_ps(fraction, _mm_set1_ps(0.5f)), one));
+  return _mm_max_ps(_mm_min_ps(rounded, max), min);
+}
+#elif defined(__aarch64__)
+// Same as above, vrndaq_f32() already rounds half away from zero. ARMv7 has
+// neither vector division nor this rounding, and uses the scalar version.
+inline float32x4_t QuantizeRound(float32x4_t data, float32x4_t scale,
+                                 float32x4_t zero_point, float32x4_t min,
+                                 float32x4_t max) {
+  const float32x4_t x = vaddq_f32(zero_point, vdivq_f32(data, scale));
+  return vmaxq_f32(vminq_f32(vrndaq_f32(x), max), min);
+}
+#endif
+
+// Scalar version of Quantize(), for the elements from `begin`.
+template <typename T>
+void QuantizeTail(absl::Span<const float> data, float scale,
+                  int32_t zero_point, int begin, absl::Span<T> output) {
+  for (int i = begin; i < data.size(); ++i) {
+    output[i] = static_cast<T>(std::max<float>(
+        std::numeric_limits<T>::min(),
+        std::min<float>(std::numeric_limits<T>::max(),
+                        std::round(zero_point + (data[i] / scale)))));
+  }
+}
+
+// Scalar version of Dequantize(), for the elements from `begin`.
+template <typename T>
+void DequantizeTail(absl::Span<const T> data, float scale, int32_t zero_point,
+                    int begin, absl::Span<float> output) {
+  for (int i = begin; i < data.size(); ++i) {
+    output[i] = scale * (data[i] - zero_point);
+  }
+}
+
 }  // namespace
 
+int32_t DotProduct(const uint8_t* a, const uint8_t* b, int size) {
+  int i = 0;
+  int32_t result = 0;
+#if defined(__AVX2__)
+  __m256i acc = _mm256_setzero_si256();
+  for (; i + 16 <= size; i += 16) {
+    const __m256i va = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+    const __m256i vb = _mm256_cvtepu8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+  }
+  int32_t lanes[8];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+  for (int32_t lane : lanes) result += lane;
+#elif defined(__SSE4_1__)
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 8 <= size; i += 8) {
+    const __m128i va = _mm_cvtepu8_epi16(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(a + i)));
+    const __m128i vb = _mm_cvtepu8_epi16(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(b + i)));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(va, vb));
+  }
+  int32_t lanes[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+  for (int32_t lane : lanes) result += lane;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  uint32x4_t acc = vdupq_n_u32(0);
+  for (; i + 8 <= size; i += 8) {
+    acc = vpadalq_u16(acc, vmull_u8(vld1_u8(a + i), vld1_u8(b + i)));
+  }
+  uint32_t lanes[4];
+  vst1q_u32(lanes, acc);
+  for (uint32_t lane : lanes) result += lane;
+#endif
+  for (; i < size; ++i) {
+    result += static_cast<int32_t>(a[i]) * b[i];
+  }
+  return result;
+}
+
+int32_t DotProduct(const int8_t* a, const int8_t* b, int size) {
+  int i = 0;
+  int32_t result = 0;
+#if defined(__AVX2__)
+  __m256i acc = _mm256_setzero_si256();
+  for (; i + 16 <= size; i += 16) {
+    const __m256i va = _mm256_cvtepi8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+    const __m256i vb = _mm256_cvtepi8_epi16(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+  }
+  int32_t lanes[8];
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), acc);
+  for (int32_t lane : lanes) result += lane;
+#elif defined(__SSE4_1__)
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 8 <= size; i += 8) {
+    const __m128i va = _mm_cvtepi8_epi16(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(a + i)));
+    const __m128i vb = _mm_cvtepi8_epi16(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(b + i)));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(va, vb));
+  }
+  int32_t lanes[4];
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), acc);
+  for (int32_t lane : lanes) result += lane;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  int32x4_t acc = vdupq_n_s32(0);
+  for (; i + 8 <= size; i += 8) {
+    acc = vpadalq_s16(acc, vmull_s8(vld1_s8(a + i), vld1_s8(b + i)));
+  }
+  int32_t lanes[4];
+  vst1q_s32(lanes, acc);
+  for (int32_t lane : lanes) result += lane;
+#endif
+  for (; i < size; ++i) {
+    result += static_cast<int32_t>(a[i]) * b[i];
+  }
+  return result;
+}
+
+void Quantize(absl::Span<const float> data, float scale, int32_t zero_point,
+              absl::Span<uint8_t> output) {
+  CHECK_EQ(data.size(), output.size());
+  int i = 0;
+#if defined(__AVX2__)
+  const __m256 vscale = _mm256_set1_ps(scale);
+  const __m256 vzero_point = _mm256_set1_ps(zero_point);
+  const __m256 vmin = _mm256_set1_ps(0.0f);
+  const __m256 vmax = _mm256_set1_ps(255.0f);
+  for (; i + 8 <= data.size(); i += 8) {
+    const __m256i q = _mm256_cvttps_epi32(QuantizeRound(
+        _mm256_loadu_ps(&data[i]), vscale, vzero_point, vmin, vmax));
+    const __m128i q16 = _mm_packs_epi32(_mm256_castsi256_si128(q),
+                                        _mm256_extracti128_si256(q, 1));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(&output[i]),
+                     _mm_packus_epi16(q16, q16));
+  }
+#elif defined(__SSE4_1__)
+  const __m128 vscale = _mm_set1_ps(scale);
+  const __m128 vzero_point = _mm_set1_ps(zero_point);
+  const __m128 vmin = _mm_set1_ps(0.0f);
+  const __m128 vmax = _mm_set1_ps(255.0f);
+  for (; i + 8 <= data.size(); i += 8) {
+    const __m128i q0 = _mm_cvttps_epi32(QuantizeRound(
+        _mm_loadu_ps(&data[i]), vscale, vzero_point, vmin, vmax));
+    const __m128i q1 = _mm_cvttps_epi32(QuantizeRound(
+        _mm_loadu_ps(&data[i + 4]), vscale, vzero_point, vmin, vmax));
+    const __m128i q16 = _mm_packs_epi32(q0, q1);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(&output[i]),
+                     _mm_packus_epi16(q16, q16));
+  }
+#elif defined(__aarch64__)
+  const float32x4_t vscale = vdupq_n_f32(scale);
+  const float32x4_t vzero_point = vdupq_n_f32(zero_point);
+  const float32x4_t vmin = vdupq_n_f32(0.0f);
+  const float32x4_t vmax = vdupq_n_f32(255.0f);
+  for (; i + 8 <= data.size(); i += 8) {
+    const int32x4_t q0 = vcvtq_s32_f32(
+        QuantizeRound(vld1q_f32(&data[i]), vscale, vzero_point, vmin, vmax));
+    const int32x4_t q1 = vcvtq_s32_f32(QuantizeRound(
+        vld1q_f32(&data[i + 4]), vscale, vzero_point, vmin, vmax));
+    vst1_u8(&output[i],
+            vqmovun_s16(vcombine_s16(vmovn_s32(q0), vmovn_s32(q1))));
+  }
+#endif
+  QuantizeTail(data, scale, zero_point, i, output);
+}
+
+void Quantize(absl::Span<const float> data, float scale, int32_t zero_point,
+              absl::Span<int32_t> output) {
+  CHECK_EQ(data.size(), output.size());
+  int i = 0;
+  // Same bounds as the scalar version, which are rounded to float.
+  const float min = std::numeric_limits<int32_t>::min();
+  const float max = std::numeric_limits<int32_t>::max();
+#if defined(__AVX2__)
+  const __m256 vscale = _mm256_set1_ps(scale);
+  const __m256 vzero_point = _mm256_set1_ps(zero_point);
+  const __m256 vmin = _mm256_set1_ps(min);
+  const __m256 vmax = _mm256_set1_ps(max);
+  for (; i + 8 <= data.size(); i += 8) {
+    _mm256_storeu_si256(
+        reinterpret_cast<__m256i*>(&output[i]),
+        _mm256_cvttps_epi32(QuantizeRound(_mm256_loadu_ps(&data[i]), vscale,
+                                          vzero_point, vmin, vmax)));
+  }
+#elif defined(__SSE4_1__)
+  const __m128 vscale = _mm_set1_ps(scale);
+  const __m128 vzero_point = _mm_set1_ps(zero_point);
+  const __m128 vmin = _mm_set1_ps(min);
+  const __m128 vmax = _mm_set1_ps(max);
+  for (; i + 4 <= data.size(); i += 4) {
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i*>(&output[i]),
+        _mm_cvttps_epi32(QuantizeRound(_mm_loadu_ps(&data[i]), vscale,
+                                       vzero_point, vmin, vmax)));
+  }
+#elif defined(__aarch64__)
+  const float32x4_t vscale = vdupq_n_f32(scale);
+  const float32x4_t vzero_point = vdupq_n_f32(zero_point);
+  const float32x4_t vmin = vdupq_n_f32(min);
+  const float32x4_t vmax = vdupq_n_f32(max);
+  for (; i + 4 <= data.size(); i += 4) {
+    vst1q_s32(&output[i], vcvtq_s32_f32(QuantizeRound(
+                              vld1q_f32(&data[i]), vscale, vzero_point, vmin,
+                              vmax)));
+  }
+#endif
+  QuantizeTail(data, scale, zero_point, i, output);
+}
+
+void Dequantize(absl::Span<const uint8_t> data, float scale,
+                int32_t zero_point, absl::Span<float> output) {
+  CHECK_EQ(data.size(), output.size());
+  int i = 0;
+#if defined(__AVX2__)
+  const __m256 vscale = _mm256_set1_ps(scale);
+  const __m256i vzero_point = _mm256_set1_epi32(zero_point);
+  for (; i + 8 <= data.size(); i += 8) {
+    const __m256i q = _mm256_cvtepu8_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&data[i])));
+    _mm256_storeu_ps(&output[i],
+                     _mm256_mul_ps(vscale, _mm256_cvtepi32_ps(_mm256_sub_epi32(
+                                               q, vzero_point))));
+  }
+#elif defined(__SSE4_1__)
+  const __m128 vscale = _mm_set1_ps(scale);
+  const __m128i vzero_point = _mm_set1_epi32(zero_point);
+  for (; i + 4 <= data.size(); i += 4) {
+    int32_t bytes;
+    std::memcpy(&bytes, &data[i], sizeof(bytes));
+    const __m128i q = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(bytes));
+    _mm_storeu_ps(&output[i],
+                  _mm_mul_ps(vscale, _mm_cvtepi32_ps(
+                                         _mm_sub_epi32(q, vzero_point))));
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  const float32x4_t vscale = vdupq_n_f32(scale);
+  const int32x4_t vzero_point = vdupq_n_s32(zero_point);
+  for (; i + 8 <= data.size(); i += 8) {
+    const uint16x8_t q = vmovl_u8(vld1_u8(&data[i]));
+    const int32x4_t q0 = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(q)));
+    const int32x4_t q1 = vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(q)));
+    vst1q_f32(&output[i],
+              vmulq_f32(vscale, vcvtq_f32_s32(vsubq_s32(q0, vzero_point))));
+    vst1q_f32(&output[i + 4],
+              vmulq_f32(vscale, vcvtq_f32_s32(vsubq_s32(q1, vzero_point))));
+  }
+#endif
+  DequantizeTail(data, scale, zero_point, i, output);
+}
+
+void Dequantize(absl::Span<const int32_t> data, float scale,
+                int32_t zero_point, absl::Span<float> output) {
+  CHECK_EQ(data.size(), output.size());
+  int i = 0;
+#if defined(__AVX2__)
+  const __m256 vscale = _mm256_set1_ps(scale);
+  const __m256i vzero_point = _mm256_set1_epi32(zero_point);
+  for (; i + 8 <= data.size(); i += 8) {
+    const __m256i q =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&data[i]));
+    _mm256_storeu_ps(&output[i],
+                     _mm256_mul_ps(vscale, _mm256_cvtepi32_ps(_mm256_sub_epi32(
+                                               q, vzero_point))));
+  }
+#elif defined(__SSE4_1__)
+  const __m128 vscale = _mm_set1_ps(scale);
+  const __m128i vzero_point = _mm_set1_epi32(zero_point);
+  for (; i + 4 <= data.size(); i += 4) {
+    const __m128i q =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(&data[i]));
+    _mm_storeu_ps(&output[i],
+                  _mm_mul_ps(vscale, _mm_cvtepi32_ps(
+                                         _mm_sub_epi32(q, vzero_point))));
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  const float32x4_t vscale = vdupq_n_f32(scale);
+  const int32x4_t vzero_point = vdupq_n_s32(zero_point);
+  for (; i + 4 <= data.size(); i += 4) {
+    vst1q_f32(&output[i],
+              vmulq_f32(vscale, vcvtq_f32_s32(
+                                    vsubq_s32(vld1q_s32(&data[i]),
+                                              vzero_point))));
+  }
+#endif
+  DequantizeTail(data, scale, zero_point, i, output);
+}
+
 // Returns index of a tensor specified by name. If non-found, return -1;
 int FindTensor(const std::string& name, const tflite::SubGraphT& subgraph_t) {
   for (int i = 0; i < subgraph_t.tensors.size(); ++i) {
@@ -658,11 +985,64 @@ std::unique_ptr<flatbuffers::FlatBufferBuilder> GetFlatBufferBuilder(
   return fbb;
 }
 
+std::unique_ptr<flatbuffers::FlatBufferBuilder> GetFlatBufferBuilder(
+    const tflite::ModelT* model_t, size_t buffer_alignment) {
+  if (buffer_alignment == 0) return GetFlatBufferBuilder(model_t);
+  CHECK_EQ(buffer_alignment & (buffer_alignment - 1), 0)
+      << "Buffer alignment must be a power of 2!";
+  using flatbuffers::Offset;
+  using flatbuffers::Vector;
+  auto fbb = absl::make_unique<flatbuffers::FlatBufferBuilder>();
+
+  // Flatbuffers are built back to front, so the data created first ends up at
+  // the end. Offsets of padded data are multiples of `buffer_alignment` from
+  // the end of the model, whose size Finish() pads to a multiple of the
+  // largest alignment.
+  const auto& buffers = model_t->buffers;
+  std::vector<Offset<Vector<uint8_t>>> buffer_data(buffers.size());
+  for (int i = buffers.size() - 1; i >= 0; --i) {
+    const std::vector<uint8_t>& data = buffers[i]->data;
+    if (data.empty() || data.size() < buffer_alignment) continue;
+    fbb->PreAlign(data.size(), buffer_alignment);
+    buffer_data[i] = fbb->CreateVector(data);
+  }
+  std::vector<Offset<tflite::Buffer>> buffer_vector;
+  for (int i = 0; i < buffers.size(); ++i) {
+    const std::vector<uint8_t>& data = buffers[i]->data;
+    if (!data.empty() && data.size() < buffer_alignment) {
+      buffer_data[i] = fbb->CreateVector(data);
+    }
+    buffer_vector.push_back(tflite::CreateBuffer(*fbb, buffer_data[i]));
+  }
+
+  // Other fields are packed like tflite::Model::Pack() does.
+  std::vector<Offset<tflite::OperatorCode>> opcode_vector;
+  for (const auto& opcode : model_t->operator_codes) {
+    opcode_vector.push_back(tflite::CreateOperatorCode(*fbb, opcode.get()));
+  }
+  std::vector<Offset<tflite::SubGraph>> subgraph_vector;
+  for (const auto& subgraph : model_t->subgraphs) {
+    subgraph_vector.push_back(tflite::CreateSubGraph(*fbb, subgraph.get()));
+  }
+  auto model = tflite::CreateModel(
+      *fbb, model_t->version,
+      opcode_vector.empty() ? 0 : fbb->CreateVector(opcode_vector),
+      subgraph_vector.empty() ? 0 : fbb->CreateVector(subgraph_vector),
+      model_t->description.empty() ? 0
+                                   : fbb->CreateString(model_t->description),
+      buffer_vector.empty() ? 0 : fbb->CreateVector(buffer_vector),
+      model_t->metadata_buffer.empty()
+          ? 0
+          : fbb->CreateVector(model_t->metadata_buffer));
+  tflite::FinishModelBuffer(*fbb, model);
+  return fbb;
+}
+
 EdgeTpuApiStatus AppendFullyConnectedAndSoftmaxLayerToModel(
     const std::string& in_model_path, const std::string& out_model_path,
     const float* weights, int weights_size, const float* biases,
     int biases_size, float out_tensor_min, float out_tensor_max,
-    EdgeTpuErrorReporter* reporter) {
+    EdgeTpuErrorReporter* reporter, size_t buffer_alignment) {
   // Read input model.
   std::string input_model_content;
   if (ReadFile(in_model_path, &input_model_content, reporter) !=
@@ -690,12 +1070,14 @@ EdgeTpuApiStatus AppendFullyConnectedAndSoftmaxLayerToModel(
       *(embedding_output_tensor->quantization), out_tensor_min, out_tensor_max);
 
   // Quantize weights and biases.
-  auto weights_quant =
-      Quantize<uint8_t>(weights, weights_size, quant_params[0]->scale[0],
-                        quant_params[0]->zero_point[0]);
-  auto biases_quant =
-      Quantize<int32_t>(biases, biases_size, quant_params[1]->scale[0],
-                        quant_params[1]->zero_point[0]);
+  std::vector<uint8_t> weights_quant(weights_size);
+  Quantize(absl::MakeConstSpan(weights, weights_size),
+           quant_params[0]->scale[0], quant_params[0]->zero_point[0],
+           absl::MakeSpan(weights_quant));
+  std::vector<int32_t> biases_quant(biases_size);
+  Quantize(absl::MakeConstSpan(biases, biases_size),
+           quant_params[1]->scale[0], quant_params[1]->zero_point[0],
+           absl::MakeSpan(biases_quant));
 
   // Append operators.
   auto fc_op_index = AppendFullyConnectedLayer(
@@ -709,7 +1091,7 @@ EdgeTpuApiStatus AppendFullyConnectedAndSoftmaxLayerToModel(
   SetConv2dParams(weights_quant, biases_quant, fc_op_index, model_t.get());
 
   // Convert from tflite::ModelT format to FlatBufferBuilder.
-  auto fbb = GetFlatBufferBuilder(model_t.get());
+  auto fbb = GetFlatBufferBuilder(model_t.get(), buffer_alignment);
   VLOG(1) << "Output model size in bytes: " << fbb->GetSize();
   return WriteFile(
       std::string(reinterpret_cast<const char*>(fbb->GetBufferPointer()),
@@ -6,6 +6,7 @@
 #include <vector>
 
 #include "absl/memory/memory.h"
+#include "absl/types/span.h"
 #include "edgetpu/cpp/error_reporter.h"
 #include "edgetpu/cpp/utils.h"
 #include "glog/logging.h"
@@ -50,6 +51,21 @@ inline std::vector<float> Dequantize(const std::vector<T>& data, float scale,
   return f;
 }
 
+// Same as Quantize() above, but writes to `output`, which must have the size
+// of `data`. Uses SIMD instructions when the target supports them, with the
+// same rounding (half away from zero) and clamping as the scalar version.
+void Quantize(absl::Span<const float> data, float scale, int32_t zero_point,
+              absl::Span<uint8_t> output);
+void Quantize(absl::Span<const float> data, float scale, int32_t zero_point,
+              absl::Span<int32_t> output);
+
+// Same as Dequantize() above, but writes to `output`, which must have the size
+// of `data`.
+void Dequantize(absl::Span<const uint8_t> data, float scale,
+                int32_t zero_point, absl::Span<float> output);
+void Dequantize(absl::Span<const int32_t> data, float scale,
+                int32_t zero_point, absl::Span<float> output);
+
 // Calculates scale and zero point, given min, max range and target data type T.
 template <typename T>
 std::pair<float, int32_t> QuantizationParams(float f_min, float f_max) {
@@ -145,6 +161,14 @@ inline std::vector<float> L2Normalize(const std::vector<float>& embedding) {
   return normalized_embedding;
 }
 
+// Computes the dot product of two uint8 vectors of length `size`, with SIMD
+// instructions when the target supports them. `size` must be at most 32768 so
+// that the result fits into int32.
+int32_t DotProduct(const uint8_t* a, const uint8_t* b, int size);
+
+// Same as above for int8 vectors.
+int32_t DotProduct(const int8_t* a, const int8_t* b, int size);
+
 // NOTE: all of the following AppendXXX functions are tuned for imprinting
 // method, especially quantization parameters. You should adapt the
 // implementation accordingly if used in other cases.
@@ -299,6 +323,16 @@ std::vector<int> CalculateConv2dOutputShape(
 std::unique_ptr<flatbuffers::FlatBufferBuilder> GetFlatBufferBuilder(
     const tflite::ModelT* model_t);
 
+// Same as above, except that the data of each buffer of at least
+// `buffer_alignment` bytes starts at an offset from the beginning of the model
+// that is a multiple of `buffer_alignment`, a power of 2. These buffers are
+// stored in a region at the end of the model, after all tables, in buffer
+// order. With the page size, weights of a model loaded with mmap() then start
+// on their own pages, which processes mapping the same file share. 0 packs the
+// model as above.
+std::unique_ptr<flatbuffers::FlatBufferBuilder> GetFlatBufferBuilder(
+    const tflite::ModelT* model_t, size_t buffer_alignment);
+
 // Appends Fully-Connected (FC) layer and softmax layer to tflite model.
 //
 // This function does the following:
@@ -307,12 +341,13 @@ std::unique_ptr<flatbuffers::FlatBufferBuilder> GetFlatBufferBuilder(
 //        classification model without the last FC+Softmax layer.
 //   2) Append (learned) weights and biases as a FC layer to input model;
 //   3) Append softmax layer after the FC layer;
-//   4) Save tflite model to |out_model_path|;
+//   4) Save tflite model to |out_model_path|, with large buffers aligned on
+//      |buffer_alignment| as done by GetFlatBufferBuilder().
 EdgeTpuApiStatus AppendFullyConnectedAndSoftmaxLayerToModel(
     const std::string& in_model_path, const std::string& out_model_path,
     const float* weights, int weights_size, const float* biases,
     int biases_size, float out_tensor_min, float out_tensor_max,
-    EdgeTpuErrorReporter* reporter);
+    EdgeTpuErrorReporter* reporter, size_t buffer_alignment = 0);
 
 }  // namespace learn
 }  // namespace coral
@@ -1,6 +1,9 @@
 #include "edgetpu/cpp/learn/utils.h"
 
 #include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/substitute.h"
@@ -474,6 +477,40 @@ TEST(UtilsTest, FindSingleOperatorWithInput) {
   EXPECT_EQ(30, softmax_op_index);
 }
 
+TEST(UtilsTest, GetFlatBufferBuilderAlignsBuffers) {
+  const auto model_t =
+      LoadModel(ModelPath("mobilenet_v1_1.0_224_quant.tflite"));
+  constexpr size_t kAlignment = 4096;
+  const auto fbb = GetFlatBufferBuilder(model_t.get(), kAlignment);
+  flatbuffers::Verifier verifier(fbb->GetBufferPointer(), fbb->GetSize());
+  ASSERT_TRUE(tflite::VerifyModelBuffer(verifier));
+
+  const tflite::Model* model = tflite::GetModel(fbb->GetBufferPointer());
+  int num_aligned = 0;
+  for (const auto* buffer : *model->buffers()) {
+    if (!buffer->data() || buffer->data()->size() < kAlignment) continue;
+    EXPECT_EQ(0, (buffer->data()->Data() - fbb->GetBufferPointer()) %
+                     kAlignment);
+    ++num_aligned;
+  }
+  EXPECT_GT(num_aligned, 0);
+
+  // Only the layout changes.
+  const auto unpacked = absl::WrapUnique<tflite::ModelT>(model->UnPack());
+  const auto expected_fbb = GetFlatBufferBuilder(model_t.get());
+  const auto actual_fbb = GetFlatBufferBuilder(unpacked.get());
+  ASSERT_EQ(expected_fbb->GetSize(), actual_fbb->GetSize());
+  EXPECT_EQ(0, std::memcmp(expected_fbb->GetBufferPointer(),
+                           actual_fbb->GetBufferPointer(),
+                           expected_fbb->GetSize()));
+  // 0 doesn't align buffers.
+  const auto unaligned_fbb = GetFlatBufferBuilder(model_t.get(), 0);
+  ASSERT_EQ(expected_fbb->GetSize(), unaligned_fbb->GetSize());
+  EXPECT_EQ(0, std::memcmp(expected_fbb->GetBufferPointer(),
+                           unaligned_fbb->GetBufferPointer(),
+                           expected_fbb->GetSize()));
+}
+
 TEST(UtilsTest, AppendFullyConnectedAndSoftmaxLayerToModel) {
   const std::string& in_model_path = ModelPath(
       "mobilenet_v1_1.0_224_quant_embedding_extractor_edgetpu.tflite");
@@ -572,6 +609,103 @@ TEST(UtilsTest,
   EXPECT_EQ(reporter.message(), expected_message);
 }
 
+template <typename T>
+void TestDotProduct() {
+  std::mt19937 generator(0);
+  std::uniform_int_distribution<int> distribution(
+      std::numeric_limits<T>::min(), std::numeric_limits<T>::max());
+  // Covers sizes with and without a tail left after the SIMD loop.
+  for (int size : {0, 1, 7, 8, 15, 16, 17, 33, 1024, 1031}) {
+    std::vector<T> a(size), b(size);
+    int32_t expected = 0;
+    for (int i = 0; i < size; ++i) {
+      a[i] = static_cast<T>(distribution(generator));
+      b[i] = static_cast<T>(distribution(generator));
+      expected += static_cast<int32_t>(a[i]) * b[i];
+    }
+    EXPECT_EQ(expected, DotProduct(a.data(), b.data(), size)) << size;
+  }
+  // Extremes of the type.
+  const std::vector<T> max(1024, std::numeric_limits<T>::max());
+  const std::vector<T> min(1024, std::numeric_limits<T>::min());
+  EXPECT_EQ(1024 * static_cast<int32_t>(max[0]) * max[0],
+            DotProduct(max.data(), max.data(), max.size()));
+  EXPECT_EQ(1024 * static_cast<int32_t>(min[0]) * min[0],
+            DotProduct(min.data(), min.data(), min.size()));
+  EXPECT_EQ(1024 * static_cast<int32_t>(min[0]) * max[0],
+            DotProduct(min.data(), max.data(), min.size()));
+}
+
+TEST(UtilsTest, DotProductUint8) { TestDotProduct<uint8_t>(); }
+
+TEST(UtilsTest, DotProductInt8) { TestDotProduct<int8_t>(); }
+
+// Returns values covering ties, clamping and the tail after SIMD loops, for a
+// quantization with `scale` and `zero_point` of type T.
+template <typename T>
+std::vector<float> GenerateValuesToQuantize(float scale, int32_t zero_point,
+                                            int size) {
+  std::mt19937 generator(size);
+  const float min = (static_cast<float>(std::numeric_limits<T>::min()) -
+                     zero_point) * scale;
+  const float max = (static_cast<float>(std::numeric_limits<T>::max()) -
+                     zero_point) * scale;
+  // Values out of range are clamped, except for int32 whose bounds are
+  // rounded up to 2^31 in float, which can't be cast back to int32.
+  const float range = sizeof(T) < sizeof(int32_t) ? 1.2f : 0.9f;
+  std::uniform_real_distribution<float> distribution(range * min, range * max);
+  std::uniform_int_distribution<int> ties(-1000, 1000);
+  std::vector<float> values(size);
+  for (int i = 0; i < size; ++i) {
+    // One value out of four is exactly halfway between two integers after
+    // quantization.
+    values[i] = i % 4 == 0 ? (ties(generator) + 0.5f) * scale
+                           : distribution(generator);
+  }
+  return values;
+}
+
+template <typename T>
+void TestQuantizeSpan(float scale, int32_t zero_point) {
+  for (int size : {0, 1, 3, 4, 7, 8, 15, 16, 17, 1024, 1031}) {
+    const std::vector<float> values =
+        GenerateValuesToQuantize<T>(scale, zero_point, size);
+    const std::vector<T> expected = Quantize<T>(values, scale, zero_point);
+    std::vector<T> output(size);
+    Quantize(values, scale, zero_point, absl::MakeSpan(output));
+    EXPECT_EQ(expected, output) << size;
+
+    const std::vector<float> expected_values =
+        Dequantize(expected, scale, zero_point);
+    std::vector<float> dequantized(size);
+    Dequantize(expected, scale, zero_point, absl::MakeSpan(dequantized));
+    // Compares bits, exact equality is expected.
+    for (int i = 0; i < size; ++i) {
+      EXPECT_EQ(0, std::memcmp(&expected_values[i], &dequantized[i],
+                               sizeof(float)))
+          << expected_values[i] << " != " << dequantized[i];
+    }
+  }
+}
+
+TEST(UtilsTest, QuantizeSpanUint8) {
+  TestQuantizeSpan<uint8_t>(/*scale=*/1.0f / 128, /*zero_point=*/128);
+  TestQuantizeSpan<uint8_t>(/*scale=*/0.0173f, /*zero_point=*/3);
+  TestQuantizeSpan<uint8_t>(/*scale=*/2.5f, /*zero_point=*/0);
+}
+
+TEST(UtilsTest, QuantizeSpanInt32) {
+  TestQuantizeSpan<int32_t>(/*scale=*/1e-6f, /*zero_point=*/0);
+  TestQuantizeSpan<int32_t>(/*scale=*/0.37f, /*zero_point=*/-42);
+  // Clamped to the (float) range of int32.
+  std::vector<int32_t> output(5);
+  Quantize({-1e10f, -3.0f, 0.0f, 3.0f, 2e9f}, /*scale=*/1.0f,
+           /*zero_point=*/0, absl::MakeSpan(output));
+  EXPECT_EQ(std::vector<int32_t>({std::numeric_limits<int32_t>::min(), -3, 0,
+                                  3, 2000000000}),
+            output);
+}
+
 }  // namespace
 }  // namespace learn
 }  // namespace coral
@@ -0,0 +1,129 @@
+#ifndef EDGETPU_CPP_PIPELINE_BOUNDED_QUEUE_H_
+#define EDGETPU_CPP_PIPELINE_BOUNDED_QUEUE_H_
+
+#include <algorithm>
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <deque>
+#include <mutex>  // NOLINT
+#include <utility>
+
+#include "glog/logging.h"
+
+namespace coral {
+
+// Thread-safe FIFO queue holding at most `capacity` elements, between threads
+// producing and consuming elements at different rates. Push() blocks while the
+// queue is full, so that a fast producer doesn't run arbitrarily far ahead,
+// and Pop() while it is empty.
+//
+// For live streams, where stale elements are worth less than new ones, Push()
+// can instead drop queued elements to make room; see OverflowPolicy.
+//
+// Close() tells consumers that no more elements will come: Push() then fails,
+// and Pop() fails once the remaining elements are consumed.
+template <typename T>
+class BoundedQueue {
+ public:
+  // What Push() does when the queue is full.
+  enum class OverflowPolicy {
+    // Waits for room.
+    kBlock,
+    // Drops the oldest element.
+    kDropOldest,
+    // Drops all queued elements, so that consumers get the newest one next,
+    // e.g. the latest frame of a camera.
+    kKeepLatest,
+  };
+
+  explicit BoundedQueue(int capacity,
+                        OverflowPolicy policy = OverflowPolicy::kBlock)
+      : capacity_(capacity), policy_(policy) {
+    CHECK_GT(capacity_, 0);
+  }
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  // Appends `value`, waiting for room or dropping elements if needed,
+  // depending on the policy. Returns false if the queue is closed.
+  bool Push(T value) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (policy_ == OverflowPolicy::kBlock) {
+      not_full_.wait(lock,
+                     [this] { return closed_ || queue_.size() < capacity_; });
+    }
+    if (closed_) return false;
+    // Destroyed once unlocked.
+    std::deque<T> dropped;
+    if (queue_.size() >= capacity_) {
+      if (policy_ == OverflowPolicy::kKeepLatest) {
+        dropped.swap(queue_);
+      } else {
+        dropped.push_back(std::move(queue_.front()));
+        queue_.pop_front();
+      }
+      num_dropped_ += dropped.size();
+    }
+    queue_.push_back(std::move(value));
+    max_size_ = std::max<int>(max_size_, queue_.size());
+    lock.unlock();
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // Removes the first element into `value`, waiting for one if needed.
+  // Returns false if the queue is closed and empty.
+  bool Pop(T* value) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return closed_ || !queue_.empty(); });
+    if (queue_.empty()) return false;
+    *value = std::move(queue_.front());
+    queue_.pop_front();
+    lock.unlock();
+    not_full_.notify_one();
+    return true;
+  }
+
+  // Wakes up all waiting threads, and fails pushes from now on.
+  void Close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  }
+
+  int size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+  }
+
+  // Largest size the queue reached.
+  int max_size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_size_;
+  }
+
+  // Elements dropped by Push(), if the policy isn't kBlock.
+  int64_t num_dropped() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_dropped_;
+  }
+
+ private:
+  const int capacity_;
+  const OverflowPolicy policy_;
+  mutable std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque<T> queue_;
+  bool closed_ = false;
+  int max_size_ = 0;
+  int64_t num_dropped_ = 0;
+};
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_PIPELINE_BOUNDED_QUEUE_H_
@@ -0,0 +1,71 @@
+#include "edgetpu/cpp/pipeline/bounded_queue.h"
+
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace coral {
+namespace {
+
+using OverflowPolicy = BoundedQueue<int>::OverflowPolicy;
+
+std::vector<int> PopAll(BoundedQueue<int>* queue) {
+  queue->Close();
+  std::vector<int> values;
+  int value;
+  while (queue->Pop(&value)) values.push_back(value);
+  return values;
+}
+
+TEST(BoundedQueueTest, BlockingPushWaitsForRoom) {
+  BoundedQueue<int> queue(2);
+  std::thread consumer([&queue] {
+    int value;
+    for (int i = 0; i < 100; ++i) {
+      ASSERT_TRUE(queue.Pop(&value));
+      EXPECT_EQ(i, value);
+    }
+  });
+  for (int i = 0; i < 100; ++i) EXPECT_TRUE(queue.Push(i));
+  consumer.join();
+  EXPECT_EQ(0, queue.size());
+  EXPECT_LE(queue.max_size(), 2);
+  EXPECT_EQ(0, queue.num_dropped());
+}
+
+TEST(BoundedQueueTest, DropOldest) {
+  BoundedQueue<int> queue(3, OverflowPolicy::kDropOldest);
+  for (int i = 0; i < 10; ++i) EXPECT_TRUE(queue.Push(i));
+  EXPECT_EQ(3, queue.size());
+  EXPECT_EQ(3, queue.max_size());
+  EXPECT_EQ(7, queue.num_dropped());
+  EXPECT_EQ(std::vector<int>({7, 8, 9}), PopAll(&queue));
+}
+
+TEST(BoundedQueueTest, KeepLatest) {
+  BoundedQueue<int> queue(3, OverflowPolicy::kKeepLatest);
+  for (int i = 0; i < 10; ++i) EXPECT_TRUE(queue.Push(i));
+  // 3, 6 and 9 find the queue full, and drop what it holds.
+  EXPECT_EQ(1, queue.size());
+  EXPECT_EQ(3, queue.max_size());
+  EXPECT_EQ(9, queue.num_dropped());
+  EXPECT_EQ(std::vector<int>({9}), PopAll(&queue));
+}
+
+TEST(BoundedQueueTest, Close) {
+  BoundedQueue<int> queue(1);
+  EXPECT_TRUE(queue.Push(1));
+  std::thread producer([&queue] { EXPECT_FALSE(queue.Push(2)); });
+  // The producer waits for room until the queue closes.
+  queue.Close();
+  producer.join();
+  EXPECT_FALSE(queue.Push(3));
+  int value;
+  EXPECT_TRUE(queue.Pop(&value));
+  EXPECT_EQ(1, value);
+  EXPECT_FALSE(queue.Pop(&value));
+}
+
+}  // namespace
+}  // namespace coral
@@ -0,0 +1,139 @@
+#include "edgetpu/cpp/pipeline/cascade_runner.h"
+
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "edgetpu/cpp/basic/edgetpu_resource_manager.h"
+#include "edgetpu/cpp/tracing.h"
+#include "glog/logging.h"
+
+namespace coral {
+
+namespace {
+// Returns the input dims of `engine`, which takes images.
+ImageDims GetInputDims(const BasicEngine& engine) {
+  const std::vector<int> shape = engine.get_input_tensor_shape();
+  CHECK_EQ(4, shape.size());
+  return {{shape[1], shape[2], shape[3]}};
+}
+}  // namespace
+
+std::vector<uint8_t> GetInputFromCrop(const BasicEngine& engine,
+                                      const ImageDims& dims,
+                                      const std::vector<uint8_t>& image,
+                                      const Box& box) {
+  ImageDims crop_dims;
+  const std::vector<uint8_t> crop =
+      CropImage(dims, image.data(), box, &crop_dims);
+  return ResizeImageToDims(crop_dims, crop.data(), GetInputDims(engine));
+}
+
+CascadeRunner::CascadeRunner(const std::string& detection_model_path,
+                             const std::string& classification_model_path,
+                             const std::string& detection_device_path,
+                             const std::string& classification_device_path,
+                             const CascadeOptions& options)
+    : options_(options),
+      detection_queue_(options.queue_size),
+      classification_queue_(options.queue_size),
+      result_queue_(options.queue_size) {
+  detection_engine_ =
+      detection_device_path.empty()
+          ? absl::make_unique<DetectionEngine>(detection_model_path)
+          : absl::make_unique<DetectionEngine>(detection_model_path,
+                                               detection_device_path);
+  std::string device_path = classification_device_path;
+  if (device_path.empty() &&
+      EdgeTpuResourceManager::GetSingleton()
+          ->ListEdgeTpuPaths(EdgeTpuResourceManager::EdgeTpuState::kUnassigned)
+          .empty()) {
+    // Shares the Edge TPU of the detection model.
+    device_path = detection_engine_->device_path();
+  }
+  classification_engine_ =
+      device_path.empty()
+          ? absl::make_unique<ClassificationEngine>(classification_model_path)
+          : absl::make_unique<ClassificationEngine>(classification_model_path,
+                                                    device_path);
+  detection_thread_ = std::thread(&CascadeRunner::RunDetection, this);
+  classification_thread_ = std::thread(&CascadeRunner::RunClassification, this);
+}
+
+CascadeRunner::~CascadeRunner() {
+  detection_queue_.Close();
+  classification_queue_.Close();
+  result_queue_.Close();
+  detection_thread_.join();
+  classification_thread_.join();
+}
+
+bool CascadeRunner::Push(std::vector<uint8_t> image, const ImageDims& dims) {
+  CHECK_EQ(ImageDimsToSize(dims), image.size());
+  Image item;
+  item.dims = dims;
+  item.data = std::move(image);
+  return detection_queue_.Push(std::move(item));
+}
+
+bool CascadeRunner::Pop(std::vector<CascadeResult>* results) {
+  Image item;
+  if (!result_queue_.Pop(&item)) return false;
+  (*results) = std::move(item.results);
+  return true;
+}
+
+void CascadeRunner::Finish() { detection_queue_.Close(); }
+
+std::string CascadeRunner::detection_device_path() const {
+  return detection_engine_->device_path();
+}
+
+std::string CascadeRunner::classification_device_path() const {
+  return classification_engine_->device_path();
+}
+
+bool CascadeRunner::IsClassified(int label) const {
+  const auto& labels = options_.classified_labels;
+  return labels.empty() ||
+         std::find(labels.begin(), labels.end(), label) != labels.end();
+}
+
+void CascadeRunner::RunDetection() {
+  SetTraceThreadName("cascade detection");
+  const ImageDims input_dims = GetInputDims(*detection_engine_);
+  Image item;
+  while (detection_queue_.Pop(&item)) {
+    CORAL_TRACE_SPAN("CascadeDetection");
+    const std::vector<DetectionCandidate> detections =
+        detection_engine_->DetectWithInputTensor(
+            ResizeImageToDims(item.dims, item.data.data(), input_dims),
+            options_.detection_threshold, options_.max_detections);
+    item.results.clear();
+    for (const DetectionCandidate& detection : detections) {
+      item.results.push_back({detection, {}});
+    }
+    if (!classification_queue_.Push(std::move(item))) break;
+  }
+  classification_queue_.Close();
+}
+
+void CascadeRunner::RunClassification() {
+  SetTraceThreadName("cascade classification");
+  Image item;
+  while (classification_queue_.Pop(&item)) {
+    CORAL_TRACE_SPAN("CascadeClassification");
+    for (CascadeResult& result : item.results) {
+      if (!IsClassified(result.detection.id)) continue;
+      result.classes = classification_engine_->ClassifyWithInputTensor(
+          GetInputFromCrop(*classification_engine_, item.dims, item.data,
+                           result.detection.bounding_box),
+          options_.classification_threshold, options_.top_k);
+    }
+    // The image isn't needed anymore.
+    item.data.clear();
+    if (!result_queue_.Push(std::move(item))) break;
+  }
+  result_queue_.Close();
+}
+
+}  // namespace coral
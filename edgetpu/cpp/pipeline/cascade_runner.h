@@ -0,0 +1,131 @@
+#ifndef EDGETPU_CPP_PIPELINE_CASCADE_RUNNER_H_
+#define EDGETPU_CPP_PIPELINE_CASCADE_RUNNER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "edgetpu/cpp/basic/inference_utils.h"
+#include "edgetpu/cpp/classification/engine.h"
+#include "edgetpu/cpp/detection/engine.h"
+#include "edgetpu/cpp/pipeline/bounded_queue.h"
+
+namespace coral {
+
+// Object detected by a CascadeRunner, with the classes of its crop.
+struct CascadeResult {
+  DetectionCandidate detection;
+  // Empty if the label of the detection isn't classified.
+  std::vector<ClassificationCandidate> classes;
+};
+
+struct CascadeOptions {
+  // Detections with a lower score are dropped.
+  float detection_threshold = 0.5;
+  // Maximum number of detections per image.
+  int max_detections = 10;
+  // Labels of the detections to classify, e.g. that of birds, or all of them
+  // if empty.
+  std::vector<int> classified_labels;
+  // Classes of crops with a lower score are dropped.
+  float classification_threshold = 0.0;
+  // Maximum number of classes per crop.
+  int top_k = 1;
+  // Maximum number of images waiting for each stage.
+  int queue_size = 2;
+};
+
+// Runs a detection model on images, then a classification model on the crop of
+// each detection, e.g. to detect birds and tell their species.
+//
+// Detection and classification run on their own threads, such that the
+// classification of an image overlaps the detection of the next one, and on
+// Edge TPUs of their own if given or available. Otherwise they share one, which
+// is best with models compiled together, so that both keep their parameters
+// cached.
+//
+// Crops of an image go to the classification stage together. Push() and Pop()
+// work like those of PipelinedModelRunner: results come in the order of
+// images, and Finish() lets Pop() return false after the last one.
+//
+// Example:
+//   CascadeOptions options;
+//   options.classified_labels = {kBirdLabel};
+//   CascadeRunner runner("ssd_edgetpu.tflite", "inat_bird_edgetpu.tflite",
+//                        "", "", options);
+//   std::thread consumer([&runner] {
+//     std::vector<CascadeResult> results;
+//     while (runner.Pop(&results)) { ... }
+//   });
+//   for (...) runner.Push(image, image_dims);
+//   runner.Finish();
+//   consumer.join();
+class CascadeRunner {
+ public:
+  // Loads the models on Edge TPUs `detection_device_path` and
+  // `classification_device_path`, or the next available ones if empty.
+  CascadeRunner(const std::string& detection_model_path,
+                const std::string& classification_model_path,
+                const std::string& detection_device_path = "",
+                const std::string& classification_device_path = "",
+                const CascadeOptions& options = CascadeOptions());
+  // Stops the threads, dropping images not processed yet.
+  ~CascadeRunner();
+
+  CascadeRunner(const CascadeRunner&) = delete;
+  CascadeRunner& operator=(const CascadeRunner&) = delete;
+
+  // Queues an image of any size, e.g. RGB of `dims` {height, width, 3},
+  // waiting while the queue is full. Returns false after Finish().
+  bool Push(std::vector<uint8_t> image, const ImageDims& dims);
+
+  // Waits for the results of the oldest image pushed. Returns false if there
+  // are no more, after Finish().
+  bool Pop(std::vector<CascadeResult>* results);
+
+  // Tells that no more images will be pushed.
+  void Finish();
+
+  std::string detection_device_path() const;
+  std::string classification_device_path() const;
+
+ private:
+  struct Image {
+    ImageDims dims;
+    std::vector<uint8_t> data;
+    std::vector<CascadeResult> results;
+  };
+
+  // Detects objects in images of `detection_queue_` into
+  // `classification_queue_`.
+  void RunDetection();
+
+  // Classifies crops of images of `classification_queue_` into
+  // `result_queue_`.
+  void RunClassification();
+
+  // Returns whether detections of `label` are classified.
+  bool IsClassified(int label) const;
+
+  const CascadeOptions options_;
+  std::unique_ptr<DetectionEngine> detection_engine_;
+  std::unique_ptr<ClassificationEngine> classification_engine_;
+  BoundedQueue<Image> detection_queue_;
+  BoundedQueue<Image> classification_queue_;
+  BoundedQueue<Image> result_queue_;
+  std::thread detection_thread_;
+  std::thread classification_thread_;
+};
+
+// Returns the input of `engine` for `box` of an image, cropped and resized
+// like CascadeRunner does.
+std::vector<uint8_t> GetInputFromCrop(const BasicEngine& engine,
+                                      const ImageDims& dims,
+                                      const std::vector<uint8_t>& image,
+                                      const Box& box);
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_PIPELINE_CASCADE_RUNNER_H_
@@ -0,0 +1,142 @@
+#include "edgetpu/cpp/pipeline/cascade_runner.h"
+
+#include <thread>  // NOLINT
+
+#include "edgetpu/cpp/basic/edgetpu_resource_manager.h"
+#include "edgetpu/cpp/test_utils.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace coral {
+namespace {
+
+constexpr char kDetectionModel[] =
+    "mobilenet_ssd_v1_coco_quant_postprocess_edgetpu.tflite";
+constexpr char kClassificationModel[] =
+    "mobilenet_v1_1.0_224_quant_edgetpu.tflite";
+// COCO label of cats.
+constexpr int kCatLabel = 16;
+
+struct TestImage {
+  ImageDims dims;
+  std::vector<uint8_t> data;
+};
+
+std::vector<TestImage> ReadImages() {
+  std::vector<TestImage> images;
+  for (const auto& name : {"cat.bmp", "grace_hopper.bmp"}) {
+    images.emplace_back();
+    images.back().data = ReadBmp(TestDataPath(name), &images.back().dims);
+    CHECK(!images.back().data.empty());
+  }
+  return images;
+}
+
+// Runs the models one after the other, without CascadeRunner.
+std::vector<CascadeResult> RunSerially(const TestImage& image,
+                                       const CascadeOptions& options) {
+  DetectionEngine detection_engine(ModelPath(kDetectionModel));
+  ClassificationEngine classification_engine(ModelPath(kClassificationModel));
+  const std::vector<int> shape = detection_engine.get_input_tensor_shape();
+  const ImageDims dims = {{shape[1], shape[2], shape[3]}};
+  std::vector<uint8_t> input(ImageDimsToSize(dims));
+  ResizeImage(image.dims, image.data.data(), dims, input.data());
+  std::vector<CascadeResult> results;
+  for (const auto& detection : detection_engine.DetectWithInputTensor(
+           input, options.detection_threshold, options.max_detections)) {
+    results.push_back({detection, {}});
+    if (detection.id != kCatLabel) continue;
+    results.back().classes = classification_engine.ClassifyWithInputTensor(
+        GetInputFromCrop(classification_engine, image.dims, image.data,
+                         detection.bounding_box),
+        options.classification_threshold, options.top_k);
+  }
+  return results;
+}
+
+void ExpectEqual(const std::vector<CascadeResult>& expected,
+                 const std::vector<CascadeResult>& results) {
+  ASSERT_EQ(expected.size(), results.size());
+  for (int i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(expected[i].detection, results[i].detection);
+    EXPECT_EQ(expected[i].classes, results[i].classes);
+  }
+}
+
+class CascadeRunnerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    images_ = ReadImages();
+    options_.classified_labels = {kCatLabel};
+    options_.top_k = 3;
+    for (const auto& image : images_) {
+      expected_.push_back(RunSerially(image, options_));
+    }
+    // The cat is detected and classified, Grace Hopper is not.
+    ASSERT_FALSE(expected_[0].empty());
+    EXPECT_EQ(kCatLabel, expected_[0][0].detection.id);
+    EXPECT_FALSE(expected_[0][0].classes.empty());
+  }
+
+  // Runs `num_images` images through `runner` and checks the results.
+  void RunCascade(CascadeRunner* runner, int num_images) {
+    int num_results = 0;
+    std::thread consumer([this, runner, &num_results] {
+      std::vector<CascadeResult> results;
+      while (runner->Pop(&results)) {
+        SCOPED_TRACE(num_results);
+        ExpectEqual(expected_[num_results % images_.size()], results);
+        ++num_results;
+      }
+    });
+    for (int i = 0; i < num_images; ++i) {
+      const TestImage& image = images_[i % images_.size()];
+      EXPECT_TRUE(runner->Push(image.data, image.dims));
+    }
+    runner->Finish();
+    consumer.join();
+    EXPECT_EQ(num_images, num_results);
+    EXPECT_FALSE(runner->Push(images_[0].data, images_[0].dims));
+  }
+
+  std::vector<TestImage> images_;
+  CascadeOptions options_;
+  std::vector<std::vector<CascadeResult>> expected_;
+};
+
+TEST_F(CascadeRunnerTest, SameResultsAsSerialRuns) {
+  CascadeRunner runner(ModelPath(kDetectionModel),
+                       ModelPath(kClassificationModel), "", "", options_);
+  RunCascade(&runner, 10);
+}
+
+TEST_F(CascadeRunnerTest, SharesOneEdgeTpu) {
+  const auto paths = EdgeTpuResourceManager::GetSingleton()->ListEdgeTpuPaths(
+      EdgeTpuResourceManager::EdgeTpuState::kUnassigned);
+  ASSERT_FALSE(paths.empty());
+  CascadeRunner runner(ModelPath(kDetectionModel),
+                       ModelPath(kClassificationModel), paths[0], paths[0],
+                       options_);
+  EXPECT_EQ(paths[0], runner.detection_device_path());
+  EXPECT_EQ(paths[0], runner.classification_device_path());
+  RunCascade(&runner, 10);
+}
+
+TEST_F(CascadeRunnerTest, StopsWithoutFinish) {
+  CascadeRunner runner(ModelPath(kDetectionModel),
+                       ModelPath(kClassificationModel), "", "", options_);
+  for (int i = 0; i < options_.queue_size; ++i) {
+    EXPECT_TRUE(runner.Push(images_[0].data, images_[0].dims));
+  }
+  // The destructor drops what is left.
+}
+
+}  // namespace
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,244 @@
+#include "edgetpu/cpp/pipeline/pipelined_model_runner.h"
+
+#include <cstring>
+#include <map>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "edgetpu/cpp/basic/edgetpu_resource_manager.h"
+#include "edgetpu/cpp/basic/inference_utils.h"
+#include "edgetpu/cpp/tracing.h"
+#include "glog/logging.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/kernels/register.h"
+#include "tensorflow/lite/model.h"
+
+namespace coral {
+
+#define PIPELINED_MODEL_RUNNER_INIT_CHECK()                                   \
+  EDGETPU_API_REPORT_ERROR(error_reporter_, !is_initialized_,                 \
+                           "PipelinedModelRunner must be initialized! Please " \
+                           "ensure the instance is created by "               \
+                           "PipelinedModelRunnerBuilder!")
+
+struct PipelinedModelRunner::Segment {
+  // Fills the input tensors of the interpreter with `tensors`, runs it, and
+  // replaces `tensors` with its output tensors.
+  bool Run(std::vector<PipelineTensor>* tensors, std::string* error) {
+    CORAL_TRACE_SPAN("RunSegment");
+    for (const auto& tensor : *tensors) {
+      TfLiteTensor* input = interpreter->tensor(input_indices.at(tensor.name));
+      std::memcpy(input->data.raw, tensor.data.data(), tensor.data.size());
+    }
+    if (interpreter->Invoke() != kTfLiteOk) {
+      *error = "Failed to run segment " + path + ": " +
+               error_reporter.message();
+      return false;
+    }
+    tensors->resize(interpreter->outputs().size());
+    const auto& outputs = interpreter->outputs();
+    for (int i = 0; i < tensors->size(); ++i) {
+      const TfLiteTensor* output = interpreter->tensor(outputs[i]);
+      (*tensors)[i].name = output->name;
+      (*tensors)[i].data.assign(output->data.raw,
+                                output->data.raw + output->bytes);
+    }
+    return true;
+  }
+
+  std::string path;
+  EdgeTpuErrorReporter error_reporter;
+  std::unique_ptr<tflite::FlatBufferModel> model;
+  // EdgeTpuResource must be destructed after interpreter, whose custom ops use
+  // the Edge TPU context.
+  std::unique_ptr<EdgeTpuResource> edgetpu_resource;
+  std::unique_ptr<tflite::Interpreter> interpreter;
+  // Interpreter tensor index and size in bytes of each input, by name.
+  std::map<std::string, int> input_indices;
+  std::map<std::string, size_t> input_sizes;
+};
+
+PipelinedModelRunner::PipelinedModelRunner() {
+  error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
+}
+
+PipelinedModelRunner::~PipelinedModelRunner() {
+  for (auto& queue : queues_) queue->Close();
+  for (auto& thread : threads_) thread.join();
+}
+
+EdgeTpuApiStatus PipelinedModelRunner::Init(
+    const std::vector<std::string>& segment_paths,
+    const std::vector<std::string>& device_paths, int queue_size) {
+  EDGETPU_API_REPORT_ERROR(error_reporter_, segment_paths.empty(),
+                           "No segment to run!");
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_,
+      !device_paths.empty() && device_paths.size() != segment_paths.size(),
+      "Number of device paths must be the number of segments!");
+  EDGETPU_API_REPORT_ERROR(error_reporter_, queue_size < 1,
+                           "Queue size must be positive!");
+
+  for (int i = 0; i < segment_paths.size(); ++i) {
+    auto segment = absl::make_unique<Segment>();
+    segment->path = segment_paths[i];
+    segment->model = tflite::FlatBufferModel::BuildFromFile(
+        segment->path.c_str(), &segment->error_reporter);
+    EDGETPU_API_REPORT_ERROR(error_reporter_, !segment->model,
+                             "Failed to load segment " + segment->path + ": " +
+                                 segment->error_reporter.message());
+    EDGETPU_API_ENSURE_STATUS(AssignEdgeTpu(
+        device_paths.empty() ? "" : device_paths[i], i, segment.get()));
+    tflite::ops::builtin::BuiltinOpResolver resolver;
+    segment->interpreter = BuildEdgeTpuInterpreter(
+        *segment->model, &resolver, segment->edgetpu_resource->context(),
+        &segment->error_reporter, segment->path);
+    EDGETPU_API_REPORT_ERROR(error_reporter_, !segment->interpreter,
+                             "Failed to build interpreter of segment " +
+                                 segment->path + ": " +
+                                 segment->error_reporter.message());
+    for (int index : segment->interpreter->inputs()) {
+      const TfLiteTensor* tensor = segment->interpreter->tensor(index);
+      segment->input_indices[tensor->name] = index;
+      segment->input_sizes[tensor->name] = tensor->bytes;
+    }
+    VLOG(1) << "Segment " << i << " " << segment->path << " runs on "
+            << segment->edgetpu_resource->path();
+
+    // Outputs of the previous segment are exactly the inputs of this one.
+    if (i > 0) {
+      const tflite::Interpreter& previous = *segments_.back()->interpreter;
+      std::map<std::string, size_t> output_sizes;
+      for (int index : previous.outputs()) {
+        output_sizes[previous.tensor(index)->name] =
+            previous.tensor(index)->bytes;
+      }
+      EDGETPU_API_REPORT_ERROR(error_reporter_,
+                               output_sizes != segment->input_sizes,
+                               "Inputs of segment " + segment->path +
+                                   " aren't the outputs of segment " +
+                                   segments_.back()->path);
+    }
+    segments_.push_back(std::move(segment));
+  }
+
+  for (int i = 0; i <= segments_.size(); ++i) {
+    queues_.push_back(
+        absl::make_unique<BoundedQueue<std::vector<PipelineTensor>>>(
+            queue_size));
+  }
+  for (int i = 0; i < segments_.size(); ++i) {
+    threads_.emplace_back(&PipelinedModelRunner::RunSegment, this, i);
+  }
+  is_initialized_ = true;
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus PipelinedModelRunner::AssignEdgeTpu(
+    const std::string& device_path, int index, Segment* segment) {
+  EdgeTpuResourceManager* manager = EdgeTpuResourceManager::GetSingleton();
+  using EdgeTpuState = EdgeTpuResourceManager::EdgeTpuState;
+  std::string path = device_path;
+  if (path.empty() &&
+      manager->ListEdgeTpuPaths(EdgeTpuState::kUnassigned).empty()) {
+    // Segments share Edge TPUs once all of them are in use.
+    const std::vector<std::string> all_paths =
+        manager->ListEdgeTpuPaths(EdgeTpuState::kNone);
+    if (!all_paths.empty()) path = all_paths[index % all_paths.size()];
+  }
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_,
+      (path.empty()
+           ? manager->GetEdgeTpuResource(&segment->edgetpu_resource)
+           : manager->GetEdgeTpuResource(path, &segment->edgetpu_resource)) ==
+          kEdgeTpuApiError,
+      manager->get_error_message());
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus PipelinedModelRunner::Push(
+    std::vector<PipelineTensor> input_tensors) {
+  {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    PIPELINED_MODEL_RUNNER_INIT_CHECK();
+    const auto& input_sizes = segments_[0]->input_sizes;
+    std::map<std::string, size_t> sizes;
+    for (const auto& tensor : input_tensors) {
+      sizes[tensor.name] = tensor.data.size();
+    }
+    EDGETPU_API_REPORT_ERROR(
+        error_reporter_,
+        sizes.size() != input_tensors.size() || sizes != input_sizes,
+        "Input tensors must be the inputs of the first segment, with their "
+        "sizes!");
+  }
+  if (!queues_[0]->Push(std::move(input_tensors))) {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    error_reporter_->Report("Pipeline is stopped!");
+    return kEdgeTpuApiError;
+  }
+  return kEdgeTpuApiOk;
+}
+
+bool PipelinedModelRunner::Pop(std::vector<PipelineTensor>* output_tensors) {
+  CHECK(output_tensors);
+  return is_initialized_ && queues_.back()->Pop(output_tensors);
+}
+
+void PipelinedModelRunner::Finish() {
+  if (is_initialized_) queues_[0]->Close();
+}
+
+std::string PipelinedModelRunner::get_error_message() {
+  std::lock_guard<std::mutex> lock(error_mutex_);
+  return error_reporter_->message();
+}
+
+void PipelinedModelRunner::RunSegment(int index) {
+  Segment& segment = *segments_[index];
+  SetTraceThreadName("pipeline segment " + std::to_string(index));
+  std::vector<PipelineTensor> tensors;
+  while (queues_[index]->Pop(&tensors)) {
+    std::string error;
+    if (!segment.Run(&tensors, &error)) {
+      Fail(error);
+      return;
+    }
+    if (!queues_[index + 1]->Push(std::move(tensors))) return;
+  }
+  // Results of all inputs were pushed.
+  queues_[index + 1]->Close();
+}
+
+void PipelinedModelRunner::Fail(const std::string& message) {
+  {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    error_reporter_->Report(message);
+  }
+  for (auto& queue : queues_) queue->Close();
+}
+
+PipelinedModelRunnerBuilder::PipelinedModelRunnerBuilder(
+    const std::vector<std::string>& segment_paths,
+    const std::vector<std::string>& device_paths, int queue_size)
+    : segment_paths_(segment_paths),
+      device_paths_(device_paths),
+      queue_size_(queue_size) {
+  error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
+}
+
+EdgeTpuApiStatus PipelinedModelRunnerBuilder::operator()(
+    std::unique_ptr<PipelinedModelRunner>* runner) {
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_, !runner,
+      "Null output pointer passed to PipelinedModelRunnerBuilder!");
+  (*runner) = absl::make_unique<PipelinedModelRunner>();
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_,
+      (*runner)->Init(segment_paths_, device_paths_, queue_size_) ==
+          kEdgeTpuApiError,
+      (*runner)->get_error_message());
+  return kEdgeTpuApiOk;
+}
+
+}  // namespace coral
@@ -0,0 +1,146 @@
+#ifndef EDGETPU_CPP_PIPELINE_PIPELINED_MODEL_RUNNER_H_
+#define EDGETPU_CPP_PIPELINE_PIPELINED_MODEL_RUNNER_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "edgetpu/cpp/error_reporter.h"
+#include "edgetpu/cpp/pipeline/bounded_queue.h"
+
+namespace coral {
+
+// Input or output tensor of a PipelinedModelRunner.
+struct PipelineTensor {
+  // Name of the tensor in the model.
+  std::string name;
+  // Raw contents of the tensor, e.g. quantized values for uint8 tensors.
+  std::vector<uint8_t> data;
+};
+
+// Runs the segments of a model split by coral::tools::SplitTfliteModel() as a
+// pipeline, each segment on its own Edge TPU and thread. Segments keep their
+// parameters cached on their Edge TPU, which a model too large for one Edge
+// TPU can't do, and work on consecutive inputs at the same time.
+//
+// A bounded queue sits before each segment: Push() waits while the first one
+// is full, and Pop() returns results in the order of inputs. Throughput is
+// that of the slowest segment, so segments should take about the same time.
+//
+// Push() and Pop() are usually called from different threads. Once all inputs
+// are pushed, Finish() lets Pop() return false after the last result. After an
+// error, Push() fails and Pop() returns false, and get_error_message() tells
+// what happened.
+class PipelinedModelRunner {
+ public:
+  PipelinedModelRunner();
+  // Stops the pipeline, dropping inputs not processed yet.
+  ~PipelinedModelRunner();
+
+  // Copying or assignment is disallowed
+  PipelinedModelRunner(const PipelinedModelRunner&) = delete;
+  PipelinedModelRunner& operator=(const PipelinedModelRunner&) = delete;
+
+  // Loads segments `segment_paths` in pipeline order, on Edge TPUs
+  // `device_paths` if not empty, or else on the next available ones, sharing
+  // them once all are in use, and starts the pipeline. Each queue holds up to
+  // `queue_size` inputs.
+  EdgeTpuApiStatus Init(const std::vector<std::string>& segment_paths,
+                        const std::vector<std::string>& device_paths,
+                        int queue_size);
+
+  // Queues the input tensors of the first segment, all of them, for the next
+  // run of the pipeline.
+  EdgeTpuApiStatus Push(std::vector<PipelineTensor> input_tensors);
+
+  // Waits for the output tensors of the last segment for the oldest input
+  // pushed. Returns false if there are no more, after Finish() or an error.
+  bool Pop(std::vector<PipelineTensor>* output_tensors);
+
+  // Tells that no more inputs will be pushed.
+  void Finish();
+
+  int num_segments() const { return segments_.size(); }
+
+  // Caller can use this function to retrieve error message when get
+  // kEdgeTpuApiError.
+  std::string get_error_message();
+
+ private:
+  struct Segment;
+
+  // Opens Edge TPU `device_path` for segment `index`, or if empty the next
+  // available one.
+  EdgeTpuApiStatus AssignEdgeTpu(const std::string& device_path, int index,
+                                 Segment* segment);
+
+  // Runs segment `index` on the inputs of its queue until it is closed.
+  void RunSegment(int index);
+
+  // Reports `message` and stops the pipeline.
+  void Fail(const std::string& message);
+
+  std::vector<std::unique_ptr<Segment>> segments_;
+  // Queue i holds the inputs of segment i, the last one the results.
+  std::vector<std::unique_ptr<BoundedQueue<std::vector<PipelineTensor>>>>
+      queues_;
+  std::vector<std::thread> threads_;
+
+  // Guards `error_reporter_`, which segments report to.
+  std::mutex error_mutex_;
+  // Data structure to stores error messages.
+  std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
+  // Indicates whether the instance is initialized.
+  bool is_initialized_ = false;
+};
+
+// Builds a PipelinedModelRunner.
+//
+// segment_paths: The file paths of the segments, in pipeline order.
+// device_paths: Edge TPU of each segment, or empty for the next available ones.
+// queue_size: Maximum number of inputs waiting for each segment.
+//
+// Example:
+//   PipelinedModelRunnerBuilder builder({"segment0.tflite",
+//                                        "segment1.tflite"});
+//   std::unique_ptr<PipelinedModelRunner> runner;
+//   if (builder(&runner) == kEdgeTpuApiOk) {
+//     std::thread consumer([&runner] {
+//       std::vector<PipelineTensor> outputs;
+//       while (runner->Pop(&outputs)) { ... }
+//     });
+//     for (...) runner->Push({{"input", image}});
+//     runner->Finish();
+//     consumer.join();
+//   }
+class PipelinedModelRunnerBuilder {
+ public:
+  explicit PipelinedModelRunnerBuilder(
+      const std::vector<std::string>& segment_paths,
+      const std::vector<std::string>& device_paths = {}, int queue_size = 2);
+
+  // Disallows copy and assign.
+  PipelinedModelRunnerBuilder(const PipelinedModelRunnerBuilder&) = delete;
+  PipelinedModelRunnerBuilder& operator=(const PipelinedModelRunnerBuilder&) =
+      delete;
+
+  EdgeTpuApiStatus operator()(std::unique_ptr<PipelinedModelRunner>* runner);
+
+  // Caller can use this function to retrieve error message when get
+  // kEdgeTpuApiError.
+  std::string get_error_message() { return error_reporter_->message(); }
+
+ private:
+  // Data structure to stores error messages.
+  std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
+  std::vector<std::string> segment_paths_;
+  std::vector<std::string> device_paths_;
+  int queue_size_;
+};
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_PIPELINE_PIPELINED_MODEL_RUNNER_H_
@@ -0,0 +1,153 @@
+#include "edgetpu/cpp/pipeline/pipelined_model_runner.h"
+
+#include <algorithm>
+#include <thread>  // NOLINT
+
+#include "edgetpu/cpp/basic/basic_engine.h"
+#include "edgetpu/cpp/basic/inference_utils.h"
+#include "edgetpu/cpp/test_utils.h"
+#include "edgetpu/cpp/tools/tflite_graph_util.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "tensorflow/lite/model.h"
+
+namespace coral {
+namespace {
+
+constexpr char kModelName[] = "mobilenet_v1_0.25_128_quant.tflite";
+
+// Splits the model into `num_segments` segments of about the same number of
+// operators, and returns their paths. Operators of the model form a chain.
+std::vector<std::string> SplitModel(const std::string& model_path,
+                                    int num_segments) {
+  auto model = tflite::FlatBufferModel::BuildFromFile(model_path.c_str());
+  CHECK(model);
+  const tflite::SubGraph& subgraph = *model->GetModel()->subgraphs()->Get(0);
+  const auto& ops = *subgraph.operators();
+  std::vector<std::vector<std::string>> split_tensor_names;
+  std::vector<std::string> segment_paths;
+  for (int i = 0; i < num_segments; ++i) {
+    if (i > 0) {
+      const auto* op = ops.Get(i * ops.size() / num_segments - 1);
+      split_tensor_names.push_back(
+          {subgraph.tensors()->Get(op->outputs()->Get(0))->name()->str()});
+    }
+    segment_paths.push_back("/tmp/pipelined_model_runner_test_segment" +
+                            std::to_string(i) + ".tflite");
+  }
+  tools::SplitTfliteModel(model_path, split_tensor_names, segment_paths);
+  return segment_paths;
+}
+
+// Runs `inputs` of tensor `input_name` through segments `segment_paths`, and
+// returns the outputs in order.
+std::vector<std::vector<PipelineTensor>> RunPipeline(
+    const std::vector<std::string>& segment_paths,
+    const std::string& input_name,
+    const std::vector<std::vector<uint8_t>>& inputs) {
+  std::unique_ptr<PipelinedModelRunner> runner;
+  PipelinedModelRunnerBuilder builder(segment_paths);
+  CHECK_EQ(builder(&runner), kEdgeTpuApiOk) << builder.get_error_message();
+  CHECK_EQ(segment_paths.size(), runner->num_segments());
+
+  std::vector<std::vector<PipelineTensor>> outputs;
+  std::thread consumer([&runner, &outputs] {
+    std::vector<PipelineTensor> output_tensors;
+    while (runner->Pop(&output_tensors)) outputs.push_back(output_tensors);
+  });
+  for (const auto& input : inputs) {
+    EXPECT_EQ(kEdgeTpuApiOk, runner->Push({{input_name, input}}))
+        << runner->get_error_message();
+  }
+  runner->Finish();
+  consumer.join();
+  return outputs;
+}
+
+class PipelinedModelRunnerTest : public ::testing::TestWithParam<int> {
+ protected:
+  void SetUp() override {
+    BasicEngine engine(ModelPath(kModelName));
+    const std::vector<int> shape = engine.get_input_tensor_shape();
+    const ImageDims dims = {shape[1], shape[2], shape[3]};
+    for (const auto& image : {"cat.bmp", "grace_hopper.bmp", "sunflower.bmp"}) {
+      inputs_.push_back(GetInputFromImage(TestDataPath(image), dims));
+      CHECK(!inputs_.back().empty());
+      const std::vector<float> result = engine.RunInference(inputs_.back())[0];
+      expected_classes_.push_back(
+          std::max_element(result.begin(), result.end()) - result.begin());
+    }
+    auto model = tflite::FlatBufferModel::BuildFromFile(
+        ModelPath(kModelName).c_str());
+    const tflite::SubGraph& subgraph = *model->GetModel()->subgraphs()->Get(0);
+    input_name_ =
+        subgraph.tensors()->Get(subgraph.inputs()->Get(0))->name()->str();
+  }
+
+  std::vector<std::vector<uint8_t>> inputs_;
+  std::vector<int> expected_classes_;
+  std::string input_name_;
+};
+
+TEST_P(PipelinedModelRunnerTest, SameResultsAsWholeModel) {
+  const int num_segments = GetParam();
+  // More inputs than queues hold, so that pushes wait for the pipeline.
+  std::vector<std::vector<uint8_t>> inputs;
+  for (int i = 0; i < 10; ++i) inputs.push_back(inputs_[i % inputs_.size()]);
+  const auto expected =
+      RunPipeline({ModelPath(kModelName)}, input_name_, inputs);
+  const auto outputs =
+      RunPipeline(SplitModel(ModelPath(kModelName), num_segments), input_name_,
+                  inputs);
+  ASSERT_EQ(inputs.size(), expected.size());
+  ASSERT_EQ(inputs.size(), outputs.size());
+  for (int i = 0; i < outputs.size(); ++i) {
+    ASSERT_EQ(1, outputs[i].size());
+    EXPECT_EQ(expected[i][0].name, outputs[i][0].name);
+    EXPECT_EQ(expected[i][0].data, outputs[i][0].data);
+    const auto& scores = outputs[i][0].data;
+    EXPECT_EQ(expected_classes_[i % inputs_.size()],
+              std::max_element(scores.begin(), scores.end()) - scores.begin());
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(PipelinedModelRunnerTest, PipelinedModelRunnerTest,
+                        ::testing::Values(1, 2, 3));
+
+TEST(PipelinedModelRunnerErrorTest, Errors) {
+  std::unique_ptr<PipelinedModelRunner> runner;
+  {
+    PipelinedModelRunnerBuilder builder({});
+    EXPECT_EQ(kEdgeTpuApiError, builder(&runner));
+    EXPECT_EQ("No segment to run!", builder.get_error_message());
+  }
+  const std::vector<std::string> segment_paths =
+      SplitModel(ModelPath(kModelName), 2);
+  {
+    PipelinedModelRunnerBuilder builder({segment_paths[1], segment_paths[0]});
+    EXPECT_EQ(kEdgeTpuApiError, builder(&runner));
+    EXPECT_EQ("Inputs of segment " + segment_paths[0] +
+                  " aren't the outputs of segment " + segment_paths[1],
+              builder.get_error_message());
+  }
+  PipelinedModelRunnerBuilder builder(segment_paths);
+  ASSERT_EQ(kEdgeTpuApiOk, builder(&runner));
+  EXPECT_EQ(kEdgeTpuApiError, runner->Push({{"not_an_input", {1, 2, 3}}}));
+  EXPECT_EQ(
+      "Input tensors must be the inputs of the first segment, with their "
+      "sizes!",
+      runner->get_error_message());
+  runner->Finish();
+  std::vector<PipelineTensor> outputs;
+  EXPECT_FALSE(runner->Pop(&outputs));
+}
+
+}  // namespace
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
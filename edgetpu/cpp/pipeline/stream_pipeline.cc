@@ -0,0 +1,161 @@
+#include "edgetpu/cpp/pipeline/stream_pipeline.h"
+
+#include <cstdio>
+
+#include "absl/memory/memory.h"
+#include "edgetpu/cpp/tracing.h"
+#include "glog/logging.h"
+
+namespace coral {
+
+namespace {
+int64_t NanosecondsBetween(std::chrono::steady_clock::time_point start,
+                           std::chrono::steady_clock::time_point end) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+      .count();
+}
+
+std::string FormatLatency(const StageLatency& latency) {
+  char line[128];
+  std::snprintf(line, sizeof(line), "mean %.3f p50 %.3f p99 %.3f max %.3f",
+                latency.mean_us / 1000, latency.p50_us / 1000,
+                latency.p99_us / 1000, latency.max_us / 1000);
+  return line;
+}
+}  // namespace
+
+std::string StreamPipelineStats::ToString() const {
+  char line[256];
+  std::snprintf(line, sizeof(line),
+                "frames in %lld out %lld, latencies in ms:\n",
+                static_cast<long long>(num_frames_in),    // NOLINT
+                static_cast<long long>(num_frames_out));  // NOLINT
+  std::string result = line;
+  for (const StreamStageStats& stage : stages) {
+    std::snprintf(line, sizeof(line),
+                  "  %-12s frames %lld rejected %lld dropped %lld queue %d "
+                  "(max %d) ",
+                  stage.name.c_str(),
+                  static_cast<long long>(stage.num_frames),    // NOLINT
+                  static_cast<long long>(stage.num_rejected),  // NOLINT
+                  static_cast<long long>(stage.num_dropped),   // NOLINT
+                  stage.queue_depth, stage.max_queue_depth);
+    result += line + FormatLatency(stage.latency) + "\n";
+  }
+  return result + "  end to end   " + FormatLatency(end_to_end) + "\n";
+}
+
+StreamPipeline::StreamPipeline(Source source, std::vector<StageOptions> stages,
+                               Sink sink)
+    : source_(std::move(source)),
+      stages_(std::move(stages)),
+      sink_(std::move(sink)) {
+  CHECK(!stages_.empty());
+  for (const StageOptions& options : stages_) {
+    states_.push_back(absl::make_unique<StageState>());
+    states_.back()->queue =
+        absl::make_unique<Queue>(options.queue_size, options.overflow_policy);
+  }
+}
+
+StreamPipeline::~StreamPipeline() { Stop(); }
+
+void StreamPipeline::Start() {
+  CHECK(threads_.empty()) << "StreamPipeline already started.";
+  threads_.emplace_back(&StreamPipeline::RunSource, this);
+  for (int i = 0; i < stages_.size(); ++i) {
+    threads_.emplace_back(&StreamPipeline::RunStage, this, i);
+  }
+}
+
+void StreamPipeline::Wait() { Join(); }
+
+void StreamPipeline::Stop() {
+  stopped_ = true;
+  for (auto& state : states_) state->queue->Close();
+  Join();
+}
+
+void StreamPipeline::Join() {
+  for (auto& thread : threads_) {
+    if (thread.joinable()) thread.join();
+  }
+}
+
+void StreamPipeline::RunSource() {
+  SetTraceThreadName("stream source");
+  Queue* queue = states_.front()->queue.get();
+  for (int64_t id = 0; !stopped_; ++id) {
+    StreamFrame frame;
+    {
+      CORAL_TRACE_SPAN("StreamSource");
+      if (!source_(&frame)) break;
+    }
+    frame.id = id;
+    frame.capture_time = std::chrono::steady_clock::now();
+    ++num_frames_in_;
+    if (!queue->Push(std::move(frame))) break;
+  }
+  queue->Close();
+}
+
+void StreamPipeline::RunStage(int index) {
+  SetTraceThreadName("stream stage " + stages_[index].name);
+  const Stage& stage = stages_[index].stage;
+  StageState* state = states_[index].get();
+  Queue* next_queue = index + 1 < states_.size()
+                          ? states_[index + 1]->queue.get()
+                          : nullptr;
+  StreamFrame frame;
+  while (state->queue->Pop(&frame) && !stopped_) {
+    const auto start = std::chrono::steady_clock::now();
+    bool keep;
+    {
+      CORAL_TRACE_SPAN("StreamStage");
+      keep = stage(&frame);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    state->latency.Record(NanosecondsBetween(start, end));
+    ++state->num_frames;
+    // Frames not through when the pipeline stops are dropped.
+    if (stopped_) break;
+    if (!keep) {
+      ++state->num_rejected;
+      continue;
+    }
+    if (next_queue) {
+      if (!next_queue->Push(std::move(frame))) break;
+      continue;
+    }
+    if (sink_) {
+      CORAL_TRACE_SPAN("StreamSink");
+      sink_(frame);
+    }
+    end_to_end_latency_.Record(NanosecondsBetween(
+        frame.capture_time, std::chrono::steady_clock::now()));
+    ++num_frames_out_;
+  }
+  if (next_queue) next_queue->Close();
+}
+
+StreamPipelineStats StreamPipeline::GetStats() const {
+  StreamPipelineStats stats;
+  stats.num_frames_in = num_frames_in_;
+  stats.num_frames_out = num_frames_out_;
+  for (int i = 0; i < stages_.size(); ++i) {
+    const StageState& state = *states_[i];
+    StreamStageStats stage;
+    stage.name = stages_[i].name;
+    stage.num_frames = state.num_frames;
+    stage.num_rejected = state.num_rejected;
+    stage.num_dropped = state.queue->num_dropped();
+    stage.queue_depth = state.queue->size();
+    stage.max_queue_depth = state.queue->max_size();
+    stage.latency = state.latency.Summarize();
+    stats.stages.push_back(stage);
+  }
+  stats.end_to_end = end_to_end_latency_.Summarize();
+  return stats;
+}
+
+}  // namespace coral
@@ -0,0 +1,171 @@
+#ifndef EDGETPU_CPP_PIPELINE_STREAM_PIPELINE_H_
+#define EDGETPU_CPP_PIPELINE_STREAM_PIPELINE_H_
+
+#include <array>
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "edgetpu/cpp/basic/inference_stats.h"
+#include "edgetpu/cpp/pipeline/bounded_queue.h"
+
+namespace coral {
+
+// Frame of a video stream, which stages of a StreamPipeline fill in turn.
+struct StreamFrame {
+  // Number of the frame in the stream, from 0, set by the pipeline.
+  int64_t id = 0;
+  // When the source returned the frame, set by the pipeline.
+  std::chrono::steady_clock::time_point capture_time;
+  // Image from the source, in height, width, depth order like ImageDims.
+  std::array<int, 3> image_dims = {{0, 0, 0}};
+  std::vector<uint8_t> image;
+  // Input tensor of the model, e.g. the resized image.
+  std::vector<uint8_t> input;
+  // Outputs of the model, as BasicEngine::RunInference() returns them.
+  std::vector<std::vector<float>> outputs;
+};
+
+// Stats of a stage of a StreamPipeline.
+struct StreamStageStats {
+  std::string name;
+  // Frames the stage processed, including those it dropped.
+  int64_t num_frames = 0;
+  // Frames the stage dropped by returning false.
+  int64_t num_rejected = 0;
+  // Frames the queue before the stage dropped to make room.
+  int64_t num_dropped = 0;
+  // Frames waiting in the queue before the stage, now and at most.
+  int queue_depth = 0;
+  int max_queue_depth = 0;
+  // Time the stage took per frame.
+  StageLatency latency;
+};
+
+struct StreamPipelineStats {
+  // Frames the source produced.
+  int64_t num_frames_in = 0;
+  // Frames that went through all stages to the sink.
+  int64_t num_frames_out = 0;
+  std::vector<StreamStageStats> stages;
+  // Time from the source to the sink, for frames out.
+  StageLatency end_to_end;
+
+  // Formats the stats in a line per stage, latencies in milliseconds.
+  std::string ToString() const;
+};
+
+// Runs a video stream through a chain of stages, e.g. preprocess, inference
+// and postprocess, each on its own thread, such that stages work on
+// consecutive frames at the same time.
+//
+// A bounded queue sits before each stage. Under overload, frames should be
+// dropped rather than queued, which would only add latency: by default queues
+// drop their oldest frame to make room, or with
+// BoundedQueue::OverflowPolicy::kKeepLatest all but the newest one. With
+// kBlock, the stage before waits instead, and so does the source in the end.
+//
+// Frames keep their order. Each stage is only called from its own thread, and
+// the sink from that of the last stage.
+//
+// Example, with stages of stream_stages.h:
+//   BasicEngine engine("mobilenet_edgetpu.tflite");
+//   StreamPipeline pipeline(
+//       camera_source,
+//       {{"preprocess", ResizeStage(engine)},
+//        {"inference", InferenceStage(&engine)}},
+//       [](const StreamFrame& frame) {
+//         Show(GetTopClassificationCandidates(frame.outputs[0], 0.5, 1));
+//       });
+//   pipeline.Start();
+//   pipeline.Wait();
+//   LOG(INFO) << pipeline.GetStats().ToString();
+class StreamPipeline {
+ public:
+  using Queue = BoundedQueue<StreamFrame>;
+
+  // Fills `frame` with the next frame of the stream, waiting for it if
+  // needed, e.g. for the camera. Returns false at the end of the stream.
+  using Source = std::function<bool(StreamFrame* frame)>;
+  // Processes `frame` in place. Returns false to drop it.
+  using Stage = std::function<bool(StreamFrame* frame)>;
+  // Consumes frames that went through all stages.
+  using Sink = std::function<void(const StreamFrame& frame)>;
+
+  struct StageOptions {
+    StageOptions(const std::string& name, Stage stage, int queue_size = 1,
+                 Queue::OverflowPolicy overflow_policy =
+                     Queue::OverflowPolicy::kDropOldest)
+        : name(name),
+          stage(std::move(stage)),
+          queue_size(queue_size),
+          overflow_policy(overflow_policy) {}
+
+    // Name in stats and traces.
+    std::string name;
+    Stage stage;
+    // Frames the queue before the stage holds.
+    int queue_size;
+    Queue::OverflowPolicy overflow_policy;
+  };
+
+  // There must be at least one stage.
+  StreamPipeline(Source source, std::vector<StageOptions> stages, Sink sink);
+  // Stops the pipeline.
+  ~StreamPipeline();
+
+  StreamPipeline(const StreamPipeline&) = delete;
+  StreamPipeline& operator=(const StreamPipeline&) = delete;
+
+  // Starts the threads of the source and the stages.
+  void Start();
+
+  // Waits until the stream ends and all frames are through.
+  void Wait();
+
+  // Stops the source, drops frames not through yet, and waits for threads.
+  // Stages finish the frames they are running, but the sink gets no more.
+  void Stop();
+
+  // Can be called while the pipeline runs.
+  StreamPipelineStats GetStats() const;
+
+ private:
+  // Per-stage counters, which GetStats() reads while the stage runs.
+  struct StageState {
+    std::unique_ptr<Queue> queue;
+    std::atomic<int64_t> num_frames{0};
+    std::atomic<int64_t> num_rejected{0};
+    ConcurrentLatencyHistogram latency;
+  };
+
+  // Pushes frames from the source into the first queue until the stream ends
+  // or the pipeline stops.
+  void RunSource();
+
+  // Runs stage `index` on the frames of its queue until it is closed.
+  void RunStage(int index);
+
+  // Joins all threads.
+  void Join();
+
+  Source source_;
+  std::vector<StageOptions> stages_;
+  Sink sink_;
+  std::vector<std::unique_ptr<StageState>> states_;
+  std::vector<std::thread> threads_;
+  std::atomic<bool> stopped_{false};
+  std::atomic<int64_t> num_frames_in_{0};
+  std::atomic<int64_t> num_frames_out_{0};
+  ConcurrentLatencyHistogram end_to_end_latency_;
+};
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_PIPELINE_STREAM_PIPELINE_H_
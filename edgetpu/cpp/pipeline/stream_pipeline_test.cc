@@ -0,0 +1,200 @@
+#include "edgetpu/cpp/pipeline/stream_pipeline.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <future>  // NOLINT
+#include <thread>  // NOLINT
+
+#include "edgetpu/cpp/basic/basic_engine.h"
+#include "edgetpu/cpp/basic/inference_utils.h"
+#include "edgetpu/cpp/pipeline/stream_stages.h"
+#include "edgetpu/cpp/test_utils.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace coral {
+namespace {
+
+using OverflowPolicy = StreamPipeline::Queue::OverflowPolicy;
+
+// Returns `num_frames` empty frames, `interval` apart.
+StreamPipeline::Source CountingSource(int num_frames,
+                                      std::chrono::microseconds interval) {
+  int count = 0;
+  return [num_frames, interval, count](StreamFrame* frame) mutable {
+    if (count++ == num_frames) return false;
+    std::this_thread::sleep_for(interval);
+    return true;
+  };
+}
+
+StreamPipeline::Stage SleepingStage(std::chrono::microseconds duration) {
+  return [duration](StreamFrame* frame) {
+    std::this_thread::sleep_for(duration);
+    return true;
+  };
+}
+
+// Frames in are either out, dropped by a queue, or rejected by a stage.
+void ExpectAllFramesAccountedFor(const StreamPipelineStats& stats) {
+  int64_t num_lost = 0;
+  for (const auto& stage : stats.stages) {
+    num_lost += stage.num_dropped + stage.num_rejected;
+    EXPECT_EQ(0, stage.queue_depth) << stage.name;
+  }
+  EXPECT_EQ(stats.num_frames_in, stats.num_frames_out + num_lost);
+  EXPECT_EQ(stats.num_frames_out, stats.end_to_end.count);
+}
+
+TEST(StreamPipelineTest, BlockingQueuesKeepAllFrames) {
+  constexpr int kNumFrames = 50;
+  std::vector<int64_t> ids;
+  StreamPipeline pipeline(
+      CountingSource(kNumFrames, std::chrono::microseconds(0)),
+      {{"fast", SleepingStage(std::chrono::microseconds(100)), 2,
+        OverflowPolicy::kBlock},
+       {"slow", SleepingStage(std::chrono::microseconds(500)), 2,
+        OverflowPolicy::kBlock}},
+      [&ids](const StreamFrame& frame) { ids.push_back(frame.id); });
+  pipeline.Start();
+  pipeline.Wait();
+  ASSERT_EQ(kNumFrames, ids.size());
+  for (int i = 0; i < kNumFrames; ++i) EXPECT_EQ(i, ids[i]);
+  const StreamPipelineStats stats = pipeline.GetStats();
+  LOG(INFO) << stats.ToString();
+  EXPECT_EQ(kNumFrames, stats.num_frames_in);
+  EXPECT_EQ(kNumFrames, stats.num_frames_out);
+  ASSERT_EQ(2, stats.stages.size());
+  EXPECT_EQ("fast", stats.stages[0].name);
+  EXPECT_EQ(kNumFrames, stats.stages[1].num_frames);
+  EXPECT_LE(stats.stages[1].max_queue_depth, 2);
+  EXPECT_GE(stats.stages[1].latency.p50_us, 500);
+  ExpectAllFramesAccountedFor(stats);
+}
+
+TEST(StreamPipelineTest, DropsStaleFramesUnderOverload) {
+  for (auto policy :
+       {OverflowPolicy::kDropOldest, OverflowPolicy::kKeepLatest}) {
+    SCOPED_TRACE(static_cast<int>(policy));
+    std::vector<int64_t> ids;
+    StreamPipeline pipeline(
+        CountingSource(100, std::chrono::microseconds(200)),
+        {{"slow", SleepingStage(std::chrono::milliseconds(2)), 2, policy}},
+        [&ids](const StreamFrame& frame) { ids.push_back(frame.id); });
+    pipeline.Start();
+    pipeline.Wait();
+    const StreamPipelineStats stats = pipeline.GetStats();
+    LOG(INFO) << stats.ToString();
+    EXPECT_EQ(100, stats.num_frames_in);
+    EXPECT_LT(stats.num_frames_out, 50);
+    EXPECT_GT(stats.stages[0].num_dropped, 0);
+    ExpectAllFramesAccountedFor(stats);
+    // The last frame is never dropped, and frames keep their order.
+    ASSERT_FALSE(ids.empty());
+    EXPECT_EQ(99, ids.back());
+    EXPECT_TRUE(std::is_sorted(ids.begin(), ids.end()));
+    // Frames wait for at most the queue to drain, not for the whole stream.
+    EXPECT_LT(stats.end_to_end.max_us, 20000);
+  }
+}
+
+TEST(StreamPipelineTest, StagesRejectFrames) {
+  std::vector<int64_t> ids;
+  StreamPipeline pipeline(
+      CountingSource(10, std::chrono::microseconds(0)),
+      {{"even", [](StreamFrame* frame) { return frame->id % 2 == 0; }, 1,
+        OverflowPolicy::kBlock}},
+      [&ids](const StreamFrame& frame) { ids.push_back(frame.id); });
+  pipeline.Start();
+  pipeline.Wait();
+  EXPECT_EQ(std::vector<int64_t>({0, 2, 4, 6, 8}), ids);
+  const StreamPipelineStats stats = pipeline.GetStats();
+  EXPECT_EQ(10, stats.stages[0].num_frames);
+  EXPECT_EQ(5, stats.stages[0].num_rejected);
+  ExpectAllFramesAccountedFor(stats);
+}
+
+TEST(StreamPipelineTest, StopsEndlessStreams) {
+  StreamPipeline pipeline(
+      [](StreamFrame* frame) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return true;
+      },
+      {{"stage", SleepingStage(std::chrono::milliseconds(1))}}, nullptr);
+  pipeline.Start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  pipeline.Stop();
+  const StreamPipelineStats stats = pipeline.GetStats();
+  EXPECT_GT(stats.num_frames_out, 0);
+  EXPECT_LE(stats.num_frames_out, stats.num_frames_in);
+}
+
+TEST(StreamPipelineTest, StopDropsQueuedFrames) {
+  std::promise<void> running, release;
+  std::shared_future<void> released = release.get_future().share();
+  bool first = true;
+  int num_frames_out = 0;
+  StreamPipeline pipeline(
+      CountingSource(10, std::chrono::microseconds(0)),
+      {{"stage",
+        [&](StreamFrame* frame) {
+          if (first) {
+            first = false;
+            running.set_value();
+            released.wait();
+          }
+          return true;
+        },
+        4, OverflowPolicy::kBlock}},
+      [&num_frames_out](const StreamFrame& frame) { ++num_frames_out; });
+  pipeline.Start();
+  running.get_future().wait();
+  std::thread stopper([&pipeline] { pipeline.Stop(); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  release.set_value();
+  stopper.join();
+  // The frame of the stage is finished, the queued ones are not.
+  EXPECT_EQ(0, num_frames_out);
+  EXPECT_EQ(1, pipeline.GetStats().stages[0].num_frames);
+}
+
+TEST(StreamPipelineTest, ClassifiesImages) {
+  BasicEngine engine(
+      ModelPath("mobilenet_v1_1.0_224_quant_edgetpu.tflite"));
+  const std::vector<int> shape = engine.get_input_tensor_shape();
+  const ImageDims dims = {shape[1], shape[2], shape[3]};
+  const std::vector<std::string> images = {TestDataPath("cat.bmp"),
+                                           TestDataPath("grace_hopper.bmp")};
+  std::vector<std::vector<std::vector<float>>> expected;
+  for (const auto& image : images) {
+    expected.push_back(engine.RunInference(GetInputFromImage(image, dims)));
+  }
+
+  constexpr int kNumFrames = 10;
+  int num_frames = 0;
+  StreamPipeline pipeline(BmpFileSource(images, kNumFrames, /*fps=*/0),
+                          {{"preprocess", ResizeStage(engine), 2,
+                            OverflowPolicy::kBlock},
+                           {"inference", InferenceStage(&engine), 2,
+                            OverflowPolicy::kBlock}},
+                          [&](const StreamFrame& frame) {
+                            EXPECT_EQ(num_frames, frame.id);
+                            EXPECT_EQ(expected[num_frames % images.size()],
+                                      frame.outputs);
+                            ++num_frames;
+                          });
+  pipeline.Start();
+  pipeline.Wait();
+  EXPECT_EQ(kNumFrames, num_frames);
+  LOG(INFO) << pipeline.GetStats().ToString();
+}
+
+}  // namespace
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,61 @@
+#include "edgetpu/cpp/pipeline/stream_stages.h"
+
+#include <chrono>  // NOLINT
+#include <memory>
+#include <thread>  // NOLINT
+
+#include "edgetpu/cpp/basic/inference_utils.h"
+#include "glog/logging.h"
+
+namespace coral {
+
+StreamPipeline::Source BmpFileSource(
+    const std::vector<std::string>& image_paths, int num_frames, double fps) {
+  CHECK(!image_paths.empty());
+  struct Image {
+    ImageDims dims;
+    std::vector<uint8_t> data;
+  };
+  auto images = std::make_shared<std::vector<Image>>();
+  for (const std::string& path : image_paths) {
+    images->emplace_back();
+    images->back().data = ReadBmp(path, &images->back().dims);
+    CHECK(!images->back().data.empty()) << "Failed to read " << path;
+  }
+  const auto interval = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double>(fps > 0 ? 1 / fps : 0));
+  int index = 0;
+  std::chrono::steady_clock::time_point next_frame_time;
+  return [images, num_frames, interval, index,
+          next_frame_time](StreamFrame* frame) mutable {
+    if (index == num_frames) return false;
+    if (index == 0) next_frame_time = std::chrono::steady_clock::now();
+    std::this_thread::sleep_until(next_frame_time);
+    next_frame_time += interval;
+    const Image& image = (*images)[index++ % images->size()];
+    frame->image_dims = image.dims;
+    frame->image = image.data;
+    return true;
+  };
+}
+
+StreamPipeline::Stage ResizeStage(const BasicEngine& engine) {
+  const std::vector<int> shape = engine.get_input_tensor_shape();
+  CHECK_EQ(4, shape.size());
+  const ImageDims dims = {{shape[1], shape[2], shape[3]}};
+  return [dims](StreamFrame* frame) {
+    frame->input =
+        ResizeImageToDims(frame->image_dims, frame->image.data(), dims);
+    return true;
+  };
+}
+
+StreamPipeline::Stage InferenceStage(BasicEngine* engine) {
+  CHECK(engine);
+  return [engine](StreamFrame* frame) {
+    frame->outputs = engine->RunInference(frame->input);
+    return true;
+  };
+}
+
+}  // namespace coral
@@ -0,0 +1,31 @@
+// Sources and stages of StreamPipeline for the engines of this library.
+
+#ifndef EDGETPU_CPP_PIPELINE_STREAM_STAGES_H_
+#define EDGETPU_CPP_PIPELINE_STREAM_STAGES_H_
+
+#include <string>
+#include <vector>
+
+#include "edgetpu/cpp/basic/basic_engine.h"
+#include "edgetpu/cpp/pipeline/stream_pipeline.h"
+
+namespace coral {
+
+// Returns `num_frames` frames of BMP images `image_paths` in turn, at `fps`
+// frames per second like a camera, or as fast as they are taken if 0.
+// Images are read once, when called.
+StreamPipeline::Source BmpFileSource(
+    const std::vector<std::string>& image_paths, int num_frames, double fps);
+
+// Resizes the image of frames into the input of `engine`, like
+// GetInputFromImage().
+StreamPipeline::Stage ResizeStage(const BasicEngine& engine);
+
+// Runs `engine`, e.g. a ClassificationEngine or DetectionEngine, on the input
+// of frames into their outputs. `engine` must outlive the stage, and be used
+// by no other thread.
+StreamPipeline::Stage InferenceStage(BasicEngine* engine);
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_PIPELINE_STREAM_STAGES_H_
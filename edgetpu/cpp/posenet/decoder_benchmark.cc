@@ -0,0 +1,180 @@
+// Benchmarks the PoseNet decoder on host. Unlike models_benchmark, this does
+// not need an Edge TPU: the decoder inputs are either recorded once from the
+// CPU models, or generated as synthetic crowd scenes.
+#include <chrono>  // NOLINT
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "benchmark/benchmark.h"
+#include "edgetpu/cpp/posenet/decoder_test_utils.h"
+#include "edgetpu/cpp/posenet/posenet_decoder.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DEFINE_string(posenet_model_dir,
+              "knowledge/cerebra/spacepark/darwinn/git/edgetpu/cpp/"
+              "posenet/test_data",
+              "Posenet model directory");
+
+DEFINE_string(posenet_data_dir,
+              "knowledge/cerebra/spacepark/darwinn/git/edgetpu/cpp/"
+              "posenet/test_data",
+              "Posenet test data directory");
+
+namespace coral {
+namespace {
+
+using posenet_decoder_op::DecodeTimings;
+using posenet_decoder_op::PoseKeypoints;
+using posenet_decoder_op::PoseKeypointScores;
+
+constexpr int kStride = 16;
+constexpr int kMaxDetections = 20;
+constexpr float kScoreThreshold = 0.5f;
+constexpr float kNmsRadius = 20.0f;
+constexpr int kRefinementSteps = 5;
+
+// Block grid of the 721x1281 model, the largest one we ship.
+constexpr int kCrowdHeight = 46;
+constexpr int kCrowdWidth = 81;
+
+// Returns the decoder inputs of the CPU model with the given input size on
+// the test image. Recording happens only once per model.
+const DecoderInputs& RecordedInputs(int ysize, int xsize) {
+  static auto* const cache =
+      new std::map<std::pair<int, int>, DecoderInputs>();
+  const auto key = std::make_pair(ysize, xsize);
+  auto it = cache->find(key);
+  if (it == cache->end()) {
+    const std::string model_path =
+        absl::StrCat(FLAGS_posenet_model_dir, "/posenet_mobilenet_v1_075_",
+                     ysize, "_", xsize, "_quant_decoder.tflite");
+    const std::string image_path =
+        absl::StrCat(FLAGS_posenet_data_dir, "/test_image.bmp");
+    it = cache->emplace(key, RecordDecoderInputs(model_path, image_path)).first;
+  }
+  return it->second;
+}
+
+const DecoderInputs& CrowdScene(int num_people) {
+  static auto* const cache = new std::map<int, DecoderInputs>();
+  auto it = cache->find(num_people);
+  if (it == cache->end()) {
+    it = cache
+             ->emplace(num_people,
+                       GenerateCrowdScene(kCrowdHeight, kCrowdWidth, kStride,
+                                          num_people, /*seed=*/num_people,
+                                          /*poses=*/nullptr))
+             .first;
+  }
+  return it->second;
+}
+
+// Runs the decoder through the TF Lite op. Prepare() runs once while
+// allocating tensors, every iteration then runs Eval().
+void RunDecoderOp(const DecoderInputs& inputs, benchmark::State& state) {
+  std::unique_ptr<tflite::Interpreter> interpreter = BuildDecoderInterpreter(
+      inputs, kMaxDetections, kScoreThreshold, kStride, kNmsRadius);
+  SetDecoderInputs(inputs, interpreter.get());
+  while (state.KeepRunning()) {
+    CHECK_EQ(interpreter->Invoke(), kTfLiteOk);
+  }
+  state.counters["num_poses"] =
+      interpreter->typed_output_tensor<float>(3)[0];
+}
+
+// Runs the same work as the op's Eval() with direct calls to Dequantize() and
+// DecodeAllPoses(), and reports the average time of each stage.
+void RunDecodeAllPoses(const DecoderInputs& inputs, benchmark::State& state) {
+  const int height = inputs.height();
+  const int width = inputs.width();
+  std::vector<float> heatmaps(inputs.heatmaps.data.size());
+  std::vector<float> short_offsets(inputs.short_offsets.data.size());
+  std::vector<float> mid_offsets(inputs.mid_offsets.data.size());
+  std::vector<PoseKeypoints> poses(kMaxDetections);
+  std::vector<PoseKeypointScores> keypoint_scores(kMaxDetections);
+  std::vector<float> pose_scores(kMaxDetections);
+
+  double dequantize_ms = 0.0;
+  double candidate_queue_ms = 0.0;
+  double backtrack_ms = 0.0;
+  double nms_ms = 0.0;
+  int num_poses = 0;
+  DecodeTimings timings;
+  while (state.KeepRunning()) {
+    const auto start = std::chrono::steady_clock::now();
+    posenet_decoder_op::Dequantize(
+        inputs.heatmaps.data.data(), heatmaps.size(),
+        inputs.heatmaps.zero_point, inputs.heatmaps.scale, heatmaps.data());
+    posenet_decoder_op::Dequantize(
+        inputs.short_offsets.data.data(), short_offsets.size(),
+        inputs.short_offsets.zero_point,
+        inputs.short_offsets.scale / kStride, short_offsets.data());
+    posenet_decoder_op::Dequantize(
+        inputs.mid_offsets.data.data(), mid_offsets.size(),
+        inputs.mid_offsets.zero_point, inputs.mid_offsets.scale / kStride,
+        mid_offsets.data());
+    dequantize_ms += std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    num_poses = posenet_decoder_op::DecodeAllPoses(
+        heatmaps.data(), short_offsets.data(), mid_offsets.data(), height,
+        width, kMaxDetections, kScoreThreshold, kRefinementSteps,
+        kNmsRadius / kStride, kStride, poses.data(), keypoint_scores.data(),
+        pose_scores.data(), &timings);
+    candidate_queue_ms += timings.candidate_queue_ms;
+    backtrack_ms += timings.backtrack_ms;
+    nms_ms += timings.nms_ms;
+  }
+  state.counters["dequantize_ms"] =
+      benchmark::Counter(dequantize_ms, benchmark::Counter::kAvgIterations);
+  state.counters["candidate_queue_ms"] = benchmark::Counter(
+      candidate_queue_ms, benchmark::Counter::kAvgIterations);
+  state.counters["backtrack_ms"] =
+      benchmark::Counter(backtrack_ms, benchmark::Counter::kAvgIterations);
+  state.counters["nms_ms"] =
+      benchmark::Counter(nms_ms, benchmark::Counter::kAvgIterations);
+  state.counters["num_poses"] = num_poses;
+}
+
+template <int ysize, int xsize>
+static void BM_DecoderOp_Recorded(benchmark::State& state) {
+  RunDecoderOp(RecordedInputs(ysize, xsize), state);
+}
+BENCHMARK_TEMPLATE(BM_DecoderOp_Recorded, 353, 481);
+BENCHMARK_TEMPLATE(BM_DecoderOp_Recorded, 481, 641);
+BENCHMARK_TEMPLATE(BM_DecoderOp_Recorded, 721, 1281);
+
+template <int ysize, int xsize>
+static void BM_DecodeAllPoses_Recorded(benchmark::State& state) {
+  RunDecodeAllPoses(RecordedInputs(ysize, xsize), state);
+}
+BENCHMARK_TEMPLATE(BM_DecodeAllPoses_Recorded, 353, 481);
+BENCHMARK_TEMPLATE(BM_DecodeAllPoses_Recorded, 481, 641);
+BENCHMARK_TEMPLATE(BM_DecodeAllPoses_Recorded, 721, 1281);
+
+// Argument is the number of people in the scene.
+static void BM_DecoderOp_Crowd(benchmark::State& state) {
+  RunDecoderOp(CrowdScene(state.range(0)), state);
+}
+BENCHMARK(BM_DecoderOp_Crowd)->Arg(1)->Arg(5)->Arg(10)->Arg(20);
+
+static void BM_DecodeAllPoses_Crowd(benchmark::State& state) {
+  RunDecodeAllPoses(CrowdScene(state.range(0)), state);
+}
+BENCHMARK(BM_DecodeAllPoses_Crowd)->Arg(1)->Arg(5)->Arg(10)->Arg(20);
+
+}  // namespace
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,173 @@
+// Tests the PoseNet decoder on host, without an Edge TPU.
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "edgetpu/cpp/posenet/decoder_test_utils.h"
+#include "edgetpu/cpp/posenet/posenet_decoder.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+DEFINE_string(posenet_model_dir,
+              "knowledge/cerebra/spacepark/darwinn/git/edgetpu/cpp/"
+              "posenet/test_data",
+              "Posenet model directory");
+
+DEFINE_string(posenet_data_dir,
+              "knowledge/cerebra/spacepark/darwinn/git/edgetpu/cpp/"
+              "posenet/test_data",
+              "Posenet test data directory");
+
+namespace coral {
+namespace {
+
+using posenet_decoder_op::DecodeTimings;
+using posenet_decoder_op::kNumKeypoints;
+using posenet_decoder_op::PoseKeypoints;
+using posenet_decoder_op::PoseKeypointScores;
+
+constexpr int kStride = 16;
+constexpr int kMaxDetections = 20;
+constexpr float kScoreThreshold = 0.5f;
+constexpr float kNmsRadius = 20.0f;
+constexpr int kRefinementSteps = 5;
+
+struct DecodedPoses {
+  int num_poses;
+  std::vector<PoseKeypoints> keypoints;
+  std::vector<PoseKeypointScores> keypoint_scores;
+  std::vector<float> pose_scores;
+};
+
+DecodedPoses DecodeDirectly(const DecoderInputs& inputs,
+                            DecodeTimings* timings) {
+  const std::vector<float> heatmaps =
+      DequantizeDecoderInput(inputs.heatmaps, 1.0f);
+  const std::vector<float> short_offsets =
+      DequantizeDecoderInput(inputs.short_offsets, 1.0f / kStride);
+  const std::vector<float> mid_offsets =
+      DequantizeDecoderInput(inputs.mid_offsets, 1.0f / kStride);
+  DecodedPoses result;
+  result.keypoints.resize(kMaxDetections);
+  result.keypoint_scores.resize(kMaxDetections);
+  result.pose_scores.resize(kMaxDetections);
+  result.num_poses = posenet_decoder_op::DecodeAllPoses(
+      heatmaps.data(), short_offsets.data(), mid_offsets.data(),
+      inputs.height(), inputs.width(), kMaxDetections, kScoreThreshold,
+      kRefinementSteps, kNmsRadius / kStride, kStride, result.keypoints.data(),
+      result.keypoint_scores.data(), result.pose_scores.data(), timings);
+  return result;
+}
+
+DecodedPoses DecodeWithOp(const DecoderInputs& inputs) {
+  std::unique_ptr<tflite::Interpreter> interpreter = BuildDecoderInterpreter(
+      inputs, kMaxDetections, kScoreThreshold, kStride, kNmsRadius);
+  SetDecoderInputs(inputs, interpreter.get());
+  CHECK_EQ(interpreter->Invoke(), kTfLiteOk);
+  DecodedPoses result;
+  const auto* keypoints = reinterpret_cast<const PoseKeypoints*>(
+      interpreter->typed_output_tensor<float>(0));
+  const auto* keypoint_scores = reinterpret_cast<const PoseKeypointScores*>(
+      interpreter->typed_output_tensor<float>(1));
+  const float* pose_scores = interpreter->typed_output_tensor<float>(2);
+  result.num_poses = interpreter->typed_output_tensor<float>(3)[0];
+  result.keypoints.assign(keypoints, keypoints + kMaxDetections);
+  result.keypoint_scores.assign(keypoint_scores,
+                                keypoint_scores + kMaxDetections);
+  result.pose_scores.assign(pose_scores, pose_scores + kMaxDetections);
+  return result;
+}
+
+void ExpectSamePoses(const DecodedPoses& expected,
+                     const DecodedPoses& actual) {
+  ASSERT_EQ(expected.num_poses, actual.num_poses);
+  for (int i = 0; i < expected.num_poses; ++i) {
+    EXPECT_FLOAT_EQ(expected.pose_scores[i], actual.pose_scores[i]);
+    for (int k = 0; k < kNumKeypoints; ++k) {
+      EXPECT_FLOAT_EQ(expected.keypoints[i].keypoint[k].y,
+                      actual.keypoints[i].keypoint[k].y);
+      EXPECT_FLOAT_EQ(expected.keypoints[i].keypoint[k].x,
+                      actual.keypoints[i].keypoint[k].x);
+      EXPECT_FLOAT_EQ(expected.keypoint_scores[i].keypoint[k],
+                      actual.keypoint_scores[i].keypoint[k]);
+    }
+  }
+}
+
+float Distance(const posenet_decoder_op::Point& a,
+               const posenet_decoder_op::Point& b) {
+  return std::hypot(a.y - b.y, a.x - b.x);
+}
+
+TEST(DecoderTest, DecodesSyntheticCrowd) {
+  for (int num_people : {1, 5, 10, 20}) {
+    SCOPED_TRACE(absl::StrCat("num_people: ", num_people));
+    std::vector<PoseKeypoints> expected_poses;
+    const DecoderInputs inputs = GenerateCrowdScene(
+        46, 81, kStride, num_people, /*seed=*/num_people, &expected_poses);
+    const DecodedPoses decoded = DecodeDirectly(inputs, nullptr);
+    ASSERT_EQ(num_people, decoded.num_poses);
+
+    // Every person must be found with all keypoints within half a block.
+    for (const auto& expected : expected_poses) {
+      int best = 0;
+      for (int i = 1; i < decoded.num_poses; ++i) {
+        if (Distance(expected.keypoint[0], decoded.keypoints[i].keypoint[0]) <
+            Distance(expected.keypoint[0],
+                     decoded.keypoints[best].keypoint[0])) {
+          best = i;
+        }
+      }
+      for (int k = 0; k < kNumKeypoints; ++k) {
+        EXPECT_LT(Distance(expected.keypoint[k],
+                           decoded.keypoints[best].keypoint[k]),
+                  kStride / 2.0f)
+            << "keypoint " << k;
+      }
+    }
+  }
+}
+
+TEST(DecoderTest, OpMatchesDecodeAllPoses) {
+  const DecoderInputs inputs =
+      GenerateCrowdScene(23, 31, kStride, /*num_people=*/8, /*seed=*/1,
+                         /*poses=*/nullptr);
+  ExpectSamePoses(DecodeDirectly(inputs, nullptr), DecodeWithOp(inputs));
+}
+
+TEST(DecoderTest, TimingsDoNotChangeResult) {
+  const DecoderInputs inputs =
+      GenerateCrowdScene(46, 81, kStride, /*num_people=*/10, /*seed=*/2,
+                         /*poses=*/nullptr);
+  DecodeTimings timings;
+  timings.candidate_queue_ms = -1.0f;
+  const DecodedPoses timed = DecodeDirectly(inputs, &timings);
+  ExpectSamePoses(DecodeDirectly(inputs, nullptr), timed);
+  EXPECT_GE(timings.candidate_queue_ms, 0.0f);
+  EXPECT_GE(timings.backtrack_ms, 0.0f);
+  EXPECT_GE(timings.nms_ms, 0.0f);
+}
+
+TEST(DecoderTest, RecordedTensors) {
+  const DecoderInputs inputs = RecordDecoderInputs(
+      absl::StrCat(FLAGS_posenet_model_dir,
+                   "/posenet_mobilenet_v1_075_353_481_quant_decoder.tflite"),
+      absl::StrCat(FLAGS_posenet_data_dir, "/test_image.bmp"));
+  EXPECT_EQ(23, inputs.height());
+  EXPECT_EQ(31, inputs.width());
+  const DecodedPoses decoded = DecodeWithOp(inputs);
+  EXPECT_GT(decoded.num_poses, 0);
+  ExpectSamePoses(decoded, DecodeDirectly(inputs, nullptr));
+}
+
+}  // namespace
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
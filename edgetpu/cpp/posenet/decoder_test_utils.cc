@@ -0,0 +1,265 @@
+#include "edgetpu/cpp/posenet/decoder_test_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+
+#include "absl/memory/memory.h"
+#include "edgetpu/cpp/basic/inference_utils.h"
+#include "edgetpu/cpp/posenet/posenet_decoder_op.h"
+#include "flatbuffers/flexbuffers.h"
+#include "glog/logging.h"
+#include "tensorflow/lite/kernels/register.h"
+#include "tensorflow/lite/model.h"
+
+namespace coral {
+namespace {
+
+using posenet_decoder_op::kNumEdges;
+using posenet_decoder_op::kNumKeypoints;
+using posenet_decoder_op::Point;
+using posenet_decoder_op::PoseKeypoints;
+
+// Keypoints of a standing person relative to its center, in block space. The
+// order follows the keypoint ids of the decoder (nose, left eye, right eye,
+// ..., right ankle).
+const Point kPersonTemplate[kNumKeypoints] = {
+    {-3.0f, 0.0f},  {-3.4f, 0.3f},  {-3.4f, -0.3f}, {-3.2f, 0.6f},
+    {-3.2f, -0.6f}, {-2.0f, 1.0f},  {-2.0f, -1.0f}, {-0.5f, 1.4f},
+    {-0.5f, -1.4f}, {0.8f, 1.6f},   {0.8f, -1.6f},  {0.5f, 0.6f},
+    {0.5f, -0.6f},  {2.0f, 0.7f},   {2.0f, -0.7f},  {3.5f, 0.7f},
+    {3.5f, -0.7f}};
+
+// Every person occupies its own slot of the grid, so that no two people get
+// close enough to confuse the decoder.
+constexpr int kSlotHeight = 9;
+constexpr int kSlotWidth = 5;
+
+// Logit of a keypoint right on its location, how fast it decays with the
+// squared distance (in blocks) and the logit of the background.
+constexpr float kPeakLogit = 3.0f;
+constexpr float kLogitDecay = 2.0f;
+constexpr float kBackgroundLogit = -4.0f;
+
+// Quantization used for the generated tensors. Heatmaps cover [-8, 8) and
+// offsets cover [-64, 64) pixels.
+constexpr float kHeatmapsScale = 1.0f / 16;
+constexpr float kOffsetsScale = 0.5f;
+constexpr int kZeroPoint = 128;
+
+uint8_t QuantizeValue(float value, float scale, int zero_point) {
+  const float q = std::round(value / scale + zero_point);
+  return static_cast<uint8_t>(std::max(0.0f, std::min(255.0f, q)));
+}
+
+QuantizedTensor CopyTensor(const TfLiteTensor& tensor) {
+  CHECK_EQ(tensor.type, kTfLiteUInt8);
+  QuantizedTensor result;
+  result.shape.assign(tensor.dims->data, tensor.dims->data + tensor.dims->size);
+  result.data.assign(tensor.data.uint8, tensor.data.uint8 + tensor.bytes);
+  result.scale = tensor.params.scale;
+  result.zero_point = tensor.params.zero_point;
+  return result;
+}
+
+QuantizedTensor CreateTensor(int height, int width, int channels, float scale) {
+  QuantizedTensor result;
+  result.shape = {1, height, width, channels};
+  result.data.assign(height * width * channels, kZeroPoint);
+  result.scale = scale;
+  result.zero_point = kZeroPoint;
+  return result;
+}
+
+TfLiteQuantizationParams QuantizationParams(const QuantizedTensor& tensor) {
+  TfLiteQuantizationParams params;
+  params.scale = tensor.scale;
+  params.zero_point = tensor.zero_point;
+  return params;
+}
+
+}  // namespace
+
+DecoderInputs RecordDecoderInputs(const std::string& model_path,
+                                  const std::string& image_path) {
+  std::unique_ptr<tflite::FlatBufferModel> model =
+      tflite::FlatBufferModel::BuildFromFile(model_path.c_str());
+  CHECK(model) << "Failed to load model " << model_path;
+  tflite::ops::builtin::BuiltinOpResolver resolver;
+  resolver.AddCustom(kPosenetDecoderOp, RegisterPosenetDecoderOp());
+  std::unique_ptr<tflite::Interpreter> interpreter;
+  CHECK_EQ(tflite::InterpreterBuilder(*model, resolver)(&interpreter),
+           kTfLiteOk);
+  interpreter->SetNumThreads(1);
+  CHECK_EQ(interpreter->AllocateTensors(), kTfLiteOk);
+
+  const TfLiteTensor* input = interpreter->tensor(interpreter->inputs()[0]);
+  const ImageDims image_dims = {input->dims->data[1], input->dims->data[2],
+                                input->dims->data[3]};
+  const std::vector<uint8_t> image = GetInputFromImage(image_path, image_dims);
+  CHECK_EQ(image.size(), input->bytes) << "Failed to read " << image_path;
+  std::memcpy(interpreter->typed_input_tensor<uint8_t>(0), image.data(),
+              image.size());
+  CHECK_EQ(interpreter->Invoke(), kTfLiteOk);
+
+  // The decoder is the last op of the graph, so its inputs are still intact
+  // once Invoke() returns.
+  const TfLiteNode& node =
+      interpreter->node_and_registration(interpreter->execution_plan().back())
+          ->first;
+  CHECK_EQ(node.inputs->size, 3) << "Last op of " << model_path
+                                 << " is not the PoseNet decoder.";
+  DecoderInputs result;
+  result.heatmaps = CopyTensor(*interpreter->tensor(node.inputs->data[0]));
+  result.short_offsets = CopyTensor(*interpreter->tensor(node.inputs->data[1]));
+  result.mid_offsets = CopyTensor(*interpreter->tensor(node.inputs->data[2]));
+  return result;
+}
+
+DecoderInputs GenerateCrowdScene(int height, int width, int stride,
+                                 int num_people, int seed,
+                                 std::vector<PoseKeypoints>* poses) {
+  const int slot_rows = height / kSlotHeight;
+  const int slot_cols = width / kSlotWidth;
+  CHECK_LE(num_people, slot_rows * slot_cols)
+      << "Grid of " << height << "x" << width << " is too small for "
+      << num_people << " people.";
+
+  std::mt19937 generator(seed);
+  std::vector<int> slots(slot_rows * slot_cols);
+  for (int i = 0; i < slots.size(); ++i) slots[i] = i;
+  std::shuffle(slots.begin(), slots.end(), generator);
+  std::uniform_real_distribution<float> jitter(-0.5f, 0.5f);
+
+  // Keypoints of all people in block space.
+  std::vector<PoseKeypoints> people(num_people);
+  for (int i = 0; i < num_people; ++i) {
+    const float center_y =
+        (slots[i] / slot_cols) * kSlotHeight + kSlotHeight / 2.0f +
+        jitter(generator);
+    const float center_x =
+        (slots[i] % slot_cols) * kSlotWidth + kSlotWidth / 2.0f +
+        jitter(generator);
+    for (int k = 0; k < kNumKeypoints; ++k) {
+      people[i].keypoint[k].y = center_y + kPersonTemplate[k].y;
+      people[i].keypoint[k].x = center_x + kPersonTemplate[k].x;
+    }
+  }
+
+  DecoderInputs result;
+  result.heatmaps = CreateTensor(height, width, kNumKeypoints, kHeatmapsScale);
+  result.short_offsets =
+      CreateTensor(height, width, 2 * kNumKeypoints, kOffsetsScale);
+  result.mid_offsets =
+      CreateTensor(height, width, 2 * 2 * kNumEdges, kOffsetsScale);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const int cell = y * width + x;
+      for (int k = 0; k < kNumKeypoints; ++k) {
+        // Each cell points to the closest keypoint of its kind.
+        float min_squared_distance = std::numeric_limits<float>::max();
+        Point closest = {static_cast<float>(y), static_cast<float>(x)};
+        for (const auto& person : people) {
+          const float dy = person.keypoint[k].y - y;
+          const float dx = person.keypoint[k].x - x;
+          const float squared_distance = dy * dy + dx * dx;
+          if (squared_distance < min_squared_distance) {
+            min_squared_distance = squared_distance;
+            closest = person.keypoint[k];
+          }
+        }
+        const float logit = std::max(
+            kBackgroundLogit, kPeakLogit - kLogitDecay * min_squared_distance);
+        result.heatmaps.data[cell * kNumKeypoints + k] =
+            QuantizeValue(logit, kHeatmapsScale, kZeroPoint);
+        uint8_t* offsets = &result.short_offsets.data[cell * 2 * kNumKeypoints];
+        offsets[k] =
+            QuantizeValue((closest.y - y) * stride, kOffsetsScale, kZeroPoint);
+        offsets[kNumKeypoints + k] =
+            QuantizeValue((closest.x - x) * stride, kOffsetsScale, kZeroPoint);
+      }
+    }
+  }
+
+  if (poses) {
+    poses->resize(num_people);
+    for (int i = 0; i < num_people; ++i) {
+      for (int k = 0; k < kNumKeypoints; ++k) {
+        (*poses)[i].keypoint[k].y = people[i].keypoint[k].y * stride;
+        (*poses)[i].keypoint[k].x = people[i].keypoint[k].x * stride;
+      }
+    }
+  }
+  return result;
+}
+
+std::vector<float> DequantizeDecoderInput(const QuantizedTensor& tensor,
+                                          float extra_scale) {
+  std::vector<float> result(tensor.data.size());
+  posenet_decoder_op::Dequantize(
+      tensor.data.data(), tensor.data.size(),
+      static_cast<float>(tensor.zero_point), tensor.scale * extra_scale,
+      result.data());
+  return result;
+}
+
+std::unique_ptr<tflite::Interpreter> BuildDecoderInterpreter(
+    const DecoderInputs& inputs, int max_detections, float score_threshold,
+    int stride, float nms_radius) {
+  auto interpreter = absl::make_unique<tflite::Interpreter>();
+  CHECK_EQ(interpreter->AddTensors(7), kTfLiteOk);
+  CHECK_EQ(interpreter->SetInputs({0, 1, 2}), kTfLiteOk);
+  CHECK_EQ(interpreter->SetOutputs({3, 4, 5, 6}), kTfLiteOk);
+
+  const QuantizedTensor* input_tensors[] = {
+      &inputs.heatmaps, &inputs.short_offsets, &inputs.mid_offsets};
+  const char* input_names[] = {"heatmaps", "short_offsets", "mid_offsets"};
+  for (int i = 0; i < 3; ++i) {
+    CHECK_EQ(interpreter->SetTensorParametersReadWrite(
+                 i, kTfLiteUInt8, input_names[i], input_tensors[i]->shape,
+                 QuantizationParams(*input_tensors[i])),
+             kTfLiteOk);
+  }
+  // Output shapes are set by the op in Prepare().
+  const char* output_names[] = {"poses", "keypoint_scores", "pose_scores",
+                                "num_poses"};
+  for (int i = 0; i < 4; ++i) {
+    CHECK_EQ(interpreter->SetTensorParametersReadWrite(
+                 3 + i, kTfLiteFloat32, output_names[i], {1},
+                 TfLiteQuantizationParams()),
+             kTfLiteOk);
+  }
+
+  flexbuffers::Builder fbb;
+  fbb.Map([&]() {
+    fbb.Int("max_detections", max_detections);
+    fbb.Float("score_threshold", score_threshold);
+    fbb.Int("stride", stride);
+    fbb.Float("nms_radius", nms_radius);
+  });
+  fbb.Finish();
+  const std::vector<uint8_t>& options = fbb.GetBuffer();
+  CHECK_EQ(interpreter->AddNodeWithParameters(
+               {0, 1, 2}, {3, 4, 5, 6},
+               reinterpret_cast<const char*>(options.data()), options.size(),
+               /*builtin_data=*/nullptr, RegisterPosenetDecoderOp()),
+           kTfLiteOk);
+  CHECK_EQ(interpreter->AllocateTensors(), kTfLiteOk);
+  return interpreter;
+}
+
+void SetDecoderInputs(const DecoderInputs& inputs,
+                      tflite::Interpreter* interpreter) {
+  const QuantizedTensor* input_tensors[] = {
+      &inputs.heatmaps, &inputs.short_offsets, &inputs.mid_offsets};
+  for (int i = 0; i < 3; ++i) {
+    TfLiteTensor* tensor = interpreter->tensor(interpreter->inputs()[i]);
+    CHECK_EQ(tensor->bytes, input_tensors[i]->data.size());
+    std::memcpy(tensor->data.uint8, input_tensors[i]->data.data(),
+                tensor->bytes);
+  }
+}
+
+}  // namespace coral
@@ -0,0 +1,69 @@
+// Utilities to exercise the PoseNet decoder on host, without an Edge TPU.
+
+#ifndef EDGETPU_CPP_POSENET_DECODER_TEST_UTILS_H_
+#define EDGETPU_CPP_POSENET_DECODER_TEST_UTILS_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "edgetpu/cpp/posenet/posenet_decoder.h"
+#include "tensorflow/lite/interpreter.h"
+
+namespace coral {
+
+// A uint8 tensor together with its quantization parameters.
+struct QuantizedTensor {
+  // In [1, height, width, channels] order.
+  std::vector<int> shape;
+  std::vector<uint8_t> data;
+  float scale = 1.0f;
+  int zero_point = 0;
+};
+
+// The three inputs of the PoseNet decoder op. Offsets are in pixels, as
+// produced by the network.
+struct DecoderInputs {
+  QuantizedTensor heatmaps;
+  QuantizedTensor short_offsets;
+  QuantizedTensor mid_offsets;
+
+  int height() const { return heatmaps.shape[1]; }
+  int width() const { return heatmaps.shape[2]; }
+};
+
+// Runs the CPU (non Edge TPU) PoseNet model at `model_path` on the image at
+// `image_path` and returns the tensors fed into its decoder op.
+DecoderInputs RecordDecoderInputs(const std::string& model_path,
+                                  const std::string& image_path);
+
+// Generates decoder inputs of a synthetic scene with `num_people` standing
+// people placed on a `height` x `width` block grid. Placement is random but
+// fully determined by `seed`, and people never overlap. Ground truth
+// keypoints are returned in pixel space if `poses` is not null.
+//
+// Mid offsets are left at zero: keypoints are located by the short offsets
+// alone, which is enough to drive every stage of the decoder.
+DecoderInputs GenerateCrowdScene(
+    int height, int width, int stride, int num_people, int seed,
+    std::vector<posenet_decoder_op::PoseKeypoints>* poses);
+
+// Dequantizes `tensor` the same way the decoder op does. `extra_scale` is
+// applied on top of the tensor scale, e.g. 1 / stride for the offsets.
+std::vector<float> DequantizeDecoderInput(const QuantizedTensor& tensor,
+                                          float extra_scale);
+
+// Builds an interpreter holding a single PoseNet decoder op whose inputs have
+// the shapes and quantization of `inputs`, and allocates its tensors.
+std::unique_ptr<tflite::Interpreter> BuildDecoderInterpreter(
+    const DecoderInputs& inputs, int max_detections, float score_threshold,
+    int stride, float nms_radius);
+
+// Copies `inputs` into the input tensors of `interpreter`.
+void SetDecoderInputs(const DecoderInputs& inputs,
+                      tflite::Interpreter* interpreter);
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_POSENET_DECODER_TEST_UTILS_H_
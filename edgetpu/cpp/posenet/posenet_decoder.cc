@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>  // NOLINT
 #include <cmath>
 #include <numeric>
 #include <ostream>
@@ -11,6 +12,7 @@
 namespace coral {
 namespace {
 
+using posenet_decoder_op::DecodeTimings;
 using posenet_decoder_op::kNumKeypoints;
 using posenet_decoder_op::Point;
 using posenet_decoder_op::PoseKeypoints;
@@ -157,6 +159,13 @@ float ComputeSquaredDistance(const Point& a, const Point& b) {
   return dy * dy + dx * dx;
 }
 
+// Returns the time elapsed since `start` in milliseconds.
+float MillisecondsSince(const std::chrono::steady_clock::time_point& start) {
+  return std::chrono::duration<float, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
 // Computes the sigmoid of the input. The output is in (0, 1).
 float Sigmoid(const float x) { return 1.0f / (1.0f + std::exp(-x)); }
 
@@ -447,6 +456,13 @@ void PerformSoftKeypointNMS(const std::vector<int>& decreasing_indices,
 
 namespace posenet_decoder_op {
 
+void Dequantize(const uint8_t* src, const int size, const float zero_point,
+                const float scale, float* dst) {
+  for (int i = 0; i < size; ++i) {
+    dst[i] = (src[i] - zero_point) * scale;
+  }
+}
+
 int DecodeAllPoses(const float* scores, const float* short_offsets,
                    const float* mid_offsets, const int height, const int width,
                    const int max_detections, const float score_threshold,
@@ -454,9 +470,17 @@ int DecodeAllPoses(const float* scores, const float* short_offsets,
                    const float nms_radius, const int stride,
                    PoseKeypoints* pose_keypoints,
                    PoseKeypointScores* pose_keypoint_scores,
-                   float* pose_scores) {
+                   float* pose_scores, DecodeTimings* timings) {
   static const int kLocalMaximumRadius = 1;
 
+  // Stage timings are only collected on request, to keep the clock reads out
+  // of the regular inference path.
+  std::chrono::steady_clock::time_point stage_start;
+  if (timings) {
+    *timings = DecodeTimings();
+    stage_start = std::chrono::steady_clock::now();
+  }
+
   // score_threshold threshold as a logit, before sigmoid
   const float min_score_logit =
       -std::log(1.0f / (score_threshold + 0.000001) - 1);
@@ -465,6 +489,7 @@ int DecodeAllPoses(const float* scores, const float* short_offsets,
   BuildKeypointWithScoreQueue(scores, short_offsets, height, width,
                               kNumKeypoints, min_score_logit,
                               kLocalMaximumRadius, &queue);
+  if (timings) timings->candidate_queue_ms = MillisecondsSince(stage_start);
   // TODO This is really a constant, better if we could do this list
   // building just once?
   AdjacencyList adjacency_list = BuildAdjacencyList();
@@ -488,10 +513,14 @@ int DecodeAllPoses(const float* scores, const float* short_offsets,
 
     // Reject a root candidate if it is within a disk of `nms_radius` pixels
     // from the corresponding part of a previously detected instance.
-    if (!PassKeypointNMS(scratch_poses.data(), pose_counter, root,
-                         nms_radius * nms_radius)) {
-      continue;
+    if (timings) stage_start = std::chrono::steady_clock::now();
+    const bool pass_nms = PassKeypointNMS(scratch_poses.data(), pose_counter,
+                                          root, nms_radius * nms_radius);
+    if (timings) {
+      timings->nms_ms += MillisecondsSince(stage_start);
+      stage_start = std::chrono::steady_clock::now();
     }
+    if (!pass_nms) continue;
 
     auto next_pose = &scratch_poses[pose_counter];
     auto next_scores = &scratch_keypoint_scores[pose_counter];
@@ -522,8 +551,11 @@ int DecodeAllPoses(const float* scores, const float* short_offsets,
       pose_counter++;
       all_instance_scores.push_back(instance_score);
     }
+    if (timings) timings->backtrack_ms += MillisecondsSince(stage_start);
   }
 
+  if (timings) stage_start = std::chrono::steady_clock::now();
+
   // Sort the detections in decreasing order of their instance-level scores.
   std::vector<int> decreasing_indices;
   DecreasingArgSort(all_instance_scores, &decreasing_indices);
@@ -537,6 +569,7 @@ int DecodeAllPoses(const float* scores, const float* short_offsets,
   // Sort the detections in decreasing order of their final instance-level
   // scores. Usually the order does not change but this is not guaranteed.
   DecreasingArgSort(all_instance_scores, &decreasing_indices);
+  if (timings) timings->nms_ms += MillisecondsSince(stage_start);
 
   pose_counter = 0;
   for (size_t index : decreasing_indices) {
@@ -1,6 +1,8 @@
 #ifndef EDGETPU_CPP_POSENET_POSENET_DECODER_H_
 #define EDGETPU_CPP_POSENET_POSENET_DECODER_H_
 
+#include <cstdint>
+
 namespace coral {
 namespace posenet_decoder_op {
 
@@ -23,6 +25,21 @@ struct PoseKeypointScores {
   float keypoint[posenet_decoder_op::kNumKeypoints];
 };
 
+// Wall time spent in each stage of DecodeAllPoses(), in milliseconds.
+struct DecodeTimings {
+  // Building the queue of local maxima that serve as root candidates.
+  float candidate_queue_ms = 0.0f;
+  // Following mid and short offsets from the roots to all other keypoints.
+  float backtrack_ms = 0.0f;
+  // Root rejection plus keypoint-level soft NMS and rescoring.
+  float nms_ms = 0.0f;
+};
+
+// Dequantizes `size` uint8 values from `src` into `dst`, computing
+// (src[i] - zero_point) * scale.
+void Dequantize(const uint8_t* src, int size, float zero_point, float scale,
+                float* dst);
+
 // Decodes poses from the score map, the short and mid offsets.
 // "Block space" refers to the output y and z size of the network.
 // For example if the network that takes a (353,481) (y,x) input image will have
@@ -60,8 +77,10 @@ int DecodeAllPoses(
         pose_keypoint_scores,  // pointer to preallocated buffer
                                // of size
                                // [max_detections*sizeof(PoseKeypointScores)]
-    float* pose_scores         // pointer to preallocated buffer of size
+    float* pose_scores,        // pointer to preallocated buffer of size
                                // [max_detections*sizeof(float)]
+    DecodeTimings* timings = nullptr  // if not null, filled with the time
+                                      // spent in each decoding stage
 );
 
 }  // namespace posenet_decoder_op
@@ -5,6 +5,7 @@
 #include <string>
 
 #include "edgetpu/cpp/posenet/posenet_decoder.h"
+#include "edgetpu/cpp/tracing.h"
 #include "flatbuffers/flexbuffers.h"
 #include "tensorflow/lite/kernels/internal/tensor.h"
 #include "tensorflow/lite/kernels/kernel_util.h"
@@ -88,9 +89,7 @@ void DequantizeTensor(TfLiteContext* context, const TfLiteTensor* src,
   assert(src_data != nullptr);
   float* dst_data = GetTensorData<float>(dst);
   assert(dst_data != nullptr);
-  for (int idx = 0; idx < num_elements; ++idx) {
-    dst_data[idx] = (src_data[idx] - quant_zero_point) * quant_scale;
-  }
+  Dequantize(src_data, num_elements, quant_zero_point, quant_scale, dst_data);
 }
 
 TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
@@ -167,6 +166,7 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
 }
 
 TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
+  CORAL_TRACE_SPAN("PosenetDecode");
   auto* op_data = reinterpret_cast<OpData*>(node->user_data);
 
   const TfLiteTensor* heatmaps = GetInput(context, node, kInputTensorHeatmaps);
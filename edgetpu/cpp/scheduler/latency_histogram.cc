@@ -0,0 +1,78 @@
+#include "edgetpu/cpp/scheduler/latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include "edgetpu/cpp/histogram_buckets.h"
+#include "glog/logging.h"
+
+namespace coral {
+
+LatencyHistogram::LatencyHistogram(int64_t max_value, int precision_bits)
+    : max_value_(max_value), precision_bits_(precision_bits) {
+  CHECK_GT(max_value_, 0);
+  CHECK_GE(precision_bits_, 1);
+  CHECK_LE(precision_bits_, 20);
+  buckets_.resize(HistogramBucketIndex(max_value_, precision_bits_) + 1);
+}
+
+void LatencyHistogram::Record(int64_t value) {
+  value = std::min(std::max(value, int64_t{0}), max_value_);
+  ++buckets_[HistogramBucketIndex(value, precision_bits_)];
+  min_ = count_ ? std::min(min_, value) : value;
+  max_ = std::max(max_, value);
+  sum_ += value;
+  ++count_;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  CHECK_EQ(max_value_, other.max_value_);
+  CHECK_EQ(precision_bits_, other.precision_bits_);
+  if (!other.count_) return;
+  for (int i = 0; i < buckets_.size(); ++i) buckets_[i] += other.buckets_[i];
+  min_ = count_ ? std::min(min_, other.min_) : other.min_;
+  max_ = std::max(max_, other.max_);
+  sum_ += other.sum_;
+  count_ += other.count_;
+}
+
+void LatencyHistogram::Reset() {
+  std::fill(buckets_.begin(), buckets_.end(), 0);
+  count_ = 0;
+  min_ = 0;
+  max_ = 0;
+  sum_ = 0;
+}
+
+double LatencyHistogram::mean() const { return count_ ? sum_ / count_ : 0; }
+
+int64_t LatencyHistogram::Percentile(double percentile) const {
+  if (!count_) return 0;
+  const int64_t rank = std::max<int64_t>(
+      1, static_cast<int64_t>(std::ceil(percentile / 100 * count_)));
+  int64_t seen = 0;
+  for (int i = 0; i < buckets_.size(); ++i) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      return std::max(
+          min(),
+          std::min(HistogramBucketMaxValue(i, precision_bits_), max_));
+    }
+  }
+  return max_;
+}
+
+std::string LatencyHistogram::Summary(double scale) const {
+  char summary[256];
+  std::snprintf(summary, sizeof(summary),
+                "count %lld mean %.3f p50 %.3f p90 %.3f p99 %.3f p99.9 %.3f "
+                "max %.3f",
+                static_cast<long long>(count_), mean() / scale,  // NOLINT
+                Percentile(50) / scale, Percentile(90) / scale,
+                Percentile(99) / scale, Percentile(99.9) / scale,
+                max() / scale);
+  return summary;
+}
+
+}  // namespace coral
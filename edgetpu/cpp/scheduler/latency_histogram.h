@@ -0,0 +1,58 @@
+#ifndef EDGETPU_CPP_SCHEDULER_LATENCY_HISTOGRAM_H_
+#define EDGETPU_CPP_SCHEDULER_LATENCY_HISTOGRAM_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace coral {
+
+// Histogram of non-negative integer values, e.g. latencies in microseconds,
+// with a bounded relative error, like HdrHistogram. Values below
+// 2^`precision_bits` are recorded exactly, larger ones in buckets whose width
+// is below 2^-(`precision_bits` - 1) of their values, so that percentiles of
+// values spanning many orders of magnitude take a few KB.
+//
+// This class is not thread-safe: record from one thread, or into one histogram
+// per thread and Merge() them.
+class LatencyHistogram {
+ public:
+  // Values above `max_value` are recorded as `max_value`.
+  explicit LatencyHistogram(int64_t max_value = 3600LL * 1000 * 1000,
+                            int precision_bits = 7);
+
+  void Record(int64_t value);
+
+  // Adds the values of `other`, which must have the same parameters.
+  void Merge(const LatencyHistogram& other);
+
+  void Reset();
+
+  int64_t count() const { return count_; }
+  // Exact minimum and maximum, 0 if empty.
+  int64_t min() const { return count_ ? min_ : 0; }
+  int64_t max() const { return max_; }
+  double mean() const;
+
+  // Returns the smallest value that `percentile` percent of the values are at
+  // most, up to the precision of the histogram, e.g. Percentile(99.9). 0 if
+  // empty.
+  int64_t Percentile(double percentile) const;
+
+  // Formats count, mean and usual percentiles, with values divided by `scale`,
+  // e.g. 1000 to print microseconds as milliseconds.
+  std::string Summary(double scale = 1) const;
+
+ private:
+  const int64_t max_value_;
+  const int precision_bits_;
+  std::vector<int64_t> buckets_;
+  int64_t count_ = 0;
+  int64_t min_ = 0;
+  int64_t max_ = 0;
+  double sum_ = 0;
+};
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_SCHEDULER_LATENCY_HISTOGRAM_H_
@@ -0,0 +1,109 @@
+#include "edgetpu/cpp/scheduler/latency_histogram.h"
+
+#include <cmath>
+#include <random>
+
+#include "gflags/gflags.h"
+#include "gtest/gtest.h"
+
+namespace coral {
+namespace {
+
+TEST(LatencyHistogramTest, Empty) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0, histogram.count());
+  EXPECT_EQ(0, histogram.min());
+  EXPECT_EQ(0, histogram.max());
+  EXPECT_EQ(0, histogram.mean());
+  EXPECT_EQ(0, histogram.Percentile(50));
+}
+
+TEST(LatencyHistogramTest, SmallValuesAreExact) {
+  LatencyHistogram histogram(/*max_value=*/1000000, /*precision_bits=*/7);
+  for (int i = 1; i <= 100; ++i) histogram.Record(i);
+  EXPECT_EQ(100, histogram.count());
+  EXPECT_EQ(1, histogram.min());
+  EXPECT_EQ(100, histogram.max());
+  EXPECT_DOUBLE_EQ(50.5, histogram.mean());
+  EXPECT_EQ(1, histogram.Percentile(0));
+  EXPECT_EQ(50, histogram.Percentile(50));
+  EXPECT_EQ(90, histogram.Percentile(90));
+  EXPECT_EQ(99, histogram.Percentile(99));
+  EXPECT_EQ(100, histogram.Percentile(99.9));
+  EXPECT_EQ(100, histogram.Percentile(100));
+}
+
+TEST(LatencyHistogramTest, BoundedRelativeError) {
+  const int kPrecisionBits = 7;
+  LatencyHistogram histogram(/*max_value=*/int64_t{1} << 40, kPrecisionBits);
+  std::mt19937 generator(1);
+  std::uniform_real_distribution<double> exponent(0, 36);
+  for (int i = 0; i < 1000; ++i) {
+    const int64_t value = std::pow(2.0, exponent(generator));
+    histogram.Reset();
+    histogram.Record(1);
+    histogram.Record(value);
+    histogram.Record(int64_t{1} << 38);
+    const int64_t median = histogram.Percentile(50);
+    EXPECT_GE(median, value);
+    EXPECT_LE(median - value, value >> (kPrecisionBits - 1)) << value;
+  }
+}
+
+TEST(LatencyHistogramTest, Percentiles) {
+  LatencyHistogram histogram;
+  // 1 ms most of the time, 10 ms for 1 in 100, 100 ms for 1 in 1000.
+  for (int i = 0; i < 100000; ++i) {
+    histogram.Record(i % 1000 == 0 ? 100000 : i % 100 == 1 ? 10000 : 1000);
+  }
+  EXPECT_NEAR(1000, histogram.Percentile(50), 1000 / 64);
+  EXPECT_NEAR(1000, histogram.Percentile(98.8), 1000 / 64);
+  EXPECT_NEAR(10000, histogram.Percentile(99.5), 10000 / 64);
+  EXPECT_NEAR(100000, histogram.Percentile(99.95), 100000 / 64);
+  EXPECT_EQ(100000, histogram.max());
+}
+
+TEST(LatencyHistogramTest, ClampsValues) {
+  LatencyHistogram histogram(/*max_value=*/1000);
+  histogram.Record(-5);
+  histogram.Record(5000);
+  EXPECT_EQ(0, histogram.min());
+  EXPECT_EQ(1000, histogram.max());
+  EXPECT_EQ(1000, histogram.Percentile(100));
+}
+
+TEST(LatencyHistogramTest, Merge) {
+  LatencyHistogram a, b, both;
+  for (int i = 0; i < 1000; ++i) {
+    a.Record(i * 10);
+    b.Record(i * 37 + 5);
+    both.Record(i * 10);
+    both.Record(i * 37 + 5);
+  }
+  a.Merge(b);
+  EXPECT_EQ(both.count(), a.count());
+  EXPECT_EQ(both.min(), a.min());
+  EXPECT_EQ(both.max(), a.max());
+  EXPECT_DOUBLE_EQ(both.mean(), a.mean());
+  for (const double percentile : {1.0, 50.0, 90.0, 99.0, 99.9}) {
+    EXPECT_EQ(both.Percentile(percentile), a.Percentile(percentile));
+  }
+}
+
+TEST(LatencyHistogramTest, Summary) {
+  LatencyHistogram histogram;
+  histogram.Record(1500);
+  EXPECT_EQ(
+      "count 1 mean 1.500 p50 1.500 p90 1.500 p99 1.500 p99.9 1.500 "
+      "max 1.500",
+      histogram.Summary(1000));
+}
+
+}  // namespace
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
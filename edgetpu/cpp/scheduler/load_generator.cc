@@ -0,0 +1,317 @@
+// Open-loop load generator, which reports latency percentiles and achieved
+// throughput of Edge TPU models for a sweep of offered loads.
+//
+// Unlike a loop of back-to-back inferences, requests arrive at a target rate,
+// at constant intervals or as a Poisson process, regardless of how fast
+// earlier ones complete. Latency is measured from the time a request was due,
+// so that it includes queueing when the models can't keep up, instead of
+// hiding it by sending less.
+//
+// For example, to compare a pool of Edge TPUs with a single one shared by two
+// models:
+//   load_generator --target=pool --rates=50,100,200 \
+//       --model_names=mobilenet_v1_1.0_224_quant_edgetpu.tflite,\
+//   inception_v1_224_quant_edgetpu.tflite
+//   load_generator --target=scheduler --rates=50,100,200 --model_names=...
+//
+// With --simulated_edgetpus, this runs without Edge TPUs, e.g. on CI machines.
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <random>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "edgetpu/cpp/basic/basic_engine.h"
+#include "edgetpu/cpp/basic/simulated_edgetpu_manager.h"
+#include "edgetpu/cpp/pipeline/bounded_queue.h"
+#include "edgetpu/cpp/scheduler/latency_histogram.h"
+#include "edgetpu/cpp/scheduler/model_scheduler.h"
+#include "edgetpu/cpp/scheduler/placement_planner.h"
+#include "edgetpu/cpp/test_utils.h"
+#include "edgetpu/cpp/tracing.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DEFINE_string(model_names, "mobilenet_v1_1.0_224_quant_edgetpu.tflite",
+              "Comma-separated models in the test data directory, which get "
+              "requests in turn.");
+DEFINE_string(target, "engines",
+              "What serves the requests: `engines`, a BasicEngine per model; "
+              "`pool`, a PlacedModelPool over all Edge TPUs; or `scheduler`, "
+              "a ModelScheduler of models sharing one Edge TPU.");
+DEFINE_string(arrivals, "poisson",
+              "Arrivals of requests: `constant` intervals or `poisson`.");
+DEFINE_string(rates, "10,20,50,100,200",
+              "Comma-separated offered loads to sweep, in requests per "
+              "second.");
+DEFINE_double(duration_s, 10, "Seconds of requests per offered load.");
+DEFINE_int32(seed, 1, "Seed of Poisson arrivals.");
+DEFINE_int32(simulated_edgetpus, 0,
+             "If positive, runs on that many simulated Edge TPUs instead of "
+             "the connected ones, see SimulatedEdgeTpuManager.");
+DEFINE_double(simulated_latency_ms, 5,
+              "Time simulated Edge TPUs take per inference, on top of the CPU "
+              "model.");
+DEFINE_double(simulated_jitter_ms, 0.5,
+              "Standard deviation of the time of simulated inferences.");
+DEFINE_double(simulated_reload_mb_per_s, 100,
+              "Speed at which simulated Edge TPUs reload parameters, in MB "
+              "per second.");
+DEFINE_string(trace_file, "",
+              "If set, writes a Chrome trace of the loads, after warm-up, to "
+              "this file.");
+
+namespace coral {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Runs requests of models, calling `done` from any thread once the request
+// completed.
+class Target {
+ public:
+  virtual ~Target() = default;
+  virtual void Submit(int model_index, std::function<void()> done) = 0;
+};
+
+// Runs requests of each model in a thread of its own, with a function that
+// blocks until the inference completed.
+class SyncTarget : public Target {
+ public:
+  explicit SyncTarget(std::vector<std::function<void()>> runs) {
+    for (auto& run : runs) {
+      auto queue = absl::make_unique<BoundedQueue<std::function<void()>>>(
+          kQueueCapacity);
+      auto* queue_ptr = queue.get();
+      queues_.push_back(std::move(queue));
+      workers_.emplace_back([queue_ptr, run] {
+        std::function<void()> done;
+        while (queue_ptr->Pop(&done)) {
+          run();
+          done();
+        }
+      });
+    }
+  }
+
+  ~SyncTarget() override {
+    for (auto& queue : queues_) queue->Close();
+    for (auto& worker : workers_) worker.join();
+  }
+
+  void Submit(int model_index, std::function<void()> done) override {
+    CHECK(queues_[model_index]->Push(std::move(done)));
+  }
+
+ private:
+  // Large enough not to block arrivals.
+  static constexpr int kQueueCapacity = 1 << 20;
+
+  std::vector<std::unique_ptr<BoundedQueue<std::function<void()>>>> queues_;
+  std::vector<std::thread> workers_;
+};
+
+class SchedulerTarget : public Target {
+ public:
+  SchedulerTarget(std::unique_ptr<ModelScheduler> scheduler,
+                  std::vector<std::vector<uint8_t>> inputs)
+      : scheduler_(std::move(scheduler)), inputs_(std::move(inputs)) {}
+
+  void Submit(int model_index, std::function<void()> done) override {
+    CHECK_EQ(kEdgeTpuApiOk,
+             scheduler_->Submit(
+                 model_index, inputs_[model_index],
+                 [done](EdgeTpuApiStatus status,
+                        std::vector<std::vector<float>> outputs) {
+                   CHECK_EQ(kEdgeTpuApiOk, status);
+                   done();
+                 }))
+        << scheduler_->get_error_message();
+  }
+
+ private:
+  std::unique_ptr<ModelScheduler> scheduler_;
+  std::vector<std::vector<uint8_t>> inputs_;
+};
+
+std::unique_ptr<Target> MakeEnginesTarget(
+    const std::vector<std::string>& model_paths) {
+  std::vector<std::function<void()>> runs;
+  for (const auto& model_path : model_paths) {
+    std::shared_ptr<BasicEngine> engine =
+        std::make_shared<BasicEngine>(model_path);
+    const auto input = GetRandomInput(engine->get_input_tensor_shape());
+    runs.push_back([engine, input] { engine->RunInference(input); });
+  }
+  return absl::make_unique<SyncTarget>(std::move(runs));
+}
+
+std::unique_ptr<Target> MakePoolTarget(
+    const std::vector<std::string>& model_paths) {
+  PlacedModelPoolBuilder builder(model_paths);
+  std::unique_ptr<PlacedModelPool> unique_pool;
+  CHECK_EQ(kEdgeTpuApiOk, builder(&unique_pool)) << builder.get_error_message();
+  std::shared_ptr<PlacedModelPool> pool(std::move(unique_pool));
+  std::vector<std::function<void()>> runs;
+  for (int i = 0; i < model_paths.size(); ++i) {
+    LOG(INFO) << model_paths[i] << " runs on " << pool->device_path(i);
+    const auto input =
+        GetRandomInput(BasicEngine(model_paths[i], pool->device_path(i))
+                           .get_input_tensor_shape());
+    runs.push_back([pool, i, input] {
+      std::vector<std::vector<float>> outputs;
+      CHECK_EQ(kEdgeTpuApiOk, pool->RunInference(i, input, &outputs))
+          << pool->get_error_message();
+    });
+  }
+  return absl::make_unique<SyncTarget>(std::move(runs));
+}
+
+std::unique_ptr<Target> MakeSchedulerTarget(
+    const std::vector<std::string>& model_paths) {
+  ModelSchedulerBuilder builder(model_paths, ModelSchedulerOptions());
+  std::unique_ptr<ModelScheduler> scheduler;
+  CHECK_EQ(kEdgeTpuApiOk, builder(&scheduler)) << builder.get_error_message();
+  std::vector<std::vector<uint8_t>> inputs;
+  for (int i = 0; i < model_paths.size(); ++i) {
+    inputs.push_back(GetRandomInput(scheduler->get_input_size(i)));
+  }
+  return absl::make_unique<SchedulerTarget>(std::move(scheduler),
+                                            std::move(inputs));
+}
+
+struct LoadResult {
+  LatencyHistogram latencies_us;
+  // Completed requests per second, from the first arrival to the last
+  // completion.
+  double throughput = 0;
+};
+
+// Sends requests to models 0, 1, ..., `num_models` - 1 in turn at `rate` per
+// second for `duration_s` seconds, then waits for all of them to complete.
+LoadResult RunLoad(Target* target, int num_models, double rate, bool poisson,
+                   double duration_s, std::mt19937* generator) {
+  LoadResult result;
+  std::mutex mutex;
+  std::condition_variable all_done;
+  int64_t num_pending = 0;
+  Clock::time_point last_done;
+
+  std::exponential_distribution<double> interval_s(rate);
+  const auto to_duration = [](double seconds) {
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(seconds));
+  };
+  const Clock::time_point start = Clock::now();
+  const Clock::time_point end = start + to_duration(duration_s);
+  Clock::time_point due = start;
+  for (int64_t i = 0; due < end; ++i) {
+    std::this_thread::sleep_until(due);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      ++num_pending;
+    }
+    target->Submit(i % num_models, [&, due] {
+      const Clock::time_point now = Clock::now();
+      std::lock_guard<std::mutex> lock(mutex);
+      result.latencies_us.Record(
+          std::chrono::duration_cast<std::chrono::microseconds>(now - due)
+              .count());
+      last_done = std::max(last_done, now);
+      if (--num_pending == 0) all_done.notify_all();
+    });
+    due += to_duration(poisson ? interval_s(*generator) : 1 / rate);
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  all_done.wait(lock, [&num_pending] { return num_pending == 0; });
+  result.throughput = result.latencies_us.count() /
+                      std::chrono::duration<double>(last_done - start).count();
+  return result;
+}
+
+}  // namespace
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  std::vector<std::string> model_paths;
+  for (const auto& name : absl::StrSplit(FLAGS_model_names, ',')) {
+    model_paths.push_back(coral::ModelPath(std::string(name)));
+  }
+  std::vector<double> rates;
+  for (const auto& rate : absl::StrSplit(FLAGS_rates, ',')) {
+    rates.emplace_back();
+    CHECK(absl::SimpleAtod(rate, &rates.back()) && rates.back() > 0)
+        << "Invalid rate: " << rate;
+  }
+  CHECK(FLAGS_arrivals == "constant" || FLAGS_arrivals == "poisson")
+      << "Unknown arrivals: " << FLAGS_arrivals;
+  CHECK_GT(FLAGS_duration_s, 0);
+
+  if (FLAGS_simulated_edgetpus > 0) {
+    coral::SimulatedEdgeTpuOptions options;
+    options.latency_ms = FLAGS_simulated_latency_ms;
+    options.jitter_ms = FLAGS_simulated_jitter_ms;
+    options.reload_bytes_per_second = FLAGS_simulated_reload_mb_per_s * 1e6;
+    coral::SetEdgeTpuDeviceManager(
+        absl::make_unique<coral::SimulatedEdgeTpuManager>(
+            std::vector<coral::SimulatedEdgeTpuOptions>(
+                FLAGS_simulated_edgetpus, options),
+            FLAGS_seed));
+  }
+
+  std::unique_ptr<coral::Target> target;
+  if (FLAGS_target == "engines") {
+    target = coral::MakeEnginesTarget(model_paths);
+  } else if (FLAGS_target == "pool") {
+    target = coral::MakePoolTarget(model_paths);
+  } else if (FLAGS_target == "scheduler") {
+    target = coral::MakeSchedulerTarget(model_paths);
+  } else {
+    LOG(FATAL) << "Unknown target: " << FLAGS_target;
+  }
+
+  std::mt19937 generator(FLAGS_seed);
+  // Warms up every model, such that the first load doesn't pay for loading
+  // them.
+  coral::RunLoad(target.get(), model_paths.size(), /*rate=*/100,
+                 /*poisson=*/false, model_paths.size() / 100.0, &generator);
+  if (!FLAGS_trace_file.empty()) coral::EnableTracing(true);
+
+  std::printf("%12s %12s %10s %10s %10s %10s %10s\n", "offered/s",
+              "achieved/s", "p50 ms", "p90 ms", "p99 ms", "p99.9 ms",
+              "max ms");
+  for (const double rate : rates) {
+    const coral::LoadResult result =
+        coral::RunLoad(target.get(), model_paths.size(), rate,
+                       FLAGS_arrivals == "poisson", FLAGS_duration_s,
+                       &generator);
+    const coral::LatencyHistogram& latencies = result.latencies_us;
+    std::printf("%12.1f %12.1f %10.3f %10.3f %10.3f %10.3f %10.3f\n", rate,
+                result.throughput, latencies.Percentile(50) / 1000.0,
+                latencies.Percentile(90) / 1000.0,
+                latencies.Percentile(99) / 1000.0,
+                latencies.Percentile(99.9) / 1000.0,
+                latencies.max() / 1000.0);
+    std::fflush(stdout);
+  }
+  if (!FLAGS_trace_file.empty()) {
+    coral::EdgeTpuErrorReporter reporter;
+    CHECK_EQ(coral::kEdgeTpuApiOk,
+             coral::WriteChromeTrace(FLAGS_trace_file, &reporter))
+        << reporter.message();
+  }
+  return 0;
+}
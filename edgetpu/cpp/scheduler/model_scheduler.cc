@@ -0,0 +1,371 @@
+#include "edgetpu/cpp/scheduler/model_scheduler.h"
+
+#include <future>  // NOLINT
+#include <numeric>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "edgetpu/cpp/basic/inference_utils.h"
+#include "glog/logging.h"
+#include "tensorflow/lite/kernels/register.h"
+
+namespace coral {
+
+#define MODEL_SCHEDULER_INIT_CHECK()                                         \
+  EDGETPU_API_REPORT_ERROR(error_reporter_, !is_initialized_,                \
+                           "ModelScheduler must be initialized! Please "     \
+                           "ensure the instance is created by "              \
+                           "ModelSchedulerBuilder!")
+
+namespace {
+// Weight of the last run in the moving average of run times.
+constexpr double kRunTimeDecay = 0.2;
+}  // namespace
+
+ModelScheduler::ModelScheduler() {
+  error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
+}
+
+ModelScheduler::~ModelScheduler() {
+  if (!thread_.joinable()) return;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  requests_ready_.notify_one();
+  thread_.join();
+}
+
+EdgeTpuApiStatus ModelScheduler::Init(
+    const std::vector<std::string>& model_paths,
+    const ModelSchedulerOptions& options) {
+  EDGETPU_API_REPORT_ERROR(error_reporter_, model_paths.empty(),
+                           "No model to schedule!");
+  EDGETPU_API_REPORT_ERROR(error_reporter_, options.max_batch_size < 1,
+                           "Max batch size must be positive!");
+  EDGETPU_API_REPORT_ERROR(error_reporter_, options.latency_slo_us < 0,
+                           "Latency SLO can't be negative!");
+  for (int max_queued : options.max_queued_requests) {
+    EDGETPU_API_REPORT_ERROR(error_reporter_, max_queued < 0,
+                             "Max queued requests can't be negative!");
+  }
+  options_ = options;
+
+  EdgeTpuResourceManager* manager = EdgeTpuResourceManager::GetSingleton();
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_,
+      (options_.device_path.empty()
+           ? manager->GetEdgeTpuResource(&edgetpu_resource_)
+           : manager->GetEdgeTpuResource(options_.device_path,
+                                         &edgetpu_resource_)) ==
+          kEdgeTpuApiError,
+      manager->get_error_message());
+
+  models_.resize(model_paths.size());
+  for (int i = 0; i < model_paths.size(); ++i) {
+    Model& model = models_[i];
+    EdgeTpuErrorReporter reporter;
+    model.model = tflite::FlatBufferModel::BuildFromFile(
+        model_paths[i].c_str(), &reporter);
+    EDGETPU_API_REPORT_ERROR(
+        error_reporter_, !model.model,
+        "Failed to load model " + model_paths[i] + ": " + reporter.message());
+    tflite::ops::builtin::BuiltinOpResolver resolver;
+    model.interpreter =
+        BuildEdgeTpuInterpreter(*model.model, &resolver,
+                                edgetpu_resource_->context(), &reporter,
+                                model_paths[i]);
+    EDGETPU_API_REPORT_ERROR(error_reporter_, !model.interpreter,
+                             "Failed to build interpreter of model " +
+                                 model_paths[i] + ": " + reporter.message());
+    EDGETPU_API_REPORT_ERROR(
+        error_reporter_, model.interpreter->inputs().size() != 1,
+        "Model " + model_paths[i] + " must have exactly one input tensor!");
+    model.input_size = model.interpreter->input_tensor(0)->bytes;
+    model.output_sizes = GetOutputTensorSizes(*model.interpreter);
+  }
+  VLOG(1) << "Scheduling " << models_.size() << " models on "
+          << edgetpu_resource_->path();
+
+  thread_ = std::thread(&ModelScheduler::Serve, this);
+  is_initialized_ = true;
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus ModelScheduler::Submit(int model_index,
+                                        std::vector<uint8_t> input,
+                                        Callback callback) {
+  return Submit(model_index, std::move(input), RequestOptions(),
+                std::move(callback));
+}
+
+EdgeTpuApiStatus ModelScheduler::Submit(int model_index,
+                                        std::vector<uint8_t> input,
+                                        const RequestOptions& request_options,
+                                        Callback callback) {
+  const int priority = static_cast<int>(request_options.priority);
+  {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    MODEL_SCHEDULER_INIT_CHECK();
+    EDGETPU_API_REPORT_ERROR(error_reporter_,
+                             model_index < 0 || model_index >= models_.size(),
+                             "Invalid model index!");
+    EDGETPU_API_REPORT_ERROR(
+        error_reporter_, input.size() != models_[model_index].input_size,
+        "Size of input must be the size of the input tensor of the model!");
+    EDGETPU_API_REPORT_ERROR(error_reporter_, !callback, "Null callback!");
+    EDGETPU_API_REPORT_ERROR(
+        error_reporter_, priority < 0 || priority >= kNumRequestPriorities,
+        "Invalid priority!");
+    EDGETPU_API_REPORT_ERROR(error_reporter_, request_options.deadline_us < 0,
+                             "Deadline can't be negative!");
+  }
+  const Clock::time_point now = Clock::now();
+  const int max_queued = options_.max_queued_requests[priority];
+  bool admitted = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (max_queued == 0 || num_queued_[priority] < max_queued) {
+      models_[model_index].requests[priority].push_back(
+          {std::move(input), std::move(callback), now, next_sequence_++,
+           priority,
+           request_options.deadline_us > 0
+               ? now + std::chrono::microseconds(request_options.deadline_us)
+               : Clock::time_point::max()});
+      ++num_queued_[priority];
+      admitted = true;
+    }
+  }
+  if (!admitted) {
+    {
+      std::lock_guard<std::mutex> lock(stats_mutex_);
+      ++priority_stats_[priority].num_rejected;
+    }
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    error_reporter_->Report("Queue of priority " + std::to_string(priority) +
+                            " is full!");
+    return kEdgeTpuApiError;
+  }
+  requests_ready_.notify_one();
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus ModelScheduler::RunInference(
+    int model_index, const std::vector<uint8_t>& input,
+    std::vector<std::vector<float>>* outputs,
+    const RequestOptions& request_options) {
+  CHECK(outputs);
+  std::promise<EdgeTpuApiStatus> done;
+  EDGETPU_API_ENSURE_STATUS(Submit(
+      model_index, input, request_options,
+      [&done, outputs](EdgeTpuApiStatus status,
+                       std::vector<std::vector<float>> results) {
+        *outputs = std::move(results);
+        done.set_value(status);
+      }));
+  return done.get_future().get();
+}
+
+int ModelScheduler::get_input_size(int model_index) const {
+  CHECK_GE(model_index, 0);
+  CHECK_LT(model_index, models_.size());
+  return models_[model_index].input_size;
+}
+
+int64_t ModelScheduler::num_model_switches() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return num_model_switches_;
+}
+
+RequestPriorityStats ModelScheduler::get_priority_stats(
+    RequestPriority priority) {
+  const int index = static_cast<int>(priority);
+  CHECK_GE(index, 0);
+  CHECK_LT(index, kNumRequestPriorities);
+  std::unique_lock<std::mutex> stats_lock(stats_mutex_);
+  RequestPriorityStats stats(priority_stats_[index]);
+  stats_lock.unlock();
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats.num_queued = num_queued_[index];
+  return stats;
+}
+
+void ModelScheduler::ResetPriorityStats() {
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  for (auto& stats : priority_stats_) {
+    stats.num_completed = 0;
+    stats.num_failed = 0;
+    stats.num_expired = 0;
+    stats.num_rejected = 0;
+    stats.latency_us.Reset();
+  }
+}
+
+std::string ModelScheduler::get_error_message() {
+  std::lock_guard<std::mutex> lock(error_mutex_);
+  return error_reporter_->message();
+}
+
+int ModelScheduler::TopPriority() const {
+  for (int priority = 0; priority < kNumRequestPriorities; ++priority) {
+    if (num_queued_[priority] > 0) return priority;
+  }
+  return -1;
+}
+
+int ModelScheduler::OldestModel(int priority, int excluded) const {
+  int oldest = -1;
+  for (int i = 0; i < models_.size(); ++i) {
+    const auto& requests = models_[i].requests[priority];
+    if (i == excluded || requests.empty()) continue;
+    if (oldest < 0 ||
+        requests.front().sequence <
+            models_[oldest].requests[priority].front().sequence) {
+      oldest = i;
+    }
+  }
+  return oldest;
+}
+
+int ModelScheduler::NextModel(Clock::time_point now, int* priority) const {
+  // Batches only group requests of the highest class with any.
+  *priority = TopPriority();
+  if (*priority < 0) return -1;
+  const int p = *priority;
+  // Co-compiled models don't evict each other's parameters, switching is free.
+  if (options_.co_compiled || current_model_ < 0 ||
+      models_[current_model_].requests[p].empty()) {
+    return OldestModel(p, /*excluded=*/-1);
+  }
+  const int other = OldestModel(p, current_model_);
+  if (other < 0) return current_model_;
+  if (batch_count_ >= options_.max_batch_size) return other;
+  if (options_.latency_slo_us > 0) {
+    // Switches if one more request of the current model, then the reload of
+    // the other model, would make its oldest request miss the target.
+    const auto waited = std::chrono::duration_cast<std::chrono::microseconds>(
+        now - models_[other].requests[p].front().submit_time);
+    if (waited.count() + models_[current_model_].run_time_us +
+            models_[other].run_time_us >=
+        options_.latency_slo_us) {
+      return other;
+    }
+  }
+  return current_model_;
+}
+
+void ModelScheduler::Serve() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    requests_ready_.wait(lock,
+                         [this] { return stopped_ || TopPriority() >= 0; });
+    const Clock::time_point now = Clock::now();
+    int priority;
+    const int index = NextModel(now, &priority);
+    // Stopped, and all requests were served.
+    if (index < 0) return;
+    Request request = std::move(models_[index].requests[priority].front());
+    models_[index].requests[priority].pop_front();
+    --num_queued_[priority];
+    lock.unlock();
+    if (now > request.deadline) {
+      // Dropped without running, nor counting in the batch.
+      {
+        std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+        ++priority_stats_[priority].num_expired;
+      }
+      {
+        std::lock_guard<std::mutex> error_lock(error_mutex_);
+        error_reporter_->Report("Request of model " + std::to_string(index) +
+                                " missed its deadline!");
+      }
+      request.callback(kEdgeTpuApiError, {});
+      lock.lock();
+      continue;
+    }
+    lock.lock();
+    if (index != current_model_) {
+      if (current_model_ >= 0) ++num_model_switches_;
+      current_model_ = index;
+      batch_count_ = 0;
+    }
+    ++batch_count_;
+    lock.unlock();
+    Run(index, std::move(request));
+    lock.lock();
+  }
+}
+
+void ModelScheduler::RecordCompletion(int priority,
+                                      Clock::time_point submit_time,
+                                      bool failed) {
+  const int64_t latency_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                            submit_time)
+          .count();
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  RequestPriorityStats& stats = priority_stats_[priority];
+  ++stats.num_completed;
+  if (failed) ++stats.num_failed;
+  stats.latency_us.Record(latency_us);
+}
+
+void ModelScheduler::Run(int index, Request request) {
+  Model& model = models_[index];
+  const auto start_time = Clock::now();
+  const int output_size = std::accumulate(model.output_sizes.begin(),
+                                          model.output_sizes.end(), 0);
+  std::vector<float> results(output_size);
+  if (!RunInferenceHelper(request.input.data(), request.input.size(),
+                          output_size, model.interpreter.get(),
+                          results.data())) {
+    {
+      std::lock_guard<std::mutex> lock(error_mutex_);
+      error_reporter_->Report("Failed to run model " + std::to_string(index) +
+                              "!");
+    }
+    RecordCompletion(request.priority, request.submit_time, /*failed=*/true);
+    request.callback(kEdgeTpuApiError, {});
+    return;
+  }
+  const double run_time_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                            start_time)
+          .count();
+  model.run_time_us = model.run_time_us == 0
+                          ? run_time_us
+                          : (1 - kRunTimeDecay) * model.run_time_us +
+                                kRunTimeDecay * run_time_us;
+
+  std::vector<std::vector<float>> outputs(model.output_sizes.size());
+  int offset = 0;
+  for (int i = 0; i < outputs.size(); ++i) {
+    outputs[i].assign(results.begin() + offset,
+                      results.begin() + offset + model.output_sizes[i]);
+    offset += model.output_sizes[i];
+  }
+  RecordCompletion(request.priority, request.submit_time, /*failed=*/false);
+  request.callback(kEdgeTpuApiOk, std::move(outputs));
+}
+
+ModelSchedulerBuilder::ModelSchedulerBuilder(
+    const std::vector<std::string>& model_paths,
+    const ModelSchedulerOptions& options)
+    : model_paths_(model_paths), options_(options) {
+  error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
+}
+
+EdgeTpuApiStatus ModelSchedulerBuilder::operator()(
+    std::unique_ptr<ModelScheduler>* scheduler) {
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_, !scheduler,
+      "Null output pointer passed to ModelSchedulerBuilder!");
+  (*scheduler) = absl::make_unique<ModelScheduler>();
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_,
+      (*scheduler)->Init(model_paths_, options_) == kEdgeTpuApiError,
+      (*scheduler)->get_error_message());
+  return kEdgeTpuApiOk;
+}
+
+}  // namespace coral
@@ -0,0 +1,270 @@
+#ifndef EDGETPU_CPP_SCHEDULER_MODEL_SCHEDULER_H_
+#define EDGETPU_CPP_SCHEDULER_MODEL_SCHEDULER_H_
+
+#include <array>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "edgetpu/cpp/basic/edgetpu_resource_manager.h"
+#include "edgetpu/cpp/error_reporter.h"
+#include "edgetpu/cpp/scheduler/latency_histogram.h"
+#include "tensorflow/lite/interpreter.h"
+#include "tensorflow/lite/model.h"
+
+namespace coral {
+
+// Priority class of a request. Requests of a higher class always run first,
+// e.g. alerts of a door camera before a bulk re-indexing job.
+enum class RequestPriority {
+  kHigh = 0,
+  kNormal = 1,
+  kLow = 2,
+};
+
+constexpr int kNumRequestPriorities = 3;
+
+// Options of a request of a ModelScheduler.
+struct RequestOptions {
+  RequestPriority priority = RequestPriority::kNormal;
+  // Time from submission after which the result is useless, in microseconds,
+  // or 0 for none. Requests still queued then are dropped rather than run.
+  int64_t deadline_us = 0;
+};
+
+// Stats of the requests of a priority class, since the scheduler started or
+// its stats were reset.
+struct RequestPriorityStats {
+  // Requests which ran, including those which failed.
+  int64_t num_completed = 0;
+  int64_t num_failed = 0;
+  // Requests dropped because their deadline passed while queued.
+  int64_t num_expired = 0;
+  // Requests refused by Submit() because the queue of the class was full.
+  int64_t num_rejected = 0;
+  // Requests queued now.
+  int num_queued = 0;
+  // Latencies of completed requests, from submission to result, in
+  // microseconds.
+  LatencyHistogram latency_us;
+};
+
+// Options of a ModelScheduler.
+struct ModelSchedulerOptions {
+  // Whether the models were compiled together, in which case their parameters
+  // are all cached on the Edge TPU and requests are simply served in order.
+  bool co_compiled = false;
+  // Maximum number of requests of a model served in a row while requests of
+  // other models wait. 1 interleaves models like they were submitted.
+  int max_batch_size = 16;
+  // Latency target of requests, from submission to result, in microseconds.
+  // Batches end early so that requests of other models still make it, as far
+  // as they can. 0 bounds batches by `max_batch_size` only.
+  int64_t latency_slo_us = 0;
+  // Edge TPU shared by the models, or empty for the next available one.
+  std::string device_path;
+  // Maximum number of queued requests of each priority class, beyond which
+  // Submit() sheds load by refusing requests of the class, or 0 for no limit.
+  std::array<int, kNumRequestPriorities> max_queued_requests = {{0, 0, 0}};
+};
+
+// Serves requests of several models sharing one Edge TPU.
+//
+// Models compiled separately each use all of the on-chip memory to cache their
+// parameters, so every switch to another model reloads them, which for large
+// models takes longer than the inference itself. The scheduler queues requests
+// per model, and runs those of one model in a row before switching, in the
+// order their oldest requests were submitted. Batches grow with the load,
+// which trades latency of the other models for throughput, up to
+// `max_batch_size` and the latency target.
+//
+// Requests of a higher RequestPriority run before any of a lower one, which
+// batching only applies within: a high priority request waits for at most the
+// request running. Requests whose deadline passed are dropped when their turn
+// comes, with kEdgeTpuApiError, and full queues refuse new requests, so that
+// an overloaded Edge TPU spends its time on requests which can still make it.
+//
+// All requests run on one thread of the scheduler, and callbacks are called
+// there, so they should return quickly.
+class ModelScheduler {
+ public:
+  // Called with the result of a request: the dequantized output tensors like
+  // BasicEngine::RunInference() returns them, or an error.
+  using Callback = std::function<void(EdgeTpuApiStatus status,
+                                      std::vector<std::vector<float>> outputs)>;
+
+  ModelScheduler();
+  // Serves the queued requests, then stops.
+  ~ModelScheduler();
+
+  // Copying or assignment is disallowed
+  ModelScheduler(const ModelScheduler&) = delete;
+  ModelScheduler& operator=(const ModelScheduler&) = delete;
+
+  // Loads models `model_paths` on one Edge TPU and starts serving requests.
+  EdgeTpuApiStatus Init(const std::vector<std::string>& model_paths,
+                        const ModelSchedulerOptions& options);
+
+  // Queues a request of model `model_index` with `input`, the input tensor of
+  // the model. `callback` is called once it ran, or with kEdgeTpuApiError if
+  // it was dropped.
+  EdgeTpuApiStatus Submit(int model_index, std::vector<uint8_t> input,
+                          Callback callback);
+  // Same, with the priority and deadline of `request_options`. Fails if the
+  // queue of the priority class is full.
+  EdgeTpuApiStatus Submit(int model_index, std::vector<uint8_t> input,
+                          const RequestOptions& request_options,
+                          Callback callback);
+
+  // Submits a request and waits for its results.
+  EdgeTpuApiStatus RunInference(
+      int model_index, const std::vector<uint8_t>& input,
+      std::vector<std::vector<float>>* outputs,
+      const RequestOptions& request_options = RequestOptions());
+
+  int num_models() const { return models_.size(); }
+
+  // Size in bytes of the input tensor of model `model_index`.
+  int get_input_size(int model_index) const;
+
+  // Number of times the Edge TPU switched to another model, each of which
+  // reloads its parameters unless models are co-compiled.
+  int64_t num_model_switches();
+
+  // Gets the stats of requests of class `priority`.
+  RequestPriorityStats get_priority_stats(RequestPriority priority);
+
+  void ResetPriorityStats();
+
+  std::string device_path() const { return edgetpu_resource_->path(); }
+
+  // Caller can use this function to retrieve error message when get
+  // kEdgeTpuApiError.
+  std::string get_error_message();
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Request {
+    std::vector<uint8_t> input;
+    Callback callback;
+    Clock::time_point submit_time;
+    // Order of submission among all requests.
+    int64_t sequence;
+    int priority;
+    // Clock::time_point::max() if none.
+    Clock::time_point deadline;
+  };
+
+  struct Model {
+    std::unique_ptr<tflite::FlatBufferModel> model;
+    std::unique_ptr<tflite::Interpreter> interpreter;
+    std::vector<int> output_sizes;
+    int input_size = 0;
+    // Queued requests, by priority.
+    std::array<std::deque<Request>, kNumRequestPriorities> requests;
+    // Moving average of the run time, including the reload of parameters
+    // after a switch, in microseconds.
+    double run_time_us = 0;
+  };
+
+  // Returns the model to serve next, and sets `priority` to the class of its
+  // request, or returns -1 if there is no request.
+  int NextModel(Clock::time_point now, int* priority) const;
+
+  // Returns the model whose oldest request of class `priority` was submitted
+  // first, other than `excluded`, or -1 if there is none.
+  int OldestModel(int priority, int excluded) const;
+
+  // Returns the highest priority class with queued requests, or -1 if none.
+  int TopPriority() const;
+
+  // Runs the requests of the model returned by NextModel() until stopped.
+  void Serve();
+
+  // Runs `request` on model `index`.
+  void Run(int index, Request request);
+
+  // Records the completion of a request of class `priority` submitted at
+  // `submit_time`.
+  void RecordCompletion(int priority, Clock::time_point submit_time,
+                        bool failed);
+
+  ModelSchedulerOptions options_;
+  // EdgeTpuResource must be destructed after interpreters, whose custom ops
+  // use the Edge TPU context.
+  std::unique_ptr<EdgeTpuResource> edgetpu_resource_;
+  std::vector<Model> models_;
+
+  // Guards the queues of `models_`, and the state below.
+  std::mutex mutex_;
+  std::condition_variable requests_ready_;
+  bool stopped_ = false;
+  int64_t next_sequence_ = 0;
+  // Model the Edge TPU ran last, and number of its requests run since.
+  int current_model_ = -1;
+  int batch_count_ = 0;
+  int64_t num_model_switches_ = 0;
+  std::array<int, kNumRequestPriorities> num_queued_ = {{0, 0, 0}};
+  std::thread thread_;
+
+  // Guards `priority_stats_`, except their `num_queued`, which is
+  // `num_queued_`.
+  std::mutex stats_mutex_;
+  std::array<RequestPriorityStats, kNumRequestPriorities> priority_stats_;
+
+  // Guards `error_reporter_`.
+  std::mutex error_mutex_;
+  // Data structure to stores error messages.
+  std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
+  // Indicates whether the instance is initialized.
+  bool is_initialized_ = false;
+};
+
+// Builds a ModelScheduler.
+//
+// model_paths: The file paths of the models sharing the Edge TPU.
+// options: How to schedule their requests, see ModelSchedulerOptions.
+//
+// Example:
+//   ModelSchedulerOptions options;
+//   options.latency_slo_us = 50000;
+//   ModelSchedulerBuilder builder({"bird.tflite", "plant.tflite"}, options);
+//   std::unique_ptr<ModelScheduler> scheduler;
+//   if (builder(&scheduler) == kEdgeTpuApiOk) {
+//     scheduler->Submit(0, bird_image,
+//                       [](EdgeTpuApiStatus status,
+//                          std::vector<std::vector<float>> outputs) { ... });
+//   }
+class ModelSchedulerBuilder {
+ public:
+  ModelSchedulerBuilder(const std::vector<std::string>& model_paths,
+                        const ModelSchedulerOptions& options);
+
+  // Disallows copy and assign.
+  ModelSchedulerBuilder(const ModelSchedulerBuilder&) = delete;
+  ModelSchedulerBuilder& operator=(const ModelSchedulerBuilder&) = delete;
+
+  EdgeTpuApiStatus operator()(std::unique_ptr<ModelScheduler>* scheduler);
+
+  // Caller can use this function to retrieve error message when get
+  // kEdgeTpuApiError.
+  std::string get_error_message() { return error_reporter_->message(); }
+
+ private:
+  // Data structure to stores error messages.
+  std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
+  std::vector<std::string> model_paths_;
+  ModelSchedulerOptions options_;
+};
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_SCHEDULER_MODEL_SCHEDULER_H_
@@ -0,0 +1,116 @@
+// Compares serving requests of two models sharing one Edge TPU in the order
+// they come (max_batch_size 1) against batching them per model, for
+// co-compiled and separately compiled models. Each iteration submits
+// `kRequestsPerModel` requests of each model, alternating, all at once.
+#include <algorithm>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <mutex>               // NOLINT
+
+#include "benchmark/benchmark.h"
+#include "edgetpu/cpp/scheduler/model_scheduler.h"
+#include "edgetpu/cpp/test_utils.h"
+#include "glog/logging.h"
+
+namespace coral {
+
+constexpr int kRequestsPerModel = 20;
+
+void BenchmarkModelScheduler(const std::vector<std::string>& model_paths,
+                             CompilationType compilation,
+                             benchmark::State& state) {
+  ModelSchedulerOptions options;
+  options.co_compiled = compilation == kCoCompilation;
+  options.max_batch_size = state.range(0);
+  std::unique_ptr<ModelScheduler> scheduler;
+  ModelSchedulerBuilder builder(model_paths, options);
+  CHECK_EQ(builder(&scheduler), kEdgeTpuApiOk) << builder.get_error_message();
+  std::vector<std::vector<uint8_t>> inputs;
+  for (int i = 0; i < model_paths.size(); ++i) {
+    inputs.push_back(GetRandomInput(scheduler->get_input_size(i)));
+  }
+
+  const int num_requests = kRequestsPerModel * model_paths.size();
+  double total_latency_ms = 0, max_latency_ms = 0;
+  while (state.KeepRunning()) {
+    std::mutex mutex;
+    std::condition_variable all_done;
+    int num_done = 0;
+    for (int i = 0; i < num_requests; ++i) {
+      const auto submit_time = std::chrono::steady_clock::now();
+      CHECK_EQ(
+          scheduler->Submit(
+              i % model_paths.size(), inputs[i % model_paths.size()],
+              [&, submit_time](EdgeTpuApiStatus status,
+                               std::vector<std::vector<float>> outputs) {
+                CHECK_EQ(status, kEdgeTpuApiOk);
+                const std::chrono::duration<double, std::milli> latency =
+                    std::chrono::steady_clock::now() - submit_time;
+                std::lock_guard<std::mutex> lock(mutex);
+                total_latency_ms += latency.count();
+                max_latency_ms = std::max(max_latency_ms, latency.count());
+                if (++num_done == num_requests) all_done.notify_one();
+              }),
+          kEdgeTpuApiOk);
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    all_done.wait(lock, [&] { return num_done == num_requests; });
+  }
+  state.SetItemsProcessed(state.iterations() * num_requests);
+  state.counters["mean_latency_ms"] =
+      total_latency_ms / (state.iterations() * num_requests);
+  state.counters["max_latency_ms"] = max_latency_ms;
+  state.counters["model_switches"] =
+      benchmark::Counter(scheduler->num_model_switches(),
+                         benchmark::Counter::kAvgIterations);
+}
+
+template <CompilationType Compilation>
+static void BM_ModelScheduler_TwoSmall(benchmark::State& state) {
+  const std::string model_path0 =
+      ModelPath((Compilation == kCoCompilation)
+                    ? "mobilenet_v1_0.25_128_quant_cocompiled_with_"
+                      "mobilenet_v1_0.5_160_quant_edgetpu.tflite"
+                    : "mobilenet_v1_0.25_128_quant_edgetpu.tflite");
+  const std::string model_path1 =
+      ModelPath((Compilation == kCoCompilation)
+                    ? "mobilenet_v1_0.5_160_quant_cocompiled_with_"
+                      "mobilenet_v1_0.25_128_quant_edgetpu.tflite"
+                    : "mobilenet_v1_0.5_160_quant_edgetpu.tflite");
+  BenchmarkModelScheduler({model_path0, model_path1}, Compilation, state);
+}
+BENCHMARK_TEMPLATE(BM_ModelScheduler_TwoSmall, kCoCompilation)
+    ->Arg(1)
+    ->Arg(kRequestsPerModel)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ModelScheduler_TwoSmall, kSingleCompilation)
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(kRequestsPerModel)
+    ->UseRealTime();
+
+template <CompilationType Compilation>
+static void BM_ModelScheduler_TwoLarge(benchmark::State& state) {
+  const std::string model_path0 =
+      ModelPath((Compilation == kCoCompilation)
+                    ? "inception_v4_299_quant_cocompiled_with_inception_v3_"
+                      "299_quant_edgetpu.tflite"
+                    : "inception_v4_299_quant_edgetpu.tflite");
+  const std::string model_path1 =
+      ModelPath((Compilation == kCoCompilation)
+                    ? "inception_v3_299_quant_cocompiled_with_inception_v4_"
+                      "299_quant_edgetpu.tflite"
+                    : "inception_v3_299_quant_edgetpu.tflite");
+  BenchmarkModelScheduler({model_path0, model_path1}, Compilation, state);
+}
+BENCHMARK_TEMPLATE(BM_ModelScheduler_TwoLarge, kCoCompilation)
+    ->Arg(1)
+    ->Arg(kRequestsPerModel)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ModelScheduler_TwoLarge, kSingleCompilation)
+    ->Arg(1)
+    ->Arg(4)
+    ->Arg(kRequestsPerModel)
+    ->UseRealTime();
+
+}  // namespace coral
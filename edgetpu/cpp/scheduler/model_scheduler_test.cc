@@ -0,0 +1,310 @@
+#include "edgetpu/cpp/scheduler/model_scheduler.h"
+
+#include <chrono>  // NOLINT
+#include <future>  // NOLINT
+#include <memory>
+#include <thread>  // NOLINT
+
+#include "edgetpu/cpp/basic/basic_engine.h"
+#include "edgetpu/cpp/test_utils.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace coral {
+namespace {
+
+const std::vector<std::string> kModelNames = {
+    "mobilenet_v1_0.25_128_quant_edgetpu.tflite",
+    "mobilenet_v1_0.5_160_quant_edgetpu.tflite"};
+
+std::vector<std::string> ModelPaths() {
+  std::vector<std::string> paths;
+  for (const auto& name : kModelNames) paths.push_back(ModelPath(name));
+  return paths;
+}
+
+// Submits `num_requests` requests alternating between the two models, all of
+// them before the first one completes, and returns the models in the order
+// they ran.
+std::vector<int> ScheduleAlternatingRequests(
+    const ModelSchedulerOptions& options, int num_requests) {
+  std::unique_ptr<ModelScheduler> scheduler;
+  ModelSchedulerBuilder builder(ModelPaths(), options);
+  CHECK_EQ(builder(&scheduler), kEdgeTpuApiOk) << builder.get_error_message();
+
+  // Callbacks run on the thread of the scheduler, one at a time.
+  std::vector<int> order;
+  std::promise<void> all_submitted;
+  std::shared_future<void> released = all_submitted.get_future().share();
+  for (int i = 0; i < num_requests; ++i) {
+    const int model_index = i % 2;
+    const auto input = GetRandomInput(scheduler->get_input_size(model_index));
+    EXPECT_EQ(kEdgeTpuApiOk,
+              scheduler->Submit(model_index, input,
+                                [&order, released, model_index](
+                                    EdgeTpuApiStatus status,
+                                    std::vector<std::vector<float>> outputs) {
+                                  EXPECT_EQ(kEdgeTpuApiOk, status);
+                                  released.wait();
+                                  order.push_back(model_index);
+                                }))
+        << scheduler->get_error_message();
+  }
+  all_submitted.set_value();
+  // Serves the remaining requests.
+  scheduler.reset();
+  return order;
+}
+
+int NumSwitches(const std::vector<int>& order) {
+  int num_switches = 0;
+  for (int i = 1; i < order.size(); ++i) {
+    if (order[i] != order[i - 1]) ++num_switches;
+  }
+  return num_switches;
+}
+
+TEST(ModelSchedulerTest, SameResultsAsBasicEngine) {
+  std::unique_ptr<ModelScheduler> scheduler;
+  ModelSchedulerBuilder builder(ModelPaths(), ModelSchedulerOptions());
+  ASSERT_EQ(kEdgeTpuApiOk, builder(&scheduler)) << builder.get_error_message();
+  ASSERT_EQ(2, scheduler->num_models());
+
+  for (int i = 0; i < kModelNames.size(); ++i) {
+    BasicEngine engine(ModelPath(kModelNames[i]), scheduler->device_path());
+    const std::vector<int> shape = engine.get_input_tensor_shape();
+    const auto input = GetInputFromImage(TestDataPath("cat.bmp"),
+                                         {shape[1], shape[2], shape[3]});
+    ASSERT_EQ(input.size(), scheduler->get_input_size(i));
+    std::vector<std::vector<float>> outputs;
+    ASSERT_EQ(kEdgeTpuApiOk, scheduler->RunInference(i, input, &outputs))
+        << scheduler->get_error_message();
+    EXPECT_EQ(engine.RunInference(input), outputs);
+  }
+}
+
+TEST(ModelSchedulerTest, BatchesSingleCompiledModels) {
+  ModelSchedulerOptions options;
+  options.max_batch_size = 5;
+  const std::vector<int> order = ScheduleAlternatingRequests(options, 20);
+  ASSERT_EQ(20, order.size());
+  // The first request runs alone, the others wait for it.
+  EXPECT_EQ(std::vector<int>({0, 0, 0, 0, 0, 1, 1, 1, 1, 1,
+                              0, 0, 0, 0, 0, 1, 1, 1, 1, 1}),
+            order);
+}
+
+TEST(ModelSchedulerTest, InterleavesWithBatchSizeOne) {
+  ModelSchedulerOptions options;
+  options.max_batch_size = 1;
+  EXPECT_EQ(19, NumSwitches(ScheduleAlternatingRequests(options, 20)));
+}
+
+TEST(ModelSchedulerTest, ServesCoCompiledModelsInOrder) {
+  ModelSchedulerOptions options;
+  options.co_compiled = true;
+  EXPECT_EQ(19, NumSwitches(ScheduleAlternatingRequests(options, 20)));
+}
+
+TEST(ModelSchedulerTest, LatencySloEndsBatches) {
+  ModelSchedulerOptions options;
+  options.max_batch_size = 20;
+  // Too short for anything to wait, so that models alternate.
+  options.latency_slo_us = 1;
+  EXPECT_EQ(19, NumSwitches(ScheduleAlternatingRequests(options, 20)));
+}
+
+// Submits a request whose callback holds the thread of `scheduler` until
+// `released` is ready, so that requests submitted meanwhile queue.
+void BlockScheduler(ModelScheduler* scheduler,
+                    std::shared_future<void> released) {
+  std::promise<void> running;
+  ASSERT_EQ(kEdgeTpuApiOk,
+            scheduler->Submit(
+                0, GetRandomInput(scheduler->get_input_size(0)),
+                [&running, released](EdgeTpuApiStatus status,
+                                     std::vector<std::vector<float>> outputs) {
+                  running.set_value();
+                  released.wait();
+                }));
+  running.get_future().wait();
+}
+
+TEST(ModelSchedulerTest, RunsHigherPrioritiesFirst) {
+  std::unique_ptr<ModelScheduler> scheduler;
+  ModelSchedulerOptions options;
+  options.max_batch_size = 20;
+  ModelSchedulerBuilder builder(ModelPaths(), options);
+  ASSERT_EQ(kEdgeTpuApiOk, builder(&scheduler)) << builder.get_error_message();
+  std::promise<void> release;
+  BlockScheduler(scheduler.get(), release.get_future().share());
+
+  // Callbacks run on the thread of the scheduler, one at a time.
+  std::vector<RequestPriority> order;
+  const std::vector<RequestPriority> priorities = {
+      RequestPriority::kLow, RequestPriority::kNormal, RequestPriority::kHigh};
+  for (int i = 0; i < 12; ++i) {
+    // Low priority requests of model 0 would batch with the blocking one.
+    RequestOptions request_options;
+    request_options.priority = priorities[i % 3];
+    const int model_index = i % 3 == 0 ? 0 : 1;
+    ASSERT_EQ(kEdgeTpuApiOk,
+              scheduler->Submit(
+                  model_index,
+                  GetRandomInput(scheduler->get_input_size(model_index)),
+                  request_options,
+                  [&order, request_options](
+                      EdgeTpuApiStatus status,
+                      std::vector<std::vector<float>> outputs) {
+                    EXPECT_EQ(kEdgeTpuApiOk, status);
+                    order.push_back(request_options.priority);
+                  }));
+  }
+  EXPECT_EQ(4, scheduler->get_priority_stats(RequestPriority::kHigh)
+                   .num_queued);
+  release.set_value();
+  scheduler.reset();
+  ASSERT_EQ(12, order.size());
+  for (int i = 0; i < 12; ++i) EXPECT_EQ(priorities[2 - i / 4], order[i]);
+}
+
+TEST(ModelSchedulerTest, DropsExpiredRequests) {
+  std::unique_ptr<ModelScheduler> scheduler;
+  ModelSchedulerBuilder builder(ModelPaths(), ModelSchedulerOptions());
+  ASSERT_EQ(kEdgeTpuApiOk, builder(&scheduler)) << builder.get_error_message();
+  std::promise<void> release;
+  BlockScheduler(scheduler.get(), release.get_future().share());
+
+  std::vector<std::future<EdgeTpuApiStatus>> results;
+  std::vector<std::vector<float>> outputs;
+  for (int deadline_us : {1000, 0}) {
+    auto done = std::make_shared<std::promise<EdgeTpuApiStatus>>();
+    results.push_back(done->get_future());
+    RequestOptions request_options;
+    request_options.deadline_us = deadline_us;
+    ASSERT_EQ(kEdgeTpuApiOk,
+              scheduler->Submit(
+                  1, GetRandomInput(scheduler->get_input_size(1)),
+                  request_options,
+                  [done](EdgeTpuApiStatus status,
+                         std::vector<std::vector<float>> outputs) {
+                    done->set_value(status);
+                  }));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  release.set_value();
+  EXPECT_EQ(kEdgeTpuApiError, results[0].get());
+  EXPECT_EQ(kEdgeTpuApiOk, results[1].get());
+  EXPECT_EQ("Request of model 1 missed its deadline!",
+            scheduler->get_error_message());
+  const RequestPriorityStats stats =
+      scheduler->get_priority_stats(RequestPriority::kNormal);
+  EXPECT_EQ(1, stats.num_expired);
+  // The blocking request and the one without deadline.
+  EXPECT_EQ(2, stats.num_completed);
+  EXPECT_EQ(2, stats.latency_us.count());
+  EXPECT_GE(stats.latency_us.max(), 10000);
+}
+
+TEST(ModelSchedulerTest, ShedsLoadOfFullQueues) {
+  std::unique_ptr<ModelScheduler> scheduler;
+  ModelSchedulerOptions options;
+  options.max_queued_requests = {{0, 0, 2}};
+  ModelSchedulerBuilder builder(ModelPaths(), options);
+  ASSERT_EQ(kEdgeTpuApiOk, builder(&scheduler)) << builder.get_error_message();
+  std::promise<void> release;
+  BlockScheduler(scheduler.get(), release.get_future().share());
+
+  const auto input = GetRandomInput(scheduler->get_input_size(0));
+  const auto callback = [](EdgeTpuApiStatus status,
+                           std::vector<std::vector<float>> outputs) {
+    EXPECT_EQ(kEdgeTpuApiOk, status);
+  };
+  RequestOptions low;
+  low.priority = RequestPriority::kLow;
+  std::vector<std::future<void>> low_done;
+  for (int i = 0; i < 2; ++i) {
+    auto done = std::make_shared<std::promise<void>>();
+    low_done.push_back(done->get_future());
+    EXPECT_EQ(kEdgeTpuApiOk,
+              scheduler->Submit(
+                  0, input, low,
+                  [done](EdgeTpuApiStatus status,
+                         std::vector<std::vector<float>> outputs) {
+                    EXPECT_EQ(kEdgeTpuApiOk, status);
+                    done->set_value();
+                  }));
+  }
+  EXPECT_EQ(kEdgeTpuApiError, scheduler->Submit(0, input, low, callback));
+  EXPECT_EQ("Queue of priority 2 is full!", scheduler->get_error_message());
+  // Other classes still get in.
+  EXPECT_EQ(kEdgeTpuApiOk, scheduler->Submit(0, input, callback));
+  const RequestPriorityStats queued =
+      scheduler->get_priority_stats(RequestPriority::kLow);
+  EXPECT_EQ(1, queued.num_rejected);
+  EXPECT_EQ(2, queued.num_queued);
+
+  release.set_value();
+  // The low queue only has room again once its requests are dequeued.
+  for (auto& done : low_done) done.wait();
+  std::vector<std::vector<float>> outputs;
+  ASSERT_EQ(kEdgeTpuApiOk, scheduler->RunInference(0, input, &outputs, low));
+  const RequestPriorityStats completed =
+      scheduler->get_priority_stats(RequestPriority::kLow);
+  EXPECT_EQ(3, completed.num_completed);
+  EXPECT_EQ(0, completed.num_queued);
+  scheduler->ResetPriorityStats();
+  const RequestPriorityStats reset =
+      scheduler->get_priority_stats(RequestPriority::kLow);
+  EXPECT_EQ(0, reset.num_completed);
+  EXPECT_EQ(0, reset.latency_us.count());
+}
+
+TEST(ModelSchedulerTest, Errors) {
+  std::unique_ptr<ModelScheduler> scheduler;
+  {
+    ModelSchedulerBuilder builder({}, ModelSchedulerOptions());
+    EXPECT_EQ(kEdgeTpuApiError, builder(&scheduler));
+    EXPECT_EQ("No model to schedule!", builder.get_error_message());
+  }
+  {
+    ModelSchedulerOptions options;
+    options.max_batch_size = 0;
+    ModelSchedulerBuilder builder(ModelPaths(), options);
+    EXPECT_EQ(kEdgeTpuApiError, builder(&scheduler));
+    EXPECT_EQ("Max batch size must be positive!", builder.get_error_message());
+  }
+  {
+    ModelSchedulerOptions options;
+    options.max_queued_requests = {{0, -1, 0}};
+    ModelSchedulerBuilder builder(ModelPaths(), options);
+    EXPECT_EQ(kEdgeTpuApiError, builder(&scheduler));
+    EXPECT_EQ("Max queued requests can't be negative!",
+              builder.get_error_message());
+  }
+  ModelSchedulerBuilder builder(ModelPaths(), ModelSchedulerOptions());
+  ASSERT_EQ(kEdgeTpuApiOk, builder(&scheduler));
+  std::vector<std::vector<float>> outputs;
+  EXPECT_EQ(kEdgeTpuApiError, scheduler->RunInference(2, {}, &outputs));
+  EXPECT_EQ("Invalid model index!", scheduler->get_error_message());
+  EXPECT_EQ(kEdgeTpuApiError, scheduler->RunInference(0, {1, 2, 3}, &outputs));
+  EXPECT_EQ("Size of input must be the size of the input tensor of the model!",
+            scheduler->get_error_message());
+  RequestOptions request_options;
+  request_options.deadline_us = -1;
+  EXPECT_EQ(kEdgeTpuApiError,
+            scheduler->RunInference(
+                0, GetRandomInput(scheduler->get_input_size(0)), &outputs,
+                request_options));
+  EXPECT_EQ("Deadline can't be negative!", scheduler->get_error_message());
+}
+
+}  // namespace
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
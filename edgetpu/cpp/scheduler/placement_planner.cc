@@ -0,0 +1,355 @@
+#include "edgetpu/cpp/scheduler/placement_planner.h"
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "edgetpu/cpp/basic/edgetpu_resource_manager.h"
+#include "edgetpu/cpp/tools/model_inspector.h"
+#include "edgetpu/cpp/utils.h"
+#include "glog/logging.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace coral {
+
+#define PLACED_MODEL_POOL_INIT_CHECK()                                        \
+  EDGETPU_API_REPORT_ERROR(error_reporter_, !is_initialized_,                 \
+                           "PlacedModelPool must be initialized! Please "     \
+                           "ensure the instance is created by "               \
+                           "PlacedModelPoolBuilder!")
+
+namespace {
+
+// Utilizations closer than this are the same.
+constexpr double kEpsilon = 1e-9;
+// Bound on the passes moving single models, each of which improves the plan.
+constexpr int kMaxImprovementPasses = 100;
+
+// Maximum and total utilization of devices, the lower the better, in that
+// order.
+std::pair<double, double> PlanCost(const std::vector<double>& utilizations) {
+  return {*std::max_element(utilizations.begin(), utilizations.end()),
+          std::accumulate(utilizations.begin(), utilizations.end(), 0.0)};
+}
+
+bool IsBetter(const std::pair<double, double>& cost,
+              const std::pair<double, double>& than) {
+  if (cost.first < than.first - kEpsilon) return true;
+  return cost.first <= than.first + kEpsilon &&
+         cost.second < than.second - kEpsilon;
+}
+
+}  // namespace
+
+std::vector<double> EstimateDeviceUtilizations(
+    const std::vector<ModelProfile>& models,
+    const std::vector<int>& model_devices, int num_devices,
+    const PlacementOptions& options) {
+  CHECK_EQ(models.size(), model_devices.size());
+  std::vector<double> rates(num_devices, 0);
+  std::vector<double> utilizations(num_devices, 0);
+  for (int i = 0; i < models.size(); ++i) {
+    // Models not placed yet.
+    if (model_devices[i] < 0) continue;
+    CHECK_LT(model_devices[i], num_devices);
+    rates[model_devices[i]] += models[i].request_rate;
+    utilizations[model_devices[i]] +=
+        models[i].request_rate * models[i].inference_time_ms / 1000;
+  }
+  for (int i = 0; i < models.size(); ++i) {
+    if (model_devices[i] < 0) continue;
+    const double others_rate = rates[model_devices[i]] - models[i].request_rate;
+    const double reloads_per_second =
+        std::min(models[i].request_rate, std::max(others_rate, 0.0)) /
+        options.batch_size;
+    utilizations[model_devices[i]] += reloads_per_second *
+                                      models[i].parameter_bytes /
+                                      options.reload_bytes_per_second;
+  }
+  return utilizations;
+}
+
+PlacementPlan PlanPlacement(const std::vector<ModelProfile>& models,
+                            int num_devices, const PlacementOptions& options) {
+  CHECK_GT(num_devices, 0);
+  CHECK_GT(options.batch_size, 0);
+  CHECK_GT(options.reload_bytes_per_second, 0);
+  const int num_models = models.size();
+  PlacementPlan plan;
+  plan.model_devices.assign(num_models, -1);
+
+  // Seconds of device time per second each model takes at worst, with a
+  // reload before each request.
+  std::vector<double> costs(num_models);
+  for (int i = 0; i < num_models; ++i) {
+    costs[i] = models[i].request_rate *
+               (models[i].inference_time_ms / 1000 +
+                models[i].parameter_bytes / options.reload_bytes_per_second);
+  }
+  std::vector<int> order(num_models);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    if (costs[a] != costs[b]) return costs[a] > costs[b];
+    return models[a].parameter_bytes > models[b].parameter_bytes;
+  });
+
+  // Places models one by one where they raise the utilization the least, on
+  // the device with the fewest models on ties.
+  std::vector<int> device_num_models(num_devices, 0);
+  for (int model : order) {
+    int best_device = -1;
+    std::pair<double, double> best_cost;
+    for (int device = 0; device < num_devices; ++device) {
+      plan.model_devices[model] = device;
+      const auto cost = PlanCost(EstimateDeviceUtilizations(
+          models, plan.model_devices, num_devices, options));
+      if (best_device < 0 || IsBetter(cost, best_cost) ||
+          (!IsBetter(best_cost, cost) &&
+           device_num_models[device] < device_num_models[best_device])) {
+        best_device = device;
+        best_cost = cost;
+      }
+    }
+    plan.model_devices[model] = best_device;
+    ++device_num_models[best_device];
+  }
+
+  // Moves single models while that improves the plan.
+  auto cost = PlanCost(EstimateDeviceUtilizations(models, plan.model_devices,
+                                                  num_devices, options));
+  for (int pass = 0; pass < kMaxImprovementPasses; ++pass) {
+    bool improved = false;
+    for (int model = 0; model < num_models; ++model) {
+      const int current_device = plan.model_devices[model];
+      for (int device = 0; device < num_devices; ++device) {
+        if (device == plan.model_devices[model]) continue;
+        const int previous_device = plan.model_devices[model];
+        plan.model_devices[model] = device;
+        const auto new_cost = PlanCost(EstimateDeviceUtilizations(
+            models, plan.model_devices, num_devices, options));
+        if (IsBetter(new_cost, cost)) {
+          cost = new_cost;
+        } else {
+          plan.model_devices[model] = previous_device;
+        }
+      }
+      improved |= plan.model_devices[model] != current_device;
+    }
+    if (!improved) break;
+  }
+
+  plan.device_utilizations = EstimateDeviceUtilizations(
+      models, plan.model_devices, num_devices, options);
+  plan.max_utilization = cost.first;
+  return plan;
+}
+
+PlacedModelPool::PlacedModelPool() {
+  error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
+}
+
+EdgeTpuApiStatus PlacedModelPool::Init(
+    const std::vector<std::string>& model_paths,
+    const std::vector<std::string>& device_paths,
+    const PlacementOptions& options) {
+  EDGETPU_API_REPORT_ERROR(error_reporter_, model_paths.empty(),
+                           "No model to place!");
+  EDGETPU_API_REPORT_ERROR(error_reporter_, options.batch_size < 1,
+                           "Batch size must be positive!");
+  EDGETPU_API_REPORT_ERROR(error_reporter_,
+                           options.reload_bytes_per_second <= 0,
+                           "Reload speed must be positive!");
+  options_ = options;
+  device_paths_ = device_paths;
+  if (device_paths_.empty()) {
+    device_paths_ = EdgeTpuResourceManager::GetSingleton()->ListEdgeTpuPaths(
+        EdgeTpuResourceManager::EdgeTpuState::kNone);
+  }
+  EDGETPU_API_REPORT_ERROR(error_reporter_, device_paths_.empty(),
+                           "No Edge TPU to place models on!");
+
+  std::vector<ModelProfile> profiles;
+  for (const auto& path : model_paths) {
+    auto model = absl::make_unique<Model>();
+    model->path = path;
+    std::string contents;
+    EDGETPU_API_ENSURE_STATUS(
+        ReadFile(path, &contents, error_reporter_.get()));
+    flatbuffers::Verifier verifier(
+        reinterpret_cast<const uint8_t*>(contents.data()), contents.size());
+    EDGETPU_API_REPORT_ERROR(error_reporter_,
+                             !tflite::VerifyModelBuffer(verifier),
+                             "Not a valid tflite model: " + path);
+    model->profile.parameter_bytes =
+        tools::InspectModel(*tflite::GetModel(contents.data()),
+                            contents.size())
+            .edgetpu_payload_bytes;
+    // Until requests come, models are as busy as each other.
+    model->profile.request_rate = 1;
+    profiles.push_back(model->profile);
+    models_.push_back(std::move(model));
+  }
+
+  plan_ = PlanPlacement(profiles, device_paths_.size(), options_);
+  for (int i = 0; i < models_.size(); ++i) {
+    EDGETPU_API_ENSURE_STATUS(
+        OpenEngine(plan_.model_devices[i], models_[i].get()));
+  }
+  plan_time_ = Clock::now();
+  is_initialized_ = true;
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus PlacedModelPool::OpenEngine(int device, Model* model) {
+  const std::string& device_path = device_paths_[device];
+  BasicEngineNativeBuilder builder(model->path, device_path);
+  std::unique_ptr<BasicEngineNative> engine;
+  if (builder(&engine) != kEdgeTpuApiOk) {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    error_reporter_->Report("Failed to open " + model->path + " on " +
+                            device_path + ": " + builder.get_error_message());
+    return kEdgeTpuApiError;
+  }
+  VLOG(1) << "Placed " << model->path << " on " << device_path;
+  std::lock_guard<std::mutex> lock(model->mutex);
+  model->engine = std::move(engine);
+  model->device = device;
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus PlacedModelPool::RunInference(
+    int model_index, const std::vector<uint8_t>& input,
+    std::vector<std::vector<float>>* outputs) {
+  CHECK(outputs);
+  {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    PLACED_MODEL_POOL_INIT_CHECK();
+    EDGETPU_API_REPORT_ERROR(error_reporter_,
+                             model_index < 0 || model_index >= models_.size(),
+                             "Invalid model index!");
+  }
+  Model& model = *models_[model_index];
+  std::lock_guard<std::mutex> lock(model.mutex);
+  const float* output;
+  int output_size;
+  if (model.engine->RunInference(input.data(), input.size(), &output,
+                                 &output_size) != kEdgeTpuApiOk) {
+    std::lock_guard<std::mutex> error_lock(error_mutex_);
+    error_reporter_->Report(model.engine->get_error_message());
+    return kEdgeTpuApiError;
+  }
+  float inference_time_ms;
+  model.engine->get_inference_time(&inference_time_ms);
+  ++model.num_requests;
+  if (model.min_inference_time_ms == 0 ||
+      inference_time_ms < model.min_inference_time_ms) {
+    model.min_inference_time_ms = inference_time_ms;
+  }
+
+  const int* tensor_sizes;
+  int num_tensors;
+  model.engine->get_all_output_tensors_sizes(&tensor_sizes, &num_tensors);
+  outputs->resize(num_tensors);
+  for (int i = 0; i < num_tensors; ++i) {
+    (*outputs)[i].assign(output, output + tensor_sizes[i]);
+    output += tensor_sizes[i];
+  }
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus PlacedModelPool::Replan(double min_improvement, bool* moved) {
+  CHECK(moved);
+  *moved = false;
+  std::lock_guard<std::mutex> plan_lock(plan_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    PLACED_MODEL_POOL_INIT_CHECK();
+  }
+  const auto now = Clock::now();
+  const double seconds =
+      std::chrono::duration<double>(now - plan_time_).count();
+  std::vector<ModelProfile> profiles;
+  std::vector<int> current_devices;
+  for (auto& model : models_) {
+    std::lock_guard<std::mutex> lock(model->mutex);
+    if (seconds > 0) {
+      model->profile.request_rate = model->num_requests / seconds;
+    }
+    model->profile.inference_time_ms = model->min_inference_time_ms;
+    model->num_requests = 0;
+    profiles.push_back(model->profile);
+    current_devices.push_back(model->device);
+  }
+  plan_time_ = now;
+
+  PlacementPlan new_plan =
+      PlanPlacement(profiles, device_paths_.size(), options_);
+  plan_.model_devices = current_devices;
+  plan_.device_utilizations = EstimateDeviceUtilizations(
+      profiles, current_devices, device_paths_.size(), options_);
+  plan_.max_utilization = *std::max_element(plan_.device_utilizations.begin(),
+                                            plan_.device_utilizations.end());
+  if (plan_.max_utilization - new_plan.max_utilization <= min_improvement) {
+    return kEdgeTpuApiOk;
+  }
+
+  for (int i = 0; i < models_.size(); ++i) {
+    if (new_plan.model_devices[i] == current_devices[i]) continue;
+    EDGETPU_API_ENSURE_STATUS(
+        OpenEngine(new_plan.model_devices[i], models_[i].get()));
+    plan_.model_devices[i] = new_plan.model_devices[i];
+    *moved = true;
+  }
+  plan_ = std::move(new_plan);
+  return kEdgeTpuApiOk;
+}
+
+std::string PlacedModelPool::device_path(int model_index) {
+  CHECK_GE(model_index, 0);
+  CHECK_LT(model_index, models_.size());
+  std::lock_guard<std::mutex> lock(models_[model_index]->mutex);
+  return device_paths_[models_[model_index]->device];
+}
+
+std::vector<ModelProfile> PlacedModelPool::profiles() {
+  std::lock_guard<std::mutex> lock(plan_mutex_);
+  std::vector<ModelProfile> profiles;
+  for (const auto& model : models_) profiles.push_back(model->profile);
+  return profiles;
+}
+
+PlacementPlan PlacedModelPool::plan() {
+  std::lock_guard<std::mutex> lock(plan_mutex_);
+  return plan_;
+}
+
+std::string PlacedModelPool::get_error_message() {
+  std::lock_guard<std::mutex> lock(error_mutex_);
+  return error_reporter_->message();
+}
+
+PlacedModelPoolBuilder::PlacedModelPoolBuilder(
+    const std::vector<std::string>& model_paths,
+    const std::vector<std::string>& device_paths,
+    const PlacementOptions& options)
+    : model_paths_(model_paths),
+      device_paths_(device_paths),
+      options_(options) {
+  error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
+}
+
+EdgeTpuApiStatus PlacedModelPoolBuilder::operator()(
+    std::unique_ptr<PlacedModelPool>* pool) {
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_, !pool,
+      "Null output pointer passed to PlacedModelPoolBuilder!");
+  (*pool) = absl::make_unique<PlacedModelPool>();
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_,
+      (*pool)->Init(model_paths_, device_paths_, options_) == kEdgeTpuApiError,
+      (*pool)->get_error_message());
+  return kEdgeTpuApiOk;
+}
+
+}  // namespace coral
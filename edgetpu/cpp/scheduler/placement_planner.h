@@ -0,0 +1,187 @@
+#ifndef EDGETPU_CPP_SCHEDULER_PLACEMENT_PLANNER_H_
+#define EDGETPU_CPP_SCHEDULER_PLACEMENT_PLANNER_H_
+
+#include <chrono>  // NOLINT
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "edgetpu/cpp/basic/basic_engine_native.h"
+#include "edgetpu/cpp/error_reporter.h"
+
+namespace coral {
+
+// What the planner knows about a model.
+struct ModelProfile {
+  // Size of the parameters the model caches on an Edge TPU, in bytes, e.g. the
+  // payload of its Edge TPU custom ops.
+  size_t parameter_bytes = 0;
+  // Requests per second.
+  double request_rate = 0;
+  // Inference time with parameters already cached, in milliseconds.
+  double inference_time_ms = 0;
+};
+
+struct PlacementOptions {
+  // Speed at which an Edge TPU reloads parameters when it switches between
+  // separately compiled models, in bytes per second.
+  double reload_bytes_per_second = 100e6;
+  // Requests of a model run in a row before switching, e.g. the batches of a
+  // ModelScheduler, which divide the number of reloads.
+  int batch_size = 1;
+};
+
+struct PlacementPlan {
+  // Index of the device of each model.
+  std::vector<int> model_devices;
+  // Estimated fraction of time each device is busy, reloads included. Above 1
+  // the device can't keep up with its requests.
+  std::vector<double> device_utilizations;
+  double max_utilization = 0;
+};
+
+// Estimates the fraction of time each of `num_devices` devices is busy when
+// model i runs on device `model_devices[i]`.
+//
+// Models sharing a device evict each other's parameters. A request of model m
+// reloads them when a request of another model ran before it, at most
+// min(rate of m, rate of the other models) times per second.
+std::vector<double> EstimateDeviceUtilizations(
+    const std::vector<ModelProfile>& models,
+    const std::vector<int>& model_devices, int num_devices,
+    const PlacementOptions& options);
+
+// Assigns `models` to `num_devices` Edge TPUs, minimizing the utilization of
+// the busiest one. Busy models go first, each to the device it loads the
+// least, then single models move while that improves the plan, e.g. to keep
+// large models apart so that they don't reload each other's parameters.
+PlacementPlan PlanPlacement(const std::vector<ModelProfile>& models,
+                            int num_devices, const PlacementOptions& options);
+
+// Runs models on several Edge TPUs as placed by PlanPlacement(), with request
+// rates and inference times observed at runtime. Replan() moves models when
+// traffic shifted enough.
+//
+// RunInference() of different models can be called from different threads.
+class PlacedModelPool {
+ public:
+  PlacedModelPool();
+
+  // Copying or assignment is disallowed
+  PlacedModelPool(const PlacedModelPool&) = delete;
+  PlacedModelPool& operator=(const PlacedModelPool&) = delete;
+
+  // Places models `model_paths` on Edge TPUs `device_paths`, or all of them if
+  // empty, assuming they get as many requests, and opens their engines.
+  EdgeTpuApiStatus Init(const std::vector<std::string>& model_paths,
+                        const std::vector<std::string>& device_paths,
+                        const PlacementOptions& options);
+
+  // Runs model `model_index` on `input`, see BasicEngine::RunInference().
+  EdgeTpuApiStatus RunInference(int model_index,
+                                const std::vector<uint8_t>& input,
+                                std::vector<std::vector<float>>* outputs);
+
+  // Plans again with the request rates since the last plan. Moves models only
+  // if that lowers the maximum utilization by more than `min_improvement`,
+  // such that noise doesn't reopen engines all the time. Sets `moved` to
+  // whether any model moved.
+  EdgeTpuApiStatus Replan(double min_improvement, bool* moved);
+
+  int num_models() const { return models_.size(); }
+
+  // Path of the Edge TPU model `model_index` runs on.
+  std::string device_path(int model_index);
+
+  // Profiles used by the last plan.
+  std::vector<ModelProfile> profiles();
+
+  PlacementPlan plan();
+
+  // Caller can use this function to retrieve error message when get
+  // kEdgeTpuApiError.
+  std::string get_error_message();
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Model {
+    std::string path;
+    // Guarded by `plan_mutex_`.
+    ModelProfile profile;
+    // Guards the engine and the state below.
+    std::mutex mutex;
+    std::unique_ptr<BasicEngineNative> engine;
+    int device = -1;
+    int64_t num_requests = 0;
+    // Shortest inference time seen, without reloads of parameters.
+    double min_inference_time_ms = 0;
+  };
+
+  // Opens the engine of `model` on device `device`.
+  EdgeTpuApiStatus OpenEngine(int device, Model* model);
+
+  std::vector<std::string> device_paths_;
+  PlacementOptions options_;
+  std::vector<std::unique_ptr<Model>> models_;
+
+  // Guards the plan, and serializes Replan().
+  std::mutex plan_mutex_;
+  PlacementPlan plan_;
+  Clock::time_point plan_time_;
+
+  // Guards `error_reporter_`.
+  std::mutex error_mutex_;
+  // Data structure to stores error messages.
+  std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
+  // Indicates whether the instance is initialized.
+  bool is_initialized_ = false;
+};
+
+// Builds a PlacedModelPool.
+//
+// model_paths: The file paths of the models to place.
+// device_paths: Edge TPUs to place them on, or empty for all of them.
+// options: Cost of reloads, see PlacementOptions.
+//
+// Example:
+//   PlacedModelPoolBuilder builder(model_paths);
+//   std::unique_ptr<PlacedModelPool> pool;
+//   if (builder(&pool) == kEdgeTpuApiOk) {
+//     pool->RunInference(0, input, &outputs);
+//     ...
+//     // Every now and then.
+//     bool moved;
+//     pool->Replan(/*min_improvement=*/0.1, &moved);
+//   }
+class PlacedModelPoolBuilder {
+ public:
+  explicit PlacedModelPoolBuilder(
+      const std::vector<std::string>& model_paths,
+      const std::vector<std::string>& device_paths = {},
+      const PlacementOptions& options = PlacementOptions());
+
+  // Disallows copy and assign.
+  PlacedModelPoolBuilder(const PlacedModelPoolBuilder&) = delete;
+  PlacedModelPoolBuilder& operator=(const PlacedModelPoolBuilder&) = delete;
+
+  EdgeTpuApiStatus operator()(std::unique_ptr<PlacedModelPool>* pool);
+
+  // Caller can use this function to retrieve error message when get
+  // kEdgeTpuApiError.
+  std::string get_error_message() { return error_reporter_->message(); }
+
+ private:
+  // Data structure to stores error messages.
+  std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
+  std::vector<std::string> model_paths_;
+  std::vector<std::string> device_paths_;
+  PlacementOptions options_;
+};
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_SCHEDULER_PLACEMENT_PLANNER_H_
@@ -0,0 +1,161 @@
+#include "edgetpu/cpp/scheduler/placement_planner.h"
+
+#include <algorithm>
+
+#include "edgetpu/cpp/basic/basic_engine.h"
+#include "edgetpu/cpp/test_utils.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace coral {
+namespace {
+
+ModelProfile Profile(size_t parameter_bytes, double request_rate,
+                     double inference_time_ms) {
+  ModelProfile profile;
+  profile.parameter_bytes = parameter_bytes;
+  profile.request_rate = request_rate;
+  profile.inference_time_ms = inference_time_ms;
+  return profile;
+}
+
+TEST(PlacementPlannerTest, EstimateDeviceUtilizations) {
+  const std::vector<ModelProfile> models = {Profile(1000000, 10, 5),
+                                            Profile(2000000, 20, 5)};
+  PlacementOptions options;
+  options.reload_bytes_per_second = 100e6;
+  // Inferences take 10 * 5 + 20 * 5 ms per second. Each model reloads at most
+  // 10 times per second, as often as model 0 runs, taking 10 and 20 ms.
+  auto utilizations =
+      EstimateDeviceUtilizations(models, {0, 0}, /*num_devices=*/2, options);
+  ASSERT_EQ(2, utilizations.size());
+  EXPECT_NEAR(0.45, utilizations[0], 1e-9);
+  EXPECT_EQ(0, utilizations[1]);
+
+  // Batches of 2 halve reloads.
+  options.batch_size = 2;
+  utilizations =
+      EstimateDeviceUtilizations(models, {0, 0}, /*num_devices=*/1, options);
+  EXPECT_NEAR(0.3, utilizations[0], 1e-9);
+
+  // No reloads on devices of their own.
+  utilizations =
+      EstimateDeviceUtilizations(models, {0, 1}, /*num_devices=*/2, options);
+  EXPECT_NEAR(0.05, utilizations[0], 1e-9);
+  EXPECT_NEAR(0.1, utilizations[1], 1e-9);
+}
+
+TEST(PlacementPlannerTest, OneModelPerDeviceWhenPossible) {
+  const std::vector<ModelProfile> models(3, Profile(5000000, 10, 5));
+  const PlacementPlan plan =
+      PlanPlacement(models, /*num_devices=*/4, PlacementOptions());
+  EXPECT_EQ(std::vector<int>({0, 1, 2}), plan.model_devices);
+  EXPECT_NEAR(0.05, plan.max_utilization, 1e-9);
+}
+
+TEST(PlacementPlannerTest, BalancesLoad) {
+  const std::vector<ModelProfile> models(4, Profile(1000000, 10, 5));
+  const PlacementPlan plan =
+      PlanPlacement(models, /*num_devices=*/2, PlacementOptions());
+  ASSERT_EQ(2, plan.device_utilizations.size());
+  EXPECT_NEAR(plan.device_utilizations[0], plan.device_utilizations[1], 1e-9);
+  EXPECT_EQ(2, std::count(plan.model_devices.begin(), plan.model_devices.end(),
+                          0));
+}
+
+TEST(PlacementPlannerTest, KeepsLargeModelsApart) {
+  const std::vector<ModelProfile> models = {
+      Profile(7000000, 20, 10), Profile(7000000, 20, 10),
+      Profile(500000, 20, 2), Profile(500000, 20, 2)};
+  const PlacementPlan plan =
+      PlanPlacement(models, /*num_devices=*/2, PlacementOptions());
+  EXPECT_NE(plan.model_devices[0], plan.model_devices[1]);
+  EXPECT_NE(plan.model_devices[2], plan.model_devices[3]);
+  EXPECT_EQ(plan.max_utilization,
+            *std::max_element(plan.device_utilizations.begin(),
+                              plan.device_utilizations.end()));
+}
+
+TEST(PlacementPlannerTest, BusyModelGetsItsOwnDevice) {
+  const std::vector<ModelProfile> models = {
+      Profile(4000000, 50, 10), Profile(4000000, 1, 10),
+      Profile(4000000, 1, 10), Profile(4000000, 1, 10)};
+  const PlacementPlan plan =
+      PlanPlacement(models, /*num_devices=*/2, PlacementOptions());
+  for (int i = 1; i < models.size(); ++i) {
+    EXPECT_NE(plan.model_devices[0], plan.model_devices[i]);
+  }
+}
+
+TEST(PlacedModelPoolTest, RunsAndReplans) {
+  const std::vector<std::string> model_paths = {
+      ModelPath("mobilenet_v1_0.25_128_quant_edgetpu.tflite"),
+      ModelPath("mobilenet_v1_0.5_160_quant_edgetpu.tflite")};
+  PlacedModelPoolBuilder builder(model_paths);
+  std::unique_ptr<PlacedModelPool> pool;
+  ASSERT_EQ(kEdgeTpuApiOk, builder(&pool)) << builder.get_error_message();
+  ASSERT_EQ(2, pool->num_models());
+  for (const auto& profile : pool->profiles()) {
+    EXPECT_GT(profile.parameter_bytes, 0);
+  }
+
+  for (int i = 0; i < model_paths.size(); ++i) {
+    BasicEngine engine(model_paths[i], pool->device_path(i));
+    const auto input = GetRandomInput(engine.get_input_tensor_shape());
+    std::vector<std::vector<float>> outputs;
+    for (int j = 0; j < 10 * (i + 1); ++j) {
+      ASSERT_EQ(kEdgeTpuApiOk, pool->RunInference(i, input, &outputs))
+          << pool->get_error_message();
+    }
+    EXPECT_EQ(engine.RunInference(input), outputs);
+  }
+
+  bool moved;
+  ASSERT_EQ(kEdgeTpuApiOk, pool->Replan(/*min_improvement=*/0, &moved))
+      << pool->get_error_message();
+  const std::vector<ModelProfile> profiles = pool->profiles();
+  EXPECT_GT(profiles[0].request_rate, 0);
+  EXPECT_GT(profiles[1].request_rate, profiles[0].request_rate);
+  EXPECT_GT(profiles[0].inference_time_ms, 0);
+  // Models moved to the new plan, or the current one is as good.
+  EXPECT_LE(pool->plan().max_utilization,
+            PlanPlacement(profiles, pool->plan().device_utilizations.size(),
+                          PlacementOptions())
+                    .max_utilization +
+                1e-9);
+
+  // Nothing changed since.
+  ASSERT_EQ(kEdgeTpuApiOk, pool->Replan(/*min_improvement=*/0, &moved));
+  EXPECT_FALSE(moved);
+}
+
+TEST(PlacedModelPoolTest, Errors) {
+  std::unique_ptr<PlacedModelPool> pool;
+  {
+    PlacedModelPoolBuilder builder({});
+    EXPECT_EQ(kEdgeTpuApiError, builder(&pool));
+    EXPECT_EQ("No model to place!", builder.get_error_message());
+  }
+  {
+    PlacedModelPoolBuilder builder({TestDataPath("cat.bmp")});
+    EXPECT_EQ(kEdgeTpuApiError, builder(&pool));
+    EXPECT_EQ("Not a valid tflite model: " + TestDataPath("cat.bmp"),
+              builder.get_error_message());
+  }
+  PlacedModelPoolBuilder builder(
+      {ModelPath("mobilenet_v1_0.25_128_quant_edgetpu.tflite")});
+  ASSERT_EQ(kEdgeTpuApiOk, builder(&pool));
+  std::vector<std::vector<float>> outputs;
+  EXPECT_EQ(kEdgeTpuApiError, pool->RunInference(1, {}, &outputs));
+  EXPECT_EQ("Invalid model index!", pool->get_error_message());
+}
+
+}  // namespace
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
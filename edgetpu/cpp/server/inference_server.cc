@@ -0,0 +1,234 @@
+#include "edgetpu/cpp/server/inference_server.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "edgetpu/cpp/basic/basic_engine_native.h"
+#include "edgetpu/cpp/server/ipc.h"
+#include "glog/logging.h"
+
+namespace coral {
+
+namespace {
+
+// State of a session, whose client loaded a model.
+struct Session {
+  std::unique_ptr<BasicEngineNative> engine;
+  std::unique_ptr<SharedMemory> slot;
+  int input_size = 0;
+  size_t output_offset = 0;
+};
+
+Message ErrorReply(const std::string& error) {
+  Message reply;
+  reply.ints = {kEdgeTpuApiError};
+  reply.strings = {error};
+  return reply;
+}
+
+Message LoadModel(const Message& request, Session* session) {
+  if (request.strings.size() != 2) return ErrorReply("Malformed kLoadModel.");
+  const std::string& model_path = request.strings[0];
+  BasicEngineNativeBuilder builder(model_path, request.strings[1]);
+  if (builder(&session->engine) != kEdgeTpuApiOk) {
+    return ErrorReply(builder.get_error_message());
+  }
+  BasicEngineNative* engine = session->engine.get();
+  int const* dims;
+  int num_dims;
+  int const* output_sizes;
+  int num_outputs;
+  int output_size;
+  std::string device_path;
+  CHECK_EQ(kEdgeTpuApiOk, engine->get_input_tensor_shape(&dims, &num_dims));
+  CHECK_EQ(kEdgeTpuApiOk, engine->get_input_array_size(&session->input_size));
+  CHECK_EQ(kEdgeTpuApiOk,
+           engine->get_all_output_tensors_sizes(&output_sizes, &num_outputs));
+  CHECK_EQ(kEdgeTpuApiOk, engine->total_output_array_size(&output_size));
+  CHECK_EQ(kEdgeTpuApiOk, engine->device_path(&device_path));
+
+  const SlotLayout layout(session->input_size, output_size);
+  EdgeTpuErrorReporter reporter;
+  session->slot = SharedMemory::Create(layout.size, &reporter);
+  if (!session->slot) {
+    session->engine.reset();
+    return ErrorReply(reporter.message());
+  }
+  session->output_offset = layout.output_offset;
+
+  Message reply;
+  reply.ints = {kEdgeTpuApiOk, num_dims};
+  reply.ints.insert(reply.ints.end(), dims, dims + num_dims);
+  reply.ints.push_back(num_outputs);
+  reply.ints.insert(reply.ints.end(), output_sizes, output_sizes + num_outputs);
+  reply.strings = {device_path};
+  reply.fd = session->slot->fd();
+  VLOG(1) << "Loaded " << model_path << " on " << device_path;
+  return reply;
+}
+
+Message RunInference(const Message& request, Session* session) {
+  if (request.ints.size() != 1) return ErrorReply("Malformed kRunInference.");
+  if (request.ints[0] != session->input_size) {
+    return ErrorReply(absl::StrCat("Input size ", request.ints[0],
+                                   " doesn't match the model's ",
+                                   session->input_size, "."));
+  }
+  BasicEngineNative* engine = session->engine.get();
+  float const* output;
+  int output_size;
+  if (engine->RunInference(session->slot->data(), session->input_size, &output,
+                           &output_size) != kEdgeTpuApiOk) {
+    return ErrorReply(engine->get_error_message());
+  }
+  std::memcpy(session->slot->data() + session->output_offset, output,
+              output_size * sizeof(float));
+  float inference_time_ms;
+  CHECK_EQ(kEdgeTpuApiOk, engine->get_inference_time(&inference_time_ms));
+  Message reply;
+  reply.ints = {kEdgeTpuApiOk, output_size,
+                static_cast<int32_t>(std::lround(inference_time_ms * 1000))};
+  return reply;
+}
+
+}  // namespace
+
+InferenceServer::InferenceServer() {
+  error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
+}
+
+InferenceServer::~InferenceServer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+    // Wakes up sessions waiting for requests.
+    for (int socket : session_sockets_) shutdown(socket, SHUT_RDWR);
+  }
+  if (listen_socket_ >= 0) {
+    // Wakes up Accept().
+    shutdown(listen_socket_, SHUT_RDWR);
+    accept_thread_.join();
+    close(listen_socket_);
+    unlink(socket_path_.c_str());
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  sessions_ended_.wait(lock, [this] { return session_sockets_.empty(); });
+}
+
+EdgeTpuApiStatus InferenceServer::Init(const std::string& socket_path) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_, socket_path.size() >= sizeof(address.sun_path),
+      absl::StrCat("Socket path is too long: ", socket_path));
+  std::strncpy(address.sun_path, socket_path.c_str(),
+               sizeof(address.sun_path) - 1);
+
+  const int listen_socket = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_, listen_socket < 0,
+      absl::StrCat("Failed to create socket: ", std::strerror(errno)));
+  unlink(socket_path.c_str());
+  if (bind(listen_socket, reinterpret_cast<sockaddr*>(&address),
+           sizeof(address)) != 0 ||
+      listen(listen_socket, SOMAXCONN) != 0) {
+    error_reporter_->Report(absl::StrCat("Failed to listen at ", socket_path,
+                                         ": ", std::strerror(errno)));
+    close(listen_socket);
+    return kEdgeTpuApiError;
+  }
+  socket_path_ = socket_path;
+  listen_socket_ = listen_socket;
+  accept_thread_ = std::thread(&InferenceServer::Accept, this);
+  return kEdgeTpuApiOk;
+}
+
+int InferenceServer::num_sessions() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return session_sockets_.size();
+}
+
+std::string InferenceServer::get_error_message() {
+  std::lock_guard<std::mutex> lock(error_mutex_);
+  return error_reporter_->message();
+}
+
+void InferenceServer::Accept() {
+  while (true) {
+    const int socket = accept4(listen_socket_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (socket < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      // Shut down, or broken.
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!stopped_) LOG(ERROR) << "accept() failed: " << std::strerror(errno);
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopped_) {
+      close(socket);
+      return;
+    }
+    session_sockets_.insert(socket);
+    std::thread(&InferenceServer::Serve, this, socket).detach();
+  }
+}
+
+void InferenceServer::Serve(int socket) {
+  Session session;
+  EdgeTpuErrorReporter reporter;
+  Message request;
+  bool closed = false;
+  while (ReceiveMessage(socket, &request, &closed, &reporter) ==
+         kEdgeTpuApiOk) {
+    // Clients have no reason to pass descriptors.
+    if (request.fd >= 0) close(request.fd);
+    Message reply;
+    if (request.type == MessageType::kLoadModel && !session.engine) {
+      reply = LoadModel(request, &session);
+    } else if (request.type == MessageType::kRunInference && session.engine) {
+      reply = RunInference(request, &session);
+    } else {
+      reply = ErrorReply("Unexpected message.");
+    }
+    if (SendMessage(socket, reply, &reporter) != kEdgeTpuApiOk) break;
+  }
+  if (!closed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!stopped_) LOG(WARNING) << "Session ended: " << reporter.message();
+  }
+  // Releases the Edge TPU before the session is seen as ended.
+  session.engine.reset();
+  session.slot.reset();
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Closed once erased, as Accept() may reuse the descriptor right away.
+  session_sockets_.erase(socket);
+  close(socket);
+  sessions_ended_.notify_all();
+}
+
+InferenceServerBuilder::InferenceServerBuilder(const std::string& socket_path)
+    : socket_path_(socket_path) {
+  error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
+}
+
+EdgeTpuApiStatus InferenceServerBuilder::operator()(
+    std::unique_ptr<InferenceServer>* server) {
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_, !server,
+      "Null output pointer passed to InferenceServerBuilder!");
+  (*server) = absl::make_unique<InferenceServer>();
+  EDGETPU_API_REPORT_ERROR(error_reporter_,
+                           (*server)->Init(socket_path_) == kEdgeTpuApiError,
+                           (*server)->get_error_message());
+  return kEdgeTpuApiOk;
+}
+
+}  // namespace coral
@@ -0,0 +1,103 @@
+#ifndef EDGETPU_CPP_SERVER_INFERENCE_SERVER_H_
+#define EDGETPU_CPP_SERVER_INFERENCE_SERVER_H_
+
+#include <condition_variable>  // NOLINT
+#include <memory>
+#include <mutex>  // NOLINT
+#include <set>
+#include <string>
+#include <thread>  // NOLINT
+
+#include "edgetpu/cpp/error_reporter.h"
+
+namespace coral {
+
+// Serves inferences of the Edge TPUs of this process to other processes, over
+// a Unix domain socket, since an Edge TPU can be opened by one process only.
+//
+// Each connection of a client, e.g. a RemoteEngineNative, is a session with a
+// BasicEngineNative of its own, which gets an Edge TPU from
+// EdgeTpuResourceManager as in the client process. Tensors go through a slot
+// of shared memory per session, whose file descriptor the server passes to
+// the client, such that the socket only carries small control messages. See
+// ipc.h for the protocol.
+//
+// Sessions are served in a thread each, and engines of several sessions can
+// share an Edge TPU, like engines of several threads.
+//
+// This class is thread-safe.
+class InferenceServer {
+ public:
+  InferenceServer();
+  // Stops accepting clients, closes their sessions and waits for them to end.
+  ~InferenceServer();
+
+  InferenceServer(const InferenceServer&) = delete;
+  InferenceServer& operator=(const InferenceServer&) = delete;
+
+  // Listens at `socket_path`, replacing any socket there, and starts accepting
+  // clients.
+  EdgeTpuApiStatus Init(const std::string& socket_path);
+
+  const std::string& socket_path() const { return socket_path_; }
+
+  // Number of open sessions.
+  int num_sessions();
+
+  // Caller can use this function to retrieve error message when get
+  // kEdgeTpuApiError.
+  std::string get_error_message();
+
+ private:
+  // Accepts clients until the listening socket is shut down.
+  void Accept();
+
+  // Serves the session of client `socket`, until either side closes it.
+  void Serve(int socket);
+
+  std::string socket_path_;
+  int listen_socket_ = -1;
+  std::thread accept_thread_;
+
+  // Guards the state below.
+  std::mutex mutex_;
+  std::condition_variable sessions_ended_;
+  bool stopped_ = false;
+  // Sockets of open sessions, whose threads are detached.
+  std::set<int> session_sockets_;
+
+  // Guards `error_reporter_`.
+  std::mutex error_mutex_;
+  // Data structure to stores error messages.
+  std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
+};
+
+// Builds an InferenceServer listening at `socket_path`.
+//
+// Example:
+//   InferenceServerBuilder builder("/tmp/edgetpu.sock");
+//   std::unique_ptr<InferenceServer> server;
+//   CHECK_EQ(kEdgeTpuApiOk, builder(&server)) << builder.get_error_message();
+class InferenceServerBuilder {
+ public:
+  explicit InferenceServerBuilder(const std::string& socket_path);
+
+  // Disallows copy and assign.
+  InferenceServerBuilder(const InferenceServerBuilder&) = delete;
+  InferenceServerBuilder& operator=(const InferenceServerBuilder&) = delete;
+
+  EdgeTpuApiStatus operator()(std::unique_ptr<InferenceServer>* server);
+
+  // Caller can use this function to retrieve error message when get
+  // kEdgeTpuApiError.
+  std::string get_error_message() { return error_reporter_->message(); }
+
+ private:
+  // Data structure to stores error messages.
+  std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
+  std::string socket_path_;
+};
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_SERVER_INFERENCE_SERVER_H_
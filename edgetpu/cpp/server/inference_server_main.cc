@@ -0,0 +1,41 @@
+// Daemon which owns the Edge TPUs of the machine and serves inferences to
+// other processes, through RemoteEngine, until it gets SIGINT or SIGTERM.
+//
+// Example:
+//   inference_server --socket_path=/tmp/edgetpu.sock
+// and in clients:
+//   RemoteEngine engine("/tmp/edgetpu.sock", "/models/x_edgetpu.tflite");
+
+#include <signal.h>
+
+#include <memory>
+
+#include "edgetpu/cpp/server/inference_server.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DEFINE_string(socket_path, "/tmp/edgetpu.sock",
+              "Path of the Unix domain socket to serve at.");
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  google::InitGoogleLogging(argv[0]);
+
+  // Blocked in all threads, so that sigwait() gets them.
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  CHECK_EQ(0, pthread_sigmask(SIG_BLOCK, &signals, nullptr));
+
+  coral::InferenceServerBuilder builder(FLAGS_socket_path);
+  std::unique_ptr<coral::InferenceServer> server;
+  CHECK_EQ(coral::kEdgeTpuApiOk, builder(&server))
+      << builder.get_error_message();
+  LOG(INFO) << "Serving at " << FLAGS_socket_path;
+
+  int signal;
+  CHECK_EQ(0, sigwait(&signals, &signal));
+  LOG(INFO) << "Stopping, " << server->num_sessions() << " sessions open.";
+  return 0;
+}
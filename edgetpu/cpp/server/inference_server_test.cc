@@ -0,0 +1,156 @@
+#include "edgetpu/cpp/server/inference_server.h"
+
+#include <unistd.h>
+
+#include <chrono>  // NOLINT
+#include <cstring>
+#include <thread>  // NOLINT
+
+#include "absl/memory/memory.h"
+#include "edgetpu/cpp/basic/basic_engine.h"
+#include "edgetpu/cpp/basic/edgetpu_resource_manager.h"
+#include "edgetpu/cpp/basic/simulated_edgetpu_manager.h"
+#include "edgetpu/cpp/server/remote_engine.h"
+#include "edgetpu/cpp/test_utils.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace coral {
+namespace {
+
+constexpr char kCpuModel[] = "mobilenet_v1_1.0_224_quant.tflite";
+constexpr char kEdgeTpuModel[] = "mobilenet_v1_1.0_224_quant_edgetpu.tflite";
+
+// Serves simulated Edge TPUs, which run CPU models, such that tests run
+// without Edge TPUs.
+class InferenceServerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SetEdgeTpuDeviceManager(absl::make_unique<SimulatedEdgeTpuManager>(
+        std::vector<SimulatedEdgeTpuOptions>(2)));
+    socket_path_ =
+        "/tmp/inference_server_test_" + std::to_string(getpid()) + ".sock";
+    InferenceServerBuilder builder(socket_path_);
+    ASSERT_EQ(kEdgeTpuApiOk, builder(&server_)) << builder.get_error_message();
+  }
+
+  void TearDown() override {
+    server_.reset();
+    EXPECT_TRUE(EdgeTpuResourceManager::GetSingleton()
+                    ->ListEdgeTpuPaths(
+                        EdgeTpuResourceManager::EdgeTpuState::kAssigned)
+                    .empty());
+    SetEdgeTpuDeviceManager(nullptr);
+  }
+
+  std::string socket_path_;
+  std::unique_ptr<InferenceServer> server_;
+};
+
+TEST_F(InferenceServerTest, RunsLikeBasicEngine) {
+  for (const char* model : {kCpuModel, kEdgeTpuModel}) {
+    SCOPED_TRACE(model);
+    RemoteEngine remote_engine(socket_path_, ModelPath(model));
+    BasicEngine engine(ModelPath(model));
+    EXPECT_EQ(ModelPath(model), remote_engine.model_path());
+    EXPECT_EQ(0, remote_engine.device_path().find("/sim/edgetpu/"));
+    EXPECT_EQ(engine.get_input_tensor_shape(),
+              remote_engine.get_input_tensor_shape());
+    EXPECT_EQ(engine.get_all_output_tensors_sizes(),
+              remote_engine.get_all_output_tensors_sizes());
+    for (int i = 0; i < 3; ++i) {
+      const auto input = GetRandomInput(engine.get_input_tensor_shape());
+      EXPECT_EQ(engine.RunInference(input), remote_engine.RunInference(input));
+      EXPECT_GT(remote_engine.get_inference_time(), 0);
+    }
+  }
+}
+
+TEST_F(InferenceServerTest, RunsInputBufferInPlace) {
+  RemoteEngineNativeBuilder builder(socket_path_, ModelPath(kCpuModel));
+  std::unique_ptr<RemoteEngineNative> remote_engine;
+  ASSERT_EQ(kEdgeTpuApiOk, builder(&remote_engine))
+      << builder.get_error_message();
+  BasicEngine engine(ModelPath(kCpuModel));
+  const auto input = GetRandomInput(engine.get_input_tensor_shape());
+  std::memcpy(remote_engine->input_buffer(), input.data(), input.size());
+  float const* output;
+  int output_size;
+  ASSERT_EQ(kEdgeTpuApiOk,
+            remote_engine->RunInference(remote_engine->input_buffer(),
+                                        input.size(), &output, &output_size))
+      << remote_engine->get_error_message();
+  EXPECT_EQ(engine.RunInference(input)[0],
+            std::vector<float>(output, output + output_size));
+}
+
+TEST_F(InferenceServerTest, ServesClientsConcurrently) {
+  constexpr int kNumClients = 4;
+  constexpr int kNumInferences = 10;
+  BasicEngine engine(ModelPath(kEdgeTpuModel));
+  const auto input = GetRandomInput(engine.get_input_tensor_shape());
+  const auto expected = engine.RunInference(input);
+  std::vector<std::thread> clients;
+  for (int i = 0; i < kNumClients; ++i) {
+    clients.emplace_back([this, &input, &expected] {
+      RemoteEngine remote_engine(socket_path_, ModelPath(kEdgeTpuModel),
+                                 "/sim/edgetpu/1");
+      for (int j = 0; j < kNumInferences; ++j) {
+        EXPECT_EQ(expected, remote_engine.RunInference(input));
+      }
+    });
+  }
+  for (auto& client : clients) client.join();
+}
+
+TEST_F(InferenceServerTest, EndsSessionsOfClosedClients) {
+  {
+    RemoteEngine remote_engine(socket_path_, ModelPath(kCpuModel));
+    EXPECT_EQ(1, server_->num_sessions());
+  }
+  // The server notices asynchronously.
+  for (int i = 0; i < 100 && server_->num_sessions() > 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_EQ(0, server_->num_sessions());
+}
+
+TEST_F(InferenceServerTest, ReportsErrors) {
+  {
+    RemoteEngineNativeBuilder builder(socket_path_,
+                                      ModelPath("missing.tflite"));
+    std::unique_ptr<RemoteEngineNative> remote_engine;
+    EXPECT_EQ(kEdgeTpuApiError, builder(&remote_engine));
+    EXPECT_FALSE(builder.get_error_message().empty());
+  }
+  {
+    RemoteEngineNativeBuilder builder(socket_path_, ModelPath(kCpuModel));
+    std::unique_ptr<RemoteEngineNative> remote_engine;
+    ASSERT_EQ(kEdgeTpuApiOk, builder(&remote_engine));
+    const std::vector<uint8_t> input(7);
+    float const* output;
+    int output_size;
+    EXPECT_EQ(kEdgeTpuApiError,
+              remote_engine->RunInference(input.data(), input.size(), &output,
+                                          &output_size));
+    EXPECT_EQ("Input size 7 doesn't match the model's 150528.",
+              remote_engine->get_error_message());
+  }
+  {
+    RemoteEngineNativeBuilder builder("/tmp/no_inference_server.sock",
+                                      ModelPath(kCpuModel));
+    std::unique_ptr<RemoteEngineNative> remote_engine;
+    EXPECT_EQ(kEdgeTpuApiError, builder(&remote_engine));
+    EXPECT_EQ(0, builder.get_error_message().find("Failed to connect"));
+  }
+}
+
+}  // namespace
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
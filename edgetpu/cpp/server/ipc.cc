@@ -0,0 +1,206 @@
+#include "edgetpu/cpp/server/ipc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+
+#include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+
+namespace coral {
+
+namespace {
+
+void AppendInt(int32_t value, std::string* buffer) {
+  buffer->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Reads an int at `*offset` of `buffer`, advancing `offset`.
+bool ReadInt(const std::string& buffer, size_t* offset, int32_t* value) {
+  if (buffer.size() - *offset < sizeof(*value)) return false;
+  std::memcpy(value, buffer.data() + *offset, sizeof(*value));
+  *offset += sizeof(*value);
+  return true;
+}
+
+// Encodes `message`, without its fd, as its type, number of ints, number of
+// strings, ints, and size and bytes of each string.
+std::string Encode(const Message& message) {
+  std::string buffer;
+  AppendInt(static_cast<int32_t>(message.type), &buffer);
+  AppendInt(message.ints.size(), &buffer);
+  AppendInt(message.strings.size(), &buffer);
+  for (int32_t value : message.ints) AppendInt(value, &buffer);
+  for (const auto& text : message.strings) {
+    AppendInt(text.size(), &buffer);
+    buffer += text;
+  }
+  return buffer;
+}
+
+bool Decode(const std::string& buffer, Message* message) {
+  size_t offset = 0;
+  int32_t type, num_ints, num_strings;
+  if (!ReadInt(buffer, &offset, &type) ||
+      !ReadInt(buffer, &offset, &num_ints) ||
+      !ReadInt(buffer, &offset, &num_strings) || num_ints < 0 ||
+      num_strings < 0) {
+    return false;
+  }
+  message->type = static_cast<MessageType>(type);
+  message->ints.resize(num_ints);
+  for (auto& value : message->ints) {
+    if (!ReadInt(buffer, &offset, &value)) return false;
+  }
+  message->strings.resize(num_strings);
+  for (auto& text : message->strings) {
+    int32_t size;
+    if (!ReadInt(buffer, &offset, &size) || size < 0 ||
+        buffer.size() - offset < size) {
+      return false;
+    }
+    text.assign(buffer, offset, size);
+    offset += size;
+  }
+  return offset == buffer.size();
+}
+
+}  // namespace
+
+EdgeTpuApiStatus SendMessage(int socket, const Message& message,
+                             EdgeTpuErrorReporter* reporter) {
+  const std::string buffer = Encode(message);
+  if (buffer.size() > kMaxMessageSize) {
+    reporter->Report(absl::StrCat("Message of ", buffer.size(),
+                                  " bytes is too large."));
+    return kEdgeTpuApiError;
+  }
+  iovec iov = {const_cast<char*>(buffer.data()), buffer.size()};
+  msghdr header = {};
+  header.msg_iov = &iov;
+  header.msg_iovlen = 1;
+  char control[CMSG_SPACE(sizeof(int))] = {};
+  if (message.fd >= 0) {
+    header.msg_control = control;
+    header.msg_controllen = sizeof(control);
+    cmsghdr* control_header = CMSG_FIRSTHDR(&header);
+    control_header->cmsg_level = SOL_SOCKET;
+    control_header->cmsg_type = SCM_RIGHTS;
+    control_header->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(control_header), &message.fd, sizeof(int));
+  }
+  ssize_t sent;
+  do {
+    sent = sendmsg(socket, &header, MSG_NOSIGNAL);
+  } while (sent < 0 && errno == EINTR);
+  if (sent != buffer.size()) {
+    reporter->Report(
+        absl::StrCat("Failed to send message: ", std::strerror(errno)));
+    return kEdgeTpuApiError;
+  }
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus ReceiveMessage(int socket, Message* message, bool* closed,
+                                EdgeTpuErrorReporter* reporter) {
+  CHECK(message);
+  CHECK(closed);
+  *closed = false;
+  std::string buffer(kMaxMessageSize, '\0');
+  iovec iov = {&buffer[0], buffer.size()};
+  msghdr header = {};
+  header.msg_iov = &iov;
+  header.msg_iovlen = 1;
+  char control[CMSG_SPACE(sizeof(int))] = {};
+  header.msg_control = control;
+  header.msg_controllen = sizeof(control);
+  ssize_t received;
+  do {
+    received = recvmsg(socket, &header, MSG_CMSG_CLOEXEC);
+  } while (received < 0 && errno == EINTR);
+  if (received == 0) {
+    *closed = true;
+    reporter->Report("Connection closed.");
+    return kEdgeTpuApiError;
+  }
+  if (received < 0) {
+    reporter->Report(
+        absl::StrCat("Failed to receive message: ", std::strerror(errno)));
+    return kEdgeTpuApiError;
+  }
+
+  message->fd = -1;
+  for (cmsghdr* control_header = CMSG_FIRSTHDR(&header);
+       control_header != nullptr;
+       control_header = CMSG_NXTHDR(&header, control_header)) {
+    if (control_header->cmsg_level == SOL_SOCKET &&
+        control_header->cmsg_type == SCM_RIGHTS) {
+      std::memcpy(&message->fd, CMSG_DATA(control_header), sizeof(int));
+    }
+  }
+  buffer.resize(received);
+  if ((header.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) ||
+      !Decode(buffer, message)) {
+    if (message->fd >= 0) close(message->fd);
+    message->fd = -1;
+    reporter->Report("Received a malformed message.");
+    return kEdgeTpuApiError;
+  }
+  return kEdgeTpuApiOk;
+}
+
+std::unique_ptr<SharedMemory> SharedMemory::Create(
+    size_t size, EdgeTpuErrorReporter* reporter) {
+  // Unlinked right away, so that only descriptors refer to it.
+  char name[64];
+  static std::atomic<int> counter(0);
+  std::snprintf(name, sizeof(name), "/coral-%d-%d", getpid(), counter++);
+  const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    reporter->Report(absl::StrCat("Failed to create shared memory: ",
+                                  std::strerror(errno)));
+    return nullptr;
+  }
+  shm_unlink(name);
+  if (ftruncate(fd, size) != 0) {
+    reporter->Report(
+        absl::StrCat("Failed to size shared memory: ", std::strerror(errno)));
+    close(fd);
+    return nullptr;
+  }
+  return Map(fd, size, reporter);
+}
+
+std::unique_ptr<SharedMemory> SharedMemory::Map(
+    int fd, size_t size, EdgeTpuErrorReporter* reporter) {
+  void* data =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    reporter->Report(
+        absl::StrCat("Failed to map shared memory: ", std::strerror(errno)));
+    close(fd);
+    return nullptr;
+  }
+  return std::unique_ptr<SharedMemory>(
+      new SharedMemory(fd, size, static_cast<uint8_t*>(data)));
+}
+
+SharedMemory::~SharedMemory() {
+  munmap(data_, size_);
+  close(fd_);
+}
+
+SlotLayout::SlotLayout(int input_size, int output_size) {
+  constexpr size_t kAlignment = 64;
+  input_offset = 0;
+  output_offset = (input_size + kAlignment - 1) / kAlignment * kAlignment;
+  size = output_offset + output_size * sizeof(float);
+}
+
+}  // namespace coral
@@ -0,0 +1,94 @@
+#ifndef EDGETPU_CPP_SERVER_IPC_H_
+#define EDGETPU_CPP_SERVER_IPC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "edgetpu/cpp/error_reporter.h"
+
+namespace coral {
+
+// Messages between InferenceServer and RemoteEngineNative, over a Unix
+// SOCK_SEQPACKET socket, which keeps message boundaries.
+//
+// A session serves one model:
+//   client: kLoadModel {strings: model path, device path}
+//   server: kReply {ints: status, number of input dims, input dims...,
+//                         number of outputs, output sizes...;
+//                   strings: error message or device path; fd: slot}
+// and then any number of inferences, whose tensors are in the slot:
+//   client: kRunInference {ints: input size}
+//   server: kReply {ints: status, output size, inference time in us;
+//                   strings: error message}
+// Closing the socket ends the session.
+enum class MessageType : int32_t {
+  kLoadModel = 1,
+  kRunInference = 2,
+  kReply = 3,
+};
+
+struct Message {
+  MessageType type = MessageType::kReply;
+  std::vector<int32_t> ints;
+  std::vector<std::string> strings;
+  // File descriptor passed along the message, or -1. Received ones are owned
+  // by the receiver.
+  int fd = -1;
+};
+
+// Largest encoded message.
+constexpr size_t kMaxMessageSize = 64 * 1024;
+
+EdgeTpuApiStatus SendMessage(int socket, const Message& message,
+                             EdgeTpuErrorReporter* reporter);
+
+// Receives the next message. Sets `closed` and returns kEdgeTpuApiError if the
+// peer closed the socket.
+EdgeTpuApiStatus ReceiveMessage(int socket, Message* message, bool* closed,
+                                EdgeTpuErrorReporter* reporter);
+
+// Anonymous shared memory, which processes share by passing its file
+// descriptor.
+class SharedMemory {
+ public:
+  // Creates `size` bytes of shared memory.
+  static std::unique_ptr<SharedMemory> Create(size_t size,
+                                              EdgeTpuErrorReporter* reporter);
+  // Maps shared memory of another process, taking ownership of `fd`.
+  static std::unique_ptr<SharedMemory> Map(int fd, size_t size,
+                                           EdgeTpuErrorReporter* reporter);
+
+  ~SharedMemory();
+
+  SharedMemory(const SharedMemory&) = delete;
+  SharedMemory& operator=(const SharedMemory&) = delete;
+
+  int fd() const { return fd_; }
+  size_t size() const { return size_; }
+  uint8_t* data() { return data_; }
+
+ private:
+  SharedMemory(int fd, size_t size, uint8_t* data)
+      : fd_(fd), size_(size), data_(data) {}
+
+  const int fd_;
+  const size_t size_;
+  uint8_t* const data_;
+};
+
+// Layout of the shared-memory slot of a session: the input tensor, followed
+// by the float output array at a cache-line boundary.
+struct SlotLayout {
+  SlotLayout(int input_size, int output_size);
+
+  size_t input_offset;
+  size_t output_offset;
+  size_t size;
+};
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_SERVER_IPC_H_
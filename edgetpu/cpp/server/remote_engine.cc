@@ -0,0 +1,278 @@
+#include "edgetpu/cpp/server/remote_engine.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+
+namespace coral {
+
+#define REMOTE_ENGINE_ENSURE(condition, msg) \
+  EDGETPU_API_REPORT_ERROR(error_reporter_, !(condition), msg)
+
+#define REMOTE_ENGINE_INIT_CHECK()                                         \
+  REMOTE_ENGINE_ENSURE(is_initialized_,                                    \
+                       "RemoteEngineNative must be initialized! Please "   \
+                       "ensure the instance is created by "                \
+                       "RemoteEngineNativeBuilder!")
+
+RemoteEngineNative::RemoteEngineNative() {
+  error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
+}
+
+RemoteEngineNative::~RemoteEngineNative() {
+  slot_.reset();
+  if (socket_ >= 0) close(socket_);
+}
+
+EdgeTpuApiStatus RemoteEngineNative::Call(const Message& request,
+                                          Message* reply) {
+  EDGETPU_API_ENSURE_STATUS(
+      SendMessage(socket_, request, error_reporter_.get()));
+  bool closed;
+  EDGETPU_API_ENSURE_STATUS(
+      ReceiveMessage(socket_, reply, &closed, error_reporter_.get()));
+  const bool malformed =
+      reply->type != MessageType::kReply || reply->ints.empty();
+  if (malformed || reply->ints[0] != kEdgeTpuApiOk) {
+    if (reply->fd >= 0) close(reply->fd);
+    error_reporter_->Report(malformed || reply->strings.empty()
+                                ? "Malformed reply."
+                                : reply->strings[0]);
+    return kEdgeTpuApiError;
+  }
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus RemoteEngineNative::Init(const std::string& socket_path,
+                                          const std::string& model_path,
+                                          const std::string& device_path) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  REMOTE_ENGINE_ENSURE(socket_path.size() < sizeof(address.sun_path),
+                       absl::StrCat("Socket path is too long: ", socket_path));
+  std::strncpy(address.sun_path, socket_path.c_str(),
+               sizeof(address.sun_path) - 1);
+  socket_ = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  REMOTE_ENGINE_ENSURE(
+      socket_ >= 0,
+      absl::StrCat("Failed to create socket: ", std::strerror(errno)));
+  REMOTE_ENGINE_ENSURE(
+      connect(socket_, reinterpret_cast<sockaddr*>(&address),
+              sizeof(address)) == 0,
+      absl::StrCat("Failed to connect to ", socket_path, ": ",
+                   std::strerror(errno)));
+
+  Message request;
+  request.type = MessageType::kLoadModel;
+  request.strings = {model_path, device_path};
+  Message reply;
+  EDGETPU_API_ENSURE_STATUS(Call(request, &reply));
+  const std::vector<int32_t>& ints = reply.ints;
+  int index = 1;
+  const auto read_list = [&ints, &index](std::vector<int>* list) {
+    if (index >= ints.size() || ints[index] < 0 ||
+        ints.size() - index - 1 < ints[index]) {
+      return false;
+    }
+    list->assign(ints.begin() + index + 1,
+                 ints.begin() + index + 1 + ints[index]);
+    index += 1 + ints[index];
+    return true;
+  };
+  if (!read_list(&input_tensor_shape_) || !read_list(&output_tensor_sizes_) ||
+      reply.strings.size() != 1 || reply.fd < 0) {
+    if (reply.fd >= 0) close(reply.fd);
+    error_reporter_->Report("Malformed reply to kLoadModel.");
+    return kEdgeTpuApiError;
+  }
+  input_array_size_ = 1;
+  for (int dim : input_tensor_shape_) input_array_size_ *= dim;
+  output_array_size_ = 0;
+  for (int size : output_tensor_sizes_) output_array_size_ += size;
+  const SlotLayout layout(input_array_size_, output_array_size_);
+  output_offset_ = layout.output_offset;
+  slot_ = SharedMemory::Map(reply.fd, layout.size, error_reporter_.get());
+  EDGETPU_API_ENSURE(slot_);
+
+  model_path_ = model_path;
+  device_path_ = reply.strings[0];
+  is_initialized_ = true;
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus RemoteEngineNative::RunInference(const uint8_t* const input,
+                                                  const int in_size,
+                                                  float const** const output,
+                                                  int* const out_size) {
+  REMOTE_ENGINE_INIT_CHECK();
+  REMOTE_ENGINE_ENSURE(in_size == input_array_size_,
+                       absl::StrCat("Input size ", in_size,
+                                    " doesn't match the model's ",
+                                    input_array_size_, "."));
+  if (input != slot_->data()) std::memcpy(slot_->data(), input, in_size);
+  Message request;
+  request.type = MessageType::kRunInference;
+  request.ints = {in_size};
+  Message reply;
+  EDGETPU_API_ENSURE_STATUS(Call(request, &reply));
+  REMOTE_ENGINE_ENSURE(
+      reply.ints.size() == 3 && reply.ints[1] == output_array_size_,
+      "Malformed reply to kRunInference.");
+  inference_time_ = reply.ints[2] / 1000.0f;
+  (*output) = reinterpret_cast<const float*>(slot_->data() + output_offset_);
+  (*out_size) = output_array_size_;
+  return kEdgeTpuApiOk;
+}
+
+uint8_t* RemoteEngineNative::input_buffer() {
+  return slot_ ? slot_->data() : nullptr;
+}
+
+EdgeTpuApiStatus RemoteEngineNative::get_input_tensor_shape(
+    int const** dims, int* dims_num) const {
+  REMOTE_ENGINE_INIT_CHECK();
+  (*dims_num) = input_tensor_shape_.size();
+  (*dims) = input_tensor_shape_.data();
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus RemoteEngineNative::get_input_array_size(
+    int* array_size) const {
+  REMOTE_ENGINE_INIT_CHECK();
+  (*array_size) = input_array_size_;
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus RemoteEngineNative::get_all_output_tensors_sizes(
+    int const** tensor_sizes, int* tensor_num) const {
+  REMOTE_ENGINE_INIT_CHECK();
+  (*tensor_num) = output_tensor_sizes_.size();
+  (*tensor_sizes) = output_tensor_sizes_.data();
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus RemoteEngineNative::total_output_array_size(
+    int* const output) const {
+  REMOTE_ENGINE_INIT_CHECK();
+  (*output) = output_array_size_;
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus RemoteEngineNative::model_path(std::string* path) const {
+  REMOTE_ENGINE_INIT_CHECK();
+  (*path) = model_path_;
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus RemoteEngineNative::device_path(std::string* path) const {
+  REMOTE_ENGINE_INIT_CHECK();
+  (*path) = device_path_;
+  return kEdgeTpuApiOk;
+}
+
+EdgeTpuApiStatus RemoteEngineNative::get_inference_time(
+    float* const time) const {
+  REMOTE_ENGINE_INIT_CHECK();
+  (*time) = inference_time_;
+  return kEdgeTpuApiOk;
+}
+
+std::string RemoteEngineNative::get_error_message() {
+  return error_reporter_->message();
+}
+
+RemoteEngineNativeBuilder::RemoteEngineNativeBuilder(
+    const std::string& socket_path, const std::string& model_path,
+    const std::string& device_path)
+    : socket_path_(socket_path),
+      model_path_(model_path),
+      device_path_(device_path) {
+  error_reporter_ = absl::make_unique<EdgeTpuErrorReporter>();
+}
+
+EdgeTpuApiStatus RemoteEngineNativeBuilder::operator()(
+    std::unique_ptr<RemoteEngineNative>* engine) {
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_, !engine,
+      "Null output pointer passed to RemoteEngineNativeBuilder!");
+  (*engine) = absl::make_unique<RemoteEngineNative>();
+  EDGETPU_API_REPORT_ERROR(
+      error_reporter_,
+      (*engine)->Init(socket_path_, model_path_, device_path_) ==
+          kEdgeTpuApiError,
+      (*engine)->get_error_message());
+  return kEdgeTpuApiOk;
+}
+
+RemoteEngine::RemoteEngine(const std::string& socket_path,
+                           const std::string& model_path,
+                           const std::string& device_path) {
+  RemoteEngineNativeBuilder builder(socket_path, model_path, device_path);
+  LOG_IF(FATAL, builder(&engine_) == kEdgeTpuApiError)
+      << builder.get_error_message();
+}
+
+std::vector<std::vector<float>> RemoteEngine::RunInference(
+    const std::vector<uint8_t>& input) {
+  float const* result;
+  int result_size;
+  LOG_IF(FATAL, engine_->RunInference(input.data(), input.size(), &result,
+                                      &result_size) == kEdgeTpuApiError)
+      << engine_->get_error_message();
+  std::vector<std::vector<float>> results;
+  int offset = 0;
+  for (int size : get_all_output_tensors_sizes()) {
+    results.emplace_back(result + offset, result + offset + size);
+    offset += size;
+  }
+  CHECK_EQ(result_size, offset);
+  return results;
+}
+
+std::string RemoteEngine::device_path() const {
+  std::string path;
+  LOG_IF(FATAL, engine_->device_path(&path) == kEdgeTpuApiError)
+      << engine_->get_error_message();
+  return path;
+}
+
+std::string RemoteEngine::model_path() const {
+  std::string path;
+  LOG_IF(FATAL, engine_->model_path(&path) == kEdgeTpuApiError)
+      << engine_->get_error_message();
+  return path;
+}
+
+std::vector<int> RemoteEngine::get_input_tensor_shape() const {
+  int const* dims;
+  int dims_num;
+  LOG_IF(FATAL,
+         engine_->get_input_tensor_shape(&dims, &dims_num) == kEdgeTpuApiError)
+      << engine_->get_error_message();
+  return std::vector<int>(dims, dims + dims_num);
+}
+
+std::vector<int> RemoteEngine::get_all_output_tensors_sizes() const {
+  int const* sizes;
+  int num;
+  LOG_IF(FATAL, engine_->get_all_output_tensors_sizes(&sizes, &num) ==
+                    kEdgeTpuApiError)
+      << engine_->get_error_message();
+  return std::vector<int>(sizes, sizes + num);
+}
+
+float RemoteEngine::get_inference_time() const {
+  float time;
+  LOG_IF(FATAL, engine_->get_inference_time(&time) == kEdgeTpuApiError)
+      << engine_->get_error_message();
+  return time;
+}
+
+}  // namespace coral
@@ -0,0 +1,134 @@
+#ifndef EDGETPU_CPP_SERVER_REMOTE_ENGINE_H_
+#define EDGETPU_CPP_SERVER_REMOTE_ENGINE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "edgetpu/cpp/error_reporter.h"
+#include "edgetpu/cpp/server/ipc.h"
+
+namespace coral {
+
+// Runs a model in an InferenceServer of another process, with the API of
+// BasicEngineNative. The model is loaded by the server, hence `model_path` is
+// a path of the server.
+//
+// Inputs and outputs go through shared memory: RunInference() copies the
+// input there, unless it already is at input_buffer(), and returns outputs
+// in place, until the next inference.
+//
+// This class is not thread-safe, like BasicEngineNative: use an engine per
+// thread.
+class RemoteEngineNative {
+ public:
+  RemoteEngineNative();
+  // Ends the session, which releases the engine in the server.
+  ~RemoteEngineNative();
+
+  RemoteEngineNative(const RemoteEngineNative&) = delete;
+  RemoteEngineNative& operator=(const RemoteEngineNative&) = delete;
+
+  // Connects to the server at `socket_path` and loads the model there, on
+  // Edge TPU `device_path`, or the next available one if empty.
+  EdgeTpuApiStatus Init(const std::string& socket_path,
+                        const std::string& model_path,
+                        const std::string& device_path);
+
+  EdgeTpuApiStatus RunInference(const uint8_t* const input, const int in_size,
+                                float const** const output,
+                                int* const out_size);
+
+  // Buffer of get_input_array_size() bytes, where inputs can be written to
+  // avoid copying them.
+  uint8_t* input_buffer();
+
+  EdgeTpuApiStatus get_input_tensor_shape(int const** dims,
+                                          int* dims_num) const;
+  EdgeTpuApiStatus get_input_array_size(int* array_size) const;
+  EdgeTpuApiStatus get_all_output_tensors_sizes(int const** tensor_sizes,
+                                                int* tensor_num) const;
+  EdgeTpuApiStatus total_output_array_size(int* const output) const;
+  EdgeTpuApiStatus model_path(std::string* path) const;
+  EdgeTpuApiStatus device_path(std::string* path) const;
+  // Time the server took for the last inference, in milliseconds.
+  EdgeTpuApiStatus get_inference_time(float* const time) const;
+
+  // This function is offered to high level APIs to retrieve error message when
+  // get kEdgeTpuApiError.
+  std::string get_error_message();
+
+ private:
+  // Sends `request` and receives `reply`, reporting the error of the server
+  // if its status isn't kEdgeTpuApiOk.
+  EdgeTpuApiStatus Call(const Message& request, Message* reply);
+
+  bool is_initialized_ = false;
+  int socket_ = -1;
+  std::string model_path_;
+  std::string device_path_;
+  std::vector<int> input_tensor_shape_;
+  int input_array_size_ = 0;
+  std::vector<int> output_tensor_sizes_;
+  int output_array_size_ = 0;
+  size_t output_offset_ = 0;
+  std::unique_ptr<SharedMemory> slot_;
+  float inference_time_ = 0;
+  // Data structure to store error messages.
+  std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
+};
+
+// Builds a RemoteEngineNative.
+//
+// Example:
+//   RemoteEngineNativeBuilder builder("/tmp/edgetpu.sock",
+//                                     "/models/mobilenet_edgetpu.tflite");
+//   std::unique_ptr<RemoteEngineNative> engine;
+//   CHECK_EQ(kEdgeTpuApiOk, builder(&engine)) << builder.get_error_message();
+class RemoteEngineNativeBuilder {
+ public:
+  RemoteEngineNativeBuilder(const std::string& socket_path,
+                            const std::string& model_path,
+                            const std::string& device_path = "");
+
+  // Disallows copy and assign.
+  RemoteEngineNativeBuilder(const RemoteEngineNativeBuilder&) = delete;
+  RemoteEngineNativeBuilder& operator=(const RemoteEngineNativeBuilder&) =
+      delete;
+
+  EdgeTpuApiStatus operator()(std::unique_ptr<RemoteEngineNative>* engine);
+
+  // Caller can use this function to retrieve error message when get
+  // kEdgeTpuApiError.
+  std::string get_error_message() { return error_reporter_->message(); }
+
+ private:
+  // Data structure to stores error messages.
+  std::unique_ptr<EdgeTpuErrorReporter> error_reporter_;
+  std::string socket_path_;
+  std::string model_path_;
+  std::string device_path_;
+};
+
+// RemoteEngineNative with the API of BasicEngine, which crashes on errors.
+class RemoteEngine {
+ public:
+  RemoteEngine(const std::string& socket_path, const std::string& model_path,
+               const std::string& device_path = "");
+
+  std::vector<std::vector<float>> RunInference(
+      const std::vector<uint8_t>& input);
+
+  std::string device_path() const;
+  std::string model_path() const;
+  std::vector<int> get_input_tensor_shape() const;
+  std::vector<int> get_all_output_tensors_sizes() const;
+  float get_inference_time() const;
+
+ private:
+  std::unique_ptr<RemoteEngineNative> engine_;
+};
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_SERVER_REMOTE_ENGINE_H_
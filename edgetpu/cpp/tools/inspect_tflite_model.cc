@@ -0,0 +1,31 @@
+// Tool to tell how a tflite model splits between the Edge TPU and the CPU:
+// operators by type, size of the Edge TPU custom ops, which hold the
+// parameters to cache on the Edge TPU, whether they fit in its parameter
+// cache, and bytes moved per inference.
+//
+// With --json, prints a JSON object instead, see ReportToJson().
+
+#include <iostream>
+
+#include "edgetpu/cpp/tools/model_inspector.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DEFINE_string(input_graph, "",
+              "Path to the input graph. Must be in tflite format.");
+
+DEFINE_bool(json, false, "Whether to print the report as JSON.");
+
+DEFINE_uint64(parameter_cache_bytes,
+              coral::tools::kEdgeTpuParameterCacheBytes,
+              "Size of the parameter cache of the Edge TPU.");
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  CHECK(!FLAGS_input_graph.empty()) << "--input_graph must be set.";
+  const coral::tools::ModelReport report =
+      coral::tools::InspectTfliteModel(FLAGS_input_graph,
+                                       FLAGS_parameter_cache_bytes);
+  std::cout << (FLAGS_json ? coral::tools::ReportToJson(report)
+                           : coral::tools::ReportToText(report));
+}
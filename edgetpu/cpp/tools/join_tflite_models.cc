@@ -1,10 +1,18 @@
-// Tool to join two tflite models. The models may contain custom operator,
+// Tool to join tflite models. The models may contain custom operator,
 // which can not be imported / exported properly by tflite/toco yet.
 //
 // Two models can be joined together only if the output tensors of
 // input_graph_base are the input tensors of input_graph_head. All other tensors
 // should have identical names.
+//
+// With --input_graphs, any number of models are joined the same way, in the
+// given order, and buffers with identical contents are stored once. Models
+// that share no tensors end up side by side in the output graph.
+
+#include <string>
+#include <vector>
 
+#include "absl/strings/str_split.h"
 #include "edgetpu/cpp/tools/tflite_graph_util.h"
 #include "gflags/gflags.h"
 
@@ -14,12 +22,28 @@ DEFINE_string(input_graph_base, "",
 DEFINE_string(input_graph_head, "",
               "Path to the head input graph. Must be in tflite format.");
 
+DEFINE_string(input_graphs, "",
+              "Comma-separated paths to input graphs in tflite format, used "
+              "instead of --input_graph_base and --input_graph_head.");
+
+DEFINE_int32(buffer_alignment, 0,
+             "With --input_graphs, alignment in bytes of buffers at least that "
+             "large in the output graph, e.g. 4096 to put weights on their "
+             "own pages. Must be 0 or a power of 2.");
+
 DEFINE_string(
     output_graph, "",
     "Path to the output graph. Output graph will be in tflite format.");
 
 int main(int argc, char** argv) {
   gflags::ParseCommandLineFlags(&argc, &argv, true);
+  if (!FLAGS_input_graphs.empty()) {
+    const std::vector<std::string> input_graphs =
+        absl::StrSplit(FLAGS_input_graphs, ',', absl::SkipEmpty());
+    coral::tools::ConcatTfliteModels(input_graphs, FLAGS_output_graph,
+                                     FLAGS_buffer_alignment);
+    return 0;
+  }
   coral::tools::ConcatTfliteModels(FLAGS_input_graph_base,
                                    FLAGS_input_graph_head, FLAGS_output_graph);
 }
@@ -0,0 +1,296 @@
+#include "edgetpu/cpp/tools/model_inspector.h"
+
+#include <cstdio>
+#include <iomanip>
+#include <set>
+#include <sstream>
+
+#include "edgetpu.h"
+#include "edgetpu/cpp/utils.h"
+#include "glog/logging.h"
+
+namespace coral {
+namespace tools {
+namespace {
+
+// Returns the size in bytes of an element of type `type`, 0 for strings,
+// whose size depends on their contents.
+size_t TensorTypeSize(tflite::TensorType type) {
+  switch (type) {
+    case tflite::TensorType_FLOAT32:
+    case tflite::TensorType_INT32:
+      return 4;
+    case tflite::TensorType_FLOAT16:
+    case tflite::TensorType_INT16:
+      return 2;
+    case tflite::TensorType_UINT8:
+    case tflite::TensorType_INT8:
+    case tflite::TensorType_BOOL:
+      return 1;
+    case tflite::TensorType_INT64:
+    case tflite::TensorType_COMPLEX64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+TensorInfo GetTensorInfo(const tflite::Tensor& tensor) {
+  TensorInfo info;
+  if (tensor.name()) info.name = tensor.name()->str();
+  info.type = tflite::EnumNameTensorType(tensor.type());
+  info.bytes = TensorTypeSize(tensor.type());
+  if (tensor.shape()) {
+    for (int dim : *tensor.shape()) {
+      info.shape.push_back(dim);
+      info.bytes *= dim;
+    }
+  }
+  return info;
+}
+
+// Returns the sum of the sizes of tensors `indices` of `subgraph`, skipping
+// optional tensors.
+size_t TensorBytes(const tflite::SubGraph& subgraph,
+                   const flatbuffers::Vector<int32_t>* indices) {
+  size_t bytes = 0;
+  if (!indices) return bytes;
+  for (int index : *indices) {
+    if (index < 0) continue;
+    bytes += GetTensorInfo(*subgraph.tensors()->Get(index)).bytes;
+  }
+  return bytes;
+}
+
+std::string OperatorName(const tflite::OperatorCode& opcode) {
+  if (opcode.builtin_code() == tflite::BuiltinOperator_CUSTOM) {
+    return opcode.custom_code() ? opcode.custom_code()->str() : "CUSTOM";
+  }
+  const std::string name =
+      tflite::EnumNameBuiltinOperator(opcode.builtin_code());
+  return name.empty() ? std::to_string(opcode.builtin_code()) : name;
+}
+
+std::string JsonString(const std::string& value) {
+  std::string result = "\"";
+  for (char c : value) {
+    switch (c) {
+      case '"':
+        result += "\\\"";
+        break;
+      case '\\':
+        result += "\\\\";
+        break;
+      case '\n':
+        result += "\\n";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          char escaped[7];
+          std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+          result += escaped;
+        } else {
+          result += c;
+        }
+    }
+  }
+  return result + "\"";
+}
+
+std::string TensorsToJson(const std::vector<TensorInfo>& tensors) {
+  std::ostringstream out;
+  out << "[";
+  for (int i = 0; i < tensors.size(); ++i) {
+    const TensorInfo& tensor = tensors[i];
+    out << (i ? ", " : "") << "{\"name\": " << JsonString(tensor.name)
+        << ", \"type\": " << JsonString(tensor.type) << ", \"shape\": [";
+    for (int j = 0; j < tensor.shape.size(); ++j) {
+      out << (j ? ", " : "") << tensor.shape[j];
+    }
+    out << "], \"bytes\": " << tensor.bytes << "}";
+  }
+  out << "]";
+  return out.str();
+}
+
+void TensorsToText(const std::vector<TensorInfo>& tensors,
+                   std::ostringstream* out) {
+  for (const TensorInfo& tensor : tensors) {
+    *out << "  " << tensor.name << " " << tensor.type << "[";
+    for (int j = 0; j < tensor.shape.size(); ++j) {
+      *out << (j ? ", " : "") << tensor.shape[j];
+    }
+    *out << "] " << tensor.bytes << " bytes\n";
+  }
+}
+
+}  // namespace
+
+ModelReport InspectModel(const tflite::Model& model, size_t model_bytes,
+                         size_t parameter_cache_bytes) {
+  ModelReport report;
+  report.model_bytes = model_bytes;
+  report.parameter_cache_bytes = parameter_cache_bytes;
+  if (!model.subgraphs()) return report;
+  report.num_subgraphs = model.subgraphs()->size();
+
+  // Constant tensors may be shared by operators, count them once.
+  std::set<uint32_t> cpu_buffers;
+  for (int s = 0; s < model.subgraphs()->size(); ++s) {
+    const tflite::SubGraph& subgraph = *model.subgraphs()->Get(s);
+    if (!subgraph.operators()) continue;
+    for (int i = 0; i < subgraph.operators()->size(); ++i) {
+      const tflite::Operator& op = *subgraph.operators()->Get(i);
+      const tflite::OperatorCode& opcode =
+          *model.operator_codes()->Get(op.opcode_index());
+      const std::string name = OperatorName(opcode);
+      ++report.num_operators;
+      ++report.operator_histogram[name];
+
+      const bool is_edgetpu = name == edgetpu::kCustomOp;
+      if (opcode.builtin_code() == tflite::BuiltinOperator_CUSTOM) {
+        CustomOpInfo info;
+        info.subgraph_index = s;
+        info.op_index = i;
+        info.custom_code = name;
+        info.payload_bytes =
+            op.custom_options() ? op.custom_options()->size() : 0;
+        info.input_bytes = TensorBytes(subgraph, op.inputs());
+        info.output_bytes = TensorBytes(subgraph, op.outputs());
+        if (is_edgetpu) {
+          ++report.num_edgetpu_operators;
+          report.edgetpu_payload_bytes += info.payload_bytes;
+          report.edgetpu_transfer_bytes +=
+              info.input_bytes + info.output_bytes;
+        }
+        report.custom_ops.push_back(info);
+      }
+      if (is_edgetpu || !op.inputs() || !model.buffers()) continue;
+      for (int index : *op.inputs()) {
+        if (index < 0) continue;
+        const uint32_t buffer = subgraph.tensors()->Get(index)->buffer();
+        const auto* data = model.buffers()->Get(buffer)->data();
+        if (buffer == 0 || !data || !cpu_buffers.insert(buffer).second) {
+          continue;
+        }
+        report.cpu_parameter_bytes += data->size();
+      }
+    }
+  }
+
+  if (parameter_cache_bytes > 0) {
+    report.parameter_cache_fraction =
+        static_cast<double>(report.edgetpu_payload_bytes) /
+        parameter_cache_bytes;
+  }
+  report.fits_parameter_cache =
+      report.edgetpu_payload_bytes <= parameter_cache_bytes;
+
+  const tflite::SubGraph& subgraph = *model.subgraphs()->Get(0);
+  if (subgraph.inputs()) {
+    for (int index : *subgraph.inputs()) {
+      report.inputs.push_back(GetTensorInfo(*subgraph.tensors()->Get(index)));
+      report.input_bytes += report.inputs.back().bytes;
+    }
+  }
+  if (subgraph.outputs()) {
+    for (int index : *subgraph.outputs()) {
+      report.outputs.push_back(GetTensorInfo(*subgraph.tensors()->Get(index)));
+      report.output_bytes += report.outputs.back().bytes;
+    }
+  }
+  return report;
+}
+
+ModelReport InspectTfliteModel(const std::string& model_path,
+                               size_t parameter_cache_bytes) {
+  std::string contents;
+  ReadFileOrDie(model_path, &contents);
+  flatbuffers::Verifier verifier(
+      reinterpret_cast<const uint8_t*>(contents.data()), contents.size());
+  CHECK(tflite::VerifyModelBuffer(verifier))
+      << "Not a valid tflite model: " << model_path;
+  return InspectModel(*tflite::GetModel(contents.data()), contents.size(),
+                      parameter_cache_bytes);
+}
+
+std::string ReportToText(const ModelReport& report) {
+  std::ostringstream out;
+  out << "Model size: " << report.model_bytes << " bytes\n"
+      << "Subgraphs: " << report.num_subgraphs << "\n"
+      << "Operators: " << report.num_operators << " ("
+      << report.num_edgetpu_operators << " on Edge TPU, "
+      << report.num_operators - report.num_edgetpu_operators << " on CPU)\n";
+  for (const auto& entry : report.operator_histogram) {
+    out << "  " << entry.first << ": " << entry.second << "\n";
+  }
+  out << "Custom operators: " << report.custom_ops.size() << "\n";
+  for (const CustomOpInfo& op : report.custom_ops) {
+    out << "  #" << op.op_index << " of subgraph " << op.subgraph_index << " "
+        << op.custom_code << ": payload " << op.payload_bytes << " bytes, "
+        << "inputs " << op.input_bytes << " bytes, outputs "
+        << op.output_bytes << " bytes\n";
+  }
+  out << "Edge TPU payload: " << report.edgetpu_payload_bytes << " bytes, "
+      << std::fixed << std::setprecision(1)
+      << report.parameter_cache_fraction * 100 << "% of the "
+      << report.parameter_cache_bytes << " bytes parameter cache ("
+      << (report.fits_parameter_cache ? "fits" : "doesn't fit") << ")\n"
+      << "CPU parameters: " << report.cpu_parameter_bytes << " bytes\n"
+      << "Edge TPU transfers per inference: " << report.edgetpu_transfer_bytes
+      << " bytes\n"
+      << "Inputs: " << report.input_bytes << " bytes\n";
+  TensorsToText(report.inputs, &out);
+  out << "Outputs: " << report.output_bytes << " bytes\n";
+  TensorsToText(report.outputs, &out);
+  return out.str();
+}
+
+std::string ReportToJson(const ModelReport& report) {
+  std::ostringstream out;
+  out << "{\n"
+      << "  \"model_bytes\": " << report.model_bytes << ",\n"
+      << "  \"num_subgraphs\": " << report.num_subgraphs << ",\n"
+      << "  \"num_operators\": " << report.num_operators << ",\n"
+      << "  \"num_edgetpu_operators\": " << report.num_edgetpu_operators
+      << ",\n"
+      << "  \"operator_histogram\": {";
+  bool first = true;
+  for (const auto& entry : report.operator_histogram) {
+    out << (first ? "" : ", ") << JsonString(entry.first) << ": "
+        << entry.second;
+    first = false;
+  }
+  out << "},\n"
+      << "  \"custom_ops\": [";
+  for (int i = 0; i < report.custom_ops.size(); ++i) {
+    const CustomOpInfo& op = report.custom_ops[i];
+    out << (i ? ", " : "") << "{\"subgraph_index\": " << op.subgraph_index
+        << ", \"op_index\": " << op.op_index
+        << ", \"custom_code\": " << JsonString(op.custom_code)
+        << ", \"payload_bytes\": " << op.payload_bytes
+        << ", \"input_bytes\": " << op.input_bytes
+        << ", \"output_bytes\": " << op.output_bytes << "}";
+  }
+  out << "],\n"
+      << "  \"edgetpu_payload_bytes\": " << report.edgetpu_payload_bytes
+      << ",\n"
+      << "  \"parameter_cache_bytes\": " << report.parameter_cache_bytes
+      << ",\n"
+      << "  \"parameter_cache_fraction\": " << report.parameter_cache_fraction
+      << ",\n"
+      << "  \"fits_parameter_cache\": "
+      << (report.fits_parameter_cache ? "true" : "false") << ",\n"
+      << "  \"cpu_parameter_bytes\": " << report.cpu_parameter_bytes << ",\n"
+      << "  \"edgetpu_transfer_bytes\": " << report.edgetpu_transfer_bytes
+      << ",\n"
+      << "  \"inputs\": " << TensorsToJson(report.inputs) << ",\n"
+      << "  \"outputs\": " << TensorsToJson(report.outputs) << ",\n"
+      << "  \"input_bytes\": " << report.input_bytes << ",\n"
+      << "  \"output_bytes\": " << report.output_bytes << "\n"
+      << "}\n";
+  return out.str();
+}
+
+}  // namespace tools
+}  // namespace coral
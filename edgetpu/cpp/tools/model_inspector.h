@@ -0,0 +1,97 @@
+#ifndef EDGETPU_CPP_TOOLS_MODEL_INSPECTOR_H_
+#define EDGETPU_CPP_TOOLS_MODEL_INSPECTOR_H_
+
+// Library to tell how a tflite model splits between the Edge TPU and the CPU,
+// and how much it moves and stores, without running it.
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tensorflow/lite/schema/schema_generated.h"
+
+namespace coral {
+namespace tools {
+
+// Size of the on-chip memory of the Edge TPU caching model parameters, 8 MiB.
+constexpr size_t kEdgeTpuParameterCacheBytes = 8 * 1024 * 1024;
+
+// Input or output tensor of a model or an operator.
+struct TensorInfo {
+  std::string name;
+  // Name of the tflite::TensorType, e.g. "UINT8".
+  std::string type;
+  std::vector<int> shape;
+  // Size of the tensor in bytes, 0 for strings.
+  size_t bytes = 0;
+};
+
+// Operator with a custom code, e.g. a part of the model compiled for the Edge
+// TPU.
+struct CustomOpInfo {
+  // Index of the operator in its subgraph.
+  int subgraph_index = 0;
+  int op_index = 0;
+  std::string custom_code;
+  // Size of the custom options, which hold the compiled executable and the
+  // parameters for Edge TPU custom ops.
+  size_t payload_bytes = 0;
+  // Bytes read and written by the operator per inference.
+  size_t input_bytes = 0;
+  size_t output_bytes = 0;
+};
+
+struct ModelReport {
+  // Size of the model file.
+  size_t model_bytes = 0;
+  int num_subgraphs = 0;
+  int num_operators = 0;
+  int num_edgetpu_operators = 0;
+  // Number of operators by builtin operator name, or custom code.
+  std::map<std::string, int> operator_histogram;
+  std::vector<CustomOpInfo> custom_ops;
+  // Total payload of the Edge TPU custom ops, an upper bound of the parameters
+  // to cache on the Edge TPU.
+  size_t edgetpu_payload_bytes = 0;
+  // Size of the parameter cache of the Edge TPU, the fraction of it the Edge
+  // TPU payload takes, and whether the payload fits in it. If not, the Edge
+  // TPU streams parameters from the host on each inference.
+  size_t parameter_cache_bytes = 0;
+  double parameter_cache_fraction = 0;
+  bool fits_parameter_cache = true;
+  // Total size of the constant tensors of the operators left to the CPU.
+  size_t cpu_parameter_bytes = 0;
+  // Inputs and outputs of the first subgraph, and their total sizes, which
+  // the application copies per inference.
+  std::vector<TensorInfo> inputs;
+  std::vector<TensorInfo> outputs;
+  size_t input_bytes = 0;
+  size_t output_bytes = 0;
+  // Bytes exchanged between the host and the Edge TPU per inference, i.e. the
+  // inputs and outputs of all Edge TPU custom ops.
+  size_t edgetpu_transfer_bytes = 0;
+};
+
+// Inspects `model`, whose file is `model_bytes` long, for an Edge TPU with a
+// parameter cache of `parameter_cache_bytes`.
+ModelReport InspectModel(
+    const tflite::Model& model, size_t model_bytes,
+    size_t parameter_cache_bytes = kEdgeTpuParameterCacheBytes);
+
+// Inspects the tflite model at `model_path`, or dies if it can't be read.
+ModelReport InspectTfliteModel(
+    const std::string& model_path,
+    size_t parameter_cache_bytes = kEdgeTpuParameterCacheBytes);
+
+// Formats `report` for humans.
+std::string ReportToText(const ModelReport& report);
+
+// Formats `report` as a JSON object, with the field names above as keys, for
+// tools like capacity planners.
+std::string ReportToJson(const ModelReport& report);
+
+}  // namespace tools
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_TOOLS_MODEL_INSPECTOR_H_
@@ -0,0 +1,120 @@
+#include "edgetpu/cpp/tools/model_inspector.h"
+
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "edgetpu/cpp/utils.h"
+#include "gflags/gflags.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tensorflow/lite/schema/schema_generated.h"
+
+DEFINE_string(
+    test_srcdir,
+    "knowledge/cerebra/spacepark/darwinn/git/edgetpu/cpp/tools/testdata",
+    "test data src directory");
+
+namespace coral {
+namespace tools {
+namespace {
+
+using ::testing::HasSubstr;
+
+std::string TestFilePath(const std::string& filename) {
+  return absl::StrCat(FLAGS_test_srcdir, "/", filename);
+}
+
+TEST(ModelInspectorTest, EdgeTpuModel) {
+  const std::string path =
+      TestFilePath("mobilenet_quant_v1_224_feature_layers-custom_op.tflite");
+  std::string contents;
+  ReadFileOrDie(path, &contents);
+  const tflite::Model& model = *tflite::GetModel(contents.data());
+  const tflite::Operator& op = *model.subgraphs()->Get(0)->operators()->Get(0);
+
+  const ModelReport report = InspectTfliteModel(path);
+  EXPECT_EQ(contents.size(), report.model_bytes);
+  EXPECT_EQ(1, report.num_subgraphs);
+  EXPECT_EQ(1, report.num_operators);
+  EXPECT_EQ(1, report.num_edgetpu_operators);
+  EXPECT_EQ(1, report.operator_histogram.at("edgetpu-custom-op"));
+  ASSERT_EQ(1, report.custom_ops.size());
+  EXPECT_EQ(op.custom_options()->size(), report.custom_ops[0].payload_bytes);
+  EXPECT_EQ(op.custom_options()->size(), report.edgetpu_payload_bytes);
+  EXPECT_EQ(0, report.cpu_parameter_bytes);
+  // MobileNet v1 weights take about 4 MiB.
+  EXPECT_EQ(kEdgeTpuParameterCacheBytes, report.parameter_cache_bytes);
+  EXPECT_DOUBLE_EQ(static_cast<double>(report.edgetpu_payload_bytes) /
+                       kEdgeTpuParameterCacheBytes,
+                   report.parameter_cache_fraction);
+  EXPECT_TRUE(report.fits_parameter_cache);
+
+  ASSERT_EQ(1, report.inputs.size());
+  EXPECT_EQ("input", report.inputs[0].name);
+  EXPECT_EQ("UINT8", report.inputs[0].type);
+  EXPECT_EQ(std::vector<int>({1, 224, 224, 3}), report.inputs[0].shape);
+  EXPECT_EQ(224 * 224 * 3, report.input_bytes);
+  EXPECT_EQ(1024, report.output_bytes);
+  EXPECT_EQ(224 * 224 * 3 + 1024, report.edgetpu_transfer_bytes);
+}
+
+TEST(ModelInspectorTest, PayloadLargerThanParameterCache) {
+  const std::string path =
+      TestFilePath("mobilenet_quant_v1_224_feature_layers-custom_op.tflite");
+  const size_t payload_bytes =
+      InspectTfliteModel(path).edgetpu_payload_bytes;
+  const ModelReport report =
+      InspectTfliteModel(path, /*parameter_cache_bytes=*/payload_bytes / 2);
+  EXPECT_EQ(payload_bytes / 2, report.parameter_cache_bytes);
+  EXPECT_GT(report.parameter_cache_fraction, 1.9);
+  EXPECT_FALSE(report.fits_parameter_cache);
+  EXPECT_THAT(ReportToText(report), HasSubstr("(doesn't fit)"));
+  EXPECT_THAT(ReportToJson(report),
+              HasSubstr("\"fits_parameter_cache\": false,"));
+}
+
+TEST(ModelInspectorTest, CpuModel) {
+  const ModelReport report = InspectTfliteModel(
+      TestFilePath("mobilenet_quant_v1_224_head_layers.tflite"));
+  EXPECT_EQ(3, report.num_operators);
+  EXPECT_EQ(0, report.num_edgetpu_operators);
+  EXPECT_TRUE(report.custom_ops.empty());
+  EXPECT_EQ(1, report.operator_histogram.at("CONV_2D"));
+  EXPECT_EQ(1, report.operator_histogram.at("RESHAPE"));
+  EXPECT_EQ(1, report.operator_histogram.at("SOFTMAX"));
+  // 1x1 convolution from 1024 to 1001 channels, with int32 biases.
+  EXPECT_GE(report.cpu_parameter_bytes, 1001 * 1024 + 1001 * 4);
+  EXPECT_EQ(0, report.edgetpu_transfer_bytes);
+  EXPECT_EQ(0, report.parameter_cache_fraction);
+  EXPECT_TRUE(report.fits_parameter_cache);
+  EXPECT_EQ(2, report.inputs.size());
+  EXPECT_EQ(1001, report.output_bytes);
+}
+
+TEST(ModelInspectorTest, Json) {
+  const ModelReport report = InspectTfliteModel(
+      TestFilePath("mobilenet_quant_v1_224_feature_layers-custom_op.tflite"));
+  const std::string json = ReportToJson(report);
+  EXPECT_THAT(json, HasSubstr("\"num_edgetpu_operators\": 1,"));
+  EXPECT_THAT(json,
+              HasSubstr("\"operator_histogram\": {\"edgetpu-custom-op\": 1}"));
+  EXPECT_THAT(json, HasSubstr(absl::StrCat("\"edgetpu_payload_bytes\": ",
+                                           report.edgetpu_payload_bytes)));
+  EXPECT_THAT(json, HasSubstr(absl::StrCat("\"parameter_cache_bytes\": ",
+                                           kEdgeTpuParameterCacheBytes)));
+  EXPECT_THAT(json, HasSubstr("\"parameter_cache_fraction\": 0."));
+  EXPECT_THAT(json, HasSubstr("\"fits_parameter_cache\": true,"));
+  EXPECT_THAT(json, HasSubstr("\"inputs\": [{\"name\": \"input\", \"type\": "
+                              "\"UINT8\", \"shape\": [1, 224, 224, 3], "
+                              "\"bytes\": 150528}]"));
+}
+
+}  // namespace
+}  // namespace tools
+}  // namespace coral
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return RUN_ALL_TESTS();
+}
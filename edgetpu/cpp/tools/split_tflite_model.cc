@@ -0,0 +1,43 @@
+// Tool to split a tflite model into segments, e.g. to run a model too large
+// for the on-chip memory of one Edge TPU as a pipeline on several ones.
+//
+// Segments are cut at the tensors given by --split_tensors: segment i computes
+// the i-th list of tensors from the previous one. For example, with
+//   --split_tensors=a,b;c --output_graphs=s0.tflite,s1.tflite,s2.tflite
+// s0.tflite computes tensors a and b from the model inputs, s1.tflite tensor c
+// from a and b, and s2.tflite the model outputs from c.
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_split.h"
+#include "edgetpu/cpp/tools/tflite_graph_util.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+DEFINE_string(input_graph, "",
+              "Path to the input graph. Must be in tflite format.");
+
+DEFINE_string(split_tensors, "",
+              "Semicolon-separated lists of comma-separated tensor names, "
+              "where to split the input graph.");
+
+DEFINE_string(output_graphs, "",
+              "Comma-separated paths to the output graphs, one more than "
+              "the lists of split tensors.");
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  std::vector<std::vector<std::string>> split_tensor_names;
+  for (absl::string_view names :
+       absl::StrSplit(FLAGS_split_tensors, ';', absl::SkipEmpty())) {
+    split_tensor_names.push_back(
+        absl::StrSplit(names, ',', absl::SkipEmpty()));
+  }
+  const std::vector<std::string> output_graphs =
+      absl::StrSplit(FLAGS_output_graphs, ',', absl::SkipEmpty());
+  CHECK_EQ(output_graphs.size(), split_tensor_names.size() + 1)
+      << "Expected one more output graph than lists of split tensors.";
+  coral::tools::SplitTfliteModel(FLAGS_input_graph, split_tensor_names,
+                                 output_graphs);
+}
@@ -1,8 +1,22 @@
 #include "edgetpu/cpp/tools/tflite_graph_util.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
 #include <map>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "absl/hash/hash.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
 #include "glog/logging.h"
 #include "tensorflow/lite/schema/schema_generated.h"
 
@@ -39,15 +53,134 @@ void CloneBuffers(const tflite::Model& model,
   }
 }
 
-// Appends clones of model tensors to vector, assuming the model has only one
-// subgraph.
-// |tensor_buffer_start_offset| specifies the offset to be added to the buffer
-// index of all tensors of this model.
+// Clones buffers of several models, storing buffers with the same contents
+// only once. The first buffer is the empty one, shared by all tensors without
+// data. Data of buffers of at least `alignment` bytes, if not 0, starts at a
+// multiple of `alignment` from the beginning of the finished model.
+class BufferDeduplicator {
+ public:
+  BufferDeduplicator(FlatBufferBuilder* builder, size_t alignment)
+      : builder_(builder), alignment_(alignment) {
+    CHECK(builder_);
+    CHECK_EQ(alignment_ & (alignment_ - 1), 0)
+        << "Buffer alignment must be a power of 2!";
+    buffer_vector_.push_back(tflite::CreateBuffer(*builder_));
+  }
+
+  // Clones the buffers of `model` that have new contents, and returns the
+  // buffer index in the result of each buffer of `model`. Data of `model`
+  // must outlive this object.
+  std::vector<uint32_t> CloneBuffers(const tflite::Model& model) {
+    std::vector<uint32_t> new_buffer_indices;
+    if (model.buffers() == nullptr) return new_buffer_indices;
+    const std::unordered_set<uint32_t> variable_buffers =
+        VariableBuffers(model);
+    new_buffer_indices.reserve(model.buffers()->size());
+    for (int i = 0; i < model.buffers()->size(); ++i) {
+      new_buffer_indices.push_back(
+          CloneBuffer(model, i, variable_buffers.count(i) > 0));
+    }
+    return new_buffer_indices;
+  }
+
+  // Clones buffer `index` of `model` if it has new contents, or backs a
+  // variable tensor, and returns its buffer index in the result. Variable
+  // tensors are written at runtime, so their buffers are never shared.
+  uint32_t CloneBuffer(const tflite::Model& model, int index,
+                       bool is_variable) {
+    if (model.buffers() == nullptr || index >= model.buffers()->size()) {
+      return 0;
+    }
+    const auto* buffer = model.buffers()->Get(index);
+    const auto* data = buffer ? buffer->data() : nullptr;
+    if (data == nullptr || data->size() == 0) return 0;
+    if (is_variable) {
+      VLOG(1) << "Buffer " << index << " backs a variable tensor.";
+      const uint32_t new_index = buffer_vector_.size();
+      AppendBuffer(*data);
+      return new_index;
+    }
+    const absl::string_view contents(
+        reinterpret_cast<const char*>(data->data()), data->size());
+    auto it = buffer_indices_.find(contents);
+    if (it == buffer_indices_.end()) {
+      VLOG(1) << "Buffer " << index << " size in bytes: " << data->size();
+      it = buffer_indices_.emplace(contents, buffer_vector_.size()).first;
+      AppendBuffer(*data);
+    } else {
+      VLOG(1) << "Buffer " << index << " is the same as buffer " << it->second;
+      num_deduplicated_bytes_ += data->size();
+    }
+    return it->second;
+  }
+
+  const std::vector<Offset<tflite::Buffer>>& buffer_vector() const {
+    return buffer_vector_;
+  }
+
+  // Size of the buffers that were not cloned again.
+  size_t num_deduplicated_bytes() const { return num_deduplicated_bytes_; }
+
+ private:
+  // Returns the buffers of `model` referenced by variable tensors.
+  static std::unordered_set<uint32_t> VariableBuffers(
+      const tflite::Model& model) {
+    std::unordered_set<uint32_t> buffers;
+    if (model.subgraphs() == nullptr) return buffers;
+    for (const auto* subgraph : *model.subgraphs()) {
+      if (subgraph->tensors() == nullptr) continue;
+      for (const auto* tensor : *subgraph->tensors()) {
+        if (tensor->is_variable()) buffers.insert(tensor->buffer());
+      }
+    }
+    return buffers;
+  }
+
+  void AppendBuffer(const Vector<uint8_t>& data) {
+    // Offsets from the end of the builder are offsets from the beginning of
+    // the model once Finish() pads it to the largest alignment.
+    if (alignment_ && data.size() >= alignment_) {
+      builder_->PreAlign(data.size(), alignment_);
+    }
+    buffer_vector_.push_back(tflite::CreateBuffer(
+        *builder_, builder_->CreateVector(data.data(), data.size())));
+  }
+
+  FlatBufferBuilder* const builder_;
+  const size_t alignment_;
+  std::vector<Offset<tflite::Buffer>> buffer_vector_;
+  // Buffer index in the result of each buffer contents.
+  std::unordered_map<absl::string_view, uint32_t, absl::Hash<absl::string_view>>
+      buffer_indices_;
+  size_t num_deduplicated_bytes_ = 0;
+};
+
+// Returns the buffer indices of `model` shifted by `start_offset`, for buffers
+// cloned by CloneBuffers() after `start_offset` others.
+std::vector<uint32_t> OffsetBufferIndices(const tflite::Model& model,
+                                          uint32_t start_offset) {
+  std::vector<uint32_t> result(model.buffers()->size());
+  for (int i = 0; i < result.size(); ++i) result[i] = start_offset + i;
+  return result;
+}
+
+// Returns [0, size).
+std::vector<int> AllIndices(int size) {
+  std::vector<int> result(size);
+  for (int i = 0; i < size; ++i) result[i] = i;
+  return result;
+}
+
+// Appends clones of model tensors with indices |tensor_indices| to vector,
+// assuming the model has only one subgraph.
+// |new_buffer_indices| maps the buffer index of each tensor of this model to
+// its buffer index in the result.
 // |tensor_name_to_buffer_index_map| is the tensor to buffer index map, and
 // |tensor_name_to_tensor_index_map| is the tensor name to tensor index map.
 // Both maps will be updated by this function.
 void CloneTensors(
-    const tflite::Model& model, uint32_t tensor_buffer_start_offset,
+    const tflite::Model& model, const std::vector<int>& tensor_indices,
+    const std::vector<uint32_t>& new_buffer_indices,
     std::vector<Offset<tflite::Tensor>>* tensor_vector,
     FlatBufferBuilder* builder,
     std::map<std::string, uint32_t>* tensor_name_to_buffer_index_map,
@@ -59,7 +192,7 @@ void CloneTensors(
 
   const auto* subgraphs = model.subgraphs();
   const auto* tensors = subgraphs->Get(0)->tensors();
-  for (int i = 0; i < tensors->size(); ++i) {
+  for (int i : tensor_indices) {
     const auto* tensor = tensors->Get(i);
     CHECK(tensor);
     tflite::TensorT tensor_t;
@@ -81,7 +214,8 @@ void CloneTensors(
 
     // Update tensor name to buffer index map. Note that buffer index must be
     // recalcualted.
-    const uint32_t buffer_index = tensor_buffer_start_offset + tensor_t.buffer;
+    CHECK_LT(tensor_t.buffer, new_buffer_indices.size());
+    const uint32_t buffer_index = new_buffer_indices[tensor_t.buffer];
     (*tensor_name_to_buffer_index_map)[tensor_t.name] = buffer_index;
     VLOG(1) << "Tensor " << tensor_vector->size() << " name: " << tensor_t.name
             << ", buffer index from " << tensor_t.buffer << " to "
@@ -94,10 +228,23 @@ void CloneTensors(
     tensor_vector->push_back(tflite::CreateTensor(
         *builder, builder->CreateVector(tensor_t.shape), tensor_t.type,
         /*buffer=*/buffer_index, builder->CreateString(tensor_t.name),
-        new_q_param));
+        new_q_param, tensor_t.is_variable));
   }
 }
 
+// Same as above for all tensors of the model.
+void CloneTensors(
+    const tflite::Model& model, const std::vector<uint32_t>& new_buffer_indices,
+    std::vector<Offset<tflite::Tensor>>* tensor_vector,
+    FlatBufferBuilder* builder,
+    std::map<std::string, uint32_t>* tensor_name_to_buffer_index_map,
+    std::map<std::string, int32_t>* tensor_name_to_tensor_index_map) {
+  CloneTensors(model, AllIndices(model.subgraphs()->Get(0)->tensors()->size()),
+               new_buffer_indices, tensor_vector, builder,
+               tensor_name_to_buffer_index_map,
+               tensor_name_to_tensor_index_map);
+}
+
 // Recalcuates tensor indices given a new tensor name to tensor index map.
 std::vector<int32_t> RecalcualteTensorIndices(
     const std::vector<int32_t>& old_tensor_indices, const tflite::Model& model,
@@ -137,18 +284,19 @@ void CloneOperatorCodes(
   }
 }
 
-// Appends clones of model operators to vector.
+// Appends clones of model operators with indices |op_indices| to vector.
 // |opcode_index_start_offset| specifies the offset to be added to the opcode
 // index of all operators.
 void CloneOperators(
-    const tflite::Model& model, uint32_t opcode_index_start_offset,
+    const tflite::Model& model, const std::vector<int>& op_indices,
+    uint32_t opcode_index_start_offset,
     const std::map<std::string, int32_t>& tensor_name_to_tensor_index_map,
     std::vector<Offset<tflite::Operator>>* op_vector,
     FlatBufferBuilder* builder) {
   CHECK(op_vector);
   CHECK(builder);
   const auto* ops = model.subgraphs()->Get(0)->operators();
-  for (int i = 0; i < ops->size(); ++i) {
+  for (int i : op_indices) {
     const auto* op = ops->Get(i);
     CHECK(op->inputs());
     CHECK(op->outputs());
@@ -182,6 +330,18 @@ void CloneOperators(
   }
 }
 
+// Same as above for all operators of the model.
+void CloneOperators(
+    const tflite::Model& model, uint32_t opcode_index_start_offset,
+    const std::map<std::string, int32_t>& tensor_name_to_tensor_index_map,
+    std::vector<Offset<tflite::Operator>>* op_vector,
+    FlatBufferBuilder* builder) {
+  CloneOperators(model,
+                 AllIndices(model.subgraphs()->Get(0)->operators()->size()),
+                 opcode_index_start_offset, tensor_name_to_tensor_index_map,
+                 op_vector, builder);
+}
+
 // Concanetate two tflite models, assuming each model has only one subgraph.
 // |builder| contains the result model.
 void ConcatModels(const tflite::Model& model0, const tflite::Model& model1,
@@ -213,10 +373,11 @@ void ConcatModels(const tflite::Model& model0, const tflite::Model& model1,
   std::vector<Offset<tflite::Tensor>> tensor_vector;
   std::map<std::string, uint32_t> tensor_name_to_buffer_index_map;
   std::map<std::string, int32_t> tensor_name_to_tensor_index_map;
-  CloneTensors(model0, /*tensor_buffer_start_offset=*/0, &tensor_vector,
-               builder, &tensor_name_to_buffer_index_map,
+  CloneTensors(model0, OffsetBufferIndices(model0, /*start_offset=*/0),
+               &tensor_vector, builder, &tensor_name_to_buffer_index_map,
                &tensor_name_to_tensor_index_map);
-  CloneTensors(model1, /*tensor_buffer_start_offset=*/num_model0_buffers,
+  CloneTensors(model1,
+               OffsetBufferIndices(model1, /*start_offset=*/num_model0_buffers),
                &tensor_vector, builder, &tensor_name_to_buffer_index_map,
                &tensor_name_to_tensor_index_map);
   VLOG(1) << "merged # tensors: " << tensor_vector.size();
@@ -281,6 +442,298 @@ void ConcatModels(const tflite::Model& model0, const tflite::Model& model1,
 
   tflite::FinishModelBuffer(*builder, merged_model);
 }
+
+// Concatenates tflite models, assuming each model has only one subgraph.
+// |builder| contains the result model.
+void ConcatModels(const std::vector<const tflite::Model*>& models,
+                  size_t buffer_alignment,
+                  flatbuffers::FlatBufferBuilder* builder) {
+  CHECK(builder);
+  CHECK(!models.empty());
+  for (const auto* model : models) {
+    CHECK(model->subgraphs());
+    CHECK_EQ(model->subgraphs()->size(), 1);
+  }
+
+  // Names of the tensors computed by operators, and of the tensors used by
+  // the operators of model i and of the following models.
+  std::unordered_set<std::string> computed_tensors;
+  std::vector<std::unordered_set<std::string>> used_tensors(models.size() + 1);
+  for (int i = models.size() - 1; i >= 0; --i) {
+    used_tensors[i] = used_tensors[i + 1];
+    const tflite::SubGraph& subgraph = *models[i]->subgraphs()->Get(0);
+    for (const auto* op : *subgraph.operators()) {
+      for (int32_t index : *op->inputs()) {
+        if (index >= 0) {
+          used_tensors[i].insert(subgraph.tensors()->Get(index)->name()->str());
+        }
+      }
+      for (int32_t index : *op->outputs()) {
+        computed_tensors.insert(subgraph.tensors()->Get(index)->name()->str());
+      }
+    }
+  }
+
+  // Buffers are cloned first, so that their data ends up after all tables,
+  // at the end of the model.
+  BufferDeduplicator buffers(builder, buffer_alignment);
+  std::vector<std::vector<uint32_t>> new_buffer_indices;
+  for (const auto* model : models) {
+    new_buffer_indices.push_back(buffers.CloneBuffers(*model));
+  }
+
+  std::vector<Offset<tflite::Tensor>> tensor_vector;
+  std::map<std::string, uint32_t> tensor_name_to_buffer_index_map;
+  std::map<std::string, int32_t> tensor_name_to_tensor_index_map;
+  std::vector<Offset<tflite::OperatorCode>> opcode_vector;
+  std::vector<Offset<tflite::Operator>> op_vector;
+  std::vector<int32_t> inputs, outputs;
+  std::unordered_set<int32_t> input_set, output_set;
+  for (int i = 0; i < models.size(); ++i) {
+    const tflite::Model& model = *models[i];
+    CloneTensors(model, new_buffer_indices[i], &tensor_vector, builder,
+                 &tensor_name_to_buffer_index_map,
+                 &tensor_name_to_tensor_index_map);
+    const int opcode_index_start_offset = opcode_vector.size();
+    CloneOperatorCodes(model, &opcode_vector, builder);
+    CloneOperators(model, opcode_index_start_offset,
+                   tensor_name_to_tensor_index_map, &op_vector, builder);
+
+    // Inputs are the inputs of all models that no operator computes, and
+    // outputs are the outputs of all models that no later model uses.
+    const tflite::SubGraph& subgraph = *model.subgraphs()->Get(0);
+    const auto* tensors = subgraph.tensors();
+    for (int32_t index : *subgraph.inputs()) {
+      const std::string name = tensors->Get(index)->name()->str();
+      const int32_t new_index = tensor_name_to_tensor_index_map.at(name);
+      if (!computed_tensors.count(name) && input_set.insert(new_index).second) {
+        inputs.push_back(new_index);
+      }
+    }
+    for (int32_t index : *subgraph.outputs()) {
+      const std::string name = tensors->Get(index)->name()->str();
+      const int32_t new_index = tensor_name_to_tensor_index_map.at(name);
+      if (!used_tensors[i + 1].count(name) &&
+          output_set.insert(new_index).second) {
+        outputs.push_back(new_index);
+      }
+    }
+    VLOG(1) << "Model " << i << " # buffers: " << model.buffers()->size()
+            << ", # tensors: " << tensors->size();
+  }
+  VLOG(1) << "merged # buffers: " << buffers.buffer_vector().size()
+          << ", # tensors: " << tensor_vector.size()
+          << ", # ops: " << op_vector.size() << ", deduplicated bytes: "
+          << buffers.num_deduplicated_bytes();
+
+  const tflite::Model& model0 = *models[0];
+  const tflite::SubGraph& subgraph0 = *model0.subgraphs()->Get(0);
+  Offset<Vector<int32_t>> merged_inputs =
+      builder->CreateVector<int32_t>(inputs);
+  Offset<Vector<int32_t>> merged_outputs =
+      builder->CreateVector<int32_t>(outputs);
+  Offset<Vector<Offset<tflite::Tensor>>> merged_tensors =
+      builder->CreateVector(tensor_vector);
+  Offset<Vector<Offset<tflite::Operator>>> merged_ops =
+      builder->CreateVector(op_vector);
+  Offset<tflite::SubGraph> subgraph = tflite::CreateSubGraph(
+      *builder, merged_tensors, merged_inputs, merged_outputs, merged_ops,
+      (subgraph0.name() ? builder->CreateString(subgraph0.name()->str()) : 0));
+  Offset<Vector<Offset<tflite::SubGraph>>> merged_subgraphs =
+      builder->CreateVector<Offset<tflite::SubGraph>>({subgraph});
+
+  Offset<Vector<Offset<tflite::Buffer>>> merged_buffers =
+      builder->CreateVector(buffers.buffer_vector());
+  Offset<Vector<Offset<tflite::OperatorCode>>> merged_opcodes =
+      builder->CreateVector(opcode_vector);
+  auto merged_model = tflite::CreateModel(
+      *builder, model0.version(), merged_opcodes, merged_subgraphs,
+      (model0.description() ? builder->CreateString(model0.description()->str())
+                            : 0),
+      merged_buffers);
+  tflite::FinishModelBuffer(*builder, merged_model);
+}
+
+// Copies operators |op_indices| of |model|, assuming it has only one subgraph,
+// into a model with inputs |input_names| and outputs |output_names|. Buffers
+// and tensors not used by these operators are left out. |builder| contains
+// the result model.
+void ExtractSegment(const tflite::Model& model,
+                    const std::vector<int>& op_indices,
+                    const std::vector<std::string>& input_names,
+                    const std::vector<std::string>& output_names,
+                    flatbuffers::FlatBufferBuilder* builder) {
+  CHECK(builder);
+  const tflite::SubGraph& subgraph = *model.subgraphs()->Get(0);
+  const auto* tensors = subgraph.tensors();
+  std::map<std::string, int> tensor_indices_by_name;
+  for (int i = 0; i < tensors->size(); ++i) {
+    tensor_indices_by_name[tensors->Get(i)->name()->str()] = i;
+  }
+  // Tensors in the order of the original model.
+  std::set<int> tensor_set;
+  for (const auto& name : input_names) {
+    tensor_set.insert(tensor_indices_by_name.at(name));
+  }
+  for (int i : op_indices) {
+    const auto* op = subgraph.operators()->Get(i);
+    for (int32_t index : *op->inputs()) {
+      if (index >= 0) tensor_set.insert(index);
+    }
+    for (int32_t index : *op->outputs()) tensor_set.insert(index);
+  }
+  const std::vector<int> tensor_indices(tensor_set.begin(), tensor_set.end());
+
+  BufferDeduplicator buffers(builder, /*alignment=*/0);
+  std::vector<uint32_t> new_buffer_indices(model.buffers()->size(), 0);
+  for (int i : tensor_indices) {
+    const auto* tensor = tensors->Get(i);
+    new_buffer_indices[tensor->buffer()] =
+        buffers.CloneBuffer(model, tensor->buffer(), tensor->is_variable());
+  }
+
+  std::vector<Offset<tflite::Tensor>> tensor_vector;
+  std::map<std::string, uint32_t> tensor_name_to_buffer_index_map;
+  std::map<std::string, int32_t> tensor_name_to_tensor_index_map;
+  CloneTensors(model, tensor_indices, new_buffer_indices, &tensor_vector,
+               builder, &tensor_name_to_buffer_index_map,
+               &tensor_name_to_tensor_index_map);
+  // Operator codes are few, unused ones are kept rather than renumbered.
+  std::vector<Offset<tflite::OperatorCode>> opcode_vector;
+  CloneOperatorCodes(model, &opcode_vector, builder);
+  std::vector<Offset<tflite::Operator>> op_vector;
+  CloneOperators(model, op_indices, /*opcode_index_start_offset=*/0,
+                 tensor_name_to_tensor_index_map, &op_vector, builder);
+  std::vector<int32_t> inputs, outputs;
+  for (const auto& name : input_names) {
+    inputs.push_back(tensor_name_to_tensor_index_map.at(name));
+  }
+  for (const auto& name : output_names) {
+    outputs.push_back(tensor_name_to_tensor_index_map.at(name));
+  }
+  VLOG(1) << "Segment # buffers: " << buffers.buffer_vector().size()
+          << ", # tensors: " << tensor_vector.size()
+          << ", # ops: " << op_vector.size();
+
+  Offset<tflite::SubGraph> new_subgraph = tflite::CreateSubGraph(
+      *builder, builder->CreateVector(tensor_vector),
+      builder->CreateVector<int32_t>(inputs),
+      builder->CreateVector<int32_t>(outputs),
+      builder->CreateVector(op_vector),
+      (subgraph.name() ? builder->CreateString(subgraph.name()->str()) : 0));
+  auto new_model = tflite::CreateModel(
+      *builder, model.version(), builder->CreateVector(opcode_vector),
+      builder->CreateVector<Offset<tflite::SubGraph>>({new_subgraph}),
+      (model.description() ? builder->CreateString(model.description()->str())
+                           : 0),
+      builder->CreateVector(buffers.buffer_vector()));
+  tflite::FinishModelBuffer(*builder, new_model);
+}
+
+// Splits |model| at |split_tensor_names| like SplitTfliteModel() does, and
+// returns the operator indices of each segment.
+std::vector<std::vector<int>> AssignOperatorsToSegments(
+    const tflite::Model& model,
+    const std::vector<std::vector<std::string>>& split_tensor_names) {
+  const tflite::SubGraph& subgraph = *model.subgraphs()->Get(0);
+  const auto* tensors = subgraph.tensors();
+  const auto* ops = subgraph.operators();
+  const int num_segments = split_tensor_names.size() + 1;
+  auto name_of = [tensors](int32_t index) {
+    return tensors->Get(index)->name()->str();
+  };
+
+  // Each operator goes to the current segment, which ends once all its split
+  // tensors are computed. Model inputs are computed by segment -1.
+  std::unordered_map<std::string, int> producer_segments;
+  std::vector<std::string> model_inputs;
+  for (int32_t index : *subgraph.inputs()) {
+    model_inputs.push_back(name_of(index));
+    producer_segments[name_of(index)] = -1;
+  }
+  std::vector<std::vector<int>> segment_ops(num_segments);
+  int segment = 0;
+  for (int i = 0; i < ops->size(); ++i) {
+    segment_ops[segment].push_back(i);
+    for (int32_t index : *ops->Get(i)->outputs()) {
+      producer_segments[name_of(index)] = segment;
+    }
+    while (segment < num_segments - 1 &&
+           std::all_of(split_tensor_names[segment].begin(),
+                       split_tensor_names[segment].end(),
+                       [&producer_segments](const std::string& name) {
+                         return producer_segments.count(name) > 0;
+                       })) {
+      ++segment;
+    }
+  }
+  CHECK_EQ(segment, num_segments - 1)
+      << "Split tensors of segment " << segment << " are never computed.";
+
+  // Segments only exchange the split tensors.
+  for (int s = 0; s < num_segments; ++s) {
+    CHECK(!segment_ops[s].empty()) << "Segment " << s << " is empty.";
+    const std::vector<std::string>& inputs =
+        s == 0 ? model_inputs : split_tensor_names[s - 1];
+    for (const auto& name : inputs) {
+      CHECK_EQ(producer_segments.at(name), s - 1)
+          << "Split tensor " << name << " must be computed by segment "
+          << s - 1;
+    }
+    for (int i : segment_ops[s]) {
+      for (int32_t index : *ops->Get(i)->inputs()) {
+        if (index < 0) continue;
+        const tflite::Tensor& tensor = *tensors->Get(index);
+        const auto* data = model.buffers()->Get(tensor.buffer())->data();
+        if (data && data->size() > 0) continue;  // Constant.
+        const std::string name = tensor.name()->str();
+        const auto it = producer_segments.find(name);
+        CHECK(it != producer_segments.end())
+            << "Tensor " << name << " is used before it is computed.";
+        CHECK(it->second == s ||
+              std::count(inputs.begin(), inputs.end(), name) > 0)
+            << "Tensor " << name << " used by segment " << s
+            << " is computed by segment " << it->second
+            << ", it must be a split tensor between both.";
+      }
+    }
+  }
+  for (int32_t index : *subgraph.outputs()) {
+    CHECK_EQ(producer_segments.at(name_of(index)), num_segments - 1)
+        << "Model output " << name_of(index)
+        << " must be computed by the last segment.";
+  }
+  return segment_ops;
+}
+
+// Read-only mapping of a whole file, or dies.
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    CHECK_GE(fd, 0) << "Failed to open file: " << path;
+    struct stat file_stat;
+    CHECK_EQ(fstat(fd, &file_stat), 0) << "Failed to get the size of " << path;
+    size_ = file_stat.st_size;
+    CHECK_GT(size_, 0) << "Empty file: " << path;
+    data_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    CHECK(data_ != MAP_FAILED) << "Failed to map file: " << path;
+  }
+
+  ~MappedFile() { munmap(data_, size_); }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const void* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  void* data_;
+  size_t size_;
+};
+
 }  // namespace
 
 void ConcatTfliteModels(const std::string& model0_path,
@@ -308,5 +761,74 @@ void ConcatTfliteModels(const std::string& model0_path,
                  output_path);
 }
 
+void ConcatTfliteModels(const std::vector<std::string>& model_paths,
+                        const std::string& output_path,
+                        size_t buffer_alignment) {
+  // Input models are mapped rather than read, so that only the output is held
+  // in memory. Deduplication only shrinks it, so the builder never needs to
+  // grow from this size and the padding of aligned buffers.
+  std::vector<std::unique_ptr<MappedFile>> files;
+  std::vector<const tflite::Model*> models;
+  size_t total_size = 0;
+  for (const auto& path : model_paths) {
+    files.push_back(absl::make_unique<MappedFile>(path));
+    models.push_back(tflite::GetModel(files.back()->data()));
+    total_size += files.back()->size();
+    if (models.back()->buffers()) {
+      total_size += models.back()->buffers()->size() * buffer_alignment;
+    }
+  }
+  flatbuffers::FlatBufferBuilder builder(/*initial_size=*/total_size);
+  ConcatModels(models, buffer_alignment, &builder);
+  files.clear();
+
+  // Writes the builder contents straight to the output file, without copying.
+  std::unique_ptr<FILE, decltype(&std::fclose)> file(
+      std::fopen(output_path.c_str(), "wb"), std::fclose);
+  CHECK(file) << "Failed to open file: " << output_path;
+  CHECK_EQ(std::fwrite(builder.GetBufferPointer(), 1, builder.GetSize(),
+                       file.get()),
+           builder.GetSize())
+      << "Failed to write file: " << output_path;
+  CHECK_EQ(std::fclose(file.release()), 0)
+      << "Failed to write file: " << output_path;
+}
+
+void SplitTfliteModel(
+    const std::string& model_path,
+    const std::vector<std::vector<std::string>>& split_tensor_names,
+    const std::vector<std::string>& output_paths) {
+  CHECK_EQ(output_paths.size(), split_tensor_names.size() + 1);
+  MappedFile file(model_path);
+  const tflite::Model* model = tflite::GetModel(file.data());
+  CHECK(model->subgraphs());
+  CHECK_EQ(model->subgraphs()->size(), 1);
+  const tflite::SubGraph& subgraph = *model->subgraphs()->Get(0);
+  const std::vector<std::vector<int>> segment_ops =
+      AssignOperatorsToSegments(*model, split_tensor_names);
+
+  std::vector<std::string> model_inputs, model_outputs;
+  for (int32_t index : *subgraph.inputs()) {
+    model_inputs.push_back(subgraph.tensors()->Get(index)->name()->str());
+  }
+  for (int32_t index : *subgraph.outputs()) {
+    model_outputs.push_back(subgraph.tensors()->Get(index)->name()->str());
+  }
+  for (int s = 0; s < segment_ops.size(); ++s) {
+    flatbuffers::FlatBufferBuilder builder(/*initial_size=*/1024 * 1024);
+    ExtractSegment(
+        *model, segment_ops[s],
+        s == 0 ? model_inputs : split_tensor_names[s - 1],
+        s + 1 == segment_ops.size() ? model_outputs : split_tensor_names[s],
+        &builder);
+    WriteFileOrDie(
+        std::string(reinterpret_cast<const char*>(builder.GetBufferPointer()),
+                    builder.GetSize()),
+        output_paths[s]);
+    VLOG(1) << "Segment " << s << ": " << segment_ops[s].size()
+            << " operators, " << builder.GetSize() << " bytes.";
+  }
+}
+
 }  // namespace tools
 }  // namespace coral
@@ -3,6 +3,7 @@
 
 // Utility library for tflite graph tooling related functions.
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -17,6 +18,41 @@ void ConcatTfliteModels(const std::string& model0_path,
                         const std::string& model1_path,
                         const std::string& output_path);
 
+// Concatenates any number of tflite models into one, assuming each input model
+// has only one subgraph. As above, tensors with the same name are the same
+// tensor, so that outputs of a model can be inputs of the next ones, and
+// independent models end up side by side, e.g. to co-locate them on one Edge
+// TPU. Inputs of the result are the inputs of all models that no operator
+// computes, and outputs are the outputs of all models that no later model
+// uses.
+//
+// Buffers with identical contents, e.g. weights shared by several models, are
+// stored only once, after all other tables. Data of buffers of at least
+// `buffer_alignment` bytes, a power of 2, starts at a multiple of it from the
+// beginning of the output, e.g. on pages of their own when it is the page size
+// and the output is loaded with mmap(). Input models are memory-mapped, so
+// that about the size of the output is held in memory.
+void ConcatTfliteModels(const std::vector<std::string>& model_paths,
+                        const std::string& output_path,
+                        size_t buffer_alignment = 0);
+
+// Splits a tflite model into segments, assuming it has only one subgraph, the
+// opposite of ConcatTfliteModels(). E.g. a model whose parameters don't fit
+// the on-chip memory of an Edge TPU can run as a pipeline on several ones, see
+// PipelinedModelRunner.
+//
+// Segment i computes tensors `split_tensor_names[i]` from the tensors
+// `split_tensor_names[i - 1]`, which are its inputs, and is written to
+// `output_paths[i]`. The first segment takes the model inputs, and the last
+// one computes the model outputs, so there is one more output path than split
+// tensor lists. Operators keep their order, each segment ends right after the
+// operator that computes the last of its split tensors. Segments only exchange
+// split tensors, otherwise it dies with the tensor that also needs to be one.
+void SplitTfliteModel(
+    const std::string& model_path,
+    const std::vector<std::vector<std::string>>& split_tensor_names,
+    const std::vector<std::string>& output_paths);
+
 }  // namespace tools
 }  // namespace coral
 
@@ -1,10 +1,18 @@
 #include "edgetpu/cpp/tools/tflite_graph_util.h"
 
+#include <cstring>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
 #include "absl/strings/str_cat.h"
 #include "gflags/gflags.h"
 #include "glog/logging.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "tensorflow/lite/schema/schema_generated.h"
 
 DEFINE_string(
     test_srcdir,
@@ -65,6 +73,256 @@ TEST(TfliteGraphUtilTest, ConcatMobilenetSSD) {
   TestConcatModels(graph0_path, graph1_path, expected_graph);
 }
 
+std::unique_ptr<tflite::ModelT> ReadModel(const std::string& path,
+                                          std::string* contents) {
+  ReadFileOrDie(path, contents);
+  return std::unique_ptr<tflite::ModelT>(
+      tflite::GetModel(contents->data())->UnPack());
+}
+
+// Returns the total size of distinct buffers of `models`.
+size_t UniqueBuffersSize(const std::vector<const tflite::ModelT*>& models) {
+  std::set<std::vector<uint8_t>> buffers;
+  for (const auto* model : models) {
+    for (const auto& buffer : model->buffers) buffers.insert(buffer->data);
+  }
+  size_t size = 0;
+  for (const auto& buffer : buffers) size += buffer.size();
+  return size;
+}
+
+std::vector<std::string> TensorNames(const tflite::SubGraphT& subgraph,
+                                     const std::vector<int32_t>& indices) {
+  std::vector<std::string> names;
+  for (int32_t index : indices) names.push_back(subgraph.tensors[index]->name);
+  return names;
+}
+
+// Expects models at both paths to compute the same graph: same operators
+// with the same tensors, up to the order of tensors and buffers.
+void ExpectSameGraph(const std::string& expected_path,
+                     const std::string& actual_path) {
+  std::string expected_contents, actual_contents;
+  const auto expected = ReadModel(expected_path, &expected_contents);
+  const auto actual = ReadModel(actual_path, &actual_contents);
+  const auto& expected_subgraph = *expected->subgraphs[0];
+  const auto& actual_subgraph = *actual->subgraphs[0];
+  EXPECT_EQ(TensorNames(expected_subgraph, expected_subgraph.inputs),
+            TensorNames(actual_subgraph, actual_subgraph.inputs));
+  EXPECT_EQ(TensorNames(expected_subgraph, expected_subgraph.outputs),
+            TensorNames(actual_subgraph, actual_subgraph.outputs));
+  ASSERT_EQ(expected_subgraph.operators.size(),
+            actual_subgraph.operators.size());
+  for (int i = 0; i < expected_subgraph.operators.size(); ++i) {
+    const auto& expected_op = *expected_subgraph.operators[i];
+    const auto& actual_op = *actual_subgraph.operators[i];
+    EXPECT_EQ(expected->operator_codes[expected_op.opcode_index]->builtin_code,
+              actual->operator_codes[actual_op.opcode_index]->builtin_code);
+    EXPECT_EQ(expected_op.custom_options, actual_op.custom_options);
+    EXPECT_EQ(TensorNames(expected_subgraph, expected_op.inputs),
+              TensorNames(actual_subgraph, actual_op.inputs));
+    EXPECT_EQ(TensorNames(expected_subgraph, expected_op.outputs),
+              TensorNames(actual_subgraph, actual_op.outputs));
+    for (int32_t index : actual_op.inputs) {
+      const auto& tensor = *actual_subgraph.tensors[index];
+      EXPECT_EQ(tensor.buffer == 0,
+                actual->buffers[tensor.buffer]->data.empty());
+      for (const auto& expected_tensor : expected_subgraph.tensors) {
+        if (expected_tensor->name != tensor.name) continue;
+        EXPECT_EQ(expected_tensor->shape, tensor.shape);
+        EXPECT_EQ(expected_tensor->type, tensor.type);
+        EXPECT_EQ(expected->buffers[expected_tensor->buffer]->data,
+                  actual->buffers[tensor.buffer]->data)
+            << tensor.name;
+      }
+    }
+  }
+}
+
+// Writes a copy of model at `path` with all tensor names prefixed, so that
+// it shares no tensor with the original, and returns its path. Tensors with
+// data are made variable if `make_variables`.
+std::string WriteRenamedCopy(const std::string& path, const std::string& prefix,
+                             bool make_variables = false) {
+  std::string contents;
+  auto model = ReadModel(path, &contents);
+  for (auto& tensor : model->subgraphs[0]->tensors) {
+    tensor->name = prefix + tensor->name;
+    if (make_variables && !model->buffers[tensor->buffer]->data.empty()) {
+      tensor->is_variable = true;
+    }
+  }
+  flatbuffers::FlatBufferBuilder builder;
+  tflite::FinishModelBuffer(builder,
+                            tflite::Model::Pack(builder, model.get()));
+  const std::string result_path = TempFilePath(prefix + "model.tflite");
+  WriteFileOrDie(
+      std::string(reinterpret_cast<const char*>(builder.GetBufferPointer()),
+                  builder.GetSize()),
+      result_path);
+  return result_path;
+}
+
+TEST(TfliteGraphUtilTest, ConcatListOfTwoModels) {
+  const std::string result_path = TempFilePath("merged_list.tflite");
+  std::remove(result_path.c_str());
+  ConcatTfliteModels(
+      {TestFilePath("mobilenet_quant_v1_224_feature_layers-custom_op.tflite"),
+       TestFilePath("mobilenet_quant_v1_224_head_layers.tflite")},
+      result_path);
+  ExpectSameGraph(
+      TestFilePath("mobilenet_quant_v1_1.0_224_partial_delegation.tflite"),
+      result_path);
+}
+
+TEST(TfliteGraphUtilTest, ConcatAlignsBuffers) {
+  const std::string result_path = TempFilePath("merged_aligned.tflite");
+  std::remove(result_path.c_str());
+  constexpr size_t kAlignment = 4096;
+  ConcatTfliteModels(
+      {TestFilePath("mobilenet_quant_v1_224_feature_layers-custom_op.tflite"),
+       TestFilePath("mobilenet_quant_v1_224_head_layers.tflite")},
+      result_path, kAlignment);
+  ExpectSameGraph(
+      TestFilePath("mobilenet_quant_v1_1.0_224_partial_delegation.tflite"),
+      result_path);
+
+  std::string contents;
+  ReadFileOrDie(result_path, &contents);
+  const tflite::Model* model = tflite::GetModel(contents.data());
+  int num_aligned = 0;
+  for (const auto* buffer : *model->buffers()) {
+    if (!buffer->data() || buffer->data()->size() < kAlignment) continue;
+    const char* data = reinterpret_cast<const char*>(buffer->data()->Data());
+    EXPECT_EQ(0, (data - contents.data()) % kAlignment);
+    ++num_aligned;
+  }
+  EXPECT_GT(num_aligned, 0);
+}
+
+TEST(TfliteGraphUtilTest, ConcatDeduplicatesBuffers) {
+  const std::string base_path =
+      TestFilePath("mobilenet_quant_v1_224_feature_layers-custom_op.tflite");
+  const std::string head_path =
+      TestFilePath("mobilenet_quant_v1_224_head_layers.tflite");
+  const std::string other_head_path = WriteRenamedCopy(head_path, "other_");
+  const std::string result_path = TempFilePath("merged_three.tflite");
+  std::remove(result_path.c_str());
+  ConcatTfliteModels({base_path, head_path, other_head_path}, result_path);
+
+  std::string base_contents, head_contents, result_contents;
+  const auto base = ReadModel(base_path, &base_contents);
+  const auto head = ReadModel(head_path, &head_contents);
+  const auto result = ReadModel(result_path, &result_contents);
+  // Weights of the other head are the same as the first one's.
+  EXPECT_EQ(UniqueBuffersSize({base.get(), head.get()}),
+            UniqueBuffersSize({result.get()}));
+  // Each buffer of the result is stored once.
+  std::set<std::vector<uint8_t>> result_buffers;
+  for (const auto& buffer : result->buffers) {
+    EXPECT_TRUE(result_buffers.insert(buffer->data).second);
+  }
+  EXPECT_TRUE(result->buffers[0]->data.empty());
+
+  // The other head shares no tensor with the base, so its input is an input
+  // of the result. Outputs of the base are used by the first head.
+  const auto& base_subgraph = *base->subgraphs[0];
+  const auto& head_subgraph = *head->subgraphs[0];
+  const auto& result_subgraph = *result->subgraphs[0];
+  std::vector<std::string> expected_inputs =
+      TensorNames(base_subgraph, base_subgraph.inputs);
+  for (const auto& name : TensorNames(head_subgraph, head_subgraph.inputs)) {
+    expected_inputs.push_back("other_" + name);
+  }
+  EXPECT_EQ(expected_inputs,
+            TensorNames(result_subgraph, result_subgraph.inputs));
+  std::vector<std::string> expected_outputs =
+      TensorNames(head_subgraph, head_subgraph.outputs);
+  for (const auto& name : TensorNames(head_subgraph, head_subgraph.outputs)) {
+    expected_outputs.push_back("other_" + name);
+  }
+  EXPECT_EQ(expected_outputs,
+            TensorNames(result_subgraph, result_subgraph.outputs));
+  EXPECT_EQ(base_subgraph.operators.size() +
+                2 * head_subgraph.operators.size(),
+            result_subgraph.operators.size());
+}
+
+TEST(TfliteGraphUtilTest, ConcatKeepsVariableBuffers) {
+  const std::string base_path =
+      TestFilePath("mobilenet_quant_v1_224_feature_layers-custom_op.tflite");
+  const std::string head_path =
+      TestFilePath("mobilenet_quant_v1_224_head_layers.tflite");
+  const std::string variable_head_path =
+      WriteRenamedCopy(head_path, "variable_", /*make_variables=*/true);
+  const std::string result_path = TempFilePath("merged_variables.tflite");
+  std::remove(result_path.c_str());
+  ConcatTfliteModels({base_path, head_path, variable_head_path}, result_path);
+
+  std::string result_contents;
+  const auto result = ReadModel(result_path, &result_contents);
+  const auto& tensors = result->subgraphs[0]->tensors;
+  std::map<std::string, uint32_t> buffers_by_name;
+  for (const auto& tensor : tensors) {
+    buffers_by_name[tensor->name] = tensor->buffer;
+  }
+  std::set<uint32_t> variable_buffers;
+  int num_variables = 0;
+  for (const auto& tensor : tensors) {
+    if (!tensor->is_variable) continue;
+    ++num_variables;
+    // Same contents as the tensor of the first head, but not shared with it
+    // nor with other variables.
+    const uint32_t buffer =
+        buffers_by_name.at(tensor->name.substr(std::strlen("variable_")));
+    EXPECT_EQ(result->buffers[buffer]->data,
+              result->buffers[tensor->buffer]->data);
+    EXPECT_NE(buffer, tensor->buffer) << tensor->name;
+    EXPECT_TRUE(variable_buffers.insert(tensor->buffer).second);
+  }
+  EXPECT_GT(num_variables, 0);
+}
+
+TEST(TfliteGraphUtilTest, SplitAndConcatBack) {
+  const std::string model_path =
+      TestFilePath("mobilenet_quant_v1_1.0_224_partial_delegation.tflite");
+  std::string contents;
+  const auto model = ReadModel(model_path, &contents);
+  const auto& subgraph = *model->subgraphs[0];
+  const int num_ops = subgraph.operators.size();
+  ASSERT_GE(num_ops, 3);
+  // Operators form a chain, so that the outputs of any of them are a split.
+  const std::vector<std::vector<std::string>> split_tensor_names = {
+      TensorNames(subgraph, subgraph.operators[num_ops / 3 - 1]->outputs),
+      TensorNames(subgraph, subgraph.operators[2 * num_ops / 3 - 1]->outputs)};
+  const std::vector<std::string> segment_paths = {
+      TempFilePath("segment0.tflite"), TempFilePath("segment1.tflite"),
+      TempFilePath("segment2.tflite")};
+  for (const auto& path : segment_paths) std::remove(path.c_str());
+  SplitTfliteModel(model_path, split_tensor_names, segment_paths);
+
+  std::vector<std::string> segment_contents(segment_paths.size());
+  int total_num_ops = 0;
+  for (int i = 0; i < segment_paths.size(); ++i) {
+    const auto segment = ReadModel(segment_paths[i], &segment_contents[i]);
+    const auto& segment_subgraph = *segment->subgraphs[0];
+    EXPECT_EQ(i == 0 ? TensorNames(subgraph, subgraph.inputs)
+                     : split_tensor_names[i - 1],
+              TensorNames(segment_subgraph, segment_subgraph.inputs));
+    EXPECT_EQ(i == 2 ? TensorNames(subgraph, subgraph.outputs)
+                     : split_tensor_names[i],
+              TensorNames(segment_subgraph, segment_subgraph.outputs));
+    EXPECT_GT(segment_subgraph.operators.size(), 0);
+    total_num_ops += segment_subgraph.operators.size();
+  }
+  EXPECT_EQ(num_ops, total_num_ops);
+
+  const std::string result_path = TempFilePath("split_and_merged.tflite");
+  std::remove(result_path.c_str());
+  ConcatTfliteModels(segment_paths, result_path);
+  ExpectSameGraph(model_path, result_path);
+}
+
 }  // namespace
 }  // namespace tools
 }  // namespace coral
@@ -0,0 +1,163 @@
+#include "edgetpu/cpp/tracing.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <vector>
+
+#include "edgetpu/cpp/utils.h"
+
+namespace coral {
+
+namespace internal {
+std::atomic<bool> tracing_enabled(false);
+}  // namespace internal
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Span {
+  const char* name;
+  Clock::time_point start;
+  Clock::time_point end;
+};
+
+// Spans of a thread, in a ring buffer. Only the thread writes them, so that
+// `mutex` is contended only while exporting.
+struct ThreadTrace {
+  std::mutex mutex;
+  int tid = 0;
+  std::string name;
+  std::vector<Span> spans;
+  // Spans recorded since the last clear, of which the latest
+  // kTraceSpansPerThread are kept.
+  int64_t num_recorded = 0;
+};
+
+// Traces of all threads that ever recorded, kept after they exit.
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::shared_ptr<ThreadTrace>> threads;
+  // Origin of timestamps.
+  const Clock::time_point origin = Clock::now();
+};
+
+Registry* GetRegistry() {
+  static auto* const registry = new Registry();
+  return registry;
+}
+
+ThreadTrace* GetThreadTrace() {
+  thread_local std::shared_ptr<ThreadTrace> thread_trace;
+  if (!thread_trace) {
+    thread_trace = std::make_shared<ThreadTrace>();
+    Registry* registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry->mutex);
+    thread_trace->tid = registry->threads.size() + 1;
+    registry->threads.push_back(thread_trace);
+  }
+  return thread_trace.get();
+}
+
+std::string EscapeJson(const std::string& text) {
+  std::string escaped;
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char code[8];
+      std::snprintf(code, sizeof(code), "\\u%04x", c);
+      escaped += code;
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+double Microseconds(Clock::duration duration) {
+  return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+}  // namespace
+
+namespace internal {
+void RecordTraceSpan(const char* name, Clock::time_point start,
+                     Clock::time_point end) {
+  ThreadTrace* trace = GetThreadTrace();
+  std::lock_guard<std::mutex> lock(trace->mutex);
+  const Span span = {name, start, end};
+  if (trace->spans.size() < kTraceSpansPerThread) {
+    trace->spans.push_back(span);
+  } else {
+    trace->spans[trace->num_recorded % kTraceSpansPerThread] = span;
+  }
+  ++trace->num_recorded;
+}
+}  // namespace internal
+
+void EnableTracing(bool enabled) {
+  internal::tracing_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void SetTraceThreadName(const std::string& name) {
+  ThreadTrace* trace = GetThreadTrace();
+  std::lock_guard<std::mutex> lock(trace->mutex);
+  trace->name = name;
+}
+
+std::string GetChromeTrace() {
+  Registry* registry = GetRegistry();
+  std::vector<std::shared_ptr<ThreadTrace>> threads;
+  {
+    std::lock_guard<std::mutex> lock(registry->mutex);
+    threads = registry->threads;
+  }
+  const int pid = getpid();
+  std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  char event[512];
+  for (const auto& thread : threads) {
+    std::lock_guard<std::mutex> lock(thread->mutex);
+    if (!thread->name.empty()) {
+      json += first ? "" : ",";
+      first = false;
+      json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" +
+              std::to_string(pid) + ",\"tid\":" + std::to_string(thread->tid) +
+              ",\"args\":{\"name\":\"" + EscapeJson(thread->name) + "\"}}";
+    }
+    for (const Span& span : thread->spans) {
+      std::snprintf(event, sizeof(event),
+                    "%s{\"name\":\"%s\",\"cat\":\"coral\",\"ph\":\"X\","
+                    "\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+                    first ? "" : ",", EscapeJson(span.name).c_str(),
+                    Microseconds(span.start - registry->origin),
+                    Microseconds(span.end - span.start), pid, thread->tid);
+      json += event;
+      first = false;
+    }
+  }
+  json += "]}\n";
+  return json;
+}
+
+EdgeTpuApiStatus WriteChromeTrace(const std::string& path,
+                                  EdgeTpuErrorReporter* reporter) {
+  return WriteFile(GetChromeTrace(), path, reporter);
+}
+
+void ClearTrace() {
+  Registry* registry = GetRegistry();
+  std::lock_guard<std::mutex> lock(registry->mutex);
+  for (const auto& thread : registry->threads) {
+    std::lock_guard<std::mutex> thread_lock(thread->mutex);
+    thread->spans.clear();
+    thread->num_recorded = 0;
+  }
+}
+
+}  // namespace coral
@@ -0,0 +1,104 @@
+#ifndef EDGETPU_CPP_TRACING_H_
+#define EDGETPU_CPP_TRACING_H_
+
+#include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
+#include <string>
+
+#include "edgetpu/cpp/error_reporter.h"
+
+namespace coral {
+
+// Tracing of spans of time across threads, e.g. model loading, interpreter
+// building and the stages of inferences, exported in the Chrome trace event
+// format for chrome://tracing or https://ui.perfetto.dev.
+//
+// Tracing is disabled by default, and a span then costs a relaxed atomic
+// load. Once enabled, every thread records its spans into a ring buffer of its
+// own, which keeps the latest kTraceSpansPerThread spans, until they're
+// exported.
+//
+// Example:
+//   EnableTracing(true);
+//   BasicEngine engine(model_path);
+//   engine.RunInference(input);
+//   CHECK_EQ(kEdgeTpuApiOk, WriteChromeTrace("/tmp/trace.json", &reporter));
+//
+// Names of spans aren't copied, hence must be string literals.
+//
+// These functions are thread-safe.
+
+constexpr int kTraceSpansPerThread = 1 << 15;
+
+namespace internal {
+extern std::atomic<bool> tracing_enabled;
+void RecordTraceSpan(const char* name,
+                     std::chrono::steady_clock::time_point start,
+                     std::chrono::steady_clock::time_point end);
+}  // namespace internal
+
+inline bool IsTracingEnabled() {
+  return internal::tracing_enabled.load(std::memory_order_relaxed);
+}
+
+// Starts or stops recording spans. Spans recorded so far are kept.
+void EnableTracing(bool enabled);
+
+// Names the calling thread in traces, e.g. "pipeline segment 0".
+void SetTraceThreadName(const std::string& name);
+
+// Records a span from `start` to `end` on the calling thread, if tracing is
+// enabled. Useful to trace stages whose times are measured anyway.
+inline void AddTraceSpan(const char* name,
+                         std::chrono::steady_clock::time_point start,
+                         std::chrono::steady_clock::time_point end) {
+  if (IsTracingEnabled()) internal::RecordTraceSpan(name, start, end);
+}
+
+// Records a span from its construction to its destruction, if tracing was
+// enabled at construction. Use through CORAL_TRACE_SPAN().
+class TraceSpan {
+ public:
+  explicit TraceSpan(const char* name) : name_(name), enabled_(false) {
+    if (IsTracingEnabled()) {
+      enabled_ = true;
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~TraceSpan() {
+    if (enabled_) {
+      internal::RecordTraceSpan(name_, start_,
+                                std::chrono::steady_clock::now());
+    }
+  }
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+ private:
+  const char* const name_;
+  bool enabled_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+#define CORAL_TRACE_SPAN_CONCAT_(a, b) a##b
+#define CORAL_TRACE_SPAN_NAME_(line) CORAL_TRACE_SPAN_CONCAT_(trace_span_, line)
+// Traces the rest of the enclosing scope as a span named `name`.
+#define CORAL_TRACE_SPAN(name) \
+  ::coral::TraceSpan CORAL_TRACE_SPAN_NAME_(__LINE__)(name)
+
+// Returns the spans recorded so far by all threads, as Chrome trace event
+// JSON.
+std::string GetChromeTrace();
+
+// Writes GetChromeTrace() to file `path`.
+EdgeTpuApiStatus WriteChromeTrace(const std::string& path,
+                                  EdgeTpuErrorReporter* reporter);
+
+// Drops the spans recorded so far.
+void ClearTrace();
+
+}  // namespace coral
+
+#endif  // EDGETPU_CPP_TRACING_H_
@@ -0,0 +1,83 @@
+#include "edgetpu/cpp/tracing.h"
+
+#include <thread>  // NOLINT
+
+#include "gtest/gtest.h"
+
+namespace coral {
+namespace {
+
+int CountOccurrences(const std::string& text, const std::string& pattern) {
+  int count = 0;
+  for (size_t pos = text.find(pattern); pos != std::string::npos;
+       pos = text.find(pattern, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+class TracingTest : public ::testing::Test {
+ protected:
+  void SetUp() override { ClearTrace(); }
+  void TearDown() override {
+    EnableTracing(false);
+    ClearTrace();
+  }
+};
+
+TEST_F(TracingTest, DisabledByDefault) {
+  EXPECT_FALSE(IsTracingEnabled());
+  { CORAL_TRACE_SPAN("disabled"); }
+  EXPECT_EQ(0, CountOccurrences(GetChromeTrace(), "disabled"));
+}
+
+TEST_F(TracingTest, RecordsSpans) {
+  EnableTracing(true);
+  {
+    CORAL_TRACE_SPAN("outer");
+    CORAL_TRACE_SPAN("inner");
+  }
+  const auto now = std::chrono::steady_clock::now();
+  AddTraceSpan("added", now, now + std::chrono::microseconds(1500));
+  const std::string trace = GetChromeTrace();
+  EXPECT_EQ(0, trace.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+  EXPECT_EQ(3, CountOccurrences(trace, "\"ph\":\"X\""));
+  EXPECT_EQ(1, CountOccurrences(trace, "\"name\":\"outer\""));
+  EXPECT_EQ(1, CountOccurrences(trace, "\"name\":\"inner\""));
+  EXPECT_EQ(1, CountOccurrences(trace, "\"dur\":1500.000"));
+}
+
+TEST_F(TracingTest, SpanStartedWhileDisabledIsDropped) {
+  {
+    CORAL_TRACE_SPAN("started_disabled");
+    EnableTracing(true);
+  }
+  EXPECT_EQ(0, CountOccurrences(GetChromeTrace(), "started_disabled"));
+}
+
+TEST_F(TracingTest, NamesThreads) {
+  EnableTracing(true);
+  std::thread thread([] {
+    SetTraceThreadName("worker \"1\"");
+    CORAL_TRACE_SPAN("in_thread");
+  });
+  thread.join();
+  const std::string trace = GetChromeTrace();
+  EXPECT_EQ(1, CountOccurrences(trace, "\"name\":\"in_thread\""));
+  EXPECT_EQ(1, CountOccurrences(
+                   trace, "\"args\":{\"name\":\"worker \\\"1\\\"\"}"));
+}
+
+TEST_F(TracingTest, KeepsLatestSpans) {
+  EnableTracing(true);
+  for (int i = 0; i < kTraceSpansPerThread + 10; ++i) {
+    CORAL_TRACE_SPAN("span");
+  }
+  EXPECT_EQ(kTraceSpansPerThread,
+            CountOccurrences(GetChromeTrace(), "\"name\":\"span\""));
+  ClearTrace();
+  EXPECT_EQ(0, CountOccurrences(GetChromeTrace(), "\"name\":\"span\""));
+}
+
+}  // namespace
+}  // namespace coral
@@ -99,7 +99,13 @@ function run_tests() {
     --test_data_dir="${ROOT_DIR}/qa_test/test_data"
   "${ROOT_DIR}/qa_test/${platform}"/edgetpu_resource_manager_test
   "${ROOT_DIR}/qa_test/${platform}"/edgetpu_resource_manager_benchmark
+  "${ROOT_DIR}/qa_test/${platform}"/simulated_edgetpu_manager_test \
+    --model_dir="${ROOT_DIR}/qa_test/test_data"
+  "${ROOT_DIR}/qa_test/${platform}"/inference_stats_test
+  "${ROOT_DIR}/qa_test/${platform}"/hot_swap_engine_test \
+    --model_dir="${ROOT_DIR}/qa_test/test_data"
   "${ROOT_DIR}/qa_test/${platform}"/version_test
+  "${ROOT_DIR}/qa_test/${platform}"/tracing_test
   "${ROOT_DIR}/qa_test/${platform}"/basic_engine_native_test \
     --model_dir="${ROOT_DIR}/qa_test/test_data" \
     --test_data_dir="${ROOT_DIR}/qa_test/test_data"
@@ -117,14 +123,55 @@ function run_tests() {
     --test_data_dir="${ROOT_DIR}/qa_test/test_data"
   "${ROOT_DIR}/qa_test/${platform}"/imprinting_engine_test \
     --imprinting_data_dir="${ROOT_DIR}/qa_test/imprinting_test_data"
+  "${ROOT_DIR}/qa_test/${platform}"/directory_enroller_test \
+    --imprinting_data_dir="${ROOT_DIR}/qa_test/imprinting_test_data"
+  "${ROOT_DIR}/qa_test/${platform}"/training_metadata_test
+  "${ROOT_DIR}/qa_test/${platform}"/flatbuffer_patcher_test
   "${ROOT_DIR}/qa_test/${platform}"/utils_test \
     --model_dir="${ROOT_DIR}/qa_test/test_data" \
     --test_data_dir="${ROOT_DIR}/qa_test/test_data"
+  "${ROOT_DIR}/qa_test/${platform}"/embedding_index_test
+  "${ROOT_DIR}/qa_test/${platform}"/embedding_index_benchmark
+  "${ROOT_DIR}/qa_test/${platform}"/softmax_regression_trainer_test \
+    --model_dir="${ROOT_DIR}/qa_test/test_data" \
+    --test_data_dir="${ROOT_DIR}/qa_test/test_data"
+  "${ROOT_DIR}/qa_test/${platform}"/softmax_regression_trainer_benchmark
+  "${ROOT_DIR}/qa_test/${platform}"/bounded_queue_test
+  "${ROOT_DIR}/qa_test/${platform}"/cascade_runner_test \
+    --model_dir="${ROOT_DIR}/qa_test/test_data" \
+    --test_data_dir="${ROOT_DIR}/qa_test/test_data"
+  "${ROOT_DIR}/qa_test/${platform}"/pipelined_model_runner_test \
+    --model_dir="${ROOT_DIR}/qa_test/test_data" \
+    --test_data_dir="${ROOT_DIR}/qa_test/test_data"
+  "${ROOT_DIR}/qa_test/${platform}"/stream_pipeline_test \
+    --model_dir="${ROOT_DIR}/qa_test/test_data" \
+    --test_data_dir="${ROOT_DIR}/qa_test/test_data"
+  "${ROOT_DIR}/qa_test/${platform}"/model_scheduler_test \
+    --model_dir="${ROOT_DIR}/qa_test/test_data" \
+    --test_data_dir="${ROOT_DIR}/qa_test/test_data"
+  "${ROOT_DIR}/qa_test/${platform}"/model_scheduler_benchmark \
+    --model_dir="${ROOT_DIR}/qa_test/test_data"
+  "${ROOT_DIR}/qa_test/${platform}"/placement_planner_test \
+    --model_dir="${ROOT_DIR}/qa_test/test_data" \
+    --test_data_dir="${ROOT_DIR}/qa_test/test_data"
+  "${ROOT_DIR}/qa_test/${platform}"/latency_histogram_test
+  "${ROOT_DIR}/qa_test/${platform}"/load_generator \
+    --model_dir="${ROOT_DIR}/qa_test/test_data" \
+    --duration_s=2
+  "${ROOT_DIR}/qa_test/${platform}"/host_kernels
+  "${ROOT_DIR}/qa_test/${platform}"/inference_server_test \
+    --model_dir="${ROOT_DIR}/qa_test/test_data"
   "${ROOT_DIR}/qa_test/${platform}"/posenet_benchmark \
     --posenet_model_dir="${ROOT_DIR}/qa_test/posenet_test_data"
   "${ROOT_DIR}/qa_test/${platform}"/posenet_test \
     --posenet_model_dir="${ROOT_DIR}/qa_test/posenet_test_data" \
     --posenet_data_dir="${ROOT_DIR}/qa_test/posenet_test_data"
+  "${ROOT_DIR}/qa_test/${platform}"/posenet_decoder_benchmark \
+    --posenet_model_dir="${ROOT_DIR}/qa_test/posenet_test_data" \
+    --posenet_data_dir="${ROOT_DIR}/qa_test/posenet_test_data"
+  "${ROOT_DIR}/qa_test/${platform}"/posenet_decoder_test \
+    --posenet_model_dir="${ROOT_DIR}/qa_test/posenet_test_data" \
+    --posenet_data_dir="${ROOT_DIR}/qa_test/posenet_test_data"
 }
 run_tests
 